@@ -904,7 +904,9 @@ ndk::ScopedAStatus Artd::mergeProfiles(const std::vector<ProfilePath>& in_profil
         .AddIfNonEmpty("--min-new-methods-percent-change=%s",
                        props_->GetOrEmpty("dalvik.vm.bgdexopt.new-methods-percent"))
         .AddIf(in_options.forceMerge, "--force-merge-and-analyze")
-        .AddIf(in_options.forBootImage, "--boot-image-merge");
+        .AddIf(in_options.forBootImage, "--boot-image-merge")
+        .AddIf(props_->GetBool("dalvik.vm.mappable-reference-profile", /*default_value=*/false),
+               "--mappable-reference-profile");
   }
 
   art_exec_args.Add("--keep-fds=%s", fd_logger.GetFds()).Add("--").Concat(std::move(args));
@@ -2047,6 +2047,38 @@ TEST_F(ArtdTest, mergeProfilesWithOptionsForceMerge) {
   EXPECT_THAT(output_profile.profilePath.tmpPath, Not(IsEmpty()));
 }
 
+TEST_F(ArtdTest, mergeProfilesMappableReferenceProfile) {
+  PrimaryCurProfilePath profile_0_path{
+      .userId = 0, .packageName = "com.android.foo", .profileName = "primary"};
+  std::string profile_0_file = OR_FATAL(BuildPrimaryCurProfilePath(profile_0_path));
+  CreateFile(profile_0_file, "def");
+
+  OutputProfile output_profile{.profilePath = tmp_profile_path_,
+                               .fsPermission = FsPermission{.uid = -1, .gid = -1}};
+  output_profile.profilePath.id = "";
+  output_profile.profilePath.tmpPath = "";
+
+  CreateFile(dex_file_);
+
+  EXPECT_CALL(*mock_props_, GetProperty("dalvik.vm.mappable-reference-profile"))
+      .WillOnce(Return("true"));
+  EXPECT_CALL(
+      *mock_exec_utils_,
+      DoExecAndReturnCode(WhenSplitBy("--", _, Contains("--mappable-reference-profile")), _, _))
+      .WillOnce(Return(ProfmanResult::kCompile));
+
+  bool result;
+  EXPECT_TRUE(artd_
+                  ->mergeProfiles({profile_0_path},
+                                  std::nullopt,
+                                  &output_profile,
+                                  {dex_file_},
+                                  /*in_options=*/{},
+                                  &result)
+                  .isOk());
+  EXPECT_TRUE(result);
+}
+
 TEST_F(ArtdTest, mergeProfilesWithOptionsDumpOnly) {
   PrimaryCurProfilePath profile_0_path{
       .userId = 0, .packageName = "com.android.foo", .profileName = "primary"};
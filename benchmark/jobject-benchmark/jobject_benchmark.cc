@@ -16,7 +16,11 @@
 
 #include "jni.h"
 
+#include <array>
+
+#include "base/array_ref.h"
 #include "jni/java_vm_ext.h"
+#include "jni/jni_env_ext-inl.h"
 #include "mirror/class-inl.h"
 #include "scoped_thread_state_change-inl.h"
 
@@ -34,6 +38,38 @@ extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeAddRemoveLocal(
   }
 }
 
+static constexpr size_t kLocalBatchSize = 64u;
+
+extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeAddRemoveLocalSequence(
+    JNIEnv* env, jobject jobj, jint reps) {
+  ScopedObjectAccess soa(env);
+  ObjPtr<mirror::Object> obj = soa.Decode<mirror::Object>(jobj);
+  CHECK(obj != nullptr);
+  std::array<jobject, kLocalBatchSize> refs;
+  for (jint i = 0; i < reps; ++i) {
+    for (jobject& ref : refs) {
+      ref = soa.Env()->AddLocalReference<jobject>(obj);
+    }
+    for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+      soa.Env()->DeleteLocalRef(*it);
+    }
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeAddRemoveLocalBatch(
+    JNIEnv* env, jobject jobj, jint reps) {
+  ScopedObjectAccess soa(env);
+  ObjPtr<mirror::Object> obj = soa.Decode<mirror::Object>(jobj);
+  CHECK(obj != nullptr);
+  std::array<ObjPtr<mirror::Object>, kLocalBatchSize> objs;
+  objs.fill(obj);
+  std::array<jobject, kLocalBatchSize> refs;
+  for (jint i = 0; i < reps; ++i) {
+    soa.Env()->AddLocalReferences(ArrayRef<const ObjPtr<mirror::Object>>(objs), refs.data());
+    soa.Env()->DeleteLocalRefs(ArrayRef<const jobject>(refs));
+  }
+}
+
 extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeDecodeLocal(
     JNIEnv* env, jobject jobj, jint reps) {
   ScopedObjectAccess soa(env);
@@ -19,6 +19,8 @@ public class JObjectBenchmark {
     // Make sure to link methods before benchmark starts.
     System.loadLibrary("artbenchmark");
     timeAddRemoveLocal(1);
+    timeAddRemoveLocalSequence(1);
+    timeAddRemoveLocalBatch(1);
     timeDecodeLocal(1);
     timeAddRemoveGlobal(1);
     timeDecodeGlobal(1);
@@ -28,6 +30,9 @@ public class JObjectBenchmark {
   }
 
   public native void timeAddRemoveLocal(int reps);
+  // Add and remove 64 local references per rep, one at a time or as a batch.
+  public native void timeAddRemoveLocalSequence(int reps);
+  public native void timeAddRemoveLocalBatch(int reps);
   public native void timeDecodeLocal(int reps);
   public native void timeAddRemoveGlobal(int reps);
   public native void timeDecodeGlobal(int reps);
@@ -56,3 +56,37 @@ extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureLon
   }
   return ret;
 }
+
+// Same as above, but with GetPrimitiveArrayCritical which avoids the copy and, for movable
+// arrays, only blocks the GC thread flip while the array is accessed.
+template <typename T>
+static jlong MeasureArrayCritical(JNIEnv* env, int reps, jarray arr) {
+  jlong ret = 0;
+  jsize size = env->GetArrayLength(arr);
+  for (jint i = 0; i < reps; ++i) {
+    T* data = reinterpret_cast<T*>(env->GetPrimitiveArrayCritical(arr, nullptr));
+    ret += data[0] + data[size - 1];
+    env->ReleasePrimitiveArrayCritical(arr, data, JNI_ABORT);
+  }
+  return ret;
+}
+
+extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureByteArrayCritical(
+    JNIEnv* env, jclass, int reps, jbyteArray arr) {
+  return MeasureArrayCritical<jbyte>(env, reps, arr);
+}
+
+extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureShortArrayCritical(
+    JNIEnv* env, jclass, int reps, jshortArray arr) {
+  return MeasureArrayCritical<jshort>(env, reps, arr);
+}
+
+extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureIntArrayCritical(
+    JNIEnv* env, jclass, int reps, jintArray arr) {
+  return MeasureArrayCritical<jint>(env, reps, arr);
+}
+
+extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureLongArrayCritical(
+    JNIEnv* env, jclass, int reps, jlongArray arr) {
+  return MeasureArrayCritical<jlong>(env, reps, arr);
+}
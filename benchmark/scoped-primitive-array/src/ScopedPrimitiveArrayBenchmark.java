@@ -20,6 +20,11 @@ public class ScopedPrimitiveArrayBenchmark {
   static native long measureShortArray(int reps, short[] arr);
   static native long measureIntArray(int reps, int[] arr);
   static native long measureLongArray(int reps, long[] arr);
+  // Same, but by using GetPrimitiveArrayCritical.
+  static native long measureByteArrayCritical(int reps, byte[] arr);
+  static native long measureShortArrayCritical(int reps, short[] arr);
+  static native long measureIntArrayCritical(int reps, int[] arr);
+  static native long measureLongArrayCritical(int reps, long[] arr);
 
   static final int smallLength = 16;
   static final int mediumLength = 256;
@@ -85,6 +90,54 @@ public class ScopedPrimitiveArrayBenchmark {
     measureLongArray(reps, largeLongs);
   }
 
+  public void timeSmallBytesCritical(int reps) {
+    measureByteArrayCritical(reps, smallBytes);
+  }
+
+  public void timeMediumBytesCritical(int reps) {
+    measureByteArrayCritical(reps, mediumBytes);
+  }
+
+  public void timeLargeBytesCritical(int reps) {
+    measureByteArrayCritical(reps, largeBytes);
+  }
+
+  public void timeSmallShortsCritical(int reps) {
+    measureShortArrayCritical(reps, smallShorts);
+  }
+
+  public void timeMediumShortsCritical(int reps) {
+    measureShortArrayCritical(reps, mediumShorts);
+  }
+
+  public void timeLargeShortsCritical(int reps) {
+    measureShortArrayCritical(reps, largeShorts);
+  }
+
+  public void timeSmallIntsCritical(int reps) {
+    measureIntArrayCritical(reps, smallInts);
+  }
+
+  public void timeMediumIntsCritical(int reps) {
+    measureIntArrayCritical(reps, mediumInts);
+  }
+
+  public void timeLargeIntsCritical(int reps) {
+    measureIntArrayCritical(reps, largeInts);
+  }
+
+  public void timeSmallLongsCritical(int reps) {
+    measureLongArrayCritical(reps, smallLongs);
+  }
+
+  public void timeMediumLongsCritical(int reps) {
+    measureLongArrayCritical(reps, mediumLongs);
+  }
+
+  public void timeLargeLongsCritical(int reps) {
+    measureLongArrayCritical(reps, largeLongs);
+  }
+
   {
     System.loadLibrary("artbenchmark");
   }
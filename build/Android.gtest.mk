@@ -131,6 +131,7 @@ endif
 
 ART_TEST_MODULES_TARGET := $(ART_TEST_MODULES_COMMON) \
     art_odrefresh_tests \
+    art_perfetto_hprof_tests \
 
 ART_TEST_MODULES_HOST := $(ART_TEST_MODULES_COMMON) \
     art_libartpalette_tests \
@@ -725,6 +725,7 @@ class TestingTargetChecker:
     self._checker.check_art_test_executable('art_libprofile_tests')
     self._checker.check_art_test_executable('art_oatdump_tests')
     self._checker.check_art_test_executable('art_odrefresh_tests', MULTILIB_FIRST)
+    self._checker.check_art_test_executable('art_perfetto_hprof_tests', MULTILIB_FIRST)
     self._checker.check_art_test_executable('art_profman_tests')
     self._checker.check_art_test_executable('art_runtime_tests')
     self._checker.check_art_test_executable('art_sigchain_tests')
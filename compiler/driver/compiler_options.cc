@@ -77,8 +77,11 @@ CompilerOptions::CompilerOptions()
       count_hotness_in_compiled_code_(false),
       resolve_startup_const_strings_(false),
       initialize_app_image_classes_(false),
+      startup_ordered_code_layout_(false),
+      share_verifier_type_resolution_(true),
       check_profiled_methods_(ProfileMethodsCheck::kNone),
       max_image_block_size_(std::numeric_limits<uint32_t>::max()),
+      image_compression_dictionary_size_(0u),
       passes_to_run_(nullptr) {
 }
 
@@ -350,6 +350,14 @@ class CompilerOptions final {
     return resolve_startup_const_strings_;
   }
 
+  bool StartupOrderedCodeLayout() const {
+    return startup_ordered_code_layout_;
+  }
+
+  bool ShareVerifierTypeResolution() const {
+    return share_verifier_type_resolution_;
+  }
+
   ProfileMethodsCheck CheckProfiledMethodsCompiled() const {
     return check_profiled_methods_;
   }
@@ -362,6 +370,14 @@ class CompilerOptions final {
     max_image_block_size_ = size;
   }
 
+  uint32_t ImageCompressionDictionarySize() const {
+    return image_compression_dictionary_size_;
+  }
+
+  void SetImageCompressionDictionarySize(uint32_t size) {
+    image_compression_dictionary_size_ = size;
+  }
+
   bool InitializeAppImageClasses() const {
     return initialize_app_image_classes_;
   }
@@ -465,6 +481,13 @@ class CompilerOptions final {
   // Whether we attempt to run class initializers for app image classes.
   bool initialize_app_image_classes_;
 
+  // Whether compiled code of startup methods is laid out in the order in which they were first
+  // executed, as recorded in the profile.
+  bool startup_ordered_code_layout_;
+
+  // Whether the verifier threads of a dex file share the types that failed to resolve.
+  bool share_verifier_type_resolution_;
+
   // When running profile-guided compilation, check that methods intended to be compiled end
   // up compiled and are not punted.
   ProfileMethodsCheck check_profiled_methods_;
@@ -472,6 +495,9 @@ class CompilerOptions final {
   // Maximum solid block size in the generated image.
   uint32_t max_image_block_size_;
 
+  // Maximum size of the dictionary for zstd compressed images, 0 for no dictionary.
+  uint32_t image_compression_dictionary_size_;
+
   // If not null, specifies optimization passes which will be run instead of defaults.
   // Note that passes_to_run_ is not checked for correctness and providing an incorrect
   // list of passes can lead to unexpected compiler behaviour. This is caused by dependencies
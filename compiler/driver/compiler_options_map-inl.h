@@ -88,10 +88,15 @@ inline bool ReadCompilerOptions(Base& map, CompilerOptions* options, std::string
   }
   map.AssignIfExists(Base::ResolveStartupConstStrings, &options->resolve_startup_const_strings_);
   map.AssignIfExists(Base::InitializeAppImageClasses, &options->initialize_app_image_classes_);
+  map.AssignIfExists(Base::StartupOrderedCodeLayout, &options->startup_ordered_code_layout_);
+  map.AssignIfExists(Base::ShareVerifierTypeResolution,
+                     &options->share_verifier_type_resolution_);
   if (map.Exists(Base::CheckProfiledMethods)) {
     options->check_profiled_methods_ = *map.Get(Base::CheckProfiledMethods);
   }
   map.AssignIfExists(Base::MaxImageBlockSize, &options->max_image_block_size_);
+  map.AssignIfExists(Base::ImageCompressionDictionarySize,
+                     &options->image_compression_dictionary_size_);
 
   if (map.Exists(Base::DumpTimings)) {
     options->dump_timings_ = true;
@@ -228,6 +233,21 @@ NO_INLINE void AddCompilerOptionsArgumentParserOptions(Builder& b) {
           .WithValueMap({{"false", false}, {"true", true}})
           .IntoKey(Map::InitializeAppImageClasses)
 
+      .Define("--startup-ordered-code-layout=_")
+          .template WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .WithHelp("If true and the profile records the order in which startup methods were\n"
+                    "first executed, lay out their compiled code in that order.")
+          .IntoKey(Map::StartupOrderedCodeLayout)
+
+      .Define("--share-verifier-type-resolution=_")
+          .template WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .WithHelp("If true (the default), the verifier threads of a dex file share the types\n"
+                    "that failed to resolve. Verification times are logged with\n"
+                    "-verbose:compiler for comparison.")
+          .IntoKey(Map::ShareVerifierTypeResolution)
+
       .Define("--verbose-methods=_")
           .template WithType<ParseStringList<','>>()
           .WithHelp("Restrict the dumped CFG data to methods whose name is listed.\n"
@@ -238,6 +258,12 @@ NO_INLINE void AddCompilerOptionsArgumentParserOptions(Builder& b) {
           .template WithType<unsigned int>()
           .WithHelp("Maximum solid block size for compressed images.")
           .IntoKey(Map::MaxImageBlockSize)
+
+      .Define("--image-compression-dictionary-size=_")
+          .template WithType<unsigned int>()
+          .WithHelp("Maximum size of a dictionary trained on the image data and shared by all\n"
+                    "blocks of a zstd compressed image. Defaults to 0, i.e. no dictionary.")
+          .IntoKey(Map::ImageCompressionDictionarySize)
       // Obsolete flags
       .Ignore({
         "--num-dex-methods=_",
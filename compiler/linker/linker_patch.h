@@ -282,7 +282,8 @@ class LinkerPatch {
            patch_type_ == Type::kPublicTypeBssEntry ||
            patch_type_ == Type::kPackageTypeBssEntry ||
            patch_type_ == Type::kStringRelative ||
-           patch_type_ == Type::kStringBssEntry);
+           patch_type_ == Type::kStringBssEntry ||
+           patch_type_ == Type::kMethodTypeBssEntry);
     return pc_insn_offset_;
   }
 
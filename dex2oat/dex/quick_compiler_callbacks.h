@@ -18,6 +18,7 @@
 #define ART_DEX2OAT_DEX_QUICK_COMPILER_CALLBACKS_H_
 
 #include "compiler_callbacks.h"
+#include "verifier/shared_reg_type_cache.h"
 #include "verifier/verifier_deps.h"
 
 namespace art {
@@ -48,6 +49,18 @@ class QuickCompilerCallbacks final : public CompilerCallbacks {
     verifier_deps_.reset(deps);
   }
 
+  verifier::SharedRegTypeCache* GetSharedRegTypeCache(const DexFile* dex_file) const override {
+    return (shared_reg_type_cache_ != nullptr && shared_reg_type_cache_->GetDexFile() == dex_file)
+        ? shared_reg_type_cache_
+        : nullptr;
+  }
+
+  // The cache is shared by the verifiers of one dex file and must not be changed while
+  // verification is running.
+  void SetSharedRegTypeCache(verifier::SharedRegTypeCache* cache) override {
+    shared_reg_type_cache_ = cache;
+  }
+
   void SetVerificationResults(VerificationResults* verification_results) {
     verification_results_ = verification_results;
   }
@@ -75,6 +88,7 @@ class QuickCompilerCallbacks final : public CompilerCallbacks {
   bool does_class_unloading_ = false;
   CompilerDriver* compiler_driver_ = nullptr;
   std::unique_ptr<verifier::VerifierDeps> verifier_deps_;
+  verifier::SharedRegTypeCache* shared_reg_type_cache_ = nullptr;
   const std::vector<const DexFile*>* dex_files_;
 };
 
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <zlib.h>
 
 #include <algorithm>
 #include <forward_list>
@@ -80,6 +81,7 @@
 #include "dex/quick_compiler_callbacks.h"
 #include "dex/verification_results.h"
 #include "dex2oat_options.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
 #include "driver/compiler_options_map-inl.h"
@@ -853,6 +855,10 @@ class Dex2Oat final {
       Usage("--dirty-image-objects and --dirty-image-objects-fd should not be both specified");
     }
 
+    if (!hot_image_objects_filenames_.empty() && !hot_image_objects_fds_.empty()) {
+      Usage("--hot-image-objects and --hot-image-objects-fd should not be both specified");
+    }
+
     if (!preloaded_classes_files_.empty() && !preloaded_classes_fds_.empty()) {
       Usage("--preloaded-classes and --preloaded-classes-fds should not be both specified");
     }
@@ -1090,6 +1096,8 @@ class Dex2Oat final {
     AssignIfExists(args, M::OutputVdexFd, &output_vdex_fd_);
     AssignIfExists(args, M::InputVdex, &input_vdex_);
     AssignIfExists(args, M::OutputVdex, &output_vdex_);
+    AssignIfExists(args, M::InputCompiledMethods, &input_compiled_methods_);
+    AssignIfExists(args, M::OutputCompiledMethods, &output_compiled_methods_);
     AssignIfExists(args, M::DmFd, &dm_fd_);
     AssignIfExists(args, M::DmFile, &dm_file_location_);
     AssignIfExists(args, M::OatFd, &oat_fd_);
@@ -1117,6 +1125,8 @@ class Dex2Oat final {
     AssignIfExists(args, M::ClasspathDir, &classpath_dir_);
     AssignIfExists(args, M::DirtyImageObjects, &dirty_image_objects_filenames_);
     AssignIfExists(args, M::DirtyImageObjectsFd, &dirty_image_objects_fds_);
+    AssignIfExists(args, M::HotImageObjects, &hot_image_objects_filenames_);
+    AssignIfExists(args, M::HotImageObjectsFd, &hot_image_objects_fds_);
     AssignIfExists(args, M::ImageFormat, &image_storage_mode_);
     AssignIfExists(args, M::CompilationReason, &compilation_reason_);
     AssignTrueIfExists(args, M::CheckLinkageConditions, &check_linkage_conditions_);
@@ -1462,7 +1472,14 @@ class Dex2Oat final {
   dex2oat::ReturnCode Setup() {
     TimingLogger::ScopedTiming t("dex2oat Setup", timings_);
 
-    if (!PrepareDirtyObjects()) {
+    if (!PrepareImageObjects("dirty",
+                             &dirty_image_objects_fds_,
+                             dirty_image_objects_filenames_,
+                             &dirty_image_objects_) ||
+        !PrepareImageObjects("hot",
+                             &hot_image_objects_fds_,
+                             hot_image_objects_filenames_,
+                             &hot_image_objects_)) {
       return dex2oat::ReturnCode::kOther;
     }
 
@@ -1997,11 +2014,79 @@ class Dex2Oat final {
                         timings_,
                         &compiler_options_->image_classes_);
     callbacks_->SetVerificationResults(nullptr);  // Should not be needed anymore.
+    std::unique_ptr<CompiledMethodCache> compiled_method_cache = LoadCompiledMethodCache(dex_files);
     driver_->CompileAll(class_loader, dex_files, timings_);
+    if (compiled_method_cache != nullptr) {
+      SaveCompiledMethodCache(compiled_method_cache.get());
+    }
     driver_->FreeThreadPools();
     return class_loader;
   }
 
+  // Describes everything outside the compiled dex files that the compiled code depends on.
+  // A compiled method cache is only used if it was written for the same environment.
+  std::string GetCompiledMethodCacheEnvironment() const {
+    std::ostringstream oss;
+    oss << "oat-version=" << reinterpret_cast<const char*>(OatHeader::kOatVersion.data())
+        << "\ndebug-build=" << kIsDebugBuild
+        << "\nisa=" << GetInstructionSetString(compiler_options_->GetInstructionSet())
+        << "\nisa-features=" << compiler_options_->GetInstructionSetFeatures()->GetFeatureString()
+        << "\ninline-max-code-units=" << compiler_options_->GetInlineMaxCodeUnits()
+        << "\ngenerate-debug-info=" << compiler_options_->GetGenerateDebugInfo()
+        << "\ngenerate-mini-debug-info=" << compiler_options_->GetGenerateMiniDebugInfo()
+        << "\nimplicit-null-checks=" << compiler_options_->GetImplicitNullChecks()
+        << "\nimplicit-so-checks=" << compiler_options_->GetImplicitStackOverflowChecks()
+        << "\nno-inline-from=" << no_inline_from_string_
+        // The filter may be changed after the key-value store is filled in, see
+        // `UpdateCompilerOptionsBasedOnProfile()`.
+        << "\ncompiler-filter="
+        << CompilerFilter::NameOfFilter(compiler_options_->GetCompilerFilter())
+        << "\nprofile-checksum=" << profile_checksum_;
+    for (const auto& [key, value] : *key_value_store_) {
+      // The command line and the compilation reason do not affect the generated code.
+      if (key != OatHeader::kDex2OatCmdLineKey && key != OatHeader::kCompilationReasonKey) {
+        oss << "\n" << key << "=" << value;
+      }
+    }
+    return oss.str();
+  }
+
+  std::unique_ptr<CompiledMethodCache> LoadCompiledMethodCache(
+      const std::vector<const DexFile*>& dex_files) {
+    if (input_compiled_methods_.empty() && output_compiled_methods_.empty()) {
+      return nullptr;
+    }
+    if (IsImage()) {
+      // Image compilations embed code addresses and initialized classes in the image.
+      LOG(WARNING) << "Compiled method cache is not supported when compiling an image";
+      return nullptr;
+    }
+    TimingLogger::ScopedTiming t("Load compiled method cache", timings_);
+    std::unique_ptr<CompiledMethodCache> cache = std::make_unique<CompiledMethodCache>(
+        driver_.get(), dex_files, GetCompiledMethodCacheEnvironment());
+    if (!input_compiled_methods_.empty()) {
+      std::string error_msg;
+      if (!cache->Load(input_compiled_methods_, &error_msg)) {
+        LOG(WARNING) << error_msg << ", compiling all methods";
+      }
+    }
+    driver_->SetCompiledMethodCache(cache.get());
+    return cache;
+  }
+
+  void SaveCompiledMethodCache(CompiledMethodCache* cache) {
+    driver_->SetCompiledMethodCache(nullptr);
+    VLOG(compiler) << "Compiled method cache: " << cache->GetNumberOfHits() << " reused, "
+                   << cache->GetNumberOfMisses() << " compiled";
+    if (!output_compiled_methods_.empty()) {
+      TimingLogger::ScopedTiming t("Save compiled method cache", timings_);
+      std::string error_msg;
+      if (!cache->Save(output_compiled_methods_, &error_msg)) {
+        LOG(WARNING) << error_msg;
+      }
+    }
+  }
+
   // Notes on the interleaving of creating the images and oat files to
   // ensure the references between the two are correct.
   //
@@ -2092,7 +2177,8 @@ class Dex2Oat final {
                                                   oat_filenames_,
                                                   dex_file_oat_index_map_,
                                                   class_loader,
-                                                  dirty_image_objects_.get()));
+                                                  dirty_image_objects_.get(),
+                                                  hot_image_objects_.get()));
 
       // We need to prepare method offsets in the image address space for resolving linker patches.
       TimingLogger::ScopedTiming t2("dex2oat Prepare image address space", timings_);
@@ -2359,6 +2445,26 @@ class Dex2Oat final {
     return DoProfileGuidedOptimizations();
   }
 
+  // Folds the contents of the profile `fd` into `profile_checksum_`. Hotness and inlining
+  // decisions depend on the profile, so the compiled method cache is keyed on it. The file
+  // offset is left untouched for the subsequent `ProfileCompilationInfo::Load()`.
+  bool UpdateProfileChecksum(int fd) {
+    std::vector<uint8_t> buffer(64 * KB);
+    off_t offset = 0;
+    while (true) {
+      ssize_t bytes_read = TEMP_FAILURE_RETRY(pread(fd, buffer.data(), buffer.size(), offset));
+      if (bytes_read < 0) {
+        PLOG(ERROR) << "Cannot read profile";
+        return false;
+      }
+      if (bytes_read == 0) {
+        return true;
+      }
+      profile_checksum_ = crc32(profile_checksum_, buffer.data(), bytes_read);
+      offset += bytes_read;
+    }
+  }
+
   bool LoadProfile() {
     DCHECK(HasProfileInput());
     profile_load_attempted_ = true;
@@ -2407,7 +2513,11 @@ class Dex2Oat final {
       new_profile_keys.insert(std::make_pair(profile_key, checksum));
       return true;
     };
+    profile_checksum_ = 0u;
     for (const std::unique_ptr<File>& profile_file : profile_files) {
+      if (!UpdateProfileChecksum(profile_file->Fd())) {
+        return false;
+      }
       if (!profile_compilation_info_->Load(profile_file->Fd(),
                                            /*merge_classes=*/ true,
                                            filter_fn)) {
@@ -2533,25 +2643,30 @@ class Dex2Oat final {
     return dex_files_size >= very_large_threshold_;
   }
 
-  bool PrepareDirtyObjects() {
-    if (!dirty_image_objects_fds_.empty()) {
-      dirty_image_objects_ = std::make_unique<std::vector<std::string>>();
-      for (int fd : dirty_image_objects_fds_) {
-        if (!ReadCommentedInputFromFd(fd, nullptr, dirty_image_objects_.get())) {
-          LOG(ERROR) << "Failed to create list of dirty objects from fd " << fd;
+  // Reads a list of image objects (dirty or hot, see --dirty-image-objects and
+  // --hot-image-objects) from the given fds or files.
+  static bool PrepareImageObjects(const char* kind,
+                                  /*inout*/ std::vector<int>* fds,
+                                  const std::vector<std::string>& filenames,
+                                  /*out*/ std::unique_ptr<std::vector<std::string>>* objects) {
+    if (!fds->empty()) {
+      *objects = std::make_unique<std::vector<std::string>>();
+      for (int fd : *fds) {
+        if (!ReadCommentedInputFromFd(fd, nullptr, objects->get())) {
+          LOG(ERROR) << "Failed to create list of " << kind << " objects from fd " << fd;
           return false;
         }
       }
       // Close since we won't need it again.
-      for (int fd : dirty_image_objects_fds_) {
+      for (int fd : *fds) {
         close(fd);
       }
-      dirty_image_objects_fds_.clear();
-    } else if (!dirty_image_objects_filenames_.empty()) {
-      dirty_image_objects_ = std::make_unique<std::vector<std::string>>();
-      for (const std::string& file : dirty_image_objects_filenames_) {
-        if (!ReadCommentedInputFromFile(file.c_str(), nullptr, dirty_image_objects_.get())) {
-          LOG(ERROR) << "Failed to create list of dirty objects from '" << file << "'";
+      fds->clear();
+    } else if (!filenames.empty()) {
+      *objects = std::make_unique<std::vector<std::string>>();
+      for (const std::string& file : filenames) {
+        if (!ReadCommentedInputFromFile(file.c_str(), nullptr, objects->get())) {
+          LOG(ERROR) << "Failed to create list of " << kind << " objects from '" << file << "'";
           return false;
         }
       }
@@ -2784,7 +2899,9 @@ class Dex2Oat final {
     }
     if (!image_writer_->Write(IsAppImage() ? app_image_fd_ : image_fd_,
                               image_filenames_,
-                              IsAppImage() ? 1u : dex_locations_.size())) {
+                              IsAppImage() ? 1u : dex_locations_.size(),
+                              thread_count_,
+                              timings_)) {
       LOG(ERROR) << "Failure during image file creation";
       return false;
     }
@@ -2939,6 +3056,8 @@ class Dex2Oat final {
   std::string input_vdex_;
   std::string output_vdex_;
   std::unique_ptr<VdexFile> input_vdex_file_;
+  std::string input_compiled_methods_;
+  std::string output_compiled_methods_;
   int dm_fd_;
   std::string dm_file_location_;
   std::unique_ptr<ZipArchive> dm_file_;
@@ -2958,6 +3077,9 @@ class Dex2Oat final {
   std::vector<std::string> dirty_image_objects_filenames_;
   std::vector<int> dirty_image_objects_fds_;
   std::unique_ptr<std::vector<std::string>> dirty_image_objects_;
+  std::vector<std::string> hot_image_objects_filenames_;
+  std::vector<int> hot_image_objects_fds_;
+  std::unique_ptr<std::vector<std::string>> hot_image_objects_;
   std::unique_ptr<std::vector<std::string>> passes_to_run_;
   bool is_host_;
   std::string android_root_;
@@ -3028,6 +3150,9 @@ class Dex2Oat final {
   // Whether or we attempted to load the profile (if given).
   bool profile_load_attempted_;
 
+  // CRC32 of the contents of all input profiles, for the compiled method cache environment.
+  uint32_t profile_checksum_ = 0u;
+
   // Whether PaletteNotify{Start,End}Dex2oatCompilation should be called.
   bool should_report_dex2oat_compilation_;
 
@@ -268,6 +268,25 @@ TEST_F(Dex2oatImageTest, TestModesAndFilters) {
     }
     std::cout << "Dirty image object sizes " << image_classes_sizes << std::endl;
   }
+  // Test hot image objects. Only the order of objects changes, the compiled code does not.
+  {
+    ScratchFile classes;
+    uint32_t sort_key = 0u;
+    VisitDexes(libcore_dexes_array,
+               VoidFunctor(),
+               [&](TypeReference ref) {
+      WriteLine(classes.GetFile(),
+                std::string(ref.dex_file->GetTypeDescriptorView(ref.TypeIndex())) + " " +
+                    std::to_string(sort_key++));
+    }, /*method_frequency=*/ 1u, /*class_frequency=*/ kTypeFrequency);
+    ImageSizes hot_objects_sizes = CompileImageAndGetSizes(
+        dex_files,
+        {"--hot-image-objects=" + classes.GetFilename()});
+    classes.Close();
+    std::cout << "Hot image object sizes " << hot_objects_sizes << std::endl;
+    EXPECT_EQ(hot_objects_sizes.oat_size, base_sizes.oat_size);
+    EXPECT_EQ(hot_objects_sizes.vdex_size, base_sizes.vdex_size);
+  }
 }
 
 TEST_F(Dex2oatImageTest, TestExtension) {
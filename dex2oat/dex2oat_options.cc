@@ -125,6 +125,16 @@ static void AddGeneratedArtifactMappings(Builder& builder) {
           .WithType<std::string>()
           .WithHelp("specifies the vdex output destination via a filename.")
           .IntoKey(M::OutputVdex)
+      .Define("--input-compiled-methods=_")
+          .WithType<std::string>()
+          .WithHelp("specifies the compiled method cache written by a previous compilation.\n"
+                    "Methods whose code, dependencies and compiler environment are unchanged\n"
+                    "are copied from it instead of being recompiled.")
+          .IntoKey(M::InputCompiledMethods)
+      .Define("--output-compiled-methods=_")
+          .WithType<std::string>()
+          .WithHelp("specifies where to write the compiled method cache for later compilations.")
+          .IntoKey(M::OutputCompiledMethods)
       .Define("--dm-fd=_")
           .WithType<int>()
           .WithHelp("specifies the dm output destination via a file descriptor.")
@@ -203,6 +213,18 @@ static void AddImageMappings(Builder& builder) {
           .WithHelp("Specify a file descriptor for reading the list of known dirty objects in\n"
                     "the image. The image writer will group them together")
           .IntoKey(M::DirtyImageObjectsFd)
+      .Define("--hot-image-objects=_")
+          .WithType<std::vector<std::string>>().AppendValues()
+          .WithHelp("list of objects in the image that are accessed during startup, in the same\n"
+                    "format as --dirty-image-objects. The image writer will place them, and the\n"
+                    "fields and methods of listed classes, first in their bins, ordered by the\n"
+                    "sort key.")
+          .IntoKey(M::HotImageObjects)
+      .Define("--hot-image-objects-fd=_")
+          .WithType<std::vector<int>>().AppendValues()
+          .WithHelp("Specify a file descriptor for reading the list of objects in the image that\n"
+                    "are accessed during startup.")
+          .IntoKey(M::HotImageObjectsFd)
       .Define("--updatable-bcp-packages-file=_")
           .WithType<std::string>()
           .WithHelp("Deprecated. No longer takes effect.")
@@ -215,9 +237,10 @@ static void AddImageMappings(Builder& builder) {
           .WithType<ImageHeader::StorageMode>()
           .WithValueMap({{"lz4", ImageHeader::kStorageModeLZ4},
                          {"lz4hc", ImageHeader::kStorageModeLZ4HC},
+                         {"zstd", ImageHeader::kStorageModeZstd},
                          {"uncompressed", ImageHeader::kStorageModeUncompressed}})
-          .WithHelp("Which format to store the image Defaults to uncompressed. Eg:"
-                    " --image-format=lz4")
+          .WithHelp("Which format to store the image: uncompressed, lz4, lz4hc or zstd."
+                    " Defaults to uncompressed. Eg: --image-format=lz4")
           .IntoKey(M::ImageFormat);
   // clang-format on
 }
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <map>
 #include <optional>
 #include <regex>
 #include <sstream>
@@ -1236,6 +1237,40 @@ TEST_F(Dex2oatDeterminism, UnloadCompile) {
       << unload_vdex_name << " " << no_unload_vdex_name;
 }
 
+// Sharing type resolution between the verifier threads must not change the verification
+// results. Run with -verbose:compiler to compare the verification times of both modes.
+TEST_F(Dex2oatDeterminism, SharedVerifierTypeResolution) {
+  std::string out_dir = GetScratchDir();
+  const std::string base_oat_name = out_dir + "/base.oat";
+  const std::string base_vdex_name = out_dir + "/base.vdex";
+  const std::string shared_vdex_name = out_dir + "/shared.vdex";
+  const std::string unshared_vdex_name = out_dir + "/unshared.vdex";
+  ASSERT_THAT(GenerateOdexForTestWithStatus(GetLibCoreDexFileNames(),
+                                            base_oat_name,
+                                            CompilerFilter::Filter::kVerify,
+                                            {"--force-determinism",
+                                             "--avoid-storing-invocation",
+                                             "--share-verifier-type-resolution=true"}),
+              HasValue(0));
+  Copy(base_vdex_name, shared_vdex_name);
+  ASSERT_THAT(GenerateOdexForTestWithStatus(GetLibCoreDexFileNames(),
+                                            base_oat_name,
+                                            CompilerFilter::Filter::kVerify,
+                                            {"--force-determinism",
+                                             "--avoid-storing-invocation",
+                                             "--share-verifier-type-resolution=false"}),
+              HasValue(0));
+  Copy(base_vdex_name, unshared_vdex_name);
+  std::unique_ptr<File> shared_vdex(OS::OpenFileForReading(shared_vdex_name.c_str()));
+  std::unique_ptr<File> unshared_vdex(OS::OpenFileForReading(unshared_vdex_name.c_str()));
+  ASSERT_TRUE(shared_vdex != nullptr);
+  ASSERT_TRUE(unshared_vdex != nullptr);
+  EXPECT_GT(shared_vdex->GetLength(), 0u);
+  EXPECT_EQ(shared_vdex->GetLength(), unshared_vdex->GetLength());
+  EXPECT_EQ(shared_vdex->Compare(unshared_vdex.get()), 0)
+      << shared_vdex_name << " " << unshared_vdex_name;
+}
+
 class Dex2oatVerifierAbort : public Dex2oatTest {};
 
 TEST_F(Dex2oatVerifierAbort, HardFail) {
@@ -2085,4 +2120,94 @@ TEST_F(Dex2oatTest, LoadOutOfDateOatFile) {
   }
 }
 
+// With --startup-ordered-code-layout, the methods in the profile's startup order are laid out
+// first, in that order, ahead of the hotness bins.
+TEST_F(Dex2oatTest, StartupOrderedCodeLayout) {
+  using Hotness = ProfileCompilationInfo::MethodHotness;
+  std::unique_ptr<const DexFile> dex(OpenTestDexFile("ManyMethods"));
+  const dex::TypeId* type_id = dex->FindTypeId("LManyMethods;");
+  ASSERT_TRUE(type_id != nullptr);
+  const dex::ClassDef* class_def = dex->FindClassDef(dex->GetIndexForTypeId(*type_id));
+  ASSERT_TRUE(class_def != nullptr);
+  std::map<std::string, uint32_t> method_indexes;
+  for (const ClassAccessor::Method& method : ClassAccessor(*dex, *class_def).GetMethods()) {
+    method_indexes.emplace(dex->GetMethodName(method.GetIndex()), method.GetIndex());
+  }
+  // The startup methods are not in method index order, and they come after the methods that are
+  // only hot in the hotness order.
+  const std::vector<std::string> startup_order = {"Print5", "Print1", "Print3"};
+  const std::vector<std::string> hot_methods = {"Print0", "Print2", "Print4"};
+  ScratchFile profile_file;
+  {
+    ProfileCompilationInfo info;
+    for (const std::string& name : hot_methods) {
+      ASSERT_TRUE(method_indexes.find(name) != method_indexes.end()) << name;
+      MethodReference ref(dex.get(), method_indexes[name]);
+      ASSERT_TRUE(info.AddMethod(ProfileMethodInfo(ref), Hotness::kFlagHot));
+    }
+    for (const std::string& name : startup_order) {
+      ASSERT_TRUE(method_indexes.find(name) != method_indexes.end()) << name;
+      MethodReference ref(dex.get(), method_indexes[name]);
+      ASSERT_TRUE(info.AddMethod(ProfileMethodInfo(ref),
+                                 static_cast<Hotness::Flag>(Hotness::kFlagHot |
+                                                            Hotness::kFlagStartup)));
+      ASSERT_TRUE(info.AddStartupSequenceMethod(ref));
+    }
+    ASSERT_TRUE(info.Save(profile_file.GetFd()));
+    ASSERT_EQ(0, profile_file.GetFile()->Flush());
+  }
+
+  auto get_code_offsets = [&](bool startup_ordered, std::map<std::string, uint32_t>* offsets) {
+    const std::string odex_location = GetScratchDir() + "/base.odex";
+    ASSERT_TRUE(GenerateOdexForTest(
+        dex->GetLocation(),
+        odex_location,
+        CompilerFilter::Filter::kSpeedProfile,
+        {"--profile-file=" + profile_file.GetFilename(),
+         "--deduplicate-code=false",
+         std::string("--startup-ordered-code-layout=") + (startup_ordered ? "true" : "false")}));
+    std::string error_msg;
+    std::unique_ptr<OatFile> odex_file(OatFile::Open(/*zip_fd=*/-1,
+                                                     odex_location,
+                                                     odex_location,
+                                                     /*executable=*/false,
+                                                     /*low_4gb=*/false,
+                                                     dex->GetLocation(),
+                                                     &error_msg));
+    ASSERT_TRUE(odex_file != nullptr) << error_msg;
+    ASSERT_EQ(1u, odex_file->GetOatDexFiles().size());
+    OatFile::OatClass oat_class =
+        odex_file->GetOatDexFiles()[0]->GetOatClass(dex->GetIndexForClassDef(*class_def));
+    uint32_t class_method_index = 0u;
+    for (const ClassAccessor::Method& method : ClassAccessor(*dex, *class_def).GetMethods()) {
+      uint32_t code_offset = oat_class.GetOatMethod(class_method_index++).GetCodeOffset();
+      offsets->emplace(dex->GetMethodName(method.GetIndex()), code_offset);
+    }
+    for (const std::vector<std::string>* names : {&startup_order, &hot_methods}) {
+      for (const std::string& name : *names) {
+        EXPECT_NE(0u, (*offsets)[name]) << name << " is not compiled";
+      }
+    }
+  };
+
+  // By default, the bins of the hotness order decide.
+  std::map<std::string, uint32_t> offsets;
+  ASSERT_NO_FATAL_FAILURE(get_code_offsets(/*startup_ordered=*/ false, &offsets));
+  for (const std::string& hot_method : hot_methods) {
+    for (const std::string& startup_method : startup_order) {
+      EXPECT_LT(offsets[hot_method], offsets[startup_method]) << hot_method << startup_method;
+    }
+  }
+
+  // The startup order comes first.
+  offsets.clear();
+  ASSERT_NO_FATAL_FAILURE(get_code_offsets(/*startup_ordered=*/ true, &offsets));
+  for (size_t i = 1u; i != startup_order.size(); ++i) {
+    EXPECT_LT(offsets[startup_order[i - 1u]], offsets[startup_order[i]]) << startup_order[i];
+  }
+  for (const std::string& hot_method : hot_methods) {
+    EXPECT_LT(offsets[startup_order.back()], offsets[hot_method]) << hot_method;
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,933 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compiled_method_cache.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+#include "base/array_ref.h"
+#include "base/casts.h"
+#include "base/leb128.h"
+#include "base/os.h"
+#include "base/unix_file/fd_file.h"
+#include "class_status.h"
+#include "compiled_method.h"
+#include "compiler_driver.h"
+#include "dex/class_accessor-inl.h"
+#include "dex/code_item_accessors-inl.h"
+#include "dex/dex_file-inl.h"
+#include "dex/dex_file_exception_helpers.h"
+#include "dex/proto_reference.h"
+#include "dex/string_reference.h"
+#include "dex/type_reference.h"
+#include "driver/compiler_options.h"
+#include "linker/linker_patch.h"
+#include "thread-current-inl.h"
+
+namespace art {
+
+namespace {  // anonymous namespace
+
+constexpr char kCacheMagic[] = { 'c', 'm', 'c', '\n' };
+constexpr char kCacheVersion[] = { '0', '0', '2', '\0' };
+
+// Class hierarchies deeper than this are not hashed. This also guards against cycles in
+// malformed dex files, which are rejected later by the class linker anyway.
+constexpr size_t kMaxClassDepth = 64u;
+
+void AppendUint(std::string* out, uint64_t value) {
+  uint8_t buffer[10];
+  uint8_t* end = EncodeUnsignedLeb128(buffer, value);
+  out->append(reinterpret_cast<const char*>(buffer), end - buffer);
+}
+
+void AppendString(std::string* out, std::string_view value) {
+  AppendUint(out, value.size());
+  out->append(value);
+}
+
+void AppendData(std::string* out, ArrayRef<const uint8_t> data) {
+  AppendString(out, std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+uint64_t HashData(std::string_view data) {
+  const Bytef* bytes = reinterpret_cast<const Bytef*>(data.data());
+  uint32_t crc = crc32(crc32(0L, Z_NULL, 0), bytes, data.size());
+  uint32_t adler = adler32(adler32(0L, Z_NULL, 0), bytes, data.size());
+  return (static_cast<uint64_t>(crc) << 32) | adler;
+}
+
+std::string GetMethodNameAndSignature(const DexFile& dex_file, uint32_t method_idx) {
+  const dex::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  std::string result(dex_file.GetMethodNameView(method_id));
+  result += dex_file.GetMethodSignature(method_id).ToString();
+  return result;
+}
+
+void AppendMethodSymbol(const DexFile& dex_file, uint32_t method_idx, std::string* out) {
+  const dex::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  AppendString(out, dex_file.GetMethodDeclaringClassDescriptorView(method_id));
+  AppendString(out, dex_file.GetMethodNameView(method_id));
+  AppendString(out, dex_file.GetMethodSignature(method_id).ToString());
+}
+
+class CacheReader {
+ public:
+  explicit CacheReader(std::string_view data)
+      : ptr_(reinterpret_cast<const uint8_t*>(data.data())), end_(ptr_ + data.size()) {}
+
+  bool ReadUint(uint64_t* value) {
+    return DecodeUnsignedLeb128Checked(&ptr_, end_, value);
+  }
+
+  bool ReadString(std::string_view* value) {
+    uint64_t size;
+    if (!ReadUint(&size) || size > static_cast<size_t>(end_ - ptr_)) {
+      return false;
+    }
+    *value = std::string_view(reinterpret_cast<const char*>(ptr_), size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool ReadData(ArrayRef<const uint8_t>* value) {
+    std::string_view data;
+    if (!ReadString(&data)) {
+      return false;
+    }
+    *value = ArrayRef<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    return true;
+  }
+
+  size_t RemainingSize() const {
+    return end_ - ptr_;
+  }
+
+ private:
+  const uint8_t* ptr_;
+  const uint8_t* const end_;
+};
+
+const dex::StringId* FindString(const DexFile& dex_file, std::string_view value) {
+  return dex_file.FindStringId(std::string(value).c_str());
+}
+
+const dex::ProtoId* FindProto(const DexFile& dex_file, std::string_view signature) {
+  dex::TypeIndex return_type_idx;
+  std::vector<dex::TypeIndex> param_type_idxs;
+  if (!dex_file.CreateTypeList(signature, &return_type_idx, &param_type_idxs)) {
+    return nullptr;
+  }
+  return dex_file.FindProtoId(return_type_idx, param_type_idxs.data(), param_type_idxs.size());
+}
+
+bool ReadMethodSymbol(const DexFile& dex_file, CacheReader* reader, uint32_t* method_idx) {
+  std::string_view descriptor;
+  std::string_view name;
+  std::string_view signature;
+  if (!reader->ReadString(&descriptor) ||
+      !reader->ReadString(&name) ||
+      !reader->ReadString(&signature)) {
+    return false;
+  }
+  const dex::TypeId* type_id = dex_file.FindTypeId(descriptor);
+  const dex::StringId* name_id = FindString(dex_file, name);
+  const dex::ProtoId* proto_id = FindProto(dex_file, signature);
+  if (type_id == nullptr || name_id == nullptr || proto_id == nullptr) {
+    return false;
+  }
+  const dex::MethodId* method_id = dex_file.FindMethodId(*type_id, *name_id, *proto_id);
+  if (method_id == nullptr) {
+    return false;
+  }
+  *method_idx = dex_file.GetIndexForMethodId(*method_id);
+  return true;
+}
+
+// Writes `patch` with its target recorded symbolically. Returns false for patches that cannot be
+// remapped to a later compilation.
+bool AppendPatch(ArrayRef<const DexFile* const> dex_files,
+                 const linker::LinkerPatch& patch,
+                 std::string* out) {
+  using Type = linker::LinkerPatch::Type;
+  auto append_dex_file = [&](const DexFile* dex_file) {
+    auto it = std::find(dex_files.begin(), dex_files.end(), dex_file);
+    if (it == dex_files.end()) {
+      return false;
+    }
+    AppendUint(out, std::distance(dex_files.begin(), it));
+    return true;
+  };
+  AppendUint(out, enum_cast<uint8_t>(patch.GetType()));
+  AppendUint(out, patch.LiteralOffset());
+  switch (patch.GetType()) {
+    case Type::kIntrinsicReference:
+      AppendUint(out, patch.PcInsnOffset());
+      AppendUint(out, patch.IntrinsicData());
+      return true;
+    case Type::kBootImageRelRo:
+      AppendUint(out, patch.PcInsnOffset());
+      AppendUint(out, patch.BootImageOffset());
+      return true;
+    case Type::kMethodRelative:
+    case Type::kMethodBssEntry:
+    case Type::kJniEntrypointRelative:
+      AppendUint(out, patch.PcInsnOffset());
+      FALLTHROUGH_INTENDED;
+    case Type::kCallRelative: {
+      MethodReference target = patch.TargetMethod();
+      if (!append_dex_file(target.dex_file)) {
+        return false;
+      }
+      AppendMethodSymbol(*target.dex_file, target.index, out);
+      return true;
+    }
+    case Type::kTypeRelative:
+    case Type::kTypeBssEntry:
+    case Type::kPublicTypeBssEntry:
+    case Type::kPackageTypeBssEntry: {
+      TypeReference target = patch.TargetType();
+      AppendUint(out, patch.PcInsnOffset());
+      if (!append_dex_file(target.dex_file)) {
+        return false;
+      }
+      AppendString(out, target.dex_file->GetTypeDescriptorView(target.TypeIndex()));
+      return true;
+    }
+    case Type::kTypeAppImageRelRo:
+      // The app image is laid out anew by each compilation.
+      return false;
+    case Type::kStringRelative:
+    case Type::kStringBssEntry: {
+      StringReference target = patch.TargetString();
+      AppendUint(out, patch.PcInsnOffset());
+      if (!append_dex_file(target.dex_file)) {
+        return false;
+      }
+      AppendString(out, target.dex_file->GetStringView(target.StringIndex()));
+      return true;
+    }
+    case Type::kMethodTypeBssEntry: {
+      ProtoReference target = patch.TargetProto();
+      AppendUint(out, patch.PcInsnOffset());
+      if (!append_dex_file(target.dex_file)) {
+        return false;
+      }
+      AppendString(out, target.dex_file->GetProtoSignature(target.ProtoId()).ToString());
+      return true;
+    }
+    case Type::kCallEntrypoint:
+      AppendUint(out, patch.EntrypointOffset());
+      return true;
+    case Type::kBakerReadBarrierBranch:
+      AppendUint(out, patch.GetBakerCustomValue1());
+      AppendUint(out, patch.GetBakerCustomValue2());
+      return true;
+  }
+  return false;
+}
+
+// Reads a patch written by `AppendPatch()` and remaps its target to `dex_files`.
+bool ReadPatch(ArrayRef<const DexFile* const> dex_files,
+               CacheReader* reader,
+               std::vector<linker::LinkerPatch>* patches) {
+  using linker::LinkerPatch;
+  using Type = LinkerPatch::Type;
+  uint64_t type_value;
+  uint64_t literal_offset;
+  if (!reader->ReadUint(&type_value) ||
+      type_value > enum_cast<uint8_t>(Type::kBakerReadBarrierBranch) ||
+      !reader->ReadUint(&literal_offset) ||
+      !IsUint<24>(literal_offset)) {
+    return false;
+  }
+  Type type = static_cast<Type>(type_value);
+  uint64_t pc_insn_offset = 0u;
+  if (type != Type::kCallRelative &&
+      type != Type::kCallEntrypoint &&
+      type != Type::kBakerReadBarrierBranch &&
+      (!reader->ReadUint(&pc_insn_offset) || !IsUint<32>(pc_insn_offset))) {
+    return false;
+  }
+  const DexFile* dex_file = nullptr;
+  auto read_dex_file = [&]() {
+    uint64_t dex_file_index;
+    if (!reader->ReadUint(&dex_file_index) || dex_file_index >= dex_files.size()) {
+      return false;
+    }
+    dex_file = dex_files[dex_file_index];
+    return true;
+  };
+  switch (type) {
+    case Type::kIntrinsicReference:
+    case Type::kBootImageRelRo: {
+      uint64_t data;
+      if (!reader->ReadUint(&data) || !IsUint<32>(data)) {
+        return false;
+      }
+      patches->push_back(type == Type::kIntrinsicReference
+          ? LinkerPatch::IntrinsicReferencePatch(literal_offset, pc_insn_offset, data)
+          : LinkerPatch::BootImageRelRoPatch(literal_offset, pc_insn_offset, data));
+      return true;
+    }
+    case Type::kMethodRelative:
+    case Type::kMethodBssEntry:
+    case Type::kJniEntrypointRelative:
+    case Type::kCallRelative: {
+      uint32_t method_idx;
+      if (!read_dex_file() || !ReadMethodSymbol(*dex_file, reader, &method_idx)) {
+        return false;
+      }
+      if (type == Type::kMethodRelative) {
+        patches->push_back(LinkerPatch::RelativeMethodPatch(
+            literal_offset, dex_file, pc_insn_offset, method_idx));
+      } else if (type == Type::kMethodBssEntry) {
+        patches->push_back(LinkerPatch::MethodBssEntryPatch(
+            literal_offset, dex_file, pc_insn_offset, method_idx));
+      } else if (type == Type::kJniEntrypointRelative) {
+        patches->push_back(LinkerPatch::RelativeJniEntrypointPatch(
+            literal_offset, dex_file, pc_insn_offset, method_idx));
+      } else {
+        patches->push_back(LinkerPatch::RelativeCodePatch(literal_offset, dex_file, method_idx));
+      }
+      return true;
+    }
+    case Type::kTypeRelative:
+    case Type::kTypeBssEntry:
+    case Type::kPublicTypeBssEntry:
+    case Type::kPackageTypeBssEntry: {
+      std::string_view descriptor;
+      if (!read_dex_file() || !reader->ReadString(&descriptor)) {
+        return false;
+      }
+      const dex::TypeId* type_id = dex_file->FindTypeId(descriptor);
+      if (type_id == nullptr) {
+        return false;
+      }
+      uint32_t type_idx = dex_file->GetIndexForTypeId(*type_id).index_;
+      if (type == Type::kTypeRelative) {
+        patches->push_back(LinkerPatch::RelativeTypePatch(
+            literal_offset, dex_file, pc_insn_offset, type_idx));
+      } else if (type == Type::kTypeBssEntry) {
+        patches->push_back(LinkerPatch::TypeBssEntryPatch(
+            literal_offset, dex_file, pc_insn_offset, type_idx));
+      } else if (type == Type::kPublicTypeBssEntry) {
+        patches->push_back(LinkerPatch::PublicTypeBssEntryPatch(
+            literal_offset, dex_file, pc_insn_offset, type_idx));
+      } else {
+        patches->push_back(LinkerPatch::PackageTypeBssEntryPatch(
+            literal_offset, dex_file, pc_insn_offset, type_idx));
+      }
+      return true;
+    }
+    case Type::kTypeAppImageRelRo:
+      return false;
+    case Type::kStringRelative:
+    case Type::kStringBssEntry: {
+      std::string_view value;
+      if (!read_dex_file() || !reader->ReadString(&value)) {
+        return false;
+      }
+      const dex::StringId* string_id = FindString(*dex_file, value);
+      if (string_id == nullptr) {
+        return false;
+      }
+      uint32_t string_idx = dex_file->GetIndexForStringId(*string_id).index_;
+      patches->push_back(type == Type::kStringRelative
+          ? LinkerPatch::RelativeStringPatch(literal_offset, dex_file, pc_insn_offset, string_idx)
+          : LinkerPatch::StringBssEntryPatch(literal_offset, dex_file, pc_insn_offset, string_idx));
+      return true;
+    }
+    case Type::kMethodTypeBssEntry: {
+      std::string_view signature;
+      if (!read_dex_file() || !reader->ReadString(&signature)) {
+        return false;
+      }
+      const dex::ProtoId* proto_id = FindProto(*dex_file, signature);
+      if (proto_id == nullptr) {
+        return false;
+      }
+      uint32_t proto_idx = dex_file->GetIndexForProtoId(*proto_id).index_;
+      patches->push_back(LinkerPatch::MethodTypeBssEntryPatch(
+          literal_offset, dex_file, pc_insn_offset, proto_idx));
+      return true;
+    }
+    case Type::kCallEntrypoint: {
+      uint64_t entrypoint_offset;
+      if (!reader->ReadUint(&entrypoint_offset) || !IsUint<32>(entrypoint_offset)) {
+        return false;
+      }
+      patches->push_back(LinkerPatch::CallEntrypointPatch(literal_offset, entrypoint_offset));
+      return true;
+    }
+    case Type::kBakerReadBarrierBranch: {
+      uint64_t custom_value1;
+      uint64_t custom_value2;
+      if (!reader->ReadUint(&custom_value1) ||
+          !IsUint<32>(custom_value1) ||
+          !reader->ReadUint(&custom_value2) ||
+          !IsUint<32>(custom_value2)) {
+        return false;
+      }
+      patches->push_back(
+          LinkerPatch::BakerReadBarrierBranchPatch(literal_offset, custom_value1, custom_value2));
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // anonymous namespace
+
+CompiledMethodCache::CompiledMethodCache(CompilerDriver* driver,
+                                         const std::vector<const DexFile*>& dex_files,
+                                         std::string_view environment)
+    : driver_(driver),
+      dex_files_(dex_files),
+      environment_(environment),
+      callee_lock_("compiled method cache callee lock"),
+      callee_groups_computed_(false),
+      lock_("compiled method cache lock"),
+      number_of_hits_(0u),
+      number_of_misses_(0u) {
+  for (const DexFile* dex_file : dex_files_) {
+    for (uint32_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+      const dex::ClassDef& class_def = dex_file->GetClassDef(i);
+      classes_.emplace(dex_file->GetTypeDescriptorView(class_def.class_idx_),
+                       ClassInfo{ClassReference(dex_file, i), 0u, false});
+    }
+  }
+  for (auto& entry : classes_) {
+    ComputeLayoutHash(&entry.second, /*depth=*/ 0u);
+  }
+}
+
+CompiledMethodCache::~CompiledMethodCache() {}
+
+uint64_t CompiledMethodCache::ComputeLayoutHash(ClassInfo* info, size_t depth) {
+  if (info->has_layout_hash) {
+    return info->layout_hash;
+  }
+  if (depth == kMaxClassDepth) {
+    return 0u;
+  }
+  const DexFile& dex_file = *info->ref.dex_file;
+  const dex::ClassDef& class_def = dex_file.GetClassDef(info->ref.ClassDefIdx());
+  std::string layout;
+  AppendUint(&layout, class_def.access_flags_);
+  AppendString(&layout, dex_file.GetTypeDescriptorView(class_def.class_idx_));
+  auto append_super_type = [&](dex::TypeIndex type_idx) {
+    std::string_view descriptor = dex_file.GetTypeDescriptorView(type_idx);
+    AppendString(&layout, descriptor);
+    auto it = classes_.find(descriptor);
+    AppendUint(&layout, (it != classes_.end()) ? ComputeLayoutHash(&it->second, depth + 1u) : 0u);
+  };
+  if (class_def.superclass_idx_.IsValid()) {
+    append_super_type(class_def.superclass_idx_);
+  } else {
+    AppendString(&layout, "");
+  }
+  const dex::TypeList* interfaces = dex_file.GetInterfacesList(class_def);
+  uint32_t num_interfaces = (interfaces != nullptr) ? interfaces->Size() : 0u;
+  AppendUint(&layout, num_interfaces);
+  for (uint32_t i = 0; i != num_interfaces; ++i) {
+    append_super_type(interfaces->GetTypeItem(i).type_idx_);
+  }
+
+  ClassAccessor accessor(dex_file, info->ref.ClassDefIdx());
+  AppendUint(&layout, accessor.NumStaticFields());
+  AppendUint(&layout, accessor.NumInstanceFields());
+  for (const ClassAccessor::Field& field : accessor.GetFields()) {
+    const dex::FieldId& field_id = dex_file.GetFieldId(field.GetIndex());
+    AppendString(&layout, dex_file.GetFieldNameView(field_id));
+    AppendString(&layout, dex_file.GetFieldTypeDescriptorView(field_id));
+    AppendUint(&layout, field.GetAccessFlags());
+  }
+  AppendUint(&layout, accessor.NumDirectMethods());
+  AppendUint(&layout, accessor.NumVirtualMethods());
+  for (const ClassAccessor::Method& method : accessor.GetMethods()) {
+    const dex::MethodId& method_id = dex_file.GetMethodId(method.GetIndex());
+    AppendString(&layout, dex_file.GetMethodNameView(method_id));
+    AppendString(&layout, dex_file.GetMethodSignature(method_id).ToString());
+    AppendUint(&layout, method.GetAccessFlags());
+  }
+  // Initial values of static fields can be used by the compiler for initialized classes.
+  for (EncodedStaticFieldValueIterator it(dex_file, class_def); it.HasNext(); it.Next()) {
+    AppendUint(&layout, it.GetValueType());
+    uint32_t index = static_cast<uint32_t>(it.GetJavaValue().i);
+    switch (it.GetValueType()) {
+      case EncodedArrayValueIterator::ValueType::kString:
+        AppendString(&layout, dex_file.GetStringView(dex::StringIndex(index)));
+        break;
+      case EncodedArrayValueIterator::ValueType::kType:
+        AppendString(&layout, dex_file.GetTypeDescriptorView(dex::TypeIndex(index)));
+        break;
+      default:
+        AppendUint(&layout, static_cast<uint64_t>(it.GetJavaValue().j));
+        break;
+    }
+  }
+
+  info->layout_hash = HashData(layout);
+  info->has_layout_hash = true;
+  return info->layout_hash;
+}
+
+const CompiledMethodCache::ClassInfo* CompiledMethodCache::FindClass(
+    std::string_view descriptor) const {
+  auto it = classes_.find(descriptor);
+  return (it != classes_.end()) ? &it->second : nullptr;
+}
+
+void CompiledMethodCache::AppendClassDependency(std::string_view descriptor,
+                                                /*inout*/ std::string* key) const {
+  size_t element_pos = descriptor.find_first_not_of('[');
+  const ClassInfo* info =
+      (element_pos != std::string_view::npos) ? FindClass(descriptor.substr(element_pos)) : nullptr;
+  if (info == nullptr) {
+    // Classes outside the compiled dex files are covered by the environment.
+    AppendUint(key, 0u);
+    return;
+  }
+  AppendUint(key, info->layout_hash);
+  // The status of superclasses matters for members resolved through them, e.g. static methods.
+  for (size_t depth = 0; info != nullptr && depth != kMaxClassDepth; ++depth) {
+    AppendUint(key, enum_cast<uint32_t>(driver_->GetClassStatus(info->ref)));
+    const DexFile& dex_file = *info->ref.dex_file;
+    const dex::ClassDef& class_def = dex_file.GetClassDef(info->ref.ClassDefIdx());
+    if (!class_def.superclass_idx_.IsValid()) {
+      break;
+    }
+    info = FindClass(dex_file.GetTypeDescriptorView(class_def.superclass_idx_));
+  }
+}
+
+bool CompiledMethodCache::AppendIndexedSymbol(const DexFile& dex_file,
+                                              Instruction::IndexType index_type,
+                                              uint32_t index,
+                                              /*inout*/ std::string* key) const {
+  switch (index_type) {
+    case Instruction::kIndexNone:
+      return true;
+    case Instruction::kIndexTypeRef: {
+      std::string_view descriptor = dex_file.GetTypeDescriptorView(dex::TypeIndex(index));
+      AppendString(key, descriptor);
+      AppendClassDependency(descriptor, key);
+      return true;
+    }
+    case Instruction::kIndexStringRef:
+      AppendString(key, dex_file.GetStringView(dex::StringIndex(index)));
+      return true;
+    case Instruction::kIndexMethodRef:
+      AppendMethodSymbol(dex_file, index, key);
+      AppendClassDependency(dex_file.GetMethodDeclaringClassDescriptorView(index), key);
+      return true;
+    case Instruction::kIndexFieldRef: {
+      const dex::FieldId& field_id = dex_file.GetFieldId(index);
+      std::string_view descriptor = dex_file.GetFieldDeclaringClassDescriptorView(field_id);
+      AppendString(key, descriptor);
+      AppendString(key, dex_file.GetFieldNameView(field_id));
+      AppendString(key, dex_file.GetFieldTypeDescriptorView(field_id));
+      AppendClassDependency(descriptor, key);
+      return true;
+    }
+    case Instruction::kIndexProtoRef:
+      AppendString(key,
+                   dex_file.GetProtoSignature(dex_file.GetProtoId(dex::ProtoIndex(index)))
+                       .ToString());
+      return true;
+    default:
+      // Call sites and method handles depend on data we do not track.
+      return false;
+  }
+}
+
+bool CompiledMethodCache::AppendMethodBody(MethodReference method_ref,
+                                           uint16_t class_def_idx,
+                                           const dex::CodeItem* code_item,
+                                           uint32_t access_flags,
+                                           /*inout*/ std::string* key,
+                                           /*out*/ std::vector<uint32_t>* invoked_methods) const {
+  const DexFile& dex_file = *method_ref.dex_file;
+  CodeItemDataAccessor accessor(dex_file, code_item);
+  if (!accessor.HasCodeItem()) {
+    return false;
+  }
+  AppendMethodSymbol(dex_file, method_ref.index, key);
+  AppendUint(key, access_flags);
+  ClassStatus status = driver_->GetClassStatus(ClassReference(&dex_file, class_def_idx));
+  AppendUint(key, enum_cast<uint32_t>(status));
+  AppendClassDependency(dex_file.GetMethodDeclaringClassDescriptorView(method_ref.index), key);
+
+  // The instructions, including the dex indices the compiled code may embed.
+  AppendUint(key, accessor.RegistersSize());
+  AppendUint(key, accessor.InsSize());
+  AppendUint(key, accessor.OutsSize());
+  AppendString(key,
+               std::string_view(reinterpret_cast<const char*>(accessor.Insns()),
+                                accessor.InsnsSizeInCodeUnits() * sizeof(uint16_t)));
+  // The entities referenced by those indices.
+  invoked_methods->clear();
+  for (const DexInstructionPcPair& inst : accessor) {
+    Instruction::Code opcode = inst->Opcode();
+    Instruction::IndexType index_type = Instruction::IndexTypeOf(opcode);
+    if (index_type == Instruction::kIndexNone) {
+      continue;
+    }
+    if (index_type == Instruction::kIndexMethodAndProtoRef) {
+      if (!AppendIndexedSymbol(dex_file, Instruction::kIndexMethodRef, inst->VRegB(), key) ||
+          !AppendIndexedSymbol(dex_file, Instruction::kIndexProtoRef, inst->VRegH(), key)) {
+        return false;
+      }
+      invoked_methods->push_back(inst->VRegB());
+      continue;
+    }
+    uint32_t index = (Instruction::FormatOf(opcode) == Instruction::k22c)
+        ? inst->VRegC_22c()
+        : inst->VRegB();
+    if (!AppendIndexedSymbol(dex_file, index_type, index, key)) {
+      return false;
+    }
+    if (inst->IsInvoke()) {
+      invoked_methods->push_back(index);
+    }
+  }
+  // Try blocks and catch handlers.
+  AppendUint(key, accessor.TriesSize());
+  for (const dex::TryItem& try_item : accessor.TryItems()) {
+    AppendUint(key, try_item.start_addr_);
+    AppendUint(key, try_item.insn_count_);
+    for (CatchHandlerIterator it(accessor, try_item); it.HasNext(); it.Next()) {
+      AppendUint(key, it.GetHandlerAddress());
+      dex::TypeIndex type_idx = it.GetHandlerTypeIndex();
+      if (type_idx.IsValid()) {
+        AppendIndexedSymbol(dex_file, Instruction::kIndexTypeRef, type_idx.index_, key);
+      } else {
+        AppendString(key, "");  // Catch-all.
+      }
+    }
+  }
+  return true;
+}
+
+size_t CompiledMethodCache::GetOrAddCalleeGroup(const DexFile& dex_file,
+                                                uint32_t method_idx) const {
+  auto [it, inserted] = callee_group_indexes_.try_emplace(
+      GetMethodNameAndSignature(dex_file, method_idx), callee_groups_.size());
+  if (inserted) {
+    callee_groups_.emplace_back();
+  }
+  return it->second;
+}
+
+void CompiledMethodCache::ComputeCalleeGroups() const {
+  std::string body;
+  std::vector<uint32_t> invoked_methods;
+  for (const DexFile* dex_file : dex_files_) {
+    for (ClassAccessor accessor : dex_file->GetClasses()) {
+      for (const ClassAccessor::Method& method : accessor.GetMethods()) {
+        size_t group = GetOrAddCalleeGroup(*dex_file, method.GetIndex());
+        if (method.GetCodeItem() == nullptr) {
+          continue;
+        }
+        body.clear();
+        if (!AppendMethodBody(method.GetReference(),
+                              accessor.GetClassDefIndex(),
+                              method.GetCodeItem(),
+                              method.GetAccessFlags(),
+                              &body,
+                              &invoked_methods)) {
+          callee_groups_[group].keyable = false;
+          continue;
+        }
+        callee_groups_[group].body_hashes.push_back(HashData(body));
+        for (uint32_t invoked_method_idx : invoked_methods) {
+          size_t callee = GetOrAddCalleeGroup(*dex_file, invoked_method_idx);
+          callee_groups_[group].callees.push_back(callee);
+        }
+      }
+    }
+  }
+
+  // Tarjan's algorithm, without recursion as call chains can be long. The components are
+  // completed in reverse topological order, so the closure hashes of the callees of a component
+  // are known when it is completed.
+  static constexpr size_t kUnvisited = static_cast<size_t>(-1);
+  const size_t num_groups = callee_groups_.size();
+  std::vector<size_t> index(num_groups, kUnvisited);
+  std::vector<size_t> low_link(num_groups);
+  std::vector<size_t> component(num_groups, kUnvisited);
+  std::vector<size_t> stack;
+  std::vector<std::pair<size_t, size_t>> frames;  // Group and next callee to visit.
+  size_t next_index = 0u;
+  auto visit = [&](size_t group) {
+    index[group] = next_index;
+    low_link[group] = next_index;
+    ++next_index;
+    stack.push_back(group);
+    frames.emplace_back(group, 0u);
+  };
+  for (size_t root = 0; root != num_groups; ++root) {
+    if (index[root] != kUnvisited) {
+      continue;
+    }
+    visit(root);
+    while (!frames.empty()) {
+      auto& [group, next_callee] = frames.back();
+      if (next_callee != callee_groups_[group].callees.size()) {
+        size_t callee = callee_groups_[group].callees[next_callee];
+        ++next_callee;
+        if (index[callee] == kUnvisited) {
+          visit(callee);
+        } else if (component[callee] == kUnvisited) {
+          // On the stack, part of the component being built.
+          low_link[group] = std::min(low_link[group], index[callee]);
+        }
+        continue;
+      }
+      const size_t done = group;
+      frames.pop_back();
+      if (!frames.empty()) {
+        size_t caller = frames.back().first;
+        low_link[caller] = std::min(low_link[caller], low_link[done]);
+      }
+      if (low_link[done] != index[done]) {
+        continue;
+      }
+      // `done` is the root of a component, which is on top of the stack.
+      auto component_begin = std::find(stack.rbegin(), stack.rend(), done).base() - 1;
+      for (auto it = component_begin; it != stack.end(); ++it) {
+        component[*it] = done;
+      }
+      std::vector<uint64_t> body_hashes;
+      std::vector<uint64_t> callee_hashes;
+      bool keyable = true;
+      for (auto it = component_begin; it != stack.end(); ++it) {
+        const CalleeGroup& member = callee_groups_[*it];
+        keyable = keyable && member.keyable;
+        body_hashes.insert(body_hashes.end(), member.body_hashes.begin(), member.body_hashes.end());
+        for (size_t callee : member.callees) {
+          if (component[callee] != done) {
+            keyable = keyable && callee_groups_[callee].closure_keyable;
+            callee_hashes.push_back(callee_groups_[callee].closure_hash);
+          }
+        }
+      }
+      std::sort(body_hashes.begin(), body_hashes.end());
+      std::sort(callee_hashes.begin(), callee_hashes.end());
+      callee_hashes.erase(std::unique(callee_hashes.begin(), callee_hashes.end()),
+                          callee_hashes.end());
+      std::string closure;
+      AppendUint(&closure, body_hashes.size());
+      for (uint64_t hash : body_hashes) {
+        AppendUint(&closure, hash);
+      }
+      for (uint64_t hash : callee_hashes) {
+        AppendUint(&closure, hash);
+      }
+      uint64_t closure_hash = HashData(closure);
+      for (auto it = component_begin; it != stack.end(); ++it) {
+        callee_groups_[*it].closure_hash = closure_hash;
+        callee_groups_[*it].closure_keyable = keyable;
+      }
+      stack.erase(component_begin, stack.end());
+    }
+  }
+}
+
+bool CompiledMethodCache::ComputeKey(MethodReference method_ref,
+                                     uint16_t class_def_idx,
+                                     const dex::CodeItem* code_item,
+                                     uint32_t access_flags,
+                                     /*out*/ std::string* key) const {
+  if (!callee_groups_computed_.load(std::memory_order_acquire)) {
+    MutexLock mu(Thread::Current(), callee_lock_);
+    if (!callee_groups_computed_.load(std::memory_order_relaxed)) {
+      ComputeCalleeGroups();
+      callee_groups_computed_.store(true, std::memory_order_release);
+    }
+  }
+  key->clear();
+  std::vector<uint32_t> invoked_methods;
+  if (!AppendMethodBody(
+          method_ref, class_def_idx, code_item, access_flags, key, &invoked_methods)) {
+    return false;
+  }
+  // The code of all methods the invokes may resolve to and inline, with their own callees.
+  // Methods outside the compiled dex files are covered by the environment.
+  for (uint32_t invoked_method_idx : invoked_methods) {
+    auto it = callee_group_indexes_.find(
+        GetMethodNameAndSignature(*method_ref.dex_file, invoked_method_idx));
+    if (it == callee_group_indexes_.end() || !callee_groups_[it->second].closure_keyable) {
+      return false;
+    }
+    AppendUint(key, callee_groups_[it->second].closure_hash);
+  }
+  return true;
+}
+
+CompiledMethod* CompiledMethodCache::Lookup(const std::string& key) {
+  auto it = previous_entries_.find(key);
+  if (it == previous_entries_.end()) {
+    number_of_misses_.fetch_add(1u, std::memory_order_relaxed);
+    return nullptr;
+  }
+  InstructionSet instruction_set = driver_->GetCompilerOptions().GetInstructionSet();
+  ArrayRef<const DexFile* const> dex_files(dex_files_);
+  CacheReader reader(it->second);
+  uint64_t isa;
+  uint64_t is_intrinsic;
+  ArrayRef<const uint8_t> code;
+  ArrayRef<const uint8_t> vmap_table;
+  ArrayRef<const uint8_t> cfi_info;
+  uint64_t num_patches;
+  bool success = reader.ReadUint(&isa) &&
+                 isa == enum_cast<uint64_t>(instruction_set) &&
+                 reader.ReadUint(&is_intrinsic) &&
+                 reader.ReadData(&code) &&
+                 reader.ReadData(&vmap_table) &&
+                 reader.ReadData(&cfi_info) &&
+                 reader.ReadUint(&num_patches) &&
+                 num_patches <= reader.RemainingSize();
+  std::vector<linker::LinkerPatch> patches;
+  if (success) {
+    patches.reserve(num_patches);
+    for (uint64_t i = 0; success && i != num_patches; ++i) {
+      // Fails if a patch target no longer exists in the dex files; the method is recompiled.
+      success = ReadPatch(dex_files, &reader, &patches);
+    }
+  }
+  if (!success) {
+    number_of_misses_.fetch_add(1u, std::memory_order_relaxed);
+    return nullptr;
+  }
+  number_of_hits_.fetch_add(1u, std::memory_order_relaxed);
+  return driver_->GetCompiledMethodStorage()->CreateCompiledMethod(
+      instruction_set,
+      code,
+      vmap_table,
+      cfi_info,
+      ArrayRef<const linker::LinkerPatch>(patches),
+      is_intrinsic != 0u);
+}
+
+void CompiledMethodCache::Record(std::string&& key, const CompiledMethod* compiled_method) {
+  std::string value;
+  AppendUint(&value, enum_cast<uint64_t>(compiled_method->GetInstructionSet()));
+  AppendUint(&value, compiled_method->IsIntrinsic() ? 1u : 0u);
+  AppendData(&value, compiled_method->GetQuickCode());
+  AppendData(&value, compiled_method->GetVmapTable());
+  AppendData(&value, compiled_method->GetCFIInfo());
+  ArrayRef<const linker::LinkerPatch> patches = compiled_method->GetPatches();
+  AppendUint(&value, patches.size());
+  for (const linker::LinkerPatch& patch : patches) {
+    if (!AppendPatch(ArrayRef<const DexFile* const>(dex_files_), patch, &value)) {
+      return;
+    }
+  }
+  MutexLock mu(Thread::Current(), lock_);
+  entries_.insert_or_assign(std::move(key), std::move(value));
+}
+
+bool CompiledMethodCache::Load(const std::string& filename, std::string* error_msg) {
+  if (!OS::FileExists(filename.c_str())) {
+    return true;
+  }
+  std::string data;
+  if (!android::base::ReadFileToString(filename, &data)) {
+    *error_msg = "Failed to read compiled method cache " + filename;
+    return false;
+  }
+  std::string expected_header(kCacheMagic, sizeof(kCacheMagic));
+  expected_header.append(kCacheVersion, sizeof(kCacheVersion));
+  if (!std::string_view(data).starts_with(expected_header)) {
+    LOG(INFO) << "Ignoring compiled method cache " << filename << " with a different version";
+    return true;
+  }
+  CacheReader reader(std::string_view(data).substr(expected_header.size()));
+  std::string_view environment;
+  if (!reader.ReadString(&environment)) {
+    *error_msg = "Truncated compiled method cache " + filename;
+    return false;
+  }
+  if (environment != environment_) {
+    LOG(INFO) << "Ignoring compiled method cache " << filename << " for a different environment";
+    return true;
+  }
+  uint64_t num_entries;
+  if (!reader.ReadUint(&num_entries)) {
+    *error_msg = "Truncated compiled method cache " + filename;
+    return false;
+  }
+  std::unordered_map<std::string, std::string> entries;
+  for (uint64_t i = 0; i != num_entries; ++i) {
+    std::string_view key;
+    std::string_view value;
+    if (!reader.ReadString(&key) || !reader.ReadString(&value)) {
+      *error_msg = "Truncated compiled method cache " + filename;
+      return false;
+    }
+    entries.emplace(key, value);
+  }
+  previous_entries_ = std::move(entries);
+  return true;
+}
+
+bool CompiledMethodCache::Save(const std::string& filename, std::string* error_msg) const {
+  std::string data(kCacheMagic, sizeof(kCacheMagic));
+  data.append(kCacheVersion, sizeof(kCacheVersion));
+  AppendString(&data, environment_);
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    // Sort the entries so that the output does not depend on the compilation order.
+    std::vector<const std::pair<const std::string, std::string>*> sorted_entries;
+    sorted_entries.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+      sorted_entries.push_back(&entry);
+    }
+    std::sort(sorted_entries.begin(), sorted_entries.end(), [](auto* lhs, auto* rhs) {
+      return lhs->first < rhs->first;
+    });
+    AppendUint(&data, sorted_entries.size());
+    for (const auto* entry : sorted_entries) {
+      AppendString(&data, entry->first);
+      AppendString(&data, entry->second);
+    }
+  }
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(filename.c_str()));
+  if (file == nullptr) {
+    *error_msg = "Failed to create compiled method cache " + filename;
+    return false;
+  }
+  if (!file->WriteFully(data.data(), data.size())) {
+    *error_msg = "Failed to write compiled method cache " + filename;
+    file->Erase(/*unlink=*/ true);
+    return false;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    *error_msg = "Failed to flush compiled method cache " + filename;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace art
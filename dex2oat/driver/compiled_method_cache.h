@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
+#define ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "dex/class_reference.h"
+#include "dex/dex_instruction.h"
+#include "dex/method_reference.h"
+
+namespace art {
+
+namespace dex {
+struct CodeItem;
+}  // namespace dex
+
+class CompiledMethod;
+class CompilerDriver;
+class DexFile;
+
+// Compiled code of a previous dex2oat invocation, used to avoid recompiling methods whose inputs
+// did not change, e.g. for an app update that only touches a few classes.
+//
+// Oat files do not retain the linker patches of the compiled code, so the cache is a separate
+// file written next to the oat file. Each entry holds the code, stack maps, CFI and the linker
+// patches of one method, with patch targets recorded symbolically so that they can be remapped
+// to the dex files of the new compilation and relocated again when the oat file is linked.
+//
+// An entry is keyed by everything the compiled code depends on:
+//   - the instructions of the method, including all dex indices embedded in them,
+//   - the strings, types, fields and methods those indices refer to,
+//   - the class status and the layout of the declaring class and of all classes referenced by
+//     the method that are being compiled, including their superclasses and interfaces.
+//   - for each invoke, the code of every method that the invoke may resolve to and that may be
+//     inlined, transitively. The inliner does not always leave inline info (e.g. for
+//     pattern-substituted getters and setters), so the key covers all methods of the compiled dex
+//     files with the name and signature of the invoked method, and everything they may invoke.
+// Dependencies outside the compiled dex files (boot class path, class loader context, compiler
+// options, profile) are covered by the environment string that must match for the cache to be
+// loaded.
+class CompiledMethodCache {
+ public:
+  CompiledMethodCache(CompilerDriver* driver,
+                      const std::vector<const DexFile*>& dex_files,
+                      std::string_view environment);
+  ~CompiledMethodCache();
+
+  // Loads the entries of a previous compilation. A missing file or a file written for a
+  // different environment leaves the cache empty without reporting an error.
+  bool Load(const std::string& filename, std::string* error_msg);
+
+  // Writes all entries recorded during this compilation.
+  bool Save(const std::string& filename, std::string* error_msg) const;
+
+  // Computes the key of the compiled code for the given method. Returns false if the method
+  // must always be compiled, e.g. because it or a method it may inline uses a call site.
+  bool ComputeKey(MethodReference method_ref,
+                  uint16_t class_def_idx,
+                  const dex::CodeItem* code_item,
+                  uint32_t access_flags,
+                  /*out*/ std::string* key) const REQUIRES(!callee_lock_);
+
+  // Returns a copy of the code previously compiled for `key`, or null if there is no usable entry.
+  CompiledMethod* Lookup(const std::string& key);
+
+  // Records the code compiled for `key` so that it is written by `Save()`.
+  void Record(std::string&& key, const CompiledMethod* compiled_method) REQUIRES(!lock_);
+
+  size_t GetNumberOfHits() const {
+    return number_of_hits_.load(std::memory_order_relaxed);
+  }
+
+  size_t GetNumberOfMisses() const {
+    return number_of_misses_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct ClassInfo {
+    ClassReference ref;
+    uint64_t layout_hash;
+    bool has_layout_hash;
+  };
+
+  // The methods of the compiled dex files with a given name and signature.
+  struct CalleeGroup {
+    // Hashes of the code of the methods with a code item.
+    std::vector<uint64_t> body_hashes;
+    // Groups of the methods invoked by these methods.
+    std::vector<size_t> callees;
+    // False if any of the methods cannot be keyed.
+    bool keyable = true;
+    // Hash of the code of these methods and of all the groups they reach, and whether all of
+    // these methods can be keyed.
+    uint64_t closure_hash = 0u;
+    bool closure_keyable = false;
+  };
+
+  uint64_t ComputeLayoutHash(ClassInfo* info, size_t depth);
+  // Appends the code of a method and everything it refers to, except for the code of invoked
+  // methods, which are returned in `invoked_methods`.
+  bool AppendMethodBody(MethodReference method_ref,
+                        uint16_t class_def_idx,
+                        const dex::CodeItem* code_item,
+                        uint32_t access_flags,
+                        /*inout*/ std::string* key,
+                        /*out*/ std::vector<uint32_t>* invoked_methods) const;
+  size_t GetOrAddCalleeGroup(const DexFile& dex_file, uint32_t method_idx) const
+      REQUIRES(callee_lock_);
+  // Hashes the code of all methods and computes the closure hashes of the callee groups over the
+  // strongly connected components of the call graph. Done on first use, once the class status of
+  // all compiled classes is final.
+  void ComputeCalleeGroups() const REQUIRES(callee_lock_);
+  const ClassInfo* FindClass(std::string_view descriptor) const;
+  void AppendClassDependency(std::string_view descriptor, /*inout*/ std::string* key) const;
+  bool AppendIndexedSymbol(const DexFile& dex_file,
+                           Instruction::IndexType index_type,
+                           uint32_t index,
+                           /*inout*/ std::string* key) const;
+
+  CompilerDriver* const driver_;
+  const std::vector<const DexFile*> dex_files_;
+  const std::string environment_;
+
+  // Compiled classes by descriptor. The first definition wins, as in the class loader.
+  std::unordered_map<std::string_view, ClassInfo> classes_;
+
+  // Serialized entries of the previous compilation, read-only once loaded.
+  std::unordered_map<std::string, std::string> previous_entries_;
+
+  // Callee groups, by method name and signature. Filled by `ComputeCalleeGroups()` with
+  // `callee_lock_` held, read-only once `callee_groups_computed_` is set.
+  mutable Mutex callee_lock_;
+  mutable std::atomic<bool> callee_groups_computed_;
+  mutable std::unordered_map<std::string, size_t> callee_group_indexes_;
+  mutable std::vector<CalleeGroup> callee_groups_;
+
+  mutable Mutex lock_;
+  std::unordered_map<std::string, std::string> entries_ GUARDED_BY(lock_);
+
+  std::atomic<size_t> number_of_hits_;
+  std::atomic<size_t> number_of_misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledMethodCache);
+};
+
+}  // namespace art
+
+#endif  // ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
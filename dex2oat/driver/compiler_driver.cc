@@ -34,6 +34,7 @@
 #include "base/arena_allocator.h"
 #include "base/array_ref.h"
 #include "base/bit_vector.h"
+#include "base/dumpable.h"
 #include "base/hash_set.h"
 #include "base/logging.h"  // For VLOG
 #include "base/pointer_size.h"
@@ -45,6 +46,7 @@
 #include "class_root-inl.h"
 #include "common_throws.h"
 #include "compiled_method-inl.h"
+#include "compiled_method_cache.h"
 #include "compiler.h"
 #include "compiler_callbacks.h"
 #include "compiler_driver-inl.h"
@@ -86,6 +88,7 @@
 #include "utils/swap_space.h"
 #include "vdex_file.h"
 #include "verifier/class_verifier.h"
+#include "verifier/shared_reg_type_cache.h"
 #include "verifier/verifier_deps.h"
 #include "verifier/verifier_enums.h"
 #include "well_known_classes-inl.h"
@@ -265,6 +268,7 @@ CompilerDriver::CompilerDriver(
       parallel_thread_count_(thread_count),
       stats_(new AOTCompilationStats),
       compiled_method_storage_(swap_fd),
+      compiled_method_cache_(nullptr),
       max_arena_alloc_(0) {
   DCHECK(compiler_options_ != nullptr);
 
@@ -520,15 +524,28 @@ static void CompileMethodQuick(
       compile = compile && ShouldCompileBasedOnProfile(compiler_options, profile_index, method_ref);
 
       if (compile) {
-        // NOTE: if compiler declines to compile this method, it will return null.
-        compiled_method = driver->GetCompiler()->Compile(code_item,
-                                                         access_flags,
-                                                         invoke_type,
-                                                         class_def_idx,
-                                                         method_idx,
-                                                         class_loader,
-                                                         dex_file,
-                                                         dex_cache);
+        // Reuse the code of a previous compilation if none of its inputs changed.
+        CompiledMethodCache* cache = driver->GetCompiledMethodCache();
+        std::string cache_key;
+        bool use_cache = (cache != nullptr) &&
+            cache->ComputeKey(method_ref, class_def_idx, code_item, access_flags, &cache_key);
+        if (use_cache) {
+          compiled_method = cache->Lookup(cache_key);
+        }
+        if (compiled_method == nullptr) {
+          // NOTE: if compiler declines to compile this method, it will return null.
+          compiled_method = driver->GetCompiler()->Compile(code_item,
+                                                           access_flags,
+                                                           invoke_type,
+                                                           class_def_idx,
+                                                           method_idx,
+                                                           class_loader,
+                                                           dex_file,
+                                                           dex_cache);
+        }
+        if (use_cache && compiled_method != nullptr) {
+          cache->Record(std::move(cache_key), compiled_method);
+        }
         ProfileMethodsCheck check_type = compiler_options.CheckProfiledMethodsCompiled();
         if (UNLIKELY(check_type != ProfileMethodsCheck::kNone)) {
           DCHECK(ShouldCompileBasedOnProfile(compiler_options, profile_index, method_ref));
@@ -571,12 +588,13 @@ static void CompileMethodQuick(
 void CompilerDriver::Resolve(jobject class_loader,
                              const std::vector<const DexFile*>& dex_files,
                              TimingLogger* timings) {
-  // Resolution allocates classes and needs to run single-threaded to be deterministic.
-  bool force_determinism = GetCompilerOptions().IsForceDeterminism();
-  ThreadPool* resolve_thread_pool = force_determinism
+  // Resolution allocates classes and needs to run single-threaded to be deterministic
+  // when the allocation order is reflected in the output.
+  bool single_threaded = NeedsSingleThreadedAllocation();
+  ThreadPool* resolve_thread_pool = single_threaded
                                      ? single_thread_pool_.get()
                                      : parallel_thread_pool_.get();
-  size_t resolve_thread_count = force_determinism ? 1U : parallel_thread_count_;
+  size_t resolve_thread_count = single_threaded ? 1U : parallel_thread_count_;
 
   for (size_t i = 0; i != dex_files.size(); ++i) {
     const DexFile* dex_file = dex_files[i];
@@ -862,7 +880,7 @@ void CompilerDriver::PreCompile(jobject class_loader,
     // multiple threads.
     const bool should_resolve_eagerly =
         compiler_options_->IsAnyCompilationEnabled() ||
-        (!GetCompilerOptions().IsForceDeterminism() && parallel_thread_count_ > 1);
+        (!NeedsSingleThreadedAllocation() && parallel_thread_count_ > 1);
     if (should_resolve_eagerly) {
       Resolve(class_loader, dex_files, timings);
       VLOG(compiler) << "Resolve: " << GetMemoryUsageString(false);
@@ -1939,11 +1957,12 @@ void CompilerDriver::Verify(jobject jclass_loader,
     }
   }
 
-  // Verification updates VerifierDeps and needs to run single-threaded to be deterministic.
-  bool force_determinism = GetCompilerOptions().IsForceDeterminism();
+  // Verification resolves and allocates classes. The VerifierDeps are made independent of the
+  // verification order below, so only the allocation order may need a single thread.
+  bool single_threaded = NeedsSingleThreadedAllocation();
   ThreadPool* verify_thread_pool =
-      force_determinism ? single_thread_pool_.get() : parallel_thread_pool_.get();
-  size_t verify_thread_count = force_determinism ? 1U : parallel_thread_count_;
+      single_threaded ? single_thread_pool_.get() : parallel_thread_pool_.get();
+  size_t verify_thread_count = single_threaded ? 1U : parallel_thread_count_;
   for (const DexFile* dex_file : dex_files) {
     CHECK(dex_file != nullptr);
     VerifyDexFile(jclass_loader,
@@ -1961,6 +1980,9 @@ void CompilerDriver::Verify(jobject jclass_loader,
       main_verifier_deps->MergeWith(std::move(thread_deps),
                                     GetCompilerOptions().GetDexFilesForOatFile());
     }
+    // Strings not present in the dex files get ids in the order the verifier threads
+    // encountered them; renumber them so that the vdex does not depend on scheduling.
+    main_verifier_deps->SortExtraStrings(GetCompilerOptions().GetDexFilesForOatFile());
     Thread::Current()->SetVerifierDeps(nullptr);
   }
 }
@@ -2126,7 +2148,27 @@ void CompilerDriver::VerifyDexFile(jobject class_loader,
                               ? verifier::HardFailLogMode::kLogInternalFatal
                               : verifier::HardFailLogMode::kLogWarning;
   VerifyClassVisitor visitor(&context, log_level);
+  // Let the verifiers on all threads share the type resolution results for this dex file, so
+  // that types which fail to resolve are looked up only once.
+  const bool share_type_resolution = GetCompilerOptions().ShareVerifierTypeResolution();
+  verifier::SharedRegTypeCache shared_reg_type_cache(&dex_file);
+  CompilerCallbacks* callbacks = Runtime::Current()->GetCompilerCallbacks();
+  if (share_type_resolution) {
+    callbacks->SetSharedRegTypeCache(&shared_reg_type_cache);
+  }
+  uint64_t start_ns = NanoTime();
   context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+  uint64_t duration_ns = NanoTime() - start_ns;
+  if (share_type_resolution) {
+    callbacks->SetSharedRegTypeCache(nullptr);
+    VLOG(compiler) << "Verified " << dex_file.NumClassDefs() << " classes of "
+                   << dex_file.GetLocation() << " in " << PrettyDuration(duration_ns)
+                   << ", " << Dumpable<verifier::SharedRegTypeCache>(shared_reg_type_cache);
+  } else {
+    VLOG(compiler) << "Verified " << dex_file.NumClassDefs() << " classes of "
+                   << dex_file.GetLocation() << " in " << PrettyDuration(duration_ns)
+                   << " without shared type resolution";
+  }
 
   // Make initialized classes visibly initialized.
   class_linker->MakeInitializedClassesVisiblyInitialized(Thread::Current(), /*wait=*/ true);
@@ -2621,12 +2663,13 @@ void CompilerDriver::InitializeClasses(jobject jni_class_loader,
                                        TimingLogger* timings) {
   TimingLogger::ScopedTiming t("InitializeNoClinit", timings);
 
-  // Initialization allocates objects and needs to run single-threaded to be deterministic.
-  bool force_determinism = GetCompilerOptions().IsForceDeterminism();
-  ThreadPool* init_thread_pool = force_determinism
+  // Initialization allocates objects and needs to run single-threaded to be deterministic
+  // when the allocation order is reflected in the output.
+  bool single_threaded = NeedsSingleThreadedAllocation();
+  ThreadPool* init_thread_pool = single_threaded
                                      ? single_thread_pool_.get()
                                      : parallel_thread_pool_.get();
-  size_t init_thread_count = force_determinism ? 1U : parallel_thread_count_;
+  size_t init_thread_count = single_threaded ? 1U : parallel_thread_count_;
 
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   ParallelCompilationManager context(
@@ -59,6 +59,7 @@ class VerifierDepsTest;
 class ArtField;
 class BitVector;
 class CompiledMethod;
+class CompiledMethodCache;
 class CompilerOptions;
 class DexCompilationUnit;
 class DexFile;
@@ -221,7 +222,23 @@ class CompilerDriver {
     return &compiled_method_storage_;
   }
 
+  // Set the cache of code compiled by a previous invocation. Not owned by the driver.
+  void SetCompiledMethodCache(CompiledMethodCache* cache) {
+    compiled_method_cache_ = cache;
+  }
+
+  CompiledMethodCache* GetCompiledMethodCache() const {
+    return compiled_method_cache_;
+  }
+
  private:
+  // Whether the phases that allocate managed objects must run on a single thread. This is only
+  // needed for deterministic images, whose layout follows the allocation order of the objects.
+  // Other outputs do not depend on the order in which classes are processed.
+  bool NeedsSingleThreadedAllocation() const {
+    return GetCompilerOptions().IsForceDeterminism() && GetCompilerOptions().IsGeneratingImage();
+  }
+
   void LoadImageClasses(TimingLogger* timings,
                         jobject class_loader,
                         /*inout*/ HashSet<std::string>* image_classes)
@@ -324,6 +341,8 @@ class CompilerDriver {
 
   CompiledMethodStorage compiled_method_storage_;
 
+  CompiledMethodCache* compiled_method_cache_;
+
   size_t max_arena_alloc_;
 
   friend class CommonCompilerDriverTest;
@@ -17,6 +17,7 @@
 #include "driver/compiler_driver.h"
 
 #include <limits>
+#include <map>
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
@@ -26,7 +27,9 @@
 #include "class_linker-inl.h"
 #include "common_compiler_driver_test.h"
 #include "compiled_method-inl.h"
+#include "compiled_method_cache.h"
 #include "compiler_callbacks.h"
+#include "dex/class_accessor-inl.h"
 #include "dex/dex_file.h"
 #include "dex/dex_file_types.h"
 #include "gc/heap.h"
@@ -362,6 +365,142 @@ TEST_F(CompilerDriverVerifyTest, RetryVerifcationStatusCheckVerified) {
   }
 }
 
+class CompilerDriverCacheTest : public CompilerDriverTest {
+ protected:
+  // Compiles `dex_files` with a cache loaded from `cache_filename` and saves the cache back.
+  void CompileWithCache(jobject class_loader,
+                        const std::vector<const DexFile*>& dex_files,
+                        const std::string& cache_filename,
+                        std::string_view environment,
+                        /*out*/ size_t* hits,
+                        /*out*/ size_t* misses) REQUIRES(!Locks::mutator_lock_) {
+    CreateCompilerDriver();
+    CompiledMethodCache cache(compiler_driver_.get(), dex_files, environment);
+    std::string error_msg;
+    ASSERT_TRUE(cache.Load(cache_filename, &error_msg)) << error_msg;
+    compiler_driver_->SetCompiledMethodCache(&cache);
+    TimingLogger timings("CompilerDriverCacheTest::CompileWithCache", false, false);
+    CompileAll(class_loader, dex_files, &timings);
+    compiler_driver_->SetCompiledMethodCache(nullptr);
+    ASSERT_TRUE(cache.Save(cache_filename, &error_msg)) << error_msg;
+    *hits = cache.GetNumberOfHits();
+    *misses = cache.GetNumberOfMisses();
+  }
+
+  std::map<std::string, std::vector<uint8_t>> GetCompiledCode(
+      const std::vector<const DexFile*>& dex_files) {
+    std::map<std::string, std::vector<uint8_t>> result;
+    for (const DexFile* dex_file : dex_files) {
+      for (uint32_t i = 0; i != dex_file->NumMethodIds(); ++i) {
+        CompiledMethod* compiled_method =
+            compiler_driver_->GetCompiledMethod(MethodReference(dex_file, i));
+        if (compiled_method != nullptr) {
+          ArrayRef<const uint8_t> code = compiled_method->GetQuickCode();
+          result.emplace(dex_file->PrettyMethod(i), std::vector<uint8_t>(code.begin(), code.end()));
+        }
+      }
+    }
+    return result;
+  }
+
+  // Returns the cache keys of the methods in `dex_files` that have one, by method name.
+  std::map<std::string, std::string> GetKeys(const std::vector<const DexFile*>& dex_files,
+                                             std::string_view environment) {
+    CompiledMethodCache cache(compiler_driver_.get(), dex_files, environment);
+    std::map<std::string, std::string> result;
+    for (const DexFile* dex_file : dex_files) {
+      for (ClassAccessor accessor : dex_file->GetClasses()) {
+        for (const ClassAccessor::Method& method : accessor.GetMethods()) {
+          std::string key;
+          if (method.GetCodeItem() != nullptr &&
+              cache.ComputeKey(method.GetReference(),
+                               accessor.GetClassDefIndex(),
+                               method.GetCodeItem(),
+                               method.GetAccessFlags(),
+                               &key)) {
+            result.emplace(dex_file->PrettyMethod(method.GetIndex()), std::move(key));
+          }
+        }
+      }
+    }
+    return result;
+  }
+};
+
+TEST_F(CompilerDriverCacheTest, ReuseCompiledMethods) {
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("ProfileTestMultiDex");
+  }
+  ASSERT_NE(class_loader, nullptr);
+  std::vector<const DexFile*> dex_files = GetDexFiles(class_loader);
+  ScratchFile cache_file;
+  ASSERT_EQ(0, unlink(cache_file.GetFilename().c_str()));
+
+  size_t hits;
+  size_t misses;
+  CompileWithCache(class_loader, dex_files, cache_file.GetFilename(), "env", &hits, &misses);
+  EXPECT_EQ(0u, hits);
+  EXPECT_NE(0u, misses);
+  std::map<std::string, std::vector<uint8_t>> expected_code = GetCompiledCode(dex_files);
+
+  // The same inputs reuse the code of the first compilation.
+  CompileWithCache(class_loader, dex_files, cache_file.GetFilename(), "env", &hits, &misses);
+  EXPECT_NE(0u, hits);
+  EXPECT_EQ(expected_code, GetCompiledCode(dex_files));
+
+  // A different environment discards the cache.
+  CompileWithCache(class_loader, dex_files, cache_file.GetFilename(), "other", &hits, &misses);
+  EXPECT_EQ(0u, hits);
+  EXPECT_EQ(expected_code, GetCompiledCode(dex_files));
+}
+
+TEST_F(CompilerDriverCacheTest, MethodsWithInvokesSurviveUnrelatedChanges) {
+  jobject original_class_loader;
+  jobject modified_class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    original_class_loader = LoadDex("MultiDex");
+    modified_class_loader = LoadDex("MultiDexModifiedSecondary");
+  }
+  ASSERT_NE(original_class_loader, nullptr);
+  ASSERT_NE(modified_class_loader, nullptr);
+  std::vector<const DexFile*> original_dex_files = GetDexFiles(original_class_loader);
+  std::vector<const DexFile*> modified_dex_files = GetDexFiles(modified_class_loader);
+  ScratchFile cache_file;
+  ASSERT_EQ(0, unlink(cache_file.GetFilename().c_str()));
+
+  size_t hits;
+  size_t misses;
+  CompileWithCache(
+      original_class_loader, original_dex_files, cache_file.GetFilename(), "env", &hits, &misses);
+  std::map<std::string, std::string> original_keys = GetKeys(original_dex_files, "env");
+  EXPECT_EQ(0u, hits);
+  EXPECT_NE(0u, misses);
+
+  // Only `Second.getSecond()` differs. The constructors call `Object.<init>()`, which may
+  // resolve to the unchanged constructors in the dex files, and are reused. `Main.main()` calls
+  // `Second.getSecond()`, which may be inlined, and is compiled again.
+  CompileWithCache(
+      modified_class_loader, modified_dex_files, cache_file.GetFilename(), "env", &hits, &misses);
+  std::map<std::string, std::string> modified_keys = GetKeys(modified_dex_files, "env");
+  EXPECT_NE(0u, hits);
+  EXPECT_NE(0u, misses);
+
+  for (const char* method : {"void Main.<init>()", "void Second.<init>()"}) {
+    ASSERT_EQ(1u, original_keys.count(method)) << method;
+    ASSERT_EQ(1u, modified_keys.count(method)) << method;
+    EXPECT_EQ(original_keys[method], modified_keys[method]) << method;
+  }
+  for (const char* method : {"void Main.main(java.lang.String[])",
+                             "java.lang.String Second.getSecond()"}) {
+    ASSERT_EQ(1u, original_keys.count(method)) << method;
+    ASSERT_EQ(1u, modified_keys.count(method)) << method;
+    EXPECT_NE(original_keys[method], modified_keys[method]) << method;
+  }
+}
+
 // TODO: need check-cast test (when stub complete & we can throw/catch
 
 }  // namespace art
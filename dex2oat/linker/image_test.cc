@@ -64,6 +64,24 @@ TEST_F(ImageTest, TestImageLayout) {
   EXPECT_LT(image_sizes.back(), image_sizes_extra.back());
 }
 
+TEST_F(ImageTest, TestHotImageObjects) {
+  // Primitive array classes are initialized and have no static fields, so they all end up in
+  // the same bin. Hot objects are moved to the start of their bin and ordered by sort key.
+  SetHotImageObjects({"[J 0", "[I 1", "[B 2"});
+  CompilationHelper helper;
+  helper.classes_to_locate = {"[J", "[I", "[B", "[Z", "[S", "[C", "[F", "[D"};
+  Compile(ImageHeader::kStorageModeUncompressed,
+          /*max_image_block_size=*/std::numeric_limits<uint32_t>::max(),
+          helper);
+  const std::vector<uintptr_t>& addresses = helper.class_image_addresses;
+  ASSERT_EQ(helper.classes_to_locate.size(), addresses.size());
+  EXPECT_LT(addresses[0], addresses[1]);
+  EXPECT_LT(addresses[1], addresses[2]);
+  for (size_t i = 3; i != addresses.size(); ++i) {
+    EXPECT_LT(addresses[2], addresses[i]) << helper.classes_to_locate[i];
+  }
+}
+
 TEST_F(ImageTest, ImageHeaderIsValid) {
   uint32_t image_begin = ART_BASE_ADDRESS;
   uint32_t image_size_ = kElfSegmentAlignment;
@@ -256,6 +274,7 @@ TEST_F(ImageTest, ImageChecksum) {
         bitmap.get(),
         ImageHeader::kStorageModeUncompressed,
         /*max_image_block_size=*/std::numeric_limits<uint32_t>::max(),
+        /*dictionary_size=*/ 0u,
         /*update_checksum=*/ true,
         &error_msg)) << error_msg;
 
@@ -272,6 +291,7 @@ TEST_F(ImageTest, ImageChecksum) {
         bitmap.get(),
         ImageHeader::kStorageModeUncompressed,
         /*max_image_block_size=*/std::numeric_limits<uint32_t>::max(),
+        /*dictionary_size=*/ 0u,
         /*update_checksum=*/ true,
         &error_msg)) << error_msg;
 
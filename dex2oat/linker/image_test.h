@@ -70,6 +70,9 @@ struct CompilationHelper {
   std::vector<ScratchFile> oat_files;
   std::vector<ScratchFile> vdex_files;
   std::string image_dir;
+  // Descriptors of classes to locate in the written image and their image addresses.
+  std::vector<std::string> classes_to_locate;
+  std::vector<uintptr_t> class_image_addresses;
 
   std::vector<size_t> GetImageObjectSectionSizes();
 
@@ -91,6 +94,10 @@ class ImageTest : public CommonCompilerDriverTest {
     compiler_filter_ = compiler_filter;
   }
 
+  void SetHotImageObjects(const std::vector<std::string>& hot_image_objects) {
+    hot_image_objects_ = hot_image_objects;
+  }
+
   void Compile(ImageHeader::StorageMode storage_mode,
                uint32_t max_image_block_size,
                /*out*/ CompilationHelper& out_helper,
@@ -129,6 +136,9 @@ class ImageTest : public CommonCompilerDriverTest {
 
   HashSet<std::string> image_classes_;
 
+  // Entries for --hot-image-objects, none if empty.
+  std::vector<std::string> hot_image_objects_;
+
   // By default we compile with "speed-profile" and an empty profile. This compiles only JNI stubs.
   CompilerFilter::Filter compiler_filter_ = CompilerFilter::kSpeedProfile;
 };
@@ -223,7 +233,10 @@ inline void ImageTest::DoCompile(ImageHeader::StorageMode storage_mode,
                                                       oat_filenames,
                                                       dex_file_to_oat_index_map,
                                                       /*class_loader=*/ nullptr,
-                                                      /*dirty_image_objects=*/ nullptr));
+                                                      /*dirty_image_objects=*/ nullptr,
+                                                      hot_image_objects_.empty()
+                                                          ? nullptr
+                                                          : &hot_image_objects_));
   {
     {
       jobject class_loader = nullptr;
@@ -287,6 +300,16 @@ inline void ImageTest::DoCompile(ImageHeader::StorageMode storage_mode,
       }
       bool image_space_ok = writer->PrepareImageAddressSpace(&timings);
       ASSERT_TRUE(image_space_ok);
+      {
+        ScopedObjectAccess soa(Thread::Current());
+        for (const std::string& descriptor : out_helper.classes_to_locate) {
+          ObjPtr<mirror::Class> klass =
+              class_linker_->LookupClass(soa.Self(), descriptor.c_str(), nullptr);
+          ASSERT_TRUE(klass != nullptr) << descriptor;
+          out_helper.class_image_addresses.push_back(
+              reinterpret_cast<uintptr_t>(writer->GetImageAddress(klass.Ptr())));
+        }
+      }
 
       DCHECK_EQ(out_helper.vdex_files.size(), out_helper.oat_files.size());
       for (size_t i = 0, size = out_helper.oat_files.size(); i != size; ++i) {
@@ -348,9 +371,12 @@ inline void ImageTest::DoCompile(ImageHeader::StorageMode storage_mode,
       }
     }
 
+    TimingLogger timings("ImageTest::Write", false, false);
     bool success_image = writer->Write(File::kInvalidFd,
                                        image_filenames,
-                                       image_filenames.size());
+                                       image_filenames.size(),
+                                       /*thread_count=*/ 2u,
+                                       &timings);
     ASSERT_TRUE(success_image);
   }
 }
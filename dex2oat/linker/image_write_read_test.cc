@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <zdict.h>
+#include <zstd.h>
+
+#include "base/time_utils.h"
 #include "image_test.h"
 
 namespace art {
@@ -22,8 +26,42 @@ namespace linker {
 class ImageWriteReadTest : public ImageTest {
  protected:
   void TestWriteRead(ImageHeader::StorageMode storage_mode, uint32_t max_image_block_size);
+
+  // Decompresses all blocks of the image `file` on this thread and logs the time it takes and
+  // the sizes, so that the storage modes can be compared.
+  void ReportDecompression(File* file,
+                           const ImageHeader& image_header,
+                           ImageHeader::StorageMode storage_mode,
+                           uint32_t max_image_block_size);
 };
 
+void ImageWriteReadTest::ReportDecompression(File* file,
+                                             const ImageHeader& image_header,
+                                             ImageHeader::StorageMode storage_mode,
+                                             uint32_t max_image_block_size) {
+  std::vector<uint8_t> data(sizeof(ImageHeader) + image_header.GetDataSize());
+  ASSERT_TRUE(file->PreadFully(data.data(), data.size(), /*offset=*/ 0));
+  ArrayRef<const uint8_t> dictionary_data;
+  ImageHeader::DecompressionDictionary dictionary;
+  std::string error_msg;
+  ASSERT_TRUE(image_header.GetCompressionDictionary(
+      data.data(), data.size(), &dictionary_data, &error_msg)) << error_msg;
+  ASSERT_TRUE(dictionary.Init(dictionary_data, &error_msg)) << error_msg;
+  std::vector<uint8_t> image(image_header.GetImageSize());
+  ImageHeader::DecompressionContext context;
+  const uint64_t start_time = NanoTime();
+  for (const ImageHeader::Block& block : image_header.GetBlocks(data.data())) {
+    ASSERT_TRUE(block.Decompress(image.data(), data.data(), dictionary, &context, &error_msg))
+        << error_msg;
+  }
+  const uint64_t decompression_time = NanoTime() - start_time;
+  LOG(INFO) << storage_mode << " image " << file->GetPath() << ": "
+            << image_header.GetImageSize() << " bytes stored in " << file->GetLength()
+            << " bytes, " << image_header.GetBlockCount() << " blocks (max block size "
+            << max_image_block_size << ", dictionary " << dictionary_data.size()
+            << " bytes), decompressed in " << PrettyDuration(decompression_time);
+}
+
 void ImageWriteReadTest::TestWriteRead(ImageHeader::StorageMode storage_mode,
                                        uint32_t max_image_block_size) {
   CompilationHelper helper;
@@ -46,6 +84,36 @@ void ImageWriteReadTest::TestWriteRead(ImageHeader::StorageMode storage_mode,
     ASSERT_TRUE(space != nullptr);
     ASSERT_TRUE(space->IsMallocSpace());
     image_file_sizes.push_back(file->GetLength());
+
+    if (storage_mode != ImageHeader::kStorageModeUncompressed) {
+      ASSERT_NO_FATAL_FAILURE(
+          ReportDecompression(file.get(), image_header, storage_mode, max_image_block_size));
+    }
+
+    if (storage_mode == ImageHeader::kStorageModeZstd &&
+        compiler_options_->ImageCompressionDictionarySize() != 0u) {
+      // A dictionary must have been trained and all blocks compressed against it.
+      std::vector<uint8_t> data(sizeof(ImageHeader) + image_header.GetDataSize());
+      ASSERT_TRUE(file->PreadFully(data.data(), data.size(), /*offset=*/ 0));
+      ArrayRef<const uint8_t> dictionary;
+      std::string error_msg;
+      ASSERT_TRUE(image_header.GetCompressionDictionary(
+          data.data(), data.size(), &dictionary, &error_msg)) << error_msg;
+      ASSERT_NE(0u, image_header.GetCompressionDictionarySize());
+      ASSERT_EQ(image_header.GetCompressionDictionarySize(), dictionary.size());
+      const unsigned dictionary_id = ZDICT_getDictID(dictionary.data(), dictionary.size());
+      ASSERT_NE(0u, dictionary_id);
+      ASSERT_NE(0u, image_header.GetBlockCount());
+      for (const ImageHeader::Block& block : image_header.GetBlocks(data.data())) {
+        EXPECT_EQ(dictionary_id,
+                  ZSTD_getDictID_fromFrame(data.data() + block.GetDataOffset(),
+                                           block.GetDataSize()));
+      }
+      // A dictionary that does not fit in the image data is rejected.
+      const size_t dictionary_end = (dictionary.data() - data.data()) + dictionary.size();
+      EXPECT_FALSE(image_header.GetCompressionDictionary(
+          data.data(), dictionary_end - 1u, &dictionary, &error_msg));
+    }
   }
 
   // Need to delete the compiler since it has worker threads which are attached to runtime.
@@ -156,5 +224,19 @@ TEST_F(ImageWriteReadTest, WriteReadLZ4HCKBBlock) {
   TestWriteRead(ImageHeader::kStorageModeLZ4HC, /*max_image_block_size=*/KB);
 }
 
+TEST_F(ImageWriteReadTest, WriteReadZstd) {
+  TestWriteRead(ImageHeader::kStorageModeZstd,
+                /*max_image_block_size=*/std::numeric_limits<uint32_t>::max());
+}
+
+TEST_F(ImageWriteReadTest, WriteReadZstdKBBlock) {
+  TestWriteRead(ImageHeader::kStorageModeZstd, /*max_image_block_size=*/KB);
+}
+
+TEST_F(ImageWriteReadTest, WriteReadZstdDictionary) {
+  compiler_options_->SetImageCompressionDictionarySize(16 * KB);
+  TestWriteRead(ImageHeader::kStorageModeZstd, /*max_image_block_size=*/16 * KB);
+}
+
 }  // namespace linker
 }  // namespace art
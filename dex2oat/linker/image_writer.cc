@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <charconv>
 #include <memory>
 #include <numeric>
@@ -29,6 +30,7 @@
 #include "android-base/strings.h"
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "base/array_ref.h"
 #include "base/callee_save_type.h"
 #include "base/globals.h"
 #include "base/logging.h"  // For VLOG.
@@ -86,6 +88,7 @@
 #include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "subtype_check.h"
+#include "thread_pool.h"
 #include "thread-current-inl.h"  // For AssertOnly1Thread.
 #include "thread_list.h"         // For AssertOnly1Thread.
 #include "well_known_classes-inl.h"
@@ -555,7 +558,9 @@ bool ImageWriter::IsInternedAppImageStringReference(ObjPtr<mirror::Object> refer
 
 bool ImageWriter::Write(int image_fd,
                         const std::vector<std::string>& image_filenames,
-                        size_t component_count) {
+                        size_t component_count,
+                        size_t thread_count,
+                        TimingLogger* timings) {
   // If image_fd or oat_fd are not File::kInvalidFd then we may have empty strings in
   // image_filenames or oat_filenames.
   CHECK(!image_filenames.empty());
@@ -568,6 +573,7 @@ bool ImageWriter::Write(int image_fd,
   Thread* const self = Thread::Current();
   ScopedDebugDisallowReadBarriers sddrb(self);
   {
+    TimingLogger::ScopedTiming t("CopyAndFixupNativeData", timings);
     ScopedObjectAccess soa(self);
     for (size_t i = 0; i < oat_filenames_.size(); ++i) {
       CreateHeader(i, component_count);
@@ -580,13 +586,16 @@ bool ImageWriter::Write(int image_fd,
     // TODO: heap validation can't handle these fix up passes.
     ScopedObjectAccess soa(self);
     Runtime::Current()->GetHeap()->DisableObjectValidation();
-    CopyAndFixupObjects();
   }
+  CopyAndFixupObjects(thread_count, timings);
 
   if (compiler_options_.IsAppImage()) {
+    TimingLogger::ScopedTiming t("CopyMetadata", timings);
     CopyMetadata();
   }
 
+  TimingLogger::ScopedTiming t("WriteImageFiles", timings);
+
   // Primary image header shall be written last for two reasons. First, this ensures
   // that we shall not end up with a valid primary image and invalid secondary image.
   // Second, its checksum shall include the checksums of the secondary images (XORed).
@@ -630,6 +639,7 @@ bool ImageWriter::Write(int image_fd,
                                  reinterpret_cast<const uint8_t*>(image_info.image_bitmap_.Begin()),
                                  image_storage_mode_,
                                  compiler_options_.MaxImageBlockSize(),
+                                 compiler_options_.ImageCompressionDictionarySize(),
                                  /* update_checksum= */ true,
                                  &error_msg)) {
       LOG(ERROR) << error_msg;
@@ -1594,9 +1604,12 @@ class ImageWriter::LayoutHelper {
   void ProcessDexFileObjects(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
   void ProcessRoots(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
   void FinalizeInternTables() REQUIRES_SHARED(Locks::mutator_lock_);
-  // Recreate dirty object offsets (kKnownDirty bin) with objects sorted by sort_key.
-  void SortDirtyObjects(const HashMap<mirror::Object*, uint32_t>& dirty_objects, size_t oat_index)
-      REQUIRES_SHARED(Locks::mutator_lock_);
+  // Recreate object offsets in the `bin` with objects sorted by their sort_key. Objects without
+  // an entry in `sort_keys` use the `default_sort_key`, ties keep the original order.
+  void SortBinObjects(Bin bin,
+                      const HashMap<mirror::Object*, uint32_t>& sort_keys,
+                      uint32_t default_sort_key,
+                      size_t oat_index) REQUIRES_SHARED(Locks::mutator_lock_);
 
   void VerifyImageBinSlotsAssigned() REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -1945,7 +1958,8 @@ void ImageWriter::LayoutHelper::ProcessDexFileObjects(Thread* self) {
   JavaVMExt* vm = down_cast<JNIEnvExt*>(self->GetJniEnv())->GetVm();
 
   // To ensure deterministic output, populate the work queue with objects in a pre-defined order.
-  // Note: If we decide to implement a profile-guided layout, this is the place to do so.
+  // Objects listed in hot-image-objects are moved to the start of their bins only after all
+  // objects have been assigned, see `SortBinObjects()`.
 
   // Get initial work queue with the image classes and assign their bin slots.
   CollectClassesVisitor visitor(image_writer_);
@@ -1980,11 +1994,33 @@ void ImageWriter::LayoutHelper::ProcessDexFileObjects(Thread* self) {
   }
   DCHECK(work_queue_.empty());
   work_queue_ = visitor.ProcessCollectedClasses(self);
+
+  // Native relocations are assigned in order, so record the fields and methods of hot classes
+  // first, ordered by their sort keys, to cluster them at the start of the native bins.
+  const HashMap<mirror::Object*, uint32_t>& hot_objects = image_writer_->hot_objects_;
+  if (!hot_objects.empty()) {
+    // Pairs of sort key and work queue index.
+    dchecked_vector<std::pair<uint32_t, size_t>> hot_classes;
+    for (size_t i = 0, size = work_queue_.size(); i != size; ++i) {
+      auto it = hot_objects.find(work_queue_[i].first.Ptr());
+      if (it != hot_objects.end()) {
+        hot_classes.emplace_back(it->second, i);
+      }
+    }
+    std::sort(hot_classes.begin(), hot_classes.end());
+    for (const std::pair<uint32_t, size_t>& hot_class : hot_classes) {
+      const std::pair<ObjPtr<mirror::Object>, size_t>& entry = work_queue_[hot_class.second];
+      image_writer_->RecordNativeRelocations(entry.first->AsClass(), entry.second);
+    }
+  }
+
   for (const std::pair<ObjPtr<mirror::Object>, size_t>& entry : work_queue_) {
     DCHECK(entry.first != nullptr);
     ObjPtr<mirror::Class> klass = entry.first->AsClass();
     size_t oat_index = entry.second;
-    image_writer_->RecordNativeRelocations(klass, oat_index);
+    if (hot_objects.find(klass.Ptr()) == hot_objects.end()) {
+      image_writer_->RecordNativeRelocations(klass, oat_index);
+    }
     AssignImageBinSlot(klass.Ptr(), oat_index);
 
     auto method_pointer_array_visitor =
@@ -2219,13 +2255,14 @@ void ImageWriter::LayoutHelper::ProcessWorkQueue() {
   }
 }
 
-void ImageWriter::LayoutHelper::SortDirtyObjects(
-    const HashMap<mirror::Object*, uint32_t>& dirty_objects, size_t oat_index) {
-  constexpr Bin bin = Bin::kKnownDirty;
+void ImageWriter::LayoutHelper::SortBinObjects(Bin bin,
+                                               const HashMap<mirror::Object*, uint32_t>& sort_keys,
+                                               uint32_t default_sort_key,
+                                               size_t oat_index) {
   ImageInfo& image_info = image_writer_->GetImageInfo(oat_index);
 
-  dchecked_vector<mirror::Object*>& known_dirty = bin_objects_[oat_index][enum_cast<size_t>(bin)];
-  if (known_dirty.empty()) {
+  dchecked_vector<mirror::Object*>& bin_objects = bin_objects_[oat_index][enum_cast<size_t>(bin)];
+  if (bin_objects.empty()) {
     return;
   }
 
@@ -2234,26 +2271,34 @@ void ImageWriter::LayoutHelper::SortDirtyObjects(
   using CombinedKey = std::pair<uint32_t, uint32_t>;
   using ObjSortPair = std::pair<mirror::Object*, CombinedKey>;
   dchecked_vector<ObjSortPair> objects;
-  objects.reserve(known_dirty.size());
-  for (mirror::Object* obj : known_dirty) {
+  objects.reserve(bin_objects.size());
+  size_t num_keyed_objects = 0u;
+  for (mirror::Object* obj : bin_objects) {
     const BinSlot bin_slot = image_writer_->GetImageBinSlot(obj, oat_index);
     const uint32_t original_offset = bin_slot.GetOffset();
-    const auto it = dirty_objects.find(obj);
-    const uint32_t sort_key = (it != dirty_objects.end()) ? it->second : 0;
+    const auto it = sort_keys.find(obj);
+    uint32_t sort_key = default_sort_key;
+    if (it != sort_keys.end()) {
+      sort_key = it->second;
+      ++num_keyed_objects;
+    }
     objects.emplace_back(obj, std::make_pair(sort_key, original_offset));
   }
+  if (num_keyed_objects == 0u) {
+    return;  // Nothing to reorder.
+  }
   // Sort by combined sort_key.
   std::sort(std::begin(objects), std::end(objects), [&](ObjSortPair& lhs, ObjSortPair& rhs) {
     return lhs.second < rhs.second;
   });
 
-  // Fill known_dirty objects in sorted order, update bin offsets.
-  known_dirty.clear();
+  // Fill bin objects in sorted order, update bin offsets.
+  bin_objects.clear();
   size_t offset = 0;
   for (const ObjSortPair& entry : objects) {
     mirror::Object* obj = entry.first;
 
-    known_dirty.push_back(obj);
+    bin_objects.push_back(obj);
     image_writer_->UpdateImageBinSlotOffset(obj, oat_index, offset);
 
     const size_t aligned_object_size = RoundUp(obj->SizeOf<kVerifyNone>(), kObjectAlignment);
@@ -2604,6 +2649,14 @@ void ImageWriter::CalculateNewObjectOffsets() {
                             dirty_objects_.size(),
                             dirty_image_objects_->size());
   }
+  // Likewise for hot-image-objects, used for both boot and app images. The objects stay in the
+  // bins chosen by `GetImageBin()` and are moved to the start of the bin below.
+  if (hot_image_objects_ != nullptr) {
+    hot_objects_ = MatchDirtyObjectPaths(*hot_image_objects_);
+    LOG(INFO) << ART_FORMAT("Matched {} out of {} hot-image-objects",
+                            hot_objects_.size(),
+                            hot_image_objects_->size());
+  }
 
   LayoutHelper layout_helper(this);
   layout_helper.ProcessDexFileObjects(self);
@@ -2613,7 +2666,25 @@ void ImageWriter::CalculateNewObjectOffsets() {
   // Sort objects in dirty bin.
   if (!dirty_objects_.empty()) {
     for (size_t oat_index = 0; oat_index < image_infos_.size(); ++oat_index) {
-      layout_helper.SortDirtyObjects(dirty_objects_, oat_index);
+      layout_helper.SortBinObjects(
+          Bin::kKnownDirty, dirty_objects_, /*default_sort_key=*/ 0u, oat_index);
+    }
+  }
+
+  // Move hot objects to the start of their bins so that the objects accessed during startup
+  // share as few pages as possible with cold objects. The string bin is excluded as intern
+  // tables depend on the order of its objects.
+  if (!hot_objects_.empty()) {
+    for (size_t oat_index = 0; oat_index < image_infos_.size(); ++oat_index) {
+      for (size_t i = 0; i != enum_cast<size_t>(Bin::kMirrorCount); ++i) {
+        Bin bin = enum_cast<Bin>(i);
+        if (bin != Bin::kKnownDirty && bin != Bin::kString) {
+          layout_helper.SortBinObjects(bin,
+                                       hot_objects_,
+                                       /*default_sort_key=*/ std::numeric_limits<uint32_t>::max(),
+                                       oat_index);
+        }
+      }
     }
   }
 
@@ -3153,7 +3224,9 @@ inline Object* ImageWriter::CopyObject(Object* obj) {
   DCHECK_LT(offset, image_info.image_end_);
   const auto* src = reinterpret_cast<const uint8_t*>(obj);
 
-  bool done = image_info.image_bitmap_.Set(dst);  // Mark the obj as live.
+  // Mark the obj as live. Neighbouring objects share bitmap words and may be copied
+  // concurrently, so the bitmap must be updated atomically.
+  bool done = image_info.image_bitmap_.AtomicTestAndSet(dst);
   // Check if the object was already copied, unless the caller indicated that it was not.
   if (kCheckIfDone && done) {
     return nullptr;
@@ -3224,7 +3297,86 @@ class ImageWriter::FixupVisitor {
   mirror::Object* const copy_;
 };
 
-void ImageWriter::CopyAndFixupObjects() {
+// Copies and fixes up a range of the objects collected by `CopyAndFixupObjects()`.
+class ImageWriter::CopyAndFixupObjectsTask final : public Task {
+ public:
+  CopyAndFixupObjectsTask(ImageWriter* image_writer, ArrayRef<mirror::Object* const> objects)
+      : image_writer_(image_writer), objects_(objects) {}
+
+  void Run(Thread* self) override {
+    ScopedDebugDisallowReadBarriers sddrb(self);
+    ScopedObjectAccess soa(self);
+    for (mirror::Object* obj : objects_) {
+      image_writer_->CopyAndFixupObject(obj);
+    }
+  }
+
+  void Finalize() override {
+    delete this;
+  }
+
+ private:
+  ImageWriter* const image_writer_;
+  const ArrayRef<mirror::Object* const> objects_;
+};
+
+void ImageWriter::CopyAndFixupObjects(size_t thread_count, TimingLogger* timings) {
+  Thread* const self = Thread::Current();
+  std::vector<mirror::Object*> objects;
+  {
+    TimingLogger::ScopedTiming t("CopyAndFixupMethodPointerArrays", timings);
+    ScopedObjectAccess soa(self);
+    CopyAndFixupMethodPointerArrays();
+    // Collect the objects to copy. Once the bin slots are assigned, each object is copied
+    // to its own location and only reads the source heap and the relocation data, so the
+    // objects can be processed in any order.
+    auto visitor = [&](Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      DCHECK(obj != nullptr);
+      if (IsImageBinSlotAssigned(obj)) {
+        objects.push_back(obj);
+      }
+    };
+    Runtime::Current()->GetHeap()->VisitObjects(visitor);
+  }
+
+  {
+    TimingLogger::ScopedTiming t("CopyAndFixupObjects", timings);
+    // Split the work into enough chunks to balance the load between the threads.
+    static constexpr size_t kMinObjectsPerTask = 1024u;
+    size_t num_tasks = std::min(thread_count * 8u, objects.size() / kMinObjectsPerTask);
+    if (thread_count <= 1u || num_tasks <= 1u) {
+      ScopedObjectAccess soa(self);
+      for (mirror::Object* obj : objects) {
+        CopyAndFixupObject(obj);
+      }
+    } else {
+      std::unique_ptr<ThreadPool> thread_pool(
+          ThreadPool::Create("Image writer thread pool", thread_count - 1u));
+      ArrayRef<mirror::Object* const> all_objects(objects);
+      size_t begin = 0u;
+      for (size_t i = 0; i != num_tasks; ++i) {
+        size_t end = (objects.size() * (i + 1u)) / num_tasks;
+        thread_pool->AddTask(self,
+                             new CopyAndFixupObjectsTask(this,
+                                                         all_objects.SubArray(begin, end - begin)));
+        begin = end;
+      }
+      DCHECK_EQ(begin, objects.size());
+      thread_pool->StartWorkers(self);
+      thread_pool->Wait(self, /* do_work= */ true, /* may_hold_locks= */ false);
+      thread_pool->StopWorkers(self);
+    }
+  }
+
+  TimingLogger::ScopedTiming t("FillPaddingObjects", timings);
+  ScopedObjectAccess soa(self);
+  FillPaddingObjects();
+
+  // We no longer need the hashcode map, values have already been copied to target objects.
+  saved_hashcode_map_.clear();
+}
+
+void ImageWriter::CopyAndFixupMethodPointerArrays() {
   // Copy and fix up pointer arrays first as they require special treatment.
   auto method_pointer_array_visitor =
       [&](ObjPtr<mirror::PointerArray> pointer_array) REQUIRES_SHARED(Locks::mutator_lock_) {
@@ -3247,12 +3399,9 @@ void ImageWriter::CopyAndFixupObjects() {
     }
   }
 
-  auto visitor = [&](Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
-    DCHECK(obj != nullptr);
-    CopyAndFixupObject(obj);
-  };
-  Runtime::Current()->GetHeap()->VisitObjects(visitor);
+}
 
+void ImageWriter::FillPaddingObjects() {
   // Fill the padding objects since they are required for in order traversal of the image space.
   for (ImageInfo& image_info : image_infos_) {
     for (const size_t start_offset : image_info.padding_offsets_) {
@@ -3274,9 +3423,6 @@ void ImageWriter::CopyAndFixupObjects() {
       }
     }
   }
-
-  // We no longer need the hashcode map, values have already been copied to target objects.
-  saved_hashcode_map_.clear();
 }
 
 class ImageWriter::FixupClassVisitor final : public FixupVisitor {
@@ -3779,7 +3925,8 @@ ImageWriter::ImageWriter(const CompilerOptions& compiler_options,
                          const std::vector<std::string>& oat_filenames,
                          const HashMap<const DexFile*, size_t>& dex_file_oat_index_map,
                          jobject class_loader,
-                         const std::vector<std::string>* dirty_image_objects)
+                         const std::vector<std::string>* dirty_image_objects,
+                         const std::vector<std::string>* hot_image_objects)
     : compiler_options_(compiler_options),
       target_ptr_size_(InstructionSetPointerSize(compiler_options.GetInstructionSet())),
       // If we're compiling a boot image and we have a profile, set methods as being shared
@@ -3803,7 +3950,8 @@ ImageWriter::ImageWriter(const CompilerOptions& compiler_options,
       image_storage_mode_(image_storage_mode),
       oat_filenames_(oat_filenames),
       dex_file_oat_index_map_(dex_file_oat_index_map),
-      dirty_image_objects_(dirty_image_objects) {
+      dirty_image_objects_(dirty_image_objects),
+      hot_image_objects_(hot_image_objects) {
   DCHECK(compiler_options.IsBootImage() ||
          compiler_options.IsBootImageExtension() ||
          compiler_options.IsAppImage());
@@ -84,7 +84,8 @@ class ImageWriter final {
               const std::vector<std::string>& oat_filenames,
               const HashMap<const DexFile*, size_t>& dex_file_oat_index_map,
               jobject class_loader,
-              const std::vector<std::string>* dirty_image_objects);
+              const std::vector<std::string>* dirty_image_objects,
+              const std::vector<std::string>* hot_image_objects);
   ~ImageWriter();
 
   /*
@@ -153,9 +154,12 @@ class ImageWriter final {
   // the names in image_filenames.
   // If oat_fd is not File::kInvalidFd, then we use that for the oat file. Otherwise we open
   // the names in oat_filenames.
+  // The objects are copied and fixed up using `thread_count` threads.
   bool Write(int image_fd,
              const std::vector<std::string>& image_filenames,
-             size_t component_count)
+             size_t component_count,
+             size_t thread_count,
+             TimingLogger* timings)
       REQUIRES(!Locks::mutator_lock_);
 
   uintptr_t GetOatDataBegin(size_t oat_index) {
@@ -463,7 +467,10 @@ class ImageWriter final {
   // Creates the contiguous image in memory and adjusts pointers.
   void CopyAndFixupNativeData(size_t oat_index) REQUIRES_SHARED(Locks::mutator_lock_);
   void CopyAndFixupJniStubMethods(size_t oat_index) REQUIRES_SHARED(Locks::mutator_lock_);
-  void CopyAndFixupObjects() REQUIRES_SHARED(Locks::mutator_lock_);
+  void CopyAndFixupObjects(size_t thread_count, TimingLogger* timings)
+      REQUIRES(!Locks::mutator_lock_);
+  void CopyAndFixupMethodPointerArrays() REQUIRES_SHARED(Locks::mutator_lock_);
+  void FillPaddingObjects() REQUIRES_SHARED(Locks::mutator_lock_);
   void CopyAndFixupObject(mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_);
   template <bool kCheckIfDone>
   mirror::Object* CopyObject(mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_);
@@ -706,12 +713,21 @@ class ImageWriter final {
   // Dirty object instances and their sort keys parsed from dirty_image_object_
   HashMap<mirror::Object*, uint32_t> dirty_objects_;
 
+  // Set of classes/objects accessed during startup, in the same format as dirty_image_objects_.
+  // Can be nullptr if there are none. These objects are placed at the start of their bins and
+  // the fields and methods of listed classes at the start of the native bins.
+  const std::vector<std::string>* hot_image_objects_;
+
+  // Hot object instances and their sort keys parsed from hot_image_objects_.
+  HashMap<mirror::Object*, uint32_t> hot_objects_;
+
   // Objects are guaranteed to not cross the region size boundary.
   size_t region_size_ = 0u;
 
   // Region alignment bytes wasted.
   size_t region_alignment_wasted_ = 0u;
 
+  class CopyAndFixupObjectsTask;
   class FixupClassVisitor;
   class FixupRootVisitor;
   class FixupVisitor;
@@ -892,6 +892,8 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
 // See also OrderedMethodVisitor.
 struct OatWriter::OrderedMethodData {
   uint32_t hotness_bits;
+  // Position in the profile's startup order, used with --startup-ordered-code-layout.
+  uint32_t startup_sequence_index;
   OatClass* oat_class;
   CompiledMethod* compiled_method;
   MethodReference method_reference;
@@ -923,6 +925,10 @@ struct OatWriter::OrderedMethodData {
   //  -- post-startup
   //
   // (See MethodHotness enum definition for up-to-date binning order.)
+  //
+  // With --startup-ordered-code-layout, methods with a position in the startup order precede
+  // all bins, in the order in which they were first executed, so that startup code is
+  // contiguous and read-ahead brings in code that is about to run.
   bool operator<(const OrderedMethodData& other) const {
     if (kOatWriterForceOatCodeLayout) {
       // Development flag: Override default behavior by sorting by name.
@@ -932,7 +938,10 @@ struct OatWriter::OrderedMethodData {
       return name < other_name;
     }
 
-    // Use the profile's method hotness to determine sort order.
+    // Use the profile's startup order and then method hotness to determine sort order.
+    if (startup_sequence_index != other.startup_sequence_index) {
+      return startup_sequence_index < other.startup_sequence_index;
+    }
     if (hotness_bits < other.hotness_bits) {
       return true;
     }
@@ -1053,6 +1062,7 @@ class OatWriter::LayoutCodeMethodVisitor final : public OatDexMethodVisitor {
       uint32_t method_index = method.GetIndex();
       MethodReference method_ref(dex_file_, method_index);
       uint32_t hotness_bits = 0u;
+      uint32_t startup_sequence_index = ProfileCompilationInfo::kNoStartupSequenceIndex;
       if (profile_index_ != ProfileCompilationInfo::MaxProfileIndex()) {
         ProfileCompilationInfo* pci = writer_->profile_compilation_info_;
         DCHECK(pci != nullptr);
@@ -1074,11 +1084,15 @@ class OatWriter::LayoutCodeMethodVisitor final : public OatDexMethodVisitor {
                          << "either start-up or post-startup. Possible corrupted profile?";
           }
         }
+        if (writer_->GetCompilerOptions().StartupOrderedCodeLayout()) {
+          startup_sequence_index = pci->GetStartupSequenceIndex(profile_index_, method_index);
+        }
       }
 
       // Handle duplicate methods by pushing them repeatedly.
       OrderedMethodData method_data = {
           hotness_bits,
+          startup_sequence_index,
           oat_class,
           compiled_method,
           method_ref,
@@ -2346,7 +2360,9 @@ size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
                   << "@ offset "
                   << relative_patcher_->GetOffset(ordered_method.method_reference)
                   << " X hotness "
-                  << ordered_method.hotness_bits;
+                  << ordered_method.hotness_bits
+                  << " X startup sequence "
+                  << ordered_method.startup_sequence_index;
       }
     }
   }
@@ -371,6 +371,38 @@ TEST_F(VerifierDepsTest, StringToId) {
   ASSERT_NE(id_Main1, id_Lorem1);
 }
 
+TEST_F(VerifierDepsTest, SortExtraStrings) {
+  ScopedObjectAccess soa(Thread::Current());
+  LoadDexFile(soa);
+  const DexFile& dex_file = *primary_dex_file_;
+  uint32_t num_ids_in_dex = dex_file.NumStringIds();
+
+  // Extra strings are numbered in the order in which they are first seen.
+  dex::StringIndex id_Main = verifier_deps_->GetIdFromString(dex_file, "LMain;");
+  dex::StringIndex id_b = verifier_deps_->GetIdFromString(dex_file, "Lb/Extra;");
+  dex::StringIndex id_a = verifier_deps_->GetIdFromString(dex_file, "La/Extra;");
+  ASSERT_EQ(num_ids_in_dex, id_b.index_);
+  ASSERT_EQ(num_ids_in_dex + 1u, id_a.index_);
+
+  VerifierDeps::DexFileDeps* deps = verifier_deps_->GetDexFileDeps(dex_file);
+  ASSERT_FALSE(deps->assignable_types_.empty());
+  deps->assignable_types_[0].emplace(id_b, id_Main);
+  deps->assignable_types_[0].emplace(id_Main, id_a);
+
+  verifier_deps_->SortExtraStrings(dex_files_);
+
+  dex::StringIndex new_id_a(num_ids_in_dex);
+  dex::StringIndex new_id_b(num_ids_in_dex + 1u);
+  ASSERT_EQ("La/Extra;", verifier_deps_->GetStringFromId(dex_file, new_id_a));
+  ASSERT_EQ("Lb/Extra;", verifier_deps_->GetStringFromId(dex_file, new_id_b));
+  ASSERT_EQ(new_id_b, verifier_deps_->GetIdFromString(dex_file, "Lb/Extra;"));
+  ASSERT_EQ(2u, deps->assignable_types_[0].size());
+  ASSERT_EQ(1u, deps->assignable_types_[0].count(
+      VerifierDeps::TypeAssignability(new_id_b, id_Main)));
+  ASSERT_EQ(1u, deps->assignable_types_[0].count(
+      VerifierDeps::TypeAssignability(id_Main, new_id_a)));
+}
+
 TEST_F(VerifierDepsTest, Assignable_BothInBoot) {
   ASSERT_TRUE(TestAssignabilityRecording(/* dst= */ "Ljava/util/TimeZone;",
                                          /* src= */ "Ljava/util/SimpleTimeZone;"));
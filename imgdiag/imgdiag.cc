@@ -20,8 +20,11 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <map>
 #include <optional>
 #include <ostream>
@@ -34,6 +37,7 @@
 #include "art_field-inl.h"
 #include "art_method-inl.h"
 #include "base/array_ref.h"
+#include "base/casts.h"
 #include "base/os.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -439,22 +443,23 @@ struct ParentInfo {
 
 using ParentMap = std::unordered_map<mirror::Object*, ParentInfo>;
 
-// Returns the "path" from root class to an object in the format:
-// <dex_location> <class_descriptor>(.<field_name>:<field_type_descriptor>)*
-// <dex_location> is either a full path to the dex file where the class is
-// defined or "primitive" if the class is a primitive array.
-std::string GetPathFromClass(mirror::Object* obj, const ParentMap& parent_map)
+// Returns the root class of an object and sets `path` to the "path" from the root class
+// to the object in the format: <class_descriptor>(.<field_name>:<field_type_descriptor>)*
+// Returns null if there is no path from a class to the object.
+ObjPtr<mirror::Class> GetReferencePathFromClass(mirror::Object* obj,
+                                                const ParentMap& parent_map,
+                                                /*out*/ std::string* path)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   auto parent_info_it = parent_map.find(obj);
-  std::string path;
+  path->clear();
   while (parent_info_it != parent_map.end() && parent_info_it->second.parent != nullptr) {
     const ParentInfo& parent_info = parent_info_it->second;
-    path = ART_FORMAT(".{}{}", parent_info.path, path);
+    *path = ART_FORMAT(".{}{}", parent_info.path, *path);
     parent_info_it = parent_map.find(parent_info.parent);
   }
 
   if (parent_info_it == parent_map.end()) {
-    return "<no path from class>";
+    return nullptr;
   }
 
   mirror::Object* class_obj = parent_info_it->first;
@@ -462,7 +467,21 @@ std::string GetPathFromClass(mirror::Object* obj, const ParentMap& parent_map)
 
   std::string temp;
   ObjPtr<mirror::Class> klass = class_obj->AsClass();
-  path = klass->GetDescriptor(&temp) + path;
+  *path = klass->GetDescriptor(&temp) + *path;
+  return klass;
+}
+
+// Returns the "path" from root class to an object in the format:
+// <dex_location> <class_descriptor>(.<field_name>:<field_type_descriptor>)*
+// <dex_location> is either a full path to the dex file where the class is
+// defined or "primitive" if the class is a primitive array.
+std::string GetPathFromClass(mirror::Object* obj, const ParentMap& parent_map)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  std::string path;
+  ObjPtr<mirror::Class> klass = GetReferencePathFromClass(obj, parent_map, &path);
+  if (klass == nullptr) {
+    return "<no path from class>";
+  }
 
   // Prepend dex location to the path.
   // Use array value type if class is an array.
@@ -1277,11 +1296,13 @@ class ImgDiagDumper {
   explicit ImgDiagDumper(std::ostream* os,
                          pid_t image_diff_pid,
                          pid_t zygote_diff_pid,
-                         bool dump_dirty_objects)
+                         bool dump_dirty_objects,
+                         bool dump_hot_objects)
       : os_(os),
         image_diff_pid_(image_diff_pid),
         zygote_diff_pid_(zygote_diff_pid),
         dump_dirty_objects_(dump_dirty_objects),
+        dump_hot_objects_(dump_hot_objects),
         zygote_pid_only_(false) {}
 
   bool Init() {
@@ -1408,12 +1429,236 @@ class ImgDiagDumper {
       os << "\n\n";
     }
 
+    if (ret && dump_hot_objects_) {
+      DumpHotObjects(image_header, image_location, parent_map);
+      os << "\n\n";
+    }
+
     os << std::flush;
 
     return ret;
   }
 
+  // Records for each page of the image mappings of the image-diff process the index of the first
+  // of `num_samples` snapshots in which the page was accessed. Pages that are already resident
+  // in the first snapshot, most of them shared with the zygote, are marked idle through
+  // /sys/kernel/mm/page_idle/bitmap and count as accessed only once the kernel clears their
+  // idle flag. Pages that were not resident count as accessed once they become present or are
+  // replaced by a private copy. Started right after the process is launched, this approximates
+  // the order in which image pages are first accessed during startup without reporting pages
+  // that are merely resident because the zygote touched them.
+  bool SampleTouchedPages(const std::vector<gc::space::ImageSpace*>& image_spaces,
+                          size_t num_samples,
+                          uint32_t sample_interval_ms) {
+    std::ostream& os = *os_;
+    if (num_samples < 2u) {
+      os << "At least two samples are needed to find touched pages";
+      return false;
+    }
+    std::unique_ptr<File> page_idle_file(OS::OpenFileReadWrite(kPageIdleBitmapPath));
+    if (page_idle_file == nullptr) {
+      os << "Failed to open " << kPageIdleBitmapPath << " for reading and writing: "
+         << strerror(errno) << "; --dump-hot-objects needs CONFIG_IDLE_PAGE_TRACKING";
+      return false;
+    }
+
+    struct SampledMapping {
+      uintptr_t start;
+      std::vector<uint32_t>* first_touch_samples;
+      // The pagemap entries of the first sample.
+      std::vector<uint64_t> initial_page_map_entries;
+    };
+    std::vector<SampledMapping> mappings;
+    for (gc::space::ImageSpace* image_space : image_spaces) {
+      const ImageHeader& image_header = image_space->GetImageHeader();
+      std::optional<android::procinfo::MapInfo> maybe_map =
+          FindImageMap(image_proc_maps_, image_space->GetImageLocation(), "image");
+      if (!maybe_map) {
+        return false;
+      }
+      size_t num_pages = RoundUp(image_header.GetImageSize(), MemMap::GetPageSize()) /
+                         MemMap::GetPageSize();
+      std::vector<uint32_t>* first_touch_samples =
+          &first_touch_samples_[image_space->GetImageLocation()];
+      first_touch_samples->assign(num_pages, kNotTouched);
+      mappings.push_back({maybe_map->start, first_touch_samples, {}});
+    }
+
+    std::vector<uint64_t> page_map_entries;
+    std::vector<uint64_t> page_frame_numbers;
+    std::vector<size_t> page_indexes;
+    std::unique_ptr<bool[]> page_idle;
+    std::string error_msg;
+    for (size_t sample = 0; sample != num_samples; ++sample) {
+      if (sample != 0u) {
+        usleep(sample_interval_ms * 1000u);
+      }
+      for (SampledMapping& mapping : mappings) {
+        std::vector<uint32_t>& first_touch_samples = *mapping.first_touch_samples;
+        page_map_entries.resize(first_touch_samples.size());
+        if (!GetPageMapEntries(image_pagemap_file_,
+                               mapping.start / MemMap::GetPageSize(),
+                               ArrayRef<uint64_t>(page_map_entries),
+                               error_msg)) {
+          os << error_msg;
+          return false;
+        }
+        page_frame_numbers.clear();
+        page_indexes.clear();
+        for (size_t i = 0; i != first_touch_samples.size(); ++i) {
+          uint64_t entry = page_map_entries[i];
+          if (first_touch_samples[i] != kNotTouched || (entry & kPageMapPresentMask) == 0u) {
+            continue;
+          }
+          if (sample != 0u &&
+              (mapping.initial_page_map_entries[i] & kPageMapPresentMask) != 0u &&
+              (mapping.initial_page_map_entries[i] & kPageFrameNumberMask) ==
+                  (entry & kPageFrameNumberMask)) {
+            // Same page frame as in the first sample, check whether it is still idle.
+            page_frame_numbers.push_back(entry & kPageFrameNumberMask);
+            page_indexes.push_back(i);
+          } else if (sample != 0u) {
+            // Faulted in or copied on write since the first sample.
+            first_touch_samples[i] = dchecked_integral_cast<uint32_t>(sample);
+          } else {
+            page_frame_numbers.push_back(entry & kPageFrameNumberMask);
+          }
+        }
+        if (page_frame_numbers.empty()) {
+          // Nothing to do.
+        } else if (sample == 0u) {
+          if (!MarkPagesIdle(*page_idle_file,
+                             ArrayRef<const uint64_t>(page_frame_numbers),
+                             error_msg)) {
+            os << error_msg;
+            return false;
+          }
+        } else {
+          page_idle.reset(new bool[page_frame_numbers.size()]);
+          if (!GetPagesIdle(*page_idle_file,
+                            ArrayRef<const uint64_t>(page_frame_numbers),
+                            ArrayRef<bool>(page_idle.get(), page_frame_numbers.size()),
+                            error_msg)) {
+            os << error_msg;
+            return false;
+          }
+          for (size_t j = 0; j != page_indexes.size(); ++j) {
+            if (!page_idle[j]) {
+              first_touch_samples[page_indexes[j]] = dchecked_integral_cast<uint32_t>(sample);
+            }
+          }
+        }
+        if (sample == 0u) {
+          mapping.initial_page_map_entries = page_map_entries;
+        }
+      }
+    }
+    return true;
+  }
+
  private:
+  static constexpr uint32_t kNotTouched = std::numeric_limits<uint32_t>::max();
+
+  // Prints the objects on touched pages in the format of --hot-image-objects for dex2oat,
+  // with the first sample in which the object was touched as the sort key. ArtMethods on
+  // touched pages are reported as their declaring class, which makes dex2oat cluster the
+  // methods of the class.
+  void DumpHotObjects(const ImageHeader& image_header,
+                      const std::string& image_location,
+                      const ParentMap& parent_map) REQUIRES_SHARED(Locks::mutator_lock_) {
+    std::ostream& os = *os_;
+    auto it = first_touch_samples_.find(image_location);
+    if (it == first_touch_samples_.end()) {
+      os << "No page samples for " << image_location << "\n";
+      return;
+    }
+    const std::vector<uint32_t>& first_touch_samples = it->second;
+
+    // The local image has the same layout as the remote one, only the address may differ.
+    uint8_t* image_begin = image_header.GetImageBegin();
+    const uint8_t* map_begin = AlignDown(image_begin, MemMap::GetPageSize());
+    auto get_first_touch = [&](const void* entry, size_t size) {
+      const uint8_t* begin = reinterpret_cast<const uint8_t*>(entry);
+      size_t first_page = (begin - map_begin) / MemMap::GetPageSize();
+      size_t last_page = (begin + size - 1u - map_begin) / MemMap::GetPageSize();
+      uint32_t result = kNotTouched;
+      for (size_t page = first_page; page <= last_page && page < first_touch_samples.size();
+           ++page) {
+        result = std::min(result, first_touch_samples[page]);
+      }
+      return result;
+    };
+
+    // Use an ordered map for deterministic output.
+    std::map<std::string, uint32_t> hot_paths;
+    std::string path;
+    auto record = [&](mirror::Object* obj, uint32_t first_touch)
+        REQUIRES_SHARED(Locks::mutator_lock_) {
+      if (first_touch == kNotTouched ||
+          GetReferencePathFromClass(obj, parent_map, &path) == nullptr) {
+        return;
+      }
+      auto [path_it, inserted] = hot_paths.emplace(path, first_touch);
+      if (!inserted) {
+        path_it->second = std::min(path_it->second, first_touch);
+      }
+    };
+
+    PointerSize pointer_size = image_header.GetPointerSize();
+    ImgObjectVisitor object_visitor([&](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      record(obj, get_first_touch(obj, obj->SizeOf()));
+    });
+    image_header.VisitObjects(&object_visitor, image_begin, pointer_size);
+    image_header.VisitPackedArtMethods(
+        [&](ArtMethod& method) REQUIRES_SHARED(Locks::mutator_lock_) {
+          ObjPtr<mirror::Class> declaring_class = method.GetDeclaringClassUnchecked();
+          if (declaring_class != nullptr) {
+            record(declaring_class.Ptr(),
+                   get_first_touch(&method, ArtMethod::Size(pointer_size)));
+          }
+        },
+        image_begin,
+        pointer_size);
+
+    std::vector<std::pair<uint32_t, const std::string*>> sorted_paths;
+    sorted_paths.reserve(hot_paths.size());
+    for (const auto& [hot_path, first_touch] : hot_paths) {
+      sorted_paths.emplace_back(first_touch, &hot_path);
+    }
+    std::stable_sort(sorted_paths.begin(),
+                     sorted_paths.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    os << "Hot objects (" << sorted_paths.size() << ")\n";
+    for (const auto& [first_touch, hot_path] : sorted_paths) {
+      os << "hot_obj: " << *hot_path << " " << first_touch << "\n";
+    }
+  }
+
+  // Finds the writable mapping of the image with the given location.
+  std::optional<android::procinfo::MapInfo> FindImageMap(
+      const std::vector<android::procinfo::MapInfo>& maps,
+      const std::string& image_location,
+      const char* tag) {
+    std::string image_location_base_name = GetImageLocationBaseName(image_location);
+    // Find the memory map for the current boot image component.
+    for (const android::procinfo::MapInfo& map_info : maps) {
+      // The map name ends with ']' if it's an anonymous memmap. We need to special case that
+      // to find the boot image map in some cases.
+      if (map_info.name.ends_with(image_location_base_name) ||
+          map_info.name.ends_with(image_location_base_name + "]")) {
+        if ((map_info.flags & PROT_WRITE) != 0) {
+          return map_info;
+        }
+        // In actuality there's more than 1 map, but the second one is read-only.
+        // The one we care about is the write-able map.
+        // The readonly maps are guaranteed to be identical, so its not interesting to compare
+        // them.
+      }
+    }
+    *os_ << "Could not find map for " << image_location_base_name << " in " << tag;
+    return std::nullopt;
+  }
+
   bool DumpImageDiff(const ImageHeader& image_header,
                      const std::string& image_location,
                      const ParentMap& parent_map) REQUIRES_SHARED(Locks::mutator_lock_) {
@@ -1534,32 +1779,9 @@ class ImgDiagDumper {
     std::ostream& os = *os_;
     std::string error_msg;
 
-    std::string image_location_base_name = GetImageLocationBaseName(image_location);
-    auto find_boot_map = [&os, &image_location_base_name](
-                             const std::vector<android::procinfo::MapInfo>& maps,
-                             const char* tag) -> std::optional<android::procinfo::MapInfo> {
-      // Find the memory map for the current boot image component.
-      for (const android::procinfo::MapInfo& map_info : maps) {
-        // The map name ends with ']' if it's an anonymous memmap. We need to special case that
-        // to find the boot image map in some cases.
-        if (map_info.name.ends_with(image_location_base_name) ||
-            map_info.name.ends_with(image_location_base_name + "]")) {
-          if ((map_info.flags & PROT_WRITE) != 0) {
-            return map_info;
-          }
-          // In actuality there's more than 1 map, but the second one is read-only.
-          // The one we care about is the write-able map.
-          // The readonly maps are guaranteed to be identical, so its not interesting to compare
-          // them.
-        }
-      }
-      os << "Could not find map for " << image_location_base_name << " in " << tag;
-      return std::nullopt;
-    };
-
     // Find the current boot image mapping.
     std::optional<android::procinfo::MapInfo> maybe_boot_map =
-        find_boot_map(image_proc_maps_, "image");
+        FindImageMap(image_proc_maps_, image_location, "image");
     if (!maybe_boot_map) {
       return false;
     }
@@ -1576,7 +1798,7 @@ class ImgDiagDumper {
     // If zygote_diff_pid_ != -1, check that the zygote boot map is the same.
     if (zygote_diff_pid_ != -1) {
       std::optional<android::procinfo::MapInfo> maybe_zygote_boot_map =
-          find_boot_map(zygote_proc_maps_, "zygote");
+          FindImageMap(zygote_proc_maps_, image_location, "zygote");
       if (!maybe_zygote_boot_map) {
         return false;
       }
@@ -1794,6 +2016,7 @@ class ImgDiagDumper {
   pid_t image_diff_pid_;  // Dump image diff against boot.art if pid is non-negative
   pid_t zygote_diff_pid_;  // Dump image diff against zygote boot.art if pid is non-negative
   bool dump_dirty_objects_;  // Adds dumping of objects that are dirty.
+  bool dump_hot_objects_;  // Adds dumping of objects on pages touched by the image-diff process.
   bool zygote_pid_only_;  // The user only specified a pid for the zygote.
 
   // Used for finding the memory mapping of the image file.
@@ -1815,6 +2038,10 @@ class ImgDiagDumper {
   // A File for reading /proc/kpagecount.
   File kpagecount_file_;
 
+  // For each image location, the first sample in which each page of the image was present
+  // in the image-diff process, see SampleTouchedPages().
+  std::map<std::string, std::vector<uint32_t>> first_touch_samples_;
+
   DISALLOW_COPY_AND_ASSIGN(ImgDiagDumper);
 };
 
@@ -1822,7 +2049,10 @@ static int DumpImage(Runtime* runtime,
                      std::ostream* os,
                      pid_t image_diff_pid,
                      pid_t zygote_diff_pid,
-                     bool dump_dirty_objects) {
+                     bool dump_dirty_objects,
+                     bool dump_hot_objects,
+                     size_t hot_objects_samples,
+                     uint32_t hot_objects_sample_interval_ms) {
   ScopedObjectAccess soa(Thread::Current());
   gc::Heap* heap = runtime->GetHeap();
   const std::vector<gc::space::ImageSpace*>& image_spaces = heap->GetBootImageSpaces();
@@ -1830,10 +2060,18 @@ static int DumpImage(Runtime* runtime,
   ImgDiagDumper img_diag_dumper(os,
                                 image_diff_pid,
                                 zygote_diff_pid,
-                                dump_dirty_objects);
+                                dump_dirty_objects,
+                                dump_hot_objects);
   if (!img_diag_dumper.Init()) {
     return EXIT_FAILURE;
   }
+  if (dump_hot_objects) {
+    ScopedThreadSuspension sts(soa.Self(), ThreadState::kNative);
+    if (!img_diag_dumper.SampleTouchedPages(
+            image_spaces, hot_objects_samples, hot_objects_sample_interval_ms)) {
+      return EXIT_FAILURE;
+    }
+  }
 
   std::vector<const ImageHeader*> image_headers;
   for (gc::space::ImageSpace* image_space : image_spaces) {
@@ -1893,6 +2131,21 @@ struct ImgDiagArgs : public CmdlineArgs {
       }
     } else if (option == "--dump-dirty-objects") {
       dump_dirty_objects_ = true;
+    } else if (option == "--dump-hot-objects") {
+      dump_hot_objects_ = true;
+    } else if (option.starts_with("--hot-objects-samples=")) {
+      const char* samples = raw_option + strlen("--hot-objects-samples=");
+      if (!android::base::ParseUint(samples, &hot_objects_samples_) ||
+          hot_objects_samples_ < 2u) {
+        *error_msg = "Invalid number of hot objects samples";
+        return kParseError;
+      }
+    } else if (option.starts_with("--hot-objects-sample-interval-ms=")) {
+      const char* interval = raw_option + strlen("--hot-objects-sample-interval-ms=");
+      if (!android::base::ParseUint(interval, &hot_objects_sample_interval_ms_)) {
+        *error_msg = "Invalid hot objects sample interval";
+        return kParseError;
+      }
     } else {
       return kParseUnknownArgument;
     }
@@ -1946,6 +2199,14 @@ struct ImgDiagArgs : public CmdlineArgs {
         "against.\n"
         "      Example: --zygote-diff-pid=$(pid zygote)\n"
         "  --dump-dirty-objects: additionally output dirty objects of interest.\n"
+        "  --dump-hot-objects: additionally output the objects on image pages accessed by the\n"
+        "      process while sampling, as input for dex2oat --hot-image-objects. Run right\n"
+        "      after starting the process to sample the order in which pages are accessed\n"
+        "      during startup. Resident pages are tracked with /sys/kernel/mm/page_idle.\n"
+        "  --hot-objects-samples=<n>: number of samples for --dump-hot-objects, at least 2.\n"
+        "      Example: --hot-objects-samples=20 (default 10)\n"
+        "  --hot-objects-sample-interval-ms=<ms>: interval between the pagemap samples.\n"
+        "      Example: --hot-objects-sample-interval-ms=50 (default 100)\n"
         "\n";
 
     return usage;
@@ -1955,6 +2216,9 @@ struct ImgDiagArgs : public CmdlineArgs {
   pid_t image_diff_pid_ = -1;
   pid_t zygote_diff_pid_ = -1;
   bool dump_dirty_objects_ = false;
+  bool dump_hot_objects_ = false;
+  size_t hot_objects_samples_ = 10u;
+  uint32_t hot_objects_sample_interval_ms_ = 100u;
 };
 
 struct ImgDiagMain : public CmdlineMain<ImgDiagArgs> {
@@ -1965,7 +2229,10 @@ struct ImgDiagMain : public CmdlineMain<ImgDiagArgs> {
                      args_->os_,
                      args_->image_diff_pid_,
                      args_->zygote_diff_pid_,
-                     args_->dump_dirty_objects_) == EXIT_SUCCESS;
+                     args_->dump_dirty_objects_,
+                     args_->dump_hot_objects_,
+                     args_->hot_objects_samples_,
+                     args_->hot_objects_sample_interval_ms_) == EXIT_SUCCESS;
   }
 };
 
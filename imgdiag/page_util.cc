@@ -16,6 +16,9 @@
 
 #include "page_util.h"
 
+#include <limits>
+#include <map>
+
 #include "android-base/stringprintf.h"
 
 namespace art {
@@ -76,24 +79,79 @@ bool GetPageFrameNumbers(File& page_map_file,
                          size_t virtual_page_index,
                          /*out*/ ArrayRef<uint64_t> page_frame_numbers,
                          /*out*/ std::string& error_msg) {
-  CHECK_NE(page_frame_numbers.size(), 0u);
-  CHECK(page_frame_numbers.data() != nullptr);
-
   // Read 64-bit entries from /proc/$pid/pagemap to get the physical page frame numbers.
-  if (!page_map_file.PreadFully(page_frame_numbers.data(),
-                                page_frame_numbers.size() * kPageMapEntrySize,
+  if (!GetPageMapEntries(page_map_file, virtual_page_index, page_frame_numbers, error_msg)) {
+    return false;
+  }
+
+  // Extract page frame numbers from pagemap entries.
+  for (uint64_t& page_frame_number : page_frame_numbers) {
+    page_frame_number &= kPageFrameNumberMask;
+  }
+
+  return true;
+}
+
+bool GetPageMapEntries(File& page_map_file,
+                       size_t virtual_page_index,
+                       /*out*/ ArrayRef<uint64_t> page_map_entries,
+                       /*out*/ std::string& error_msg) {
+  CHECK_NE(page_map_entries.size(), 0u);
+  CHECK(page_map_entries.data() != nullptr);
+
+  if (!page_map_file.PreadFully(page_map_entries.data(),
+                                page_map_entries.size() * kPageMapEntrySize,
                                 virtual_page_index * kPageMapEntrySize)) {
     error_msg = StringPrintf("Failed to read virtual page index entries from %s, error: %s",
                              page_map_file.GetPath().c_str(),
                              strerror(errno));
     return false;
   }
+  return true;
+}
 
-  // Extract page frame numbers from pagemap entries.
-  for (uint64_t& page_frame_number : page_frame_numbers) {
-    page_frame_number &= kPageFrameNumberMask;
+bool MarkPagesIdle(File& page_idle_file,
+                   ArrayRef<const uint64_t> page_frame_numbers,
+                   /*out*/ std::string& error_msg) {
+  // The bitmap can only be written in whole 64-bit words. Set bits mark the corresponding
+  // page frames idle, clear bits are ignored.
+  std::map<uint64_t, uint64_t> words;
+  for (uint64_t page_frame_number : page_frame_numbers) {
+    words[page_frame_number / kPageIdleBitsPerEntry] |=
+        UINT64_C(1) << (page_frame_number % kPageIdleBitsPerEntry);
   }
+  for (const auto& [word_index, word] : words) {
+    if (!page_idle_file.PwriteFully(&word, kPageIdleEntrySize, word_index * kPageIdleEntrySize)) {
+      error_msg = StringPrintf("Failed to mark pages idle in %s, error: %s",
+                               page_idle_file.GetPath().c_str(),
+                               strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
 
+bool GetPagesIdle(File& page_idle_file,
+                  ArrayRef<const uint64_t> page_frame_numbers,
+                  /*out*/ ArrayRef<bool> page_idle,
+                  /*out*/ std::string& error_msg) {
+  CHECK_EQ(page_idle.size(), page_frame_numbers.size());
+
+  uint64_t word_index = std::numeric_limits<uint64_t>::max();
+  uint64_t word = 0u;
+  for (size_t i = 0; i != page_frame_numbers.size(); ++i) {
+    uint64_t page_frame_number = page_frame_numbers[i];
+    if (page_frame_number / kPageIdleBitsPerEntry != word_index) {
+      word_index = page_frame_number / kPageIdleBitsPerEntry;
+      if (!page_idle_file.PreadFully(&word, kPageIdleEntrySize, word_index * kPageIdleEntrySize)) {
+        error_msg = StringPrintf("Failed to read the idle flags from %s, error: %s",
+                                 page_idle_file.GetPath().c_str(),
+                                 strerror(errno));
+        return false;
+      }
+    }
+    page_idle[i] = (word & (UINT64_C(1) << (page_frame_number % kPageIdleBitsPerEntry))) != 0u;
+  }
   return true;
 }
 
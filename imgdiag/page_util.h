@@ -27,6 +27,8 @@ namespace art {
 static constexpr size_t kPageMapEntrySize = sizeof(uint64_t);
 // bits 0-54 [in /proc/$pid/pagemap]
 static constexpr uint64_t kPageFrameNumberMask = (1ULL << 55) - 1;
+// bit 63 [in /proc/$pid/pagemap], set if the page is mapped in the page tables of the process.
+static constexpr uint64_t kPageMapPresentMask = (1ULL << 63);
 
 static constexpr size_t kPageFlagsEntrySize = sizeof(uint64_t);
 static constexpr size_t kPageCountEntrySize = sizeof(uint64_t);
@@ -34,6 +36,11 @@ static constexpr uint64_t kPageFlagsDirtyMask = (1ULL << 4);    // in /proc/kpag
 static constexpr uint64_t kPageFlagsNoPageMask = (1ULL << 20);  // in /proc/kpageflags
 static constexpr uint64_t kPageFlagsMmapMask = (1ULL << 11);    // in /proc/kpageflags
 
+// /sys/kernel/mm/page_idle/bitmap has one bit per page frame, accessed in 64-bit words.
+static constexpr const char* kPageIdleBitmapPath = "/sys/kernel/mm/page_idle/bitmap";
+static constexpr size_t kPageIdleEntrySize = sizeof(uint64_t);
+static constexpr size_t kPageIdleBitsPerEntry = kPageIdleEntrySize * 8u;
+
 // Note: On failure, `page_flags_or_counts[.]` shall be clobbered.
 bool GetPageFlagsOrCount(art::File& kpage_file,
                          uint64_t page_frame_number,
@@ -56,6 +63,26 @@ bool GetPageFrameNumbers(art::File& page_map_file,
                          /*out*/ ArrayRef<uint64_t> page_frame_numbers,
                          /*out*/ std::string& error_msg);
 
+// Reads the raw /proc/$pid/pagemap entries, including the flags, for consecutive pages.
+// Note: On failure, `page_map_entries[.]` shall be clobbered.
+bool GetPageMapEntries(art::File& page_map_file,
+                       size_t virtual_page_index,
+                       /*out*/ ArrayRef<uint64_t> page_map_entries,
+                       /*out*/ std::string& error_msg);
+
+// Marks the given page frames idle in /sys/kernel/mm/page_idle/bitmap. The kernel clears
+// the idle flag of a page frame when any process accesses it afterwards.
+bool MarkPagesIdle(art::File& page_idle_file,
+                   ArrayRef<const uint64_t> page_frame_numbers,
+                   /*out*/ std::string& error_msg);
+
+// Reads the idle flags of the given page frames from /sys/kernel/mm/page_idle/bitmap.
+// Note: On failure, `page_idle[.]` shall be clobbered.
+bool GetPagesIdle(art::File& page_idle_file,
+                  ArrayRef<const uint64_t> page_frame_numbers,
+                  /*out*/ ArrayRef<bool> page_idle,
+                  /*out*/ std::string& error_msg);
+
 }  // namespace art
 
 #endif  // ART_IMGDIAG_PAGE_UTIL_H_
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pprof_builder.h"
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+
+namespace art {
+
+namespace {
+
+// Field numbers of profile.proto.
+enum ProfileField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileLocation = 4,
+  kProfileFunction = 5,
+  kProfileStringTable = 6,
+  kProfileTimeNanos = 9,
+  kProfileDurationNanos = 10,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+
+enum ValueTypeField : uint32_t {
+  kValueTypeType = 1,
+  kValueTypeUnit = 2,
+};
+
+enum SampleField : uint32_t {
+  kSampleLocationId = 1,
+  kSampleValue = 2,
+  kSampleLabel = 3,
+};
+
+enum LabelField : uint32_t {
+  kLabelKey = 1,
+  kLabelStr = 2,
+};
+
+enum LocationField : uint32_t {
+  kLocationId = 1,
+  kLocationLine = 4,
+};
+
+enum LineField : uint32_t {
+  kLineFunctionId = 1,
+  kLineLine = 2,
+};
+
+enum FunctionField : uint32_t {
+  kFunctionId = 1,
+  kFunctionName = 2,
+  kFunctionSystemName = 3,
+  kFunctionFilename = 4,
+};
+
+enum WireType : uint32_t {
+  kWireTypeVarint = 0,
+  kWireTypeLengthDelimited = 2,
+};
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80u) {
+    out->push_back(static_cast<char>((value & 0x7fu) | 0x80u));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendTag(uint32_t field, WireType wire_type, std::string* out) {
+  AppendVarint((field << 3) | wire_type, out);
+}
+
+// Fields with the default value are omitted, as protobuf encoders do.
+void AppendVarintField(uint32_t field, uint64_t value, std::string* out) {
+  if (value != 0u) {
+    AppendTag(field, kWireTypeVarint, out);
+    AppendVarint(value, out);
+  }
+}
+
+void AppendBytesField(uint32_t field, std::string_view data, std::string* out) {
+  AppendTag(field, kWireTypeLengthDelimited, out);
+  AppendVarint(data.size(), out);
+  out->append(data);
+}
+
+template <typename T>
+void AppendPackedField(uint32_t field, const std::vector<T>& values, std::string* out) {
+  if (values.empty()) {
+    return;
+  }
+  std::string packed;
+  for (T value : values) {
+    // Negative int64 values are encoded as their two's complement, as for the int64 type.
+    AppendVarint(static_cast<uint64_t>(value), &packed);
+  }
+  AppendBytesField(field, packed, out);
+}
+
+std::string EncodeValueType(std::pair<int64_t, int64_t> type_and_unit) {
+  std::string value_type;
+  AppendVarintField(kValueTypeType, type_and_unit.first, &value_type);
+  AppendVarintField(kValueTypeUnit, type_and_unit.second, &value_type);
+  return value_type;
+}
+
+}  // namespace
+
+PprofBuilder::PprofBuilder()
+    : period_type_(0, 0),
+      period_(0),
+      time_nanos_(0),
+      duration_nanos_(0),
+      num_samples_(0u) {
+  // The string table must start with the empty string.
+  InternString("");
+}
+
+int64_t PprofBuilder::InternString(std::string_view str) {
+  auto it = string_ids_.find(str);
+  if (it != string_ids_.end()) {
+    return it->second;
+  }
+  int64_t id = static_cast<int64_t>(strings_.size());
+  strings_.emplace_back(str);
+  string_ids_.emplace(std::string(str), id);
+  return id;
+}
+
+void PprofBuilder::AddSampleType(std::string_view type, std::string_view unit) {
+  DCHECK_EQ(num_samples_, 0u) << "Sample types must be added before the samples";
+  sample_types_.emplace_back(InternString(type), InternString(unit));
+}
+
+void PprofBuilder::SetPeriod(std::string_view type, std::string_view unit, int64_t period) {
+  period_type_ = std::make_pair(InternString(type), InternString(unit));
+  period_ = period;
+}
+
+uint64_t PprofBuilder::AddLocation(std::string_view function_name,
+                                   std::string_view file_name,
+                                   int64_t line) {
+  std::pair<int64_t, int64_t> function_key(InternString(function_name), InternString(file_name));
+  // Ids start at 1, 0 is reserved.
+  auto function_it = function_ids_.emplace(function_key, function_ids_.size() + 1u).first;
+  std::pair<uint64_t, int64_t> location_key(function_it->second, std::max<int64_t>(line, 0));
+  return location_ids_.emplace(location_key, location_ids_.size() + 1u).first->second;
+}
+
+void PprofBuilder::AddSample(
+    const std::vector<uint64_t>& location_ids,
+    const std::vector<int64_t>& values,
+    const std::vector<std::pair<std::string_view, std::string_view>>& labels) {
+  DCHECK_EQ(values.size(), sample_types_.size());
+  std::string sample;
+  AppendPackedField(kSampleLocationId, location_ids, &sample);
+  AppendPackedField(kSampleValue, values, &sample);
+  for (const auto& [key, str] : labels) {
+    std::string label;
+    AppendVarintField(kLabelKey, InternString(key), &label);
+    AppendVarintField(kLabelStr, InternString(str), &label);
+    AppendBytesField(kSampleLabel, label, &sample);
+  }
+  AppendBytesField(kProfileSample, sample, &samples_);
+  ++num_samples_;
+}
+
+std::string PprofBuilder::Build() const {
+  std::string profile;
+  for (std::pair<int64_t, int64_t> sample_type : sample_types_) {
+    AppendBytesField(kProfileSampleType, EncodeValueType(sample_type), &profile);
+  }
+  profile.append(samples_);
+  for (const auto& [key, id] : location_ids_) {
+    std::string line;
+    AppendVarintField(kLineFunctionId, key.first, &line);
+    AppendVarintField(kLineLine, static_cast<uint64_t>(key.second), &line);
+    std::string location;
+    AppendVarintField(kLocationId, id, &location);
+    AppendBytesField(kLocationLine, line, &location);
+    AppendBytesField(kProfileLocation, location, &profile);
+  }
+  for (const auto& [key, id] : function_ids_) {
+    std::string function;
+    AppendVarintField(kFunctionId, id, &function);
+    AppendVarintField(kFunctionName, key.first, &function);
+    AppendVarintField(kFunctionSystemName, key.first, &function);
+    AppendVarintField(kFunctionFilename, key.second, &function);
+    AppendBytesField(kProfileFunction, function, &profile);
+  }
+  for (const std::string& str : strings_) {
+    AppendBytesField(kProfileStringTable, str, &profile);
+  }
+  AppendVarintField(kProfileTimeNanos, static_cast<uint64_t>(time_nanos_), &profile);
+  AppendVarintField(kProfileDurationNanos, static_cast<uint64_t>(duration_nanos_), &profile);
+  if (period_type_.first != 0) {
+    AppendBytesField(kProfilePeriodType, EncodeValueType(period_type_), &profile);
+  }
+  AppendVarintField(kProfilePeriod, static_cast<uint64_t>(period_), &profile);
+  return profile;
+}
+
+}  // namespace art
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_LIBARTBASE_BASE_PPROF_BUILDER_H_
+#define ART_LIBARTBASE_BASE_PPROF_BUILDER_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "macros.h"
+
+namespace art {
+
+// Builds a profile in the pprof format, i.e. a serialized `perftools.profiles.Profile` message
+// (https://github.com/google/pprof/blob/main/proto/profile.proto). The output is not compressed;
+// pprof accepts both compressed and uncompressed profiles.
+//
+// Locations are symbolized: each one is a single line of a function, there are no mappings or
+// addresses. Functions and locations are deduplicated, so callers can add the frames of every
+// sample without keeping their own tables.
+class PprofBuilder {
+ public:
+  PprofBuilder();
+
+  // Adds the type of the next value of each sample, e.g. ("alloc_space", "bytes").
+  void AddSampleType(std::string_view type, std::string_view unit);
+
+  // Sets the type of the sampling events and the number of events between two samples.
+  void SetPeriod(std::string_view type, std::string_view unit, int64_t period);
+
+  void SetTimeNanos(int64_t time_nanos) {
+    time_nanos_ = time_nanos;
+  }
+
+  void SetDurationNanos(int64_t duration_nanos) {
+    duration_nanos_ = duration_nanos;
+  }
+
+  // Returns the id of the location for `line` of the given function. A negative `line` means
+  // that the line is not known.
+  uint64_t AddLocation(std::string_view function_name, std::string_view file_name, int64_t line);
+
+  // Adds a sample with one value per sample type. `location_ids` start with the innermost frame.
+  void AddSample(const std::vector<uint64_t>& location_ids,
+                 const std::vector<int64_t>& values,
+                 const std::vector<std::pair<std::string_view, std::string_view>>& labels = {});
+
+  size_t GetNumberOfSamples() const {
+    return num_samples_;
+  }
+
+  // Returns the serialized profile.
+  std::string Build() const;
+
+ private:
+  int64_t InternString(std::string_view str);
+
+  std::vector<std::string> strings_;
+  std::map<std::string, int64_t, std::less<>> string_ids_;
+  // Function id by (name, file name) string ids.
+  std::map<std::pair<int64_t, int64_t>, uint64_t> function_ids_;
+  // Location id by (function id, line).
+  std::map<std::pair<uint64_t, int64_t>, uint64_t> location_ids_;
+
+  std::vector<std::pair<int64_t, int64_t>> sample_types_;
+  std::pair<int64_t, int64_t> period_type_;
+  int64_t period_;
+  int64_t time_nanos_;
+  int64_t duration_nanos_;
+
+  // The encoded `sample` fields.
+  std::string samples_;
+  size_t num_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(PprofBuilder);
+};
+
+}  // namespace art
+
+#endif  // ART_LIBARTBASE_BASE_PPROF_BUILDER_H_
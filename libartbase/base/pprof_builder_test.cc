@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pprof_builder.h"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+namespace {
+
+uint64_t ReadVarint(std::string_view* data) {
+  uint64_t value = 0u;
+  for (uint32_t shift = 0u; !data->empty(); shift += 7u) {
+    uint8_t byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1u);
+    value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+    if ((byte & 0x80u) == 0u) {
+      break;
+    }
+  }
+  return value;
+}
+
+// Returns the top-level fields of a message as (field number, value) pairs. Varint values are
+// returned as decimal strings.
+std::vector<std::pair<uint32_t, std::string>> ReadFields(std::string_view data) {
+  std::vector<std::pair<uint32_t, std::string>> fields;
+  while (!data.empty()) {
+    uint64_t tag = ReadVarint(&data);
+    uint32_t field = static_cast<uint32_t>(tag >> 3);
+    if ((tag & 7u) == 0u) {
+      fields.emplace_back(field, std::to_string(ReadVarint(&data)));
+    } else {
+      EXPECT_EQ(2u, tag & 7u);
+      size_t size = ReadVarint(&data);
+      fields.emplace_back(field, std::string(data.substr(0u, size)));
+      data.remove_prefix(size);
+    }
+  }
+  return fields;
+}
+
+std::vector<std::string> GetFields(std::string_view data, uint32_t field) {
+  std::vector<std::string> result;
+  for (auto& entry : ReadFields(data)) {
+    if (entry.first == field) {
+      result.push_back(std::move(entry.second));
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(PprofBuilder, DeduplicatesLocationsAndFunctions) {
+  PprofBuilder builder;
+  uint64_t a1 = builder.AddLocation("Foo.a()", "Foo.java", 1);
+  uint64_t a2 = builder.AddLocation("Foo.a()", "Foo.java", 2);
+  uint64_t b1 = builder.AddLocation("Foo.b()", "Foo.java", 1);
+  EXPECT_EQ(1u, a1);
+  EXPECT_EQ(2u, a2);
+  EXPECT_EQ(3u, b1);
+  EXPECT_EQ(a2, builder.AddLocation("Foo.a()", "Foo.java", 2));
+
+  builder.AddSampleType("samples", "count");
+  builder.AddSample({a2, b1}, {3});
+  std::string profile = builder.Build();
+  EXPECT_EQ(3u, GetFields(profile, /*location=*/ 4u).size());
+  EXPECT_EQ(2u, GetFields(profile, /*function=*/ 5u).size());
+}
+
+TEST(PprofBuilder, EncodesSamples) {
+  PprofBuilder builder;
+  builder.AddSampleType("alloc_objects", "count");
+  builder.AddSampleType("alloc_space", "bytes");
+  builder.SetPeriod("space", "bytes", 4096);
+  uint64_t location = builder.AddLocation("Foo.a()", "Foo.java", 12);
+  builder.AddSample({location}, {2, 300}, {{"object type", "java.lang.String"}});
+  EXPECT_EQ(1u, builder.GetNumberOfSamples());
+
+  std::string profile = builder.Build();
+  std::vector<std::string> strings = GetFields(profile, /*string_table=*/ 6u);
+  ASSERT_FALSE(strings.empty());
+  EXPECT_EQ("", strings[0]);
+  auto string_id = [&](std::string_view str) {
+    auto it = std::find(strings.begin(), strings.end(), str);
+    EXPECT_TRUE(it != strings.end()) << str;
+    return std::to_string(it - strings.begin());
+  };
+
+  std::vector<std::string> sample_types = GetFields(profile, /*sample_type=*/ 1u);
+  ASSERT_EQ(2u, sample_types.size());
+  EXPECT_EQ(string_id("alloc_space"), GetFields(sample_types[1], /*type=*/ 1u)[0]);
+  EXPECT_EQ(string_id("bytes"), GetFields(sample_types[1], /*unit=*/ 2u)[0]);
+
+  std::vector<std::string> samples = GetFields(profile, /*sample=*/ 2u);
+  ASSERT_EQ(1u, samples.size());
+  std::string_view values = GetFields(samples[0], /*value=*/ 2u)[0];
+  EXPECT_EQ(2u, ReadVarint(&values));
+  EXPECT_EQ(300u, ReadVarint(&values));
+  std::string label = GetFields(samples[0], /*label=*/ 3u)[0];
+  EXPECT_EQ(string_id("object type"), GetFields(label, /*key=*/ 1u)[0]);
+  EXPECT_EQ(string_id("java.lang.String"), GetFields(label, /*str=*/ 2u)[0]);
+
+  std::string location_proto = GetFields(profile, /*location=*/ 4u)[0];
+  std::string line = GetFields(location_proto, /*line=*/ 4u)[0];
+  EXPECT_EQ("12", GetFields(line, /*line=*/ 2u)[0]);
+  EXPECT_EQ("4096", GetFields(profile, /*period=*/ 12u)[0]);
+}
+
+}  // namespace art
@@ -18,6 +18,7 @@
 
 #include <fcntl.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -199,6 +200,25 @@ int InflateBuffer(ArrayRef<const uint8_t> in_buffer, /*out*/ ArrayRef<uint8_t> o
   return ret;
 }
 
+// Bounds-checked reads from an uncompressed section of a mapped profile. Unlike `SafeBuffer`,
+// this does not own or copy the data.
+struct MappedSectionReader {
+  template <typename T>
+  bool ReadUint(/*out*/ T* value) {
+    static_assert(std::is_unsigned_v<T>);
+    if (sizeof(T) > size - pos) {
+      return false;
+    }
+    memcpy(value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+
+  const uint8_t* data;
+  size_t size;
+  size_t pos;
+};
+
 }  // anonymous namespace
 
 enum class ProfileCompilationInfo::ProfileLoadStatus : uint32_t {
@@ -236,8 +256,17 @@ enum class ProfileCompilationInfo::FileSectionType : uint32_t {
   // an optional reserved section not implemented on client yet.
   kAggregationCounts = 4,
 
+  // The order in which startup methods were first executed. This section is
+  // optional and written only when the profile records such an order.
+  kStartupMethodSequence = 5,
+
+  // Uncompressed bitmaps of methods and classes for queries on a mapped file,
+  // see `ProfileCompilationInfo::MappedProfile`. This section is optional and
+  // written only for profiles saved as mappable.
+  kMappedIndex = 6,
+
   // The number of known sections.
-  kNumberOfSections = 5
+  kNumberOfSections = 7
 };
 
 class ProfileCompilationInfo::FileSectionInfo {
@@ -570,7 +599,9 @@ ProfileCompilationInfo::ProfileCompilationInfo(ArenaPool* custom_arena_pool, boo
       profile_key_map_(std::less<const std::string_view>(), allocator_.Adapter(kArenaAllocProfile)),
       extra_descriptors_(),
       extra_descriptors_indexes_(ExtraDescriptorHash(&extra_descriptors_),
-                                 ExtraDescriptorEquals(&extra_descriptors_)) {
+                                 ExtraDescriptorEquals(&extra_descriptors_)),
+      startup_sequence_size_(0u),
+      save_mappable_(false) {
   memcpy(version_,
          for_boot_image ? kProfileVersionForBootImage : kProfileVersion,
          kProfileVersionSize);
@@ -963,6 +994,10 @@ static bool WriteBuffer(int fd, const void* buffer, size_t byte_count) {
  *   Classes - optional, zipped
  *   Methods - optional, zipped
  *   AggregationCounts - optional, zipped, server-side
+ *   StartupMethodSequence - optional, zipped
+ *   MappedIndex - optional, plaintext
+ * For profiles saved as mappable, all sections are plaintext and the MappedIndex
+ * section is present.
  *
  * DexFiles:
  *    number_of_dex_files
@@ -1001,6 +1036,23 @@ static bool WriteBuffer(int fd, const void* buffer, size_t byte_count) {
  *    type_index_diff[dex_map_size]
  * where `M` stands for special encodings indicating missing types (kIsMissingTypesEncoding)
  * or memamorphic call (kIsMegamorphicEncoding) which both imply `dex_map_size == 0`.
+ *
+ * StartupMethodSequence contains records for any number of dex files, each consisting of:
+ *    profile_index  // Index of the dex file in DexFiles section.
+ *    number_of_methods
+ *    (method_index_diff,sequence_index)[number_of_methods]
+ * where `sequence_index` is the position of the method in the order in which startup
+ * methods were first executed. The order is global across all dex files of the profile.
+ *
+ * MappedIndex:
+ *    number_of_dex_files
+ *    data_offset[number_of_dex_files]  // From the start of the section.
+ *    (hot_methods,method_flags,classes)[number_of_dex_files]
+ * where `hot_methods` contains `num_method_ids` bits, `method_flags` contains `num_method_ids`
+ * bits for each method flag other than "hot" that can be stored in the profile (the same
+ * layout as `DexFileData::method_bitmap`) and `classes` contains `num_type_ids` bits. Each
+ * bitmap is rounded up to whole bytes and bits are stored starting from the least significant
+ * bit. Classes referenced through extra descriptors are not included.
  **/
 bool ProfileCompilationInfo::Save(int fd) {
   uint64_t start = NanoTime();
@@ -1020,6 +1072,11 @@ bool ProfileCompilationInfo::Save(int fd) {
   uint64_t dex_files_section_size = sizeof(ProfileIndexType);  // Number of dex files.
   uint64_t classes_section_size = 0u;
   uint64_t methods_section_size = 0u;
+  uint64_t startup_sequence_section_size = 0u;
+  uint64_t mapped_index_section_size = 0u;
+  if (save_mappable_) {
+    mapped_index_section_size = sizeof(uint32_t);  // Number of dex files.
+  }
   DCHECK_LE(info_.size(), MaxProfileIndex());
   for (const std::unique_ptr<DexFileData>& dex_data : info_) {
     if (dex_data->profile_key.size() > kMaxDexFileKeyLength) {
@@ -1032,13 +1089,19 @@ bool ProfileCompilationInfo::Save(int fd) {
         sizeof(uint16_t) + dex_data->profile_key.size();
     classes_section_size += dex_data->ClassesDataSize();
     methods_section_size += dex_data->MethodsDataSize();
+    startup_sequence_section_size += dex_data->StartupSequenceDataSize();
+    if (save_mappable_) {
+      mapped_index_section_size += sizeof(uint32_t) + dex_data->MappedIndexDataSize();
+    }
   }
 
   const uint32_t file_section_count =
       /* dex files */ 1u +
       /* extra descriptors */ (extra_descriptors_section_size != 0u ? 1u : 0u) +
       /* classes */ (classes_section_size != 0u ? 1u : 0u) +
-      /* methods */ (methods_section_size != 0u ? 1u : 0u);
+      /* methods */ (methods_section_size != 0u ? 1u : 0u) +
+      /* startup method sequence */ (startup_sequence_section_size != 0u ? 1u : 0u) +
+      /* mapped index */ (mapped_index_section_size != 0u ? 1u : 0u);
   uint64_t header_and_infos_size =
       sizeof(FileHeader) + file_section_count * sizeof(FileSectionInfo);
 
@@ -1049,7 +1112,9 @@ bool ProfileCompilationInfo::Save(int fd) {
       dex_files_section_size +
       extra_descriptors_section_size +
       classes_section_size +
-      methods_section_size;
+      methods_section_size +
+      startup_sequence_section_size +
+      mapped_index_section_size;
   VLOG(profiler) << "Required capacity: " << total_uncompressed_size << " bytes.";
   if (total_uncompressed_size > GetSizeErrorThresholdBytes()) {
     LOG(WARNING) << "Profile data size exceeds "
@@ -1080,6 +1145,21 @@ bool ProfileCompilationInfo::Save(int fd) {
     file_offset += file_size;
     section_index += 1u;
   };
+  // Sections other than dex files are compressed, unless the profile is saved as mappable.
+  auto write_section = [&](FileSectionType type, SafeBuffer& buffer) {
+    uint32_t inflated_size = 0u;
+    if (!save_mappable_) {
+      inflated_size = buffer.Size();
+      if (!buffer.Deflate()) {
+        return false;
+      }
+    }
+    if (!WriteBuffer(fd, buffer.Get(), buffer.Size())) {
+      return false;
+    }
+    add_section_info(type, buffer.Size(), inflated_size);
+    return true;
+  };
 
   // Write the dex files section.
   {
@@ -1108,14 +1188,9 @@ bool ProfileCompilationInfo::Save(int fd) {
       buffer.WriteUintAndAdvance(dchecked_integral_cast<uint16_t>(descriptor.size()));
       buffer.WriteAndAdvance(descriptor.c_str(), descriptor.size());
     }
-    if (!buffer.Deflate()) {
-      return false;
-    }
-    if (!WriteBuffer(fd, buffer.Get(), buffer.Size())) {
+    if (!write_section(FileSectionType::kExtraDescriptors, buffer)) {
       return false;
     }
-    add_section_info(
-        FileSectionType::kExtraDescriptors, buffer.Size(), extra_descriptors_section_size);
   }
 
   // Write the classes section.
@@ -1124,13 +1199,9 @@ bool ProfileCompilationInfo::Save(int fd) {
     for (const std::unique_ptr<DexFileData>& dex_data : info_) {
       dex_data->WriteClasses(buffer);
     }
-    if (!buffer.Deflate()) {
-      return false;
-    }
-    if (!WriteBuffer(fd, buffer.Get(), buffer.Size())) {
+    if (!write_section(FileSectionType::kClasses, buffer)) {
       return false;
     }
-    add_section_info(FileSectionType::kClasses, buffer.Size(), classes_section_size);
   }
 
   // Write the methods section.
@@ -1139,13 +1210,39 @@ bool ProfileCompilationInfo::Save(int fd) {
     for (const std::unique_ptr<DexFileData>& dex_data : info_) {
       dex_data->WriteMethods(buffer);
     }
-    if (!buffer.Deflate()) {
+    if (!write_section(FileSectionType::kMethods, buffer)) {
       return false;
     }
-    if (!WriteBuffer(fd, buffer.Get(), buffer.Size())) {
+  }
+
+  // Write the startup method sequence section.
+  if (startup_sequence_section_size != 0u) {
+    SafeBuffer buffer(startup_sequence_section_size);
+    for (const std::unique_ptr<DexFileData>& dex_data : info_) {
+      dex_data->WriteStartupSequence(buffer);
+    }
+    if (!write_section(FileSectionType::kStartupMethodSequence, buffer)) {
+      return false;
+    }
+  }
+
+  // Write the mapped index section.
+  if (mapped_index_section_size != 0u) {
+    SafeBuffer buffer(mapped_index_section_size);
+    buffer.WriteUintAndAdvance(dchecked_integral_cast<uint32_t>(info_.size()));
+    uint32_t data_offset = sizeof(uint32_t) + info_.size() * sizeof(uint32_t);
+    for (const std::unique_ptr<DexFileData>& dex_data : info_) {
+      buffer.WriteUintAndAdvance(data_offset);
+      data_offset += dex_data->MappedIndexDataSize();
+    }
+    DCHECK_EQ(data_offset, mapped_index_section_size);
+    for (const std::unique_ptr<DexFileData>& dex_data : info_) {
+      dex_data->WriteMappedIndex(buffer);
+    }
+    DCHECK_EQ(buffer.GetAvailableBytes(), 0u);
+    if (!write_section(FileSectionType::kMappedIndex, buffer)) {
       return false;
     }
-    add_section_info(FileSectionType::kMethods, buffer.Size(), methods_section_size);
   }
 
   if (file_offset > GetSizeWarningThresholdBytes()) {
@@ -1316,6 +1413,33 @@ ProfileCompilationInfo::ExtraDescriptorIndex ProfileCompilationInfo::AddExtraDes
   return new_extra_descriptor_index;
 }
 
+void ProfileCompilationInfo::AddStartupSequenceMethod(ProfileIndexType profile_index,
+                                                      uint32_t method_index) {
+  DCHECK_LT(profile_index, info_.size());
+  DexFileData* const data = info_[profile_index].get();
+  DCHECK_LT(method_index, data->num_method_ids);
+  if (data->GetStartupSequenceIndex(method_index) != kNoStartupSequenceIndex) {
+    return;  // Keep the position of the first execution.
+  }
+  DCHECK_NE(startup_sequence_size_, kNoStartupSequenceIndex);
+  data->AddStartupSequenceIndex(dchecked_integral_cast<uint16_t>(method_index),
+                                startup_sequence_size_);
+  ++startup_sequence_size_;
+}
+
+bool ProfileCompilationInfo::AddStartupSequenceMethod(const MethodReference& method_ref,
+                                                      const ProfileSampleAnnotation& annotation) {
+  DexFileData* const data = GetOrAddDexFileData(method_ref.dex_file, annotation);
+  if (data == nullptr) {  // checksum mismatch
+    return false;
+  }
+  if (UNLIKELY(startup_sequence_size_ == kNoStartupSequenceIndex)) {
+    return false;
+  }
+  AddStartupSequenceMethod(data->profile_index, method_ref.index);
+  return true;
+}
+
 bool ProfileCompilationInfo::AddMethod(const ProfileMethodInfo& pmi,
                                        MethodHotness::Flag flags,
                                        const ProfileSampleAnnotation& annotation,
@@ -1791,6 +1915,45 @@ ProfileCompilationInfo::ProfileLoadStatus ProfileCompilationInfo::ReadMethodsSec
   return ProfileLoadStatus::kSuccess;
 }
 
+ProfileCompilationInfo::ProfileLoadStatus ProfileCompilationInfo::ReadStartupMethodSequenceSection(
+    ProfileSource& source,
+    const FileSectionInfo& section_info,
+    const dchecked_vector<ProfileIndexType>& dex_profile_index_remap,
+    /*out*/ std::string* error) {
+  DCHECK(section_info.GetType() == FileSectionType::kStartupMethodSequence);
+  SafeBuffer buffer;
+  ProfileLoadStatus status = ReadSectionData(source, section_info, &buffer, error);
+  if (status != ProfileLoadStatus::kSuccess) {
+    return status;
+  }
+
+  while (buffer.GetAvailableBytes() != 0u) {
+    ProfileIndexType profile_index;
+    if (!buffer.ReadUintAndAdvance(&profile_index)) {
+      *error = "Error profile index in startup method sequence section.";
+      return ProfileLoadStatus::kBadData;
+    }
+    if (profile_index >= dex_profile_index_remap.size()) {
+      *error = "Invalid profile index in startup method sequence section.";
+      return ProfileLoadStatus::kBadData;
+    }
+    profile_index = dex_profile_index_remap[profile_index];
+    if (profile_index == MaxProfileIndex()) {
+      status = DexFileData::SkipStartupSequence(buffer, error);
+    } else {
+      uint32_t max_sequence_index = 0u;
+      status = info_[profile_index]->ReadStartupSequence(buffer, &max_sequence_index, error);
+      if (status == ProfileLoadStatus::kSuccess) {
+        startup_sequence_size_ = std::max(startup_sequence_size_, max_sequence_index + 1u);
+      }
+    }
+    if (status != ProfileLoadStatus::kSuccess) {
+      return status;
+    }
+  }
+  return ProfileLoadStatus::kSuccess;
+}
+
 // TODO(calin): fail fast if the dex checksums don't match.
 ProfileCompilationInfo::ProfileLoadStatus ProfileCompilationInfo::LoadInternal(
     int32_t fd,
@@ -1915,6 +2078,13 @@ ProfileCompilationInfo::ProfileLoadStatus ProfileCompilationInfo::LoadInternal(
       case FileSectionType::kAggregationCounts:
         // This section is only used on server side.
         break;
+      case FileSectionType::kStartupMethodSequence:
+        // Skip if all dex files were filtered out.
+        if (!info_.empty()) {
+          status = ReadStartupMethodSequenceSection(
+              *source, section_info, dex_profile_index_remap, error);
+        }
+        break;
       default:
         // Unknown section. Skip it. New versions of ART are allowed
         // to add sections that shall be ignored by old versions.
@@ -2054,7 +2224,14 @@ bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other,
 
     // Merge the method bitmaps.
     dex_data->MergeBitmap(*other_dex_data);
+
+    // Merge the startup method sequence. Methods recorded in both profiles keep the earlier
+    // position, so the merged order approximates the interleaving of both startups.
+    for (const auto& [method_index, sequence_index] : other_dex_data->startup_sequence) {
+      dex_data->AddStartupSequenceIndex(method_index, sequence_index);
+    }
   }
+  startup_sequence_size_ = std::max(startup_sequence_size_, other.startup_sequence_size_);
 
   return true;
 }
@@ -2075,6 +2252,230 @@ bool ProfileCompilationInfo::ContainsClass(const DexFile& dex_file,
   return (dex_data != nullptr) && dex_data->ContainsClass(type_idx);
 }
 
+std::unique_ptr<ProfileCompilationInfo::MappedProfile> ProfileCompilationInfo::MappedProfile::Open(
+    int fd, /*out*/ std::string* error_msg) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  struct stat stat_buffer;
+  if (fstat(fd, &stat_buffer) != 0) {
+    *error_msg = std::string("Failed to stat profile: ") + strerror(errno);
+    return nullptr;
+  }
+  size_t file_size = static_cast<size_t>(stat_buffer.st_size);
+  if (file_size < sizeof(FileHeader)) {
+    *error_msg = "Profile is too small.";
+    return nullptr;
+  }
+  MemMap map = MemMap::MapFile(file_size,
+                               PROT_READ,
+                               MAP_PRIVATE,
+                               fd,
+                               /*start=*/ 0,
+                               /*low_4gb=*/ false,
+                               "mapped profile",
+                               error_msg);
+  if (!map.IsValid()) {
+    return nullptr;
+  }
+  const uint8_t* const begin = map.Begin();
+
+  FileHeader header;
+  memcpy(&header, begin, sizeof(FileHeader));
+  if (!header.IsValid()) {
+    header.InvalidHeaderMessage(error_msg);
+    return nullptr;
+  }
+  const uint32_t section_count = header.GetFileSectionCount();
+  if (section_count > (file_size - sizeof(FileHeader)) / sizeof(FileSectionInfo)) {
+    *error_msg = "Profile is too small for its section infos.";
+    return nullptr;
+  }
+  const FileSectionInfo* dex_files_section_info = nullptr;
+  const FileSectionInfo* mapped_index_section_info = nullptr;
+  dchecked_vector<FileSectionInfo> section_infos(section_count);
+  memcpy(section_infos.data(), begin + sizeof(FileHeader), section_count * sizeof(FileSectionInfo));
+  for (const FileSectionInfo& section_info : section_infos) {
+    if (section_info.GetFileOffset() > file_size ||
+        section_info.GetFileSize() > file_size - section_info.GetFileOffset()) {
+      *error_msg = "Section exceeds the profile size.";
+      return nullptr;
+    }
+    if (section_info.GetType() == FileSectionType::kDexFiles) {
+      dex_files_section_info = &section_info;
+    } else if (section_info.GetType() == FileSectionType::kMappedIndex) {
+      mapped_index_section_info = &section_info;
+    }
+  }
+  if (dex_files_section_info != &section_infos[0]) {
+    *error_msg = "First section is not dex files section.";
+    return nullptr;
+  }
+  if (mapped_index_section_info == nullptr) {
+    *error_msg = "Profile was not saved as mappable.";
+    return nullptr;
+  }
+  if (dex_files_section_info->GetInflatedSize() != 0u ||
+      mapped_index_section_info->GetInflatedSize() != 0u) {
+    *error_msg = "Compressed section in a mappable profile.";
+    return nullptr;
+  }
+
+  const bool is_for_boot_image =
+      memcmp(header.GetVersion(), kProfileVersionForBootImage, kProfileVersionSize) == 0;
+  std::unique_ptr<MappedProfile> profile(new MappedProfile(std::move(map), is_for_boot_image));
+
+  MappedSectionReader dex_files{begin + dex_files_section_info->GetFileOffset(),
+                                dex_files_section_info->GetFileSize(),
+                                /*pos=*/ 0u};
+  ProfileIndexType num_dex_files;
+  if (!dex_files.ReadUint(&num_dex_files)) {
+    *error_msg = "Error reading number of dex files.";
+    return nullptr;
+  }
+  if (num_dex_files >= MaxProfileIndex()) {
+    *error_msg = "Too many dex files.";
+    return nullptr;
+  }
+  profile->dex_files_.resize(num_dex_files);
+  for (DexFileIndex& index : profile->dex_files_) {
+    uint16_t key_length;
+    if (!dex_files.ReadUint(&index.checksum) ||
+        !dex_files.ReadUint(&index.num_type_ids) ||
+        !dex_files.ReadUint(&index.num_method_ids) ||
+        !dex_files.ReadUint(&key_length) ||
+        key_length > dex_files.size - dex_files.pos) {
+      *error_msg = "Error reading dex file data.";
+      return nullptr;
+    }
+    index.profile_key = std::string_view(
+        reinterpret_cast<const char*>(dex_files.data + dex_files.pos), key_length);
+    dex_files.pos += key_length;
+  }
+
+  MappedSectionReader mapped_index{begin + mapped_index_section_info->GetFileOffset(),
+                                   mapped_index_section_info->GetFileSize(),
+                                   /*pos=*/ 0u};
+  uint32_t num_indexed_dex_files;
+  if (!mapped_index.ReadUint(&num_indexed_dex_files) ||
+      num_indexed_dex_files != num_dex_files) {
+    *error_msg = "Mapped index does not match the dex files.";
+    return nullptr;
+  }
+  // The bitmaps are only read, `BitMemoryRegion` just does not distinguish const data.
+  uint8_t* const mapped_index_begin = const_cast<uint8_t*>(mapped_index.data);
+  for (DexFileIndex& index : profile->dex_files_) {
+    uint32_t data_offset;
+    if (!mapped_index.ReadUint(&data_offset)) {
+      *error_msg = "Error reading mapped index offset.";
+      return nullptr;
+    }
+    size_t hot_methods_size = BitsToBytesRoundUp(index.num_method_ids);
+    size_t method_flags_bits =
+        DexFileData::ComputeBitmapBits(is_for_boot_image, index.num_method_ids);
+    size_t method_flags_size = BitsToBytesRoundUp(method_flags_bits);
+    size_t classes_size = BitsToBytesRoundUp(index.num_type_ids);
+    if (data_offset > mapped_index.size ||
+        hot_methods_size + method_flags_size + classes_size > mapped_index.size - data_offset) {
+      *error_msg = "Mapped index data exceeds the section size.";
+      return nullptr;
+    }
+    uint8_t* data = mapped_index_begin + data_offset;
+    index.hot_methods = BitMemoryRegion(data, /*bit_start=*/ 0, index.num_method_ids);
+    data += hot_methods_size;
+    index.method_flags = BitMemoryRegion(data, /*bit_start=*/ 0, method_flags_bits);
+    data += method_flags_size;
+    index.classes = BitMemoryRegion(data, /*bit_start=*/ 0, index.num_type_ids);
+  }
+  return profile;
+}
+
+ProfileCompilationInfo::ProfileIndexType ProfileCompilationInfo::MappedProfile::FindDexFile(
+    const DexFile& dex_file) const {
+  std::string_view profile_key = GetProfileDexFileBaseKeyView(dex_file.GetLocation());
+  for (size_t i = 0, size = dex_files_.size(); i != size; ++i) {
+    if (profile_key == GetBaseKeyViewFromAugmentedKey(dex_files_[i].profile_key)) {
+      return ChecksumMatch(dex_files_[i].checksum, dex_file.GetLocationChecksum())
+          ? dchecked_integral_cast<ProfileIndexType>(i)
+          : MaxProfileIndex();
+    }
+  }
+  return MaxProfileIndex();
+}
+
+ProfileCompilationInfo::MethodHotness ProfileCompilationInfo::MappedProfile::GetMethodHotness(
+    ProfileIndexType profile_index, uint32_t method_index) const {
+  DCHECK_LT(profile_index, dex_files_.size());
+  const DexFileIndex& index = dex_files_[profile_index];
+  MethodHotness hotness;
+  if (method_index >= index.num_method_ids) {
+    return hotness;
+  }
+  if (index.hot_methods.LoadBit(method_index)) {
+    hotness.AddFlag(MethodHotness::kFlagHot);
+  }
+  uint32_t last_flag =
+      is_for_boot_image_ ? MethodHotness::kFlagLastBoot : MethodHotness::kFlagLastRegular;
+  for (uint32_t flag = MethodHotness::kFlagStartup; flag <= last_flag; flag = flag << 1) {
+    // Same as `DexFileData::MethodFlagBitmapIndex()`.
+    size_t bit_index = method_index + (WhichPowerOf2(flag) - 1u) * index.num_method_ids;
+    if (index.method_flags.LoadBit(bit_index)) {
+      hotness.AddFlag(static_cast<MethodHotness::Flag>(flag));
+    }
+  }
+  return hotness;
+}
+
+ProfileCompilationInfo::MethodHotness ProfileCompilationInfo::MappedProfile::GetMethodHotness(
+    const MethodReference& method_ref) const {
+  ProfileIndexType profile_index = FindDexFile(*method_ref.dex_file);
+  return profile_index != MaxProfileIndex()
+      ? GetMethodHotness(profile_index, method_ref.index)
+      : MethodHotness();
+}
+
+bool ProfileCompilationInfo::MappedProfile::ContainsClass(ProfileIndexType profile_index,
+                                                          dex::TypeIndex type_index) const {
+  DCHECK_LT(profile_index, dex_files_.size());
+  const DexFileIndex& index = dex_files_[profile_index];
+  return type_index.index_ < index.num_type_ids && index.classes.LoadBit(type_index.index_);
+}
+
+bool ProfileCompilationInfo::MappedProfile::ContainsClass(const DexFile& dex_file,
+                                                          dex::TypeIndex type_index) const {
+  ProfileIndexType profile_index = FindDexFile(dex_file);
+  return profile_index != MaxProfileIndex() && ContainsClass(profile_index, type_index);
+}
+
+bool ProfileCompilationInfo::MappedProfile::GetClassesAndMethods(
+    const DexFile& dex_file,
+    /*out*/std::set<dex::TypeIndex>* class_set,
+    /*out*/std::set<uint16_t>* hot_method_set,
+    /*out*/std::set<uint16_t>* startup_method_set,
+    /*out*/std::set<uint16_t>* post_startup_method_method_set) const {
+  ProfileIndexType profile_index = FindDexFile(dex_file);
+  if (profile_index == MaxProfileIndex()) {
+    return false;
+  }
+  const DexFileIndex& index = dex_files_[profile_index];
+  for (uint32_t method_idx = 0; method_idx < index.num_method_ids; ++method_idx) {
+    MethodHotness hotness = GetMethodHotness(profile_index, method_idx);
+    if (hotness.IsHot()) {
+      hot_method_set->insert(method_idx);
+    }
+    if (hotness.IsStartup()) {
+      startup_method_set->insert(method_idx);
+    }
+    if (hotness.IsPostStartup()) {
+      post_startup_method_method_set->insert(method_idx);
+    }
+  }
+  for (uint32_t type_idx = 0; type_idx < index.num_type_ids; ++type_idx) {
+    if (index.classes.LoadBit(type_idx)) {
+      class_set->insert(dex::TypeIndex(type_idx));
+    }
+  }
+  return true;
+}
+
 uint32_t ProfileCompilationInfo::GetNumberOfMethods() const {
   uint32_t total = 0;
   for (const std::unique_ptr<DexFileData>& dex_data : info_) {
@@ -2194,6 +2595,16 @@ std::string ProfileCompilationInfo::DumpInfo(const std::vector<const DexFile*>&
         os << type_index.index_ << ",";
       }
     }
+    if (!dex_data->startup_sequence.empty()) {
+      os << "\n\tstartup sequence: ";
+      for (const auto& [method_idx, sequence_index] : dex_data->startup_sequence) {
+        if (dex_file != nullptr) {
+          os << "\n\t\t" << sequence_index << ":" << dex_file->PrettyMethod(method_idx, true);
+        } else {
+          os << sequence_index << ":" << method_idx << ", ";
+        }
+      }
+    }
   }
   return os.str();
 }
@@ -2589,6 +3000,7 @@ void ProfileCompilationInfo::ClearData() {
   info_.clear();
   extra_descriptors_indexes_.clear();
   extra_descriptors_.clear();
+  startup_sequence_size_ = 0u;
 }
 
 void ProfileCompilationInfo::ClearDataAndAdjustVersion(bool for_boot_image) {
@@ -2991,6 +3403,134 @@ ProfileCompilationInfo::ProfileLoadStatus ProfileCompilationInfo::DexFileData::S
   return ProfileLoadStatus::kSuccess;
 }
 
+void ProfileCompilationInfo::DexFileData::AddStartupSequenceIndex(uint16_t method_index,
+                                                                  uint32_t sequence_index) {
+  DCHECK_LT(method_index, num_method_ids);
+  DCHECK_NE(sequence_index, kNoStartupSequenceIndex);
+  auto it = startup_sequence.lower_bound(method_index);
+  if (it != startup_sequence.end() && it->first == method_index) {
+    it->second = std::min(it->second, sequence_index);
+  } else {
+    startup_sequence.PutBefore(it, method_index, sequence_index);
+  }
+}
+
+uint32_t ProfileCompilationInfo::DexFileData::StartupSequenceDataSize() const {
+  return startup_sequence.empty()
+      ? 0u
+      : sizeof(ProfileIndexType) +  // Which dex file.
+        sizeof(uint32_t) +          // Number of methods.
+        (sizeof(uint16_t) + sizeof(uint32_t)) * startup_sequence.size();  // Index diffs, positions.
+}
+
+void ProfileCompilationInfo::DexFileData::WriteStartupSequence(SafeBuffer& buffer) const {
+  if (startup_sequence.empty()) {
+    return;
+  }
+  buffer.WriteUintAndAdvance(profile_index);
+  buffer.WriteUintAndAdvance(dchecked_integral_cast<uint32_t>(startup_sequence.size()));
+  // Store the difference between the method indexes for better compression.
+  uint16_t last_method_index = 0u;
+  for (const auto& [method_index, sequence_index] : startup_sequence) {
+    DCHECK_GE(method_index, last_method_index);
+    uint16_t diff_with_last_method_index = method_index - last_method_index;
+    last_method_index = method_index;
+    buffer.WriteUintAndAdvance(diff_with_last_method_index);
+    buffer.WriteUintAndAdvance(sequence_index);
+  }
+}
+
+ProfileCompilationInfo::ProfileLoadStatus
+ProfileCompilationInfo::DexFileData::ReadStartupSequence(SafeBuffer& buffer,
+                                                         /*out*/ uint32_t* max_sequence_index,
+                                                         std::string* error) {
+  uint32_t methods_size;
+  if (!buffer.ReadUintAndAdvance(&methods_size)) {
+    *error = "Error reading startup methods size.";
+    return ProfileLoadStatus::kBadData;
+  }
+  uint32_t local_max_sequence_index = 0u;
+  uint16_t method_index = 0u;
+  for (uint32_t i = 0; i != methods_size; ++i) {
+    uint16_t method_index_diff;
+    uint32_t sequence_index;
+    if (!buffer.ReadUintAndAdvance(&method_index_diff) ||
+        !buffer.ReadUintAndAdvance(&sequence_index)) {
+      *error = "Error reading startup method sequence entry.";
+      return ProfileLoadStatus::kBadData;
+    }
+    if (method_index_diff == 0u && i != 0u) {
+      *error = "Duplicate startup method index.";
+      return ProfileLoadStatus::kBadData;
+    }
+    if (method_index_diff >= num_method_ids - method_index) {
+      *error = "Invalid startup method index.";
+      return ProfileLoadStatus::kBadData;
+    }
+    if (sequence_index == kNoStartupSequenceIndex) {
+      *error = "Invalid startup sequence index.";
+      return ProfileLoadStatus::kBadData;
+    }
+    method_index += method_index_diff;
+    AddStartupSequenceIndex(method_index, sequence_index);
+    local_max_sequence_index = std::max(local_max_sequence_index, sequence_index);
+  }
+  *max_sequence_index = local_max_sequence_index;
+  return ProfileLoadStatus::kSuccess;
+}
+
+uint32_t ProfileCompilationInfo::DexFileData::MappedIndexDataSize() const {
+  return BitsToBytesRoundUp(num_method_ids) +  // Hot methods.
+         bitmap_storage.size() +               // Other method flags.
+         BitsToBytesRoundUp(num_type_ids);     // Classes.
+}
+
+void ProfileCompilationInfo::DexFileData::WriteMappedIndex(SafeBuffer& buffer) const {
+  auto write_bitmap = [&buffer](size_t num_bits, auto&& fill_fn) {
+    size_t size = BitsToBytesRoundUp(num_bits);
+    if (size == 0u) {
+      return;
+    }
+    memset(buffer.GetCurrentPtr(), 0, size);
+    BitMemoryRegion bitmap(buffer.GetCurrentPtr(), /*bit_start=*/ 0, num_bits);
+    fill_fn(bitmap);
+    buffer.Advance(size);
+  };
+  write_bitmap(num_method_ids, [&](BitMemoryRegion bitmap) {
+    for (const auto& method_entry : method_map) {
+      bitmap.StoreBit(method_entry.first, /*value=*/ true);
+    }
+  });
+  if (!bitmap_storage.empty()) {
+    buffer.WriteAndAdvance(bitmap_storage.data(), bitmap_storage.size());
+  }
+  write_bitmap(num_type_ids, [&](BitMemoryRegion bitmap) {
+    for (dex::TypeIndex type_index : class_set) {
+      // Classes referenced through extra descriptors are not indexed.
+      if (type_index.index_ < num_type_ids) {
+        bitmap.StoreBit(type_index.index_, /*value=*/ true);
+      }
+    }
+  });
+}
+
+ProfileCompilationInfo::ProfileLoadStatus
+ProfileCompilationInfo::DexFileData::SkipStartupSequence(SafeBuffer& buffer, std::string* error) {
+  uint32_t methods_size;
+  if (!buffer.ReadUintAndAdvance(&methods_size)) {
+    *error = "Error reading startup methods size to skip.";
+    return ProfileLoadStatus::kBadData;
+  }
+  size_t following_data_size =
+      static_cast<size_t>(methods_size) * (sizeof(uint16_t) + sizeof(uint32_t));
+  if (following_data_size > buffer.GetAvailableBytes()) {
+    *error = "Startup method sequence data size to skip exceeds remaining data.";
+    return ProfileLoadStatus::kBadData;
+  }
+  buffer.Advance(following_data_size);
+  return ProfileLoadStatus::kSuccess;
+}
+
 void ProfileCompilationInfo::DexFileData::WriteClassSet(
     SafeBuffer& buffer,
     const ArenaSet<dex::TypeIndex>& class_set) {
@@ -94,6 +94,9 @@ class ProfileCompilationInfo {
   static constexpr size_t kProfileVersionSize = 4;
   static constexpr uint8_t kIndividualInlineCacheSize = 5;
 
+  // Startup sequence index of methods without a recorded position in the startup order.
+  static constexpr uint32_t kNoStartupSequenceIndex = std::numeric_limits<uint32_t>::max();
+
   // Data structures for encoding the offline representation of inline caches.
   // This is exposed as public in order to make it available to dex2oat compilations
   // (see compiler/optimizing/inliner.cc).
@@ -482,6 +485,13 @@ class ProfileCompilationInfo {
   // A fallback implementation of `Save` that uses a flock.
   bool SaveFallback(const std::string& filename, uint64_t* bytes_written);
 
+  // Selects the layout written by `Save()`. A mappable profile is stored without compression
+  // and with an additional index section, so that it can be queried through `MappedProfile`.
+  // It is larger on disk but `Load()` and `MergeWith()` read it like any other profile.
+  void SetSaveMappable(bool mappable) {
+    save_mappable_ = mappable;
+  }
+
   // Return the number of dex files referenced in the profile.
   size_t GetNumberOfDexFiles() const {
     return info_.size();
@@ -515,6 +525,30 @@ class ProfileCompilationInfo {
     return data->IsMethodInProfile(method_index);
   }
 
+  // Appends the referenced method to the order in which methods were first executed during
+  // startup, unless it already has a position in that order. The order spans all dex files
+  // in the profile.
+  void AddStartupSequenceMethod(ProfileIndexType profile_index, uint32_t method_index);
+
+  // Same as above, but looks up or adds the dex file of the method.
+  //
+  // Note: see AddMethods docs for the handling of annotations.
+  bool AddStartupSequenceMethod(
+      const MethodReference& method_ref,
+      const ProfileSampleAnnotation& annotation = ProfileSampleAnnotation::kNone);
+
+  // Returns the position of the referenced method in the startup order, or
+  // `kNoStartupSequenceIndex` if the profile does not record one for the method.
+  uint32_t GetStartupSequenceIndex(ProfileIndexType profile_index, uint32_t method_index) const {
+    DCHECK_LT(profile_index, info_.size());
+    return info_[profile_index]->GetStartupSequenceIndex(method_index);
+  }
+
+  // Returns whether the profile records the order in which startup methods were first executed.
+  bool HasStartupSequence() const {
+    return startup_sequence_size_ != 0u;
+  }
+
   // Returns the profile method info for a given method reference.
   //
   // Note that if the profile was built with annotations, the same dex file may be
@@ -696,6 +730,67 @@ class ProfileCompilationInfo {
   std::unique_ptr<FlattenProfileData> ExtractProfileData(
       const std::vector<std::unique_ptr<const DexFile>>& dex_files) const;
 
+  // A read-only view of a profile saved with `SetSaveMappable(true)` that answers method and
+  // class queries directly from the mapped file. Opening it only parses the header and the
+  // dex files section; no section is read into memory or inflated and no hash maps are built.
+  //
+  // Only hotness flags and classes with a `dex::TypeId` in their dex file are indexed. Inline
+  // caches, classes referenced through extra descriptors and the startup order are available
+  // only after a full `Load()`.
+  class MappedProfile {
+   public:
+    // Maps the profile open in `fd`. Returns null if it is not a valid mappable profile.
+    static std::unique_ptr<MappedProfile> Open(int fd, /*out*/ std::string* error_msg);
+
+    bool IsForBootImage() const {
+      return is_for_boot_image_;
+    }
+
+    size_t GetNumberOfDexFiles() const {
+      return dex_files_.size();
+    }
+
+    // Find a dex file in the profile, ignoring annotations. Returns `MaxProfileIndex()` if no
+    // dex file in the profile has the same base key and checksum.
+    ProfileIndexType FindDexFile(const DexFile& dex_file) const;
+
+    MethodHotness GetMethodHotness(ProfileIndexType profile_index, uint32_t method_index) const;
+    MethodHotness GetMethodHotness(const MethodReference& method_ref) const;
+
+    bool ContainsClass(ProfileIndexType profile_index, dex::TypeIndex type_index) const;
+    bool ContainsClass(const DexFile& dex_file, dex::TypeIndex type_index) const;
+
+    // Same as `ProfileCompilationInfo::GetClassesAndMethods()` without annotations, except
+    // that classes referenced through extra descriptors are not reported.
+    bool GetClassesAndMethods(
+        const DexFile& dex_file,
+        /*out*/std::set<dex::TypeIndex>* class_set,
+        /*out*/std::set<uint16_t>* hot_method_set,
+        /*out*/std::set<uint16_t>* startup_method_set,
+        /*out*/std::set<uint16_t>* post_startup_method_method_set) const;
+
+   private:
+    struct DexFileIndex {
+      std::string_view profile_key;
+      uint32_t checksum;
+      uint32_t num_type_ids;
+      uint32_t num_method_ids;
+      BitMemoryRegion hot_methods;
+      // Other method flags, in the layout of `DexFileData::method_bitmap`.
+      BitMemoryRegion method_flags;
+      BitMemoryRegion classes;
+    };
+
+    MappedProfile(MemMap&& map, bool is_for_boot_image)
+        : map_(std::move(map)), is_for_boot_image_(is_for_boot_image) {}
+
+    MemMap map_;
+    const bool is_for_boot_image_;
+    std::vector<DexFileIndex> dex_files_;
+
+    DISALLOW_COPY_AND_ASSIGN(MappedProfile);
+  };
+
  private:
   // Helper classes.
   class FileHeader;
@@ -785,7 +880,8 @@ class ProfileCompilationInfo {
           num_type_ids(num_types),
           num_method_ids(num_methods),
           bitmap_storage(allocator->Adapter(kArenaAllocProfile)),
-          is_for_boot_image(for_boot_image) {
+          is_for_boot_image(for_boot_image),
+          startup_sequence(std::less<uint16_t>(), allocator->Adapter(kArenaAllocProfile)) {
       bitmap_storage.resize(ComputeBitmapStorage(is_for_boot_image, num_method_ids));
       if (!bitmap_storage.empty()) {
         method_bitmap =
@@ -813,6 +909,7 @@ class ProfileCompilationInfo {
           num_method_ids == other.num_method_ids &&
           method_map == other.method_map &&
           class_set == other.class_set &&
+          startup_sequence == other.startup_sequence &&
           BitMemoryRegion::Equals(method_bitmap, other.method_bitmap);
     }
 
@@ -860,6 +957,15 @@ class ProfileCompilationInfo {
       return has_flag || IsHotMethod(method_index);
     }
 
+    uint32_t GetStartupSequenceIndex(uint32_t method_index) const {
+      DCHECK_LT(method_index, num_method_ids);
+      auto it = startup_sequence.find(method_index);
+      return it != startup_sequence.end() ? it->second : kNoStartupSequenceIndex;
+    }
+
+    // Records `sequence_index` for the method, keeping the lower index if there is one already.
+    void AddStartupSequenceIndex(uint16_t method_index, uint32_t sequence_index);
+
     bool ContainsClass(dex::TypeIndex type_index) const;
 
     uint32_t ClassesDataSize() const;
@@ -879,6 +985,16 @@ class ProfileCompilationInfo {
         std::string* error);
     static ProfileLoadStatus SkipMethods(SafeBuffer& buffer, std::string* error);
 
+    uint32_t StartupSequenceDataSize() const;
+    void WriteStartupSequence(SafeBuffer& buffer) const;
+    ProfileLoadStatus ReadStartupSequence(SafeBuffer& buffer,
+                                          /*out*/ uint32_t* max_sequence_index,
+                                          std::string* error);
+    static ProfileLoadStatus SkipStartupSequence(SafeBuffer& buffer, std::string* error);
+
+    uint32_t MappedIndexDataSize() const;
+    void WriteMappedIndex(SafeBuffer& buffer) const;
+
     // The allocator used to allocate new inline cache maps.
     ArenaAllocator* const allocator_;
     // The profile key this data belongs to.
@@ -902,6 +1018,8 @@ class ProfileCompilationInfo {
     ArenaVector<uint8_t> bitmap_storage;
     BitMemoryRegion method_bitmap;
     bool is_for_boot_image;
+    // Positions of methods in the order in which startup methods were first executed.
+    ArenaSafeMap<uint16_t, uint32_t> startup_sequence;
 
    private:
     template <typename Fn>
@@ -1019,6 +1137,12 @@ class ProfileCompilationInfo {
       const dchecked_vector<ExtraDescriptorIndex>& extra_descriptors_remap,
       /*out*/ std::string* error);
 
+  ProfileLoadStatus ReadStartupMethodSequenceSection(
+      ProfileSource& source,
+      const FileSectionInfo& section_info,
+      const dchecked_vector<ProfileIndexType>& dex_profile_index_remap,
+      /*out*/ std::string* error);
+
   // Entry point for profile loading functionality.
   ProfileLoadStatus LoadInternal(
       int32_t fd,
@@ -1080,6 +1204,13 @@ class ProfileCompilationInfo {
   dchecked_vector<std::string> extra_descriptors_;
   ExtraDescriptorHashSet extra_descriptors_indexes_;
 
+  // The number of positions used in the startup order, one more than the highest
+  // startup sequence index of any method.
+  uint32_t startup_sequence_size_;
+
+  // Whether `Save()` writes the uncompressed layout with the index used by `MappedProfile`.
+  bool save_mappable_;
+
   // The version of the profile.
   uint8_t version_[kProfileVersionSize];
 };
@@ -20,6 +20,7 @@
 
 #include "base/arena_allocator.h"
 #include "base/common_art_test.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
 #include "dex/compact_dex_file.h"
 #include "dex/dex_file.h"
@@ -889,6 +890,191 @@ TEST_F(ProfileCompilationInfoTest, SampledMethodsTest) {
   }
 }
 
+TEST_F(ProfileCompilationInfoTest, StartupMethodSequence) {
+  ProfileCompilationInfo test_info;
+  EXPECT_FALSE(test_info.HasStartupSequence());
+  ASSERT_TRUE(test_info.AddStartupSequenceMethod(MethodReference(dex2, 7)));
+  ASSERT_TRUE(test_info.AddStartupSequenceMethod(MethodReference(dex1, 3)));
+  ASSERT_TRUE(test_info.AddStartupSequenceMethod(MethodReference(dex2, 1)));
+  // A repeated method keeps the position of its first execution.
+  ASSERT_TRUE(test_info.AddStartupSequenceMethod(MethodReference(dex2, 7)));
+  EXPECT_TRUE(test_info.HasStartupSequence());
+  auto get_index = [](const ProfileCompilationInfo& info, const DexFile* dex, uint16_t idx) {
+    ProfileCompilationInfo::ProfileIndexType profile_index = info.FindDexFile(*dex);
+    EXPECT_NE(profile_index, ProfileCompilationInfo::MaxProfileIndex());
+    return info.GetStartupSequenceIndex(profile_index, idx);
+  };
+  auto run_test = [&](const ProfileCompilationInfo& info) {
+    EXPECT_EQ(0u, get_index(info, dex2, 7));
+    EXPECT_EQ(1u, get_index(info, dex1, 3));
+    EXPECT_EQ(2u, get_index(info, dex2, 1));
+    EXPECT_EQ(ProfileCompilationInfo::kNoStartupSequenceIndex, get_index(info, dex1, 7));
+  };
+  run_test(test_info);
+
+  // Save the profile and check that the order survives a round trip.
+  ScratchFile profile;
+  ASSERT_TRUE(test_info.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(test_info));
+  run_test(loaded_info);
+
+  // New methods are appended after the loaded order.
+  ASSERT_TRUE(loaded_info.AddStartupSequenceMethod(MethodReference(dex3, 5)));
+  EXPECT_EQ(3u, get_index(loaded_info, dex3, 5));
+
+  // Merging keeps the earlier position of methods present in both profiles.
+  ProfileCompilationInfo merge_info;
+  ASSERT_TRUE(merge_info.AddStartupSequenceMethod(MethodReference(dex1, 3)));
+  ASSERT_TRUE(merge_info.AddStartupSequenceMethod(MethodReference(dex1, 9)));
+  ASSERT_TRUE(test_info.MergeWith(merge_info));
+  EXPECT_EQ(0u, get_index(test_info, dex1, 3));
+  EXPECT_EQ(1u, get_index(test_info, dex1, 9));
+  EXPECT_EQ(0u, get_index(test_info, dex2, 7));
+  ASSERT_TRUE(test_info.AddStartupSequenceMethod(MethodReference(dex1, 10)));
+  EXPECT_EQ(3u, get_index(test_info, dex1, 10));
+}
+
+TEST_F(ProfileCompilationInfoTest, MappedProfile) {
+  for (bool for_boot_image : {false, true}) {
+    ProfileCompilationInfo info(for_boot_image);
+    uint32_t last_flag = for_boot_image ? Hotness::kFlagLastBoot : Hotness::kFlagLastRegular;
+    for (uint16_t i = 0; i < 50; i++) {
+      // Hot methods only at even indexes, other flags in rotation.
+      uint32_t flags = (1u << (i % (WhichPowerOf2(last_flag) + 1u))) | ((i & 1u) ? 0u : 1u);
+      ASSERT_TRUE(AddMethod(&info, dex1, i, static_cast<Hotness::Flag>(flags)));
+      ASSERT_TRUE(AddMethod(&info, dex3, 2u * i + 1u, Hotness::kFlagStartup));
+    }
+    for (uint16_t i = 0; i < kNumSharedTypes; i += 3u) {
+      ASSERT_TRUE(AddClass(&info, dex1, dex::TypeIndex(i)));
+      ASSERT_TRUE(AddClass(&info, dex2, dex::TypeIndex(i + 1u)));
+    }
+
+    ScratchFile profile;
+    info.SetSaveMappable(true);
+    ASSERT_TRUE(info.Save(GetFd(profile)));
+    ASSERT_EQ(0, profile.GetFile()->Flush());
+
+    std::string error_msg;
+    std::unique_ptr<ProfileCompilationInfo::MappedProfile> mapped =
+        ProfileCompilationInfo::MappedProfile::Open(GetFd(profile), &error_msg);
+    ASSERT_TRUE(mapped != nullptr) << error_msg;
+    EXPECT_EQ(for_boot_image, mapped->IsForBootImage());
+    EXPECT_EQ(info.GetNumberOfDexFiles(), mapped->GetNumberOfDexFiles());
+    EXPECT_EQ(ProfileCompilationInfo::MaxProfileIndex(), mapped->FindDexFile(*dex4));
+    EXPECT_EQ(ProfileCompilationInfo::MaxProfileIndex(),
+              mapped->FindDexFile(*dex1_checksum_missmatch));
+    for (const DexFile* dex : {dex1, dex2, dex3, dex4}) {
+      for (uint32_t method_idx = 0; method_idx != dex->NumMethodIds(); ++method_idx) {
+        MethodReference ref(dex, method_idx);
+        EXPECT_EQ(info.GetMethodHotness(ref).GetFlags(), mapped->GetMethodHotness(ref).GetFlags())
+            << dex->GetLocation() << " " << method_idx;
+      }
+      for (uint32_t type_idx = 0; type_idx != dex->NumTypeIds(); ++type_idx) {
+        EXPECT_EQ(info.ContainsClass(*dex, dex::TypeIndex(type_idx)),
+                  mapped->ContainsClass(*dex, dex::TypeIndex(type_idx)))
+            << dex->GetLocation() << " " << type_idx;
+      }
+      std::set<dex::TypeIndex> classes, mapped_classes;
+      std::set<uint16_t> hot, mapped_hot, startup, mapped_startup, post, mapped_post;
+      EXPECT_EQ(info.GetClassesAndMethods(*dex, &classes, &hot, &startup, &post),
+                mapped->GetClassesAndMethods(
+                    *dex, &mapped_classes, &mapped_hot, &mapped_startup, &mapped_post));
+      EXPECT_EQ(classes, mapped_classes);
+      EXPECT_EQ(hot, mapped_hot);
+      EXPECT_EQ(startup, mapped_startup);
+      EXPECT_EQ(post, mapped_post);
+    }
+
+    // The mappable profile is still a regular profile.
+    ProfileCompilationInfo loaded_info(for_boot_image);
+    ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+    ASSERT_TRUE(loaded_info.Equals(info));
+
+    // A profile saved without the index cannot be mapped.
+    ScratchFile compressed_profile;
+    ASSERT_TRUE(loaded_info.Save(GetFd(compressed_profile)));
+    ASSERT_EQ(0, compressed_profile.GetFile()->Flush());
+    EXPECT_TRUE(
+        ProfileCompilationInfo::MappedProfile::Open(GetFd(compressed_profile), &error_msg) ==
+        nullptr);
+  }
+}
+
+// A mappable profile of a large dex file answers the same queries as the loaded profile.
+// Checks every lookup on a large mapped profile against the loaded profile. Also compares the
+// cost of both views: the load or map time, the lookup time and the memory they use. The costs
+// are only logged, they depend too much on the host to be asserted.
+TEST_F(ProfileCompilationInfoTest, MappedProfileLargeDexFile) {
+  static constexpr size_t kNumMethodIds = 1u << 15;
+  const DexFile* dex = BuildDex("large", /*location_checksum=*/ 5, "LLarge;", kNumMethodIds);
+  ProfileCompilationInfo info;
+  for (uint32_t i = 0; i < kNumMethodIds; i += 3u) {
+    ASSERT_TRUE(AddMethod(&info, dex, i, Hotness::kFlagHot));
+    ASSERT_TRUE(AddMethod(&info, dex, i + 1u, Hotness::kFlagStartup));
+  }
+  ASSERT_TRUE(AddClass(&info, dex, dex::TypeIndex(0)));
+
+  ScratchFile compressed_profile;
+  ASSERT_TRUE(info.Save(GetFd(compressed_profile)));
+  ASSERT_EQ(0, compressed_profile.GetFile()->Flush());
+  ScratchFile mappable_profile;
+  info.SetSaveMappable(true);
+  ASSERT_TRUE(info.Save(GetFd(mappable_profile)));
+  ASSERT_EQ(0, mappable_profile.GetFile()->Flush());
+
+  uint64_t start = NanoTime();
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(GetFd(compressed_profile)));
+  const uint64_t load_time = NanoTime() - start;
+  start = NanoTime();
+  size_t loaded_hot_count = 0u;
+  for (uint32_t i = 0; i != kNumMethodIds; ++i) {
+    loaded_hot_count += loaded_info.GetMethodHotness(MethodReference(dex, i)).IsHot() ? 1u : 0u;
+  }
+  const uint64_t loaded_lookup_time = NanoTime() - start;
+
+  start = NanoTime();
+  std::string error_msg;
+  std::unique_ptr<ProfileCompilationInfo::MappedProfile> mapped =
+      ProfileCompilationInfo::MappedProfile::Open(GetFd(mappable_profile), &error_msg);
+  ASSERT_TRUE(mapped != nullptr) << error_msg;
+  const uint64_t map_time = NanoTime() - start;
+  start = NanoTime();
+  size_t mapped_hot_count = 0u;
+  for (uint32_t i = 0; i != kNumMethodIds; ++i) {
+    mapped_hot_count += mapped->GetMethodHotness(MethodReference(dex, i)).IsHot() ? 1u : 0u;
+  }
+  const uint64_t mapped_lookup_time = NanoTime() - start;
+  EXPECT_EQ(loaded_hot_count, mapped_hot_count);
+
+  // The loaded profile inflates its data into arena memory, the mapped profile only maps the
+  // file, so at most the file size becomes resident.
+  LOG(INFO) << "Current format: " << compressed_profile.GetFile()->GetLength()
+            << " bytes in file, " << loaded_info.GetAllocator()->BytesUsed()
+            << " bytes of arena memory, load " << PrettyDuration(load_time)
+            << ", lookups " << PrettyDuration(loaded_lookup_time);
+  LOG(INFO) << "Mappable format: " << mappable_profile.GetFile()->GetLength()
+            << " bytes in file, mapped, map " << PrettyDuration(map_time)
+            << ", lookups " << PrettyDuration(mapped_lookup_time);
+
+  size_t hot_count = 0u;
+  size_t startup_count = 0u;
+  for (uint32_t i = 0; i != kNumMethodIds; ++i) {
+    MethodReference ref(dex, i);
+    Hotness hotness = mapped->GetMethodHotness(ref);
+    ASSERT_EQ(loaded_info.GetMethodHotness(ref).GetFlags(), hotness.GetFlags()) << i;
+    hot_count += hotness.IsHot() ? 1u : 0u;
+    startup_count += hotness.IsStartup() ? 1u : 0u;
+  }
+  EXPECT_EQ(info.GetNumberOfMethods(), hot_count);
+  EXPECT_EQ(hot_count, startup_count);
+  EXPECT_TRUE(mapped->ContainsClass(*dex, dex::TypeIndex(0)));
+  EXPECT_FALSE(mapped->ContainsClass(*dex, dex::TypeIndex(1)));
+}
+
 TEST_F(ProfileCompilationInfoTest, LoadFromZipCompress) {
   TestProfileLoadFromZip("primary.prof",
                          ZipWriter::kCompress | ZipWriter::kAlign32,
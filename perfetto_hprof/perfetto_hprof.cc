@@ -31,8 +31,11 @@
 #include <thread>
 #include <time.h>
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <optional>
+#include <set>
 #include <type_traits>
 
 #include "android-base/file.h"
@@ -40,10 +43,13 @@
 #include "android-base/properties.h"
 #include "base/fast_exit.h"
 #include "base/systrace.h"
+#include "class_linker.h"
+#include "class_root-inl.h"
 #include "gc/heap-visit-objects-inl.h"
 #include "gc/heap.h"
 #include "gc/scoped_gc_critical_section.h"
 #include "mirror/object-refvisitor-inl.h"
+#include "mirror/reference.h"
 #include "nativehelper/scoped_local_ref.h"
 #include "perfetto/profiling/parse_smaps.h"
 #include "perfetto/trace/interned_data/interned_data.pbzero.h"
@@ -52,6 +58,7 @@
 #include "perfetto/trace/profiling/smaps.pbzero.h"
 #include "perfetto/config/profiling/java_hprof_config.pbzero.h"
 #include "perfetto/protozero/packed_repeated_fields.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
 #include "perfetto/tracing.h"
 #include "runtime-inl.h"
 #include "runtime_callbacks.h"
@@ -77,6 +84,15 @@ constexpr time_t kWatchdogTimeoutSec = 120;
 // submessages can be up to 100k here for a 500k chunk size.
 // DropBox has a 500k chunk limit, and each chunk needs to parse as a proto.
 constexpr uint32_t kPacketSizeThreshold = 400000;
+// Objects encoded by one thread in one go when encoding the heap graph in parallel.
+constexpr size_t kObjectsPerChunk = 2048;
+// The encoding of a chunk is split in pieces of about this size, each appended to a packet as a
+// whole. Like the other submessages, they need to stay well below the 100k assumed above.
+constexpr size_t kEncodedPieceSize = 32 * 1024;
+// Upper bound for the encoded size of an object record, without its packed references.
+constexpr size_t kMaxEncodedObjectOverhead = 96;
+// Upper bound for the threads encoding the heap graph, including the dumping thread.
+constexpr size_t kMaxEncodingThreads = 8;
 constexpr char kByte[1] = {'x'};
 static art::Mutex& GetStateMutex() {
   static art::Mutex state_mutex("perfetto_hprof_state_mutex", art::LockLevel::kGenericBottomLock);
@@ -343,21 +359,32 @@ bool TimedWaitForDataSource(art::Thread* self, int64_t timeout_ms) {
   return true;
 }
 
+// Destination of the perfetto.protos.HeapGraph messages of a heap dump.
+class HeapGraphWriter {
+ public:
+  virtual ~HeapGraphWriter() {}
+
+  // Return whether the next call to GetHeapGraph will create a new message.
+  virtual bool will_create_new_packet() const = 0;
+
+  virtual perfetto::protos::pbzero::HeapGraph* GetHeapGraph() = 0;
+};
+
 // Helper class to write Java heap dumps to `ctx`. The whole heap dump can be
 // split into more perfetto.protos.HeapGraph messages, to avoid making each
 // message too big.
-class Writer {
+class Writer final : public HeapGraphWriter {
  public:
   Writer(pid_t pid, JavaHprofDataSource::TraceContext* ctx, uint64_t timestamp)
       : pid_(pid), ctx_(ctx), timestamp_(timestamp),
         last_written_(ctx_->written()) {}
 
   // Return whether the next call to GetHeapGraph will create a new TracePacket.
-  bool will_create_new_packet() const {
+  bool will_create_new_packet() const override {
     return !heap_graph_ || ctx_->written() - last_written_ > kPacketSizeThreshold;
   }
 
-  perfetto::protos::pbzero::HeapGraph* GetHeapGraph() {
+  perfetto::protos::pbzero::HeapGraph* GetHeapGraph() override {
     if (will_create_new_packet()) {
       CreateNewHeapGraph();
     }
@@ -371,7 +398,7 @@ class Writer {
     heap_graph_ = nullptr;
   }
 
-  ~Writer() { Finalize(); }
+  ~Writer() override { Finalize(); }
 
  private:
   Writer(const Writer&) = delete;
@@ -409,6 +436,20 @@ class Writer {
   uint64_t index_ = 0;
 };
 
+// Writes a whole heap dump to a single perfetto.protos.HeapGraph message.
+class SingleMessageWriter final : public HeapGraphWriter {
+ public:
+  explicit SingleMessageWriter(perfetto::protos::pbzero::HeapGraph* heap_graph)
+      : heap_graph_(heap_graph) {}
+
+  bool will_create_new_packet() const override { return false; }
+
+  perfetto::protos::pbzero::HeapGraph* GetHeapGraph() override { return heap_graph_; }
+
+ private:
+  perfetto::protos::pbzero::HeapGraph* const heap_graph_;
+};
+
 class ReferredObjectsFinder {
  public:
   explicit ReferredObjectsFinder(
@@ -424,16 +465,22 @@ class ReferredObjectsFinder {
       // Skip shadow$klass pointer.
       return;
     }
-    art::mirror::Object* ref = obj->GetFieldObject<art::mirror::Object>(offset);
-    art::ArtField* field;
-    if (is_static) {
-      field = art::ArtField::FindStaticFieldWithOffset(obj->AsClass(), offset.Uint32Value());
-    } else {
-      field = art::ArtField::FindInstanceFieldWithOffset(obj->GetClass(), offset.Uint32Value());
-    }
+    // This can run on threads that are not attached to the runtime, which cannot use read
+    // barriers. There is no GC running, so the references are the same without them.
+    art::mirror::Object* ref = obj->GetFieldObject<art::mirror::Object,
+                                                   art::kDefaultVerifyFlags,
+                                                   art::kWithoutReadBarrier>(offset);
     std::string field_name = "";
-    if (field != nullptr && emit_field_ids_) {
-      field_name = field->PrettyField(/*with_type=*/true);
+    if (emit_field_ids_) {
+      art::ArtField* field;
+      if (is_static) {
+        field = art::ArtField::FindStaticFieldWithOffset(obj->AsClass(), offset.Uint32Value());
+      } else {
+        field = art::ArtField::FindInstanceFieldWithOffset(obj->GetClass(), offset.Uint32Value());
+      }
+      if (field != nullptr) {
+        field_name = field->PrettyField(/*with_type=*/true);
+      }
     }
     referred_objects_->emplace_back(std::move(field_name), ref);
   }
@@ -570,14 +617,32 @@ uint64_t GetObjectId(const art::mirror::Object* obj) {
   return reinterpret_cast<uint64_t>(obj) / std::alignment_of<art::mirror::Object>::value;
 }
 
+// Calls `fn` with the offset of each reference instance field declared by `*klass`, in the order
+// of the offsets. `*reference_class` is java.lang.ref.Reference. Does not use read barriers.
 template <typename F>
-void ForInstanceReferenceField(art::mirror::Class* klass, F fn) NO_THREAD_SAFETY_ANALYSIS {
-  for (art::ArtField& af : klass->GetIFields()) {
-    if (af.IsPrimitiveType() ||
-        af.GetOffset().Uint32Value() == art::mirror::Object::ClassOffset().Uint32Value()) {
-      continue;
+void ForInstanceReferenceField(art::mirror::Class* klass,
+                               art::mirror::Class* reference_class,
+                               F fn) NO_THREAD_SAFETY_ANALYSIS {
+  if (!klass->IsResolved()) {
+    return;
+  }
+  uint32_t num_reference_fields = klass->NumReferenceInstanceFields();
+  if (klass == reference_class) {
+    // The class linker does not count `referent`, so that the GC does not visit it. It is the
+    // last reference field of java.lang.ref.Reference.
+    ++num_reference_fields;
+  }
+  if (num_reference_fields == 0u) {
+    return;
+  }
+  uint32_t offset = klass->GetFirstReferenceInstanceFieldOffset<art::kDefaultVerifyFlags,
+                                                                art::kWithoutReadBarrier>()
+                        .Uint32Value();
+  for (uint32_t i = 0; i != num_reference_fields; ++i) {
+    if (offset != art::mirror::Object::ClassOffset().Uint32Value()) {
+      fn(art::MemberOffset(offset));
     }
-    fn(af.GetOffset());
+    offset += sizeof(art::mirror::HeapReference<art::mirror::Object>);
   }
 }
 
@@ -587,10 +652,12 @@ size_t EncodedSize(uint64_t n) {
 }
 
 // Returns all the references that `*obj` (an object of type `*klass`) is holding.
-std::vector<std::pair<std::string, art::mirror::Object*>> GetReferences(art::mirror::Object* obj,
-                                                                        art::mirror::Class* klass,
-                                                                        bool emit_field_ids)
-    REQUIRES_SHARED(art::Locks::mutator_lock_) {
+// `*reference_class` is java.lang.ref.Reference.
+std::vector<std::pair<std::string, art::mirror::Object*>> GetReferences(
+    art::mirror::Object* obj,
+    art::mirror::Class* klass,
+    art::mirror::Class* reference_class,
+    bool emit_field_ids) REQUIRES_SHARED(art::Locks::mutator_lock_) {
   std::vector<std::pair<std::string, art::mirror::Object*>> referred_objects;
   ReferredObjectsFinder objf(&referred_objects, emit_field_ids);
 
@@ -600,10 +667,15 @@ std::vector<std::pair<std::string, art::mirror::Object*>> GetReferences(art::mir
       klass_flags != art::mirror::kClassFlagWeakReference &&
       klass_flags != art::mirror::kClassFlagFinalizerReference &&
       klass_flags != art::mirror::kClassFlagPhantomReference) {
-    obj->VisitReferences(objf, art::VoidFunctor());
+    obj->VisitReferences</*kVisitNativeRoots=*/true,
+                         art::kDefaultVerifyFlags,
+                         art::kWithoutReadBarrier>(objf, art::VoidFunctor());
   } else {
-    for (art::mirror::Class* cls = klass; cls != nullptr; cls = cls->GetSuperClass().Ptr()) {
+    for (art::mirror::Class* cls = klass;
+         cls != nullptr;
+         cls = cls->GetSuperClass<art::kDefaultVerifyFlags, art::kWithoutReadBarrier>().Ptr()) {
       ForInstanceReferenceField(cls,
+                                reference_class,
                                 [obj, objf](art::MemberOffset offset) NO_THREAD_SAFETY_ANALYSIS {
                                   objf(art::ObjPtr<art::mirror::Object>(obj),
                                        offset,
@@ -649,14 +721,17 @@ uint64_t EncodeBaseObjId(
 // perfetto.protos.HeapGraph.
 class HeapGraphDumper {
  public:
-  // Instances of classes whose name is in `ignored_types` will be ignored.
-  explicit HeapGraphDumper(const std::vector<std::string>& ignored_types)
+  // Instances of classes whose name is in `ignored_types` will be ignored. With more than one
+  // `encoding_threads`, most objects are encoded in parallel.
+  HeapGraphDumper(const std::vector<std::string>& ignored_types, size_t encoding_threads)
       : ignored_types_(ignored_types),
-        reference_field_ids_(std::make_unique<protozero::PackedVarInt>()),
-        reference_object_ids_(std::make_unique<protozero::PackedVarInt>()) {}
+        encoding_threads_(encoding_threads),
+        reference_field_ids_(std::make_unique<protozero::PackedVarInt>()) {}
 
   // Dumps a heap graph from `*runtime` and writes it to `writer`.
-  void Dump(art::Runtime* runtime, Writer& writer) REQUIRES(art::Locks::mutator_lock_) {
+  void Dump(art::Runtime* runtime, HeapGraphWriter& writer) REQUIRES(art::Locks::mutator_lock_) {
+    CollectClasses(runtime);
+
     DumpRootObjects(runtime, writer);
 
     DumpObjects(runtime, writer);
@@ -664,9 +739,72 @@ class HeapGraphDumper {
     WriteInternedData(writer);
   }
 
+  size_t GetNumberOfObjects() const {
+    return num_objects_;
+  }
+
+  size_t GetNumberOfObjectsEncodedInParallel() const {
+    return num_objects_encoded_in_parallel_;
+  }
+
  private:
+  // State for encoding a sequence of objects.
+  struct EncodingState {
+    // Id of the previous object that was encoded. Used for delta encoding.
+    uint64_t prev_object_id = 0;
+
+    // Upper bound for the bytes of the objects encoded since this was last reset.
+    size_t encoded_size = 0;
+
+    // Temporary buffers: used locally when encoding an object and then cleared.
+    protozero::PackedVarInt reference_field_ids;
+    protozero::PackedVarInt reference_object_ids;
+  };
+
+  // Objects encoded together by one thread into standalone perfetto.protos.HeapGraph messages
+  // (pieces of about kEncodedPieceSize bytes), whose fields are then appended to the packets of
+  // the writer. The first object of a piece has its full id, so the piece does not depend on the
+  // objects written before it.
+  struct ObjectChunk {
+    struct Entry {
+      art::mirror::Object* obj;
+      art::mirror::Class* klass;
+      uint64_t class_id;
+    };
+
+    std::vector<Entry> objects;
+    std::vector<std::vector<uint8_t>> encoded_pieces;
+    uint64_t last_object_id = 0;
+  };
+
+  // Finds the classes that the objects are checked against while encoding them, so that this can
+  // be done by pointer comparison, which the encoding threads can do without read barriers.
+  // The classes come from the class tables, which is much cheaper than another heap walk.
+  void CollectClasses(art::Runtime* runtime) REQUIRES(art::Locks::mutator_lock_) {
+    reference_class_ = art::GetClassRoot<art::mirror::Reference>().Ptr();
+    art::ClassFuncVisitor visitor(
+        [this](art::ObjPtr<art::mirror::Class> k) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+          art::mirror::Class* klass = k.Ptr();
+          std::string temp;
+          std::string_view descriptor(klass->GetDescriptor(&temp));
+          if (std::find(ignored_types_.begin(), ignored_types_.end(), descriptor) !=
+              ignored_types_.end()) {
+            ignored_classes_.insert(klass);
+          }
+          if (descriptor == "Llibcore/util/NativeAllocationRegistry;") {
+            art::ArtField* af = klass->FindDeclaredInstanceField(
+                "size", art::Primitive::Descriptor(art::Primitive::kPrimLong));
+            if (af != nullptr) {
+              native_allocation_registry_size_offsets_.emplace(klass, af->GetOffset());
+            }
+          }
+          return true;
+        });
+    runtime->GetClassLinker()->VisitClasses(&visitor);
+  }
+
   // Dumps the root objects from `*runtime` to `writer`.
-  void DumpRootObjects(art::Runtime* runtime, Writer& writer)
+  void DumpRootObjects(art::Runtime* runtime, HeapGraphWriter& writer)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
     std::map<art::RootType, std::vector<art::mirror::Object*>> root_objects;
     RootFinder rcf(&root_objects);
@@ -692,15 +830,112 @@ class HeapGraphDumper {
   }
 
   // Dumps all the objects from `*runtime` to `writer`.
-  void DumpObjects(art::Runtime* runtime, Writer& writer) REQUIRES(art::Locks::mutator_lock_) {
+  void DumpObjects(art::Runtime* runtime, HeapGraphWriter& writer)
+      REQUIRES(art::Locks::mutator_lock_) {
+    if (encoding_threads_ > 1u) {
+      DumpObjectsParallel(runtime, writer);
+      return;
+    }
     runtime->GetHeap()->VisitObjectsPaused(
         [this, &writer](art::mirror::Object* obj)
             REQUIRES_SHARED(art::Locks::mutator_lock_) { WriteOneObject(obj, writer); });
   }
 
+  // Like `DumpObjects()`, but the records of the objects that do not intern anything are encoded
+  // in chunks by several threads. The heap is still walked in order by the dumping thread, which
+  // also writes the classes and the other objects, and interns the types of all objects, so the
+  // interned tables are only modified by one thread.
+  //
+  // The encoding threads are plain threads: this runs in the forked child, where the runtime
+  // cannot attach new threads, and there is no GC to synchronize with.
+  void DumpObjectsParallel(art::Runtime* runtime, HeapGraphWriter& writer)
+      REQUIRES(art::Locks::mutator_lock_) {
+    const size_t max_chunks_per_round = 4u * encoding_threads_;
+    std::vector<std::unique_ptr<ObjectChunk>> round;
+    std::unique_ptr<ObjectChunk> chunk;
+    runtime->GetHeap()->VisitObjectsPaused(
+        [&](art::mirror::Object* obj) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+          art::mirror::Class* klass = obj->GetClass();
+          if (obj->IsClass() || EmitsFieldIds(klass->GetClassFlags())) {
+            WriteOneObject(obj, writer);
+            return;
+          }
+          if (IsIgnored(obj)) {
+            return;
+          }
+          if (chunk == nullptr) {
+            chunk = std::make_unique<ObjectChunk>();
+            chunk->objects.reserve(kObjectsPerChunk);
+          }
+          uint64_t class_id = FindOrAppend(&interned_classes_, reinterpret_cast<uintptr_t>(klass));
+          chunk->objects.push_back({obj, klass, class_id});
+          if (chunk->objects.size() == kObjectsPerChunk) {
+            round.push_back(std::move(chunk));
+            if (round.size() == max_chunks_per_round) {
+              EncodeAndWriteChunks(round, writer);
+              round.clear();
+            }
+          }
+        });
+    if (chunk != nullptr) {
+      round.push_back(std::move(chunk));
+    }
+    EncodeAndWriteChunks(round, writer);
+  }
+
+  void EncodeAndWriteChunks(const std::vector<std::unique_ptr<ObjectChunk>>& chunks,
+                            HeapGraphWriter& writer) NO_THREAD_SAFETY_ANALYSIS {
+    std::atomic<size_t> next_chunk(0u);
+    auto encode_chunks = [&]() NO_THREAD_SAFETY_ANALYSIS {
+      EncodingState state;
+      for (size_t i = next_chunk.fetch_add(1u, std::memory_order_relaxed);
+           i < chunks.size();
+           i = next_chunk.fetch_add(1u, std::memory_order_relaxed)) {
+        ObjectChunk* chunk = chunks[i].get();
+        auto heap_graph =
+            std::make_unique<protozero::HeapBuffered<perfetto::protos::pbzero::HeapGraph>>();
+        state.prev_object_id = 0;
+        state.encoded_size = 0;
+        for (const ObjectChunk::Entry& entry : chunk->objects) {
+          WriteObjectProto(entry.obj, entry.klass, entry.class_id, heap_graph->get(), &state);
+          if (state.encoded_size >= kEncodedPieceSize) {
+            chunk->encoded_pieces.push_back(heap_graph->SerializeAsArray());
+            heap_graph =
+                std::make_unique<protozero::HeapBuffered<perfetto::protos::pbzero::HeapGraph>>();
+            chunk->last_object_id = state.prev_object_id;
+            state.prev_object_id = 0;
+            state.encoded_size = 0;
+          }
+        }
+        if (state.encoded_size != 0) {
+          chunk->encoded_pieces.push_back(heap_graph->SerializeAsArray());
+          chunk->last_object_id = state.prev_object_id;
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    size_t num_threads = std::min(encoding_threads_, chunks.size());
+    for (size_t i = 1u; i < num_threads; ++i) {
+      threads.emplace_back(encode_chunks);
+    }
+    encode_chunks();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (const std::unique_ptr<ObjectChunk>& chunk : chunks) {
+      // Packets are only split between pieces, see `Writer::GetHeapGraph()`.
+      for (const std::vector<uint8_t>& piece : chunk->encoded_pieces) {
+        writer.GetHeapGraph()->AppendRawProtoBytes(piece.data(), piece.size());
+      }
+      state_.prev_object_id = chunk->last_object_id;
+      num_objects_ += chunk->objects.size();
+      num_objects_encoded_in_parallel_ += chunk->objects.size();
+    }
+  }
+
   // Writes all the previously accumulated (while dumping objects and roots) interned data to
   // `writer`.
-  void WriteInternedData(Writer& writer) {
+  void WriteInternedData(HeapGraphWriter& writer) {
     for (const auto& p : interned_locations_) {
       const std::string& str = p.first;
       uint64_t id = p.second;
@@ -722,7 +957,7 @@ class HeapGraphDumper {
   }
 
   // Writes `*obj` into `writer`.
-  void WriteOneObject(art::mirror::Object* obj, Writer& writer)
+  void WriteOneObject(art::mirror::Object* obj, HeapGraphWriter& writer)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
     if (obj->IsClass()) {
       WriteClass(obj->AsClass().Ptr(), writer);
@@ -743,14 +978,26 @@ class HeapGraphDumper {
 
     auto class_id = FindOrAppend(&interned_classes_, class_ptr);
 
+    WriteObjectProto(obj, klass, class_id, writer.GetHeapGraph(), &state_);
+    ++num_objects_;
+  }
+
+  // Writes the record of `*obj` (an object of type `*klass`) into `*heap_graph`. Only interns
+  // field names if the type of the object emits field ids, see `EmitsFieldIds()`.
+  void WriteObjectProto(art::mirror::Object* obj,
+                        art::mirror::Class* klass,
+                        uint64_t class_id,
+                        perfetto::protos::pbzero::HeapGraph* heap_graph,
+                        EncodingState* state)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
     uint64_t object_id = GetObjectId(obj);
-    perfetto::protos::pbzero::HeapGraphObject* object_proto = writer.GetHeapGraph()->add_objects();
-    if (prev_object_id_ && prev_object_id_ < object_id) {
-      object_proto->set_id_delta(object_id - prev_object_id_);
+    perfetto::protos::pbzero::HeapGraphObject* object_proto = heap_graph->add_objects();
+    if (state->prev_object_id && state->prev_object_id < object_id) {
+      object_proto->set_id_delta(object_id - state->prev_object_id);
     } else {
       object_proto->set_id(object_id);
     }
-    prev_object_id_ = object_id;
+    state->prev_object_id = object_id;
     object_proto->set_type_id(class_id);
 
     // Arrays / strings are magic and have an instance dependent size.
@@ -758,13 +1005,26 @@ class HeapGraphDumper {
       object_proto->set_self_size(obj->SizeOf());
     }
 
-    FillReferences(obj, klass, object_proto);
+    FillReferences(obj, klass, object_proto, state);
 
     FillFieldValues(obj, klass, object_proto);
+
+    state->encoded_size += kMaxEncodedObjectOverhead;
+  }
+
+  // Whether the references of objects with the given class flags are written with the names of
+  // their fields.
+  static bool EmitsFieldIds(uint32_t klass_flags) {
+    return klass_flags != art::mirror::kClassFlagObjectArray &&
+           klass_flags != art::mirror::kClassFlagNormal &&
+           klass_flags != art::mirror::kClassFlagSoftReference &&
+           klass_flags != art::mirror::kClassFlagWeakReference &&
+           klass_flags != art::mirror::kClassFlagFinalizerReference &&
+           klass_flags != art::mirror::kClassFlagPhantomReference;
   }
 
   // Writes `*klass` into `writer`.
-  void WriteClass(art::mirror::Class* klass, Writer& writer)
+  void WriteClass(art::mirror::Class* klass, HeapGraphWriter& writer)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
     perfetto::protos::pbzero::HeapGraphType* type_proto = writer.GetHeapGraph()->add_types();
     type_proto->set_id(FindOrAppend(&interned_classes_, reinterpret_cast<uintptr_t>(klass)));
@@ -778,7 +1038,9 @@ class HeapGraphDumper {
           &interned_classes_, reinterpret_cast<uintptr_t>(klass->GetSuperClass().Ptr())));
     }
     ForInstanceReferenceField(
-        klass, [klass, this](art::MemberOffset offset) NO_THREAD_SAFETY_ANALYSIS {
+        klass,
+        reference_class_,
+        [klass, this](art::MemberOffset offset) NO_THREAD_SAFETY_ANALYSIS {
           auto art_field = art::ArtField::FindInstanceFieldWithOffset(klass, offset.Uint32Value());
           reference_field_ids_->Append(
               FindOrAppend(&interned_fields_, art_field->PrettyField(true)));
@@ -788,7 +1050,7 @@ class HeapGraphDumper {
   }
 
   // Creates a fake class that represents a type only used by `*obj` into `writer`.
-  uintptr_t WriteSyntheticClassFromObj(art::mirror::Object* obj, Writer& writer)
+  uintptr_t WriteSyntheticClassFromObj(art::mirror::Object* obj, HeapGraphWriter& writer)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
     CHECK(obj->IsClass());
     perfetto::protos::pbzero::HeapGraphType* type_proto = writer.GetHeapGraph()->add_types();
@@ -805,17 +1067,12 @@ class HeapGraphDumper {
   // Fills `*object_proto` with all the references held by `*obj` (an object of type `*klass`).
   void FillReferences(art::mirror::Object* obj,
                       art::mirror::Class* klass,
-                      perfetto::protos::pbzero::HeapGraphObject* object_proto)
+                      perfetto::protos::pbzero::HeapGraphObject* object_proto,
+                      EncodingState* state)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
-    const uint32_t klass_flags = klass->GetClassFlags();
-    const bool emit_field_ids = klass_flags != art::mirror::kClassFlagObjectArray &&
-                                klass_flags != art::mirror::kClassFlagNormal &&
-                                klass_flags != art::mirror::kClassFlagSoftReference &&
-                                klass_flags != art::mirror::kClassFlagWeakReference &&
-                                klass_flags != art::mirror::kClassFlagFinalizerReference &&
-                                klass_flags != art::mirror::kClassFlagPhantomReference;
+    const bool emit_field_ids = EmitsFieldIds(klass->GetClassFlags());
     std::vector<std::pair<std::string, art::mirror::Object*>> referred_objects =
-        GetReferences(obj, klass, emit_field_ids);
+        GetReferences(obj, klass, reference_class_, emit_field_ids);
 
     art::mirror::Object* min_nonnull_ptr = FilterIgnoredReferencesAndFindMin(referred_objects);
 
@@ -825,25 +1082,26 @@ class HeapGraphDumper {
       const std::string& field_name = p.first;
       art::mirror::Object* referred_obj = p.second;
       if (emit_field_ids) {
-        reference_field_ids_->Append(FindOrAppend(&interned_fields_, field_name));
+        state->reference_field_ids.Append(FindOrAppend(&interned_fields_, field_name));
       }
       uint64_t referred_obj_id = GetObjectId(referred_obj);
       if (referred_obj_id) {
         referred_obj_id -= base_obj_id;
       }
-      reference_object_ids_->Append(referred_obj_id);
+      state->reference_object_ids.Append(referred_obj_id);
     }
+    state->encoded_size += state->reference_field_ids.size() + state->reference_object_ids.size();
     if (emit_field_ids) {
-      object_proto->set_reference_field_id(*reference_field_ids_);
-      reference_field_ids_->Reset();
+      object_proto->set_reference_field_id(state->reference_field_ids);
+      state->reference_field_ids.Reset();
     }
     if (base_obj_id) {
       // The field is called `reference_field_id_base`, but it has always been used as a base for
       // `reference_object_id`. It should be called `reference_object_id_base`.
       object_proto->set_reference_field_id_base(base_obj_id);
     }
-    object_proto->set_reference_object_id(*reference_object_ids_);
-    reference_object_ids_->Reset();
+    object_proto->set_reference_object_id(state->reference_object_ids);
+    state->reference_object_ids.Reset();
   }
 
   // Iterates all the `referred_objects` and sets all the objects that are supposed to be ignored
@@ -873,39 +1131,42 @@ class HeapGraphDumper {
                        art::mirror::Class* klass,
                        perfetto::protos::pbzero::HeapGraphObject* object_proto) const
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
-    if (obj->IsClass() || klass->IsClassClass()) {
+    if (native_allocation_registry_size_offsets_.empty() || obj->IsClass()) {
       return;
     }
 
-    for (art::mirror::Class* cls = klass; cls != nullptr; cls = cls->GetSuperClass().Ptr()) {
-      if (cls->IsArrayClass()) {
-        continue;
-      }
-
-      if (cls->DescriptorEquals("Llibcore/util/NativeAllocationRegistry;")) {
-        art::ArtField* af = cls->FindDeclaredInstanceField(
-            "size", art::Primitive::Descriptor(art::Primitive::kPrimLong));
-        if (af) {
-          object_proto->set_native_allocation_registry_size_field(af->GetLong(obj));
-        }
+    for (art::mirror::Class* cls = klass;
+         cls != nullptr;
+         cls = cls->GetSuperClass<art::kDefaultVerifyFlags, art::kWithoutReadBarrier>().Ptr()) {
+      auto it = native_allocation_registry_size_offsets_.find(cls);
+      if (it != native_allocation_registry_size_offsets_.end()) {
+        object_proto->set_native_allocation_registry_size_field(obj->GetField64(it->second));
       }
     }
   }
 
   // Returns true if `*obj` has a type that's supposed to be ignored.
   bool IsIgnored(art::mirror::Object* obj) const REQUIRES_SHARED(art::Locks::mutator_lock_) {
-    if (obj->IsClass()) {
+    if (ignored_classes_.empty() || obj->IsClass()) {
       return false;
     }
-    art::mirror::Class* klass = obj->GetClass();
-    std::string temp;
-    std::string_view name(klass->GetDescriptor(&temp));
-    return std::find(ignored_types_.begin(), ignored_types_.end(), name) != ignored_types_.end();
+    art::mirror::Class* klass = obj->GetClass<art::kDefaultVerifyFlags, art::kWithoutReadBarrier>();
+    return ignored_classes_.find(klass) != ignored_classes_.end();
   }
 
   // Name of classes whose instances should be ignored.
   const std::vector<std::string> ignored_types_;
 
+  // The classes named by `ignored_types_`, see `CollectClasses()`.
+  std::set<art::mirror::Class*> ignored_classes_;
+  // Offset of the `size` field of each libcore.util.NativeAllocationRegistry class.
+  std::map<art::mirror::Class*, art::MemberOffset> native_allocation_registry_size_offsets_;
+  // java.lang.ref.Reference.
+  art::mirror::Class* reference_class_ = nullptr;
+
+  // Number of threads encoding the objects, including the dumping thread.
+  const size_t encoding_threads_;
+
   // Make sure that intern ID 0 (default proto value for a uint64_t) always maps to ""
   // (default proto value for a string) or to 0 (default proto value for a uint64).
 
@@ -916,14 +1177,26 @@ class HeapGraphDumper {
   // Map from addr (the class pointer) to its id in perfetto.protos.HeapGraph.types
   std::map<uintptr_t, uint64_t> interned_classes_{{0, 0}};
 
-  // Temporary buffers: used locally in some methods and then cleared.
+  // Temporary buffer: used locally when writing a class and then cleared.
   std::unique_ptr<protozero::PackedVarInt> reference_field_ids_;
-  std::unique_ptr<protozero::PackedVarInt> reference_object_ids_;
 
-  // Id of the previous object that was dumped. Used for delta encoding.
-  uint64_t prev_object_id_ = 0;
+  // State for the objects written directly to the packets.
+  EncodingState state_;
+
+  size_t num_objects_ = 0u;
+  size_t num_objects_encoded_in_parallel_ = 0u;
 };
 
+std::vector<uint8_t> DumpHeapGraphForTesting(const std::vector<std::string>& ignored_types,
+                                             size_t encoding_threads) NO_THREAD_SAFETY_ANALYSIS {
+  art::Locks::mutator_lock_->AssertExclusiveHeld(art::Thread::Current());
+  protozero::HeapBuffered<perfetto::protos::pbzero::HeapGraph> heap_graph;
+  SingleMessageWriter writer(heap_graph.get());
+  HeapGraphDumper dumper(ignored_types, encoding_threads);
+  dumper.Dump(art::Runtime::Current(), writer);
+  return heap_graph.SerializeAsArray();
+}
+
 // waitpid with a timeout implemented by ~busy-waiting
 // See b/181031512 for rationale.
 void BusyWaitpid(pid_t pid, uint32_t timeout_ms) {
@@ -1016,6 +1289,16 @@ void ForkAndRun(art::Thread* self,
   art::FastExit(0);
 }
 
+// Number of threads encoding the heap graph. The property allows comparing with the serial
+// encoding (a value of 1) on the same heap.
+size_t GetEncodingThreads() {
+  size_t default_threads = std::clamp<size_t>(std::thread::hardware_concurrency(),
+                                              1u,
+                                              kMaxEncodingThreads);
+  return android::base::GetUintProperty<size_t>(
+      "dalvik.vm.perfetto_hprof.encoding_threads", default_threads, kMaxEncodingThreads);
+}
+
 void WriteHeapPackets(pid_t parent_pid, uint64_t timestamp) {
   JavaHprofDataSource::Trace(
       [parent_pid, timestamp](JavaHprofDataSource::TraceContext ctx)
@@ -1036,12 +1319,18 @@ void WriteHeapPackets(pid_t parent_pid, uint64_t timestamp) {
             if (dump_smaps) {
               DumpSmaps(&ctx);
             }
+            const uint64_t start_ns = GetCurrentBootClockNs();
+            const uint64_t start_written = ctx.written();
             Writer writer(parent_pid, &ctx, timestamp);
-            HeapGraphDumper dumper(ignored_types);
+            HeapGraphDumper dumper(ignored_types, GetEncodingThreads());
 
             dumper.Dump(art::Runtime::Current(), writer);
 
             writer.Finalize();
+            VLOG(plugin) << "heap graph of " << parent_pid << ": " << dumper.GetNumberOfObjects()
+                      << " objects (" << dumper.GetNumberOfObjectsEncodedInParallel()
+                      << " encoded in parallel), " << (ctx.written() - start_written)
+                      << " bytes in " << (GetCurrentBootClockNs() - start_ns) / 1000000 << " ms";
             ctx.Flush([] {
               art::MutexLock lk(JavaHprofDataSource::art_thread(), GetStateMutex());
               g_state = State::kEnd;
@@ -17,7 +17,11 @@
 #ifndef ART_PERFETTO_HPROF_PERFETTO_HPROF_H_
 #define ART_PERFETTO_HPROF_PERFETTO_HPROF_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <ostream>
+#include <string>
+#include <vector>
 
 namespace perfetto_hprof {
 
@@ -37,6 +41,12 @@ enum class State {
 
 std::ostream& operator<<(std::ostream& os, State state);
 
+// Dumps the heap graph of the current runtime, as it would be written to a trace, into a single
+// serialized perfetto.protos.HeapGraph message. The caller must have suspended all the other
+// threads, and there must be no GC running.
+std::vector<uint8_t> DumpHeapGraphForTesting(const std::vector<std::string>& ignored_types,
+                                             size_t encoding_threads);
+
 }  // namespace perfetto_hprof
 
 #endif  // ART_PERFETTO_HPROF_PERFETTO_HPROF_H_
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "perfetto_hprof.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "gc/scoped_gc_critical_section.h"
+#include "handle_scope-inl.h"
+#include "mirror/object_array-alloc-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string-alloc-inl.h"
+#include "perfetto/trace/profiling/heap_graph.pbzero.h"
+#include "perfetto/trace/profiling/profile_common.pbzero.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_list.h"
+
+namespace perfetto_hprof {
+
+// An object of a heap graph, with the ids of the other objects and the names of the types and
+// fields resolved, so that it does not depend on how the heap graph was encoded.
+struct DecodedObject {
+  std::string type;
+  uint64_t self_size = 0u;
+  std::vector<std::string> reference_fields;
+  std::vector<uint64_t> referred_objects;
+  uint64_t native_allocation_registry_size = 0u;
+
+  bool operator==(const DecodedObject& other) const {
+    return type == other.type &&
+           self_size == other.self_size &&
+           reference_fields == other.reference_fields &&
+           referred_objects == other.referred_objects &&
+           native_allocation_registry_size == other.native_allocation_registry_size;
+  }
+};
+
+struct DecodedHeapGraph {
+  std::map<uint64_t, DecodedObject> objects;
+  size_t num_types = 0u;
+  size_t num_field_names = 0u;
+};
+
+static bool Decode(const std::vector<uint8_t>& data, /*out*/ DecodedHeapGraph* graph) {
+  using perfetto::protos::pbzero::HeapGraph;
+  using perfetto::protos::pbzero::HeapGraphObject;
+  using perfetto::protos::pbzero::HeapGraphType;
+  using perfetto::protos::pbzero::InternedString;
+
+  HeapGraph::Decoder decoder(data.data(), data.size());
+  std::map<uint64_t, std::string> type_names;
+  for (auto it = decoder.types(); it; ++it) {
+    HeapGraphType::Decoder type(*it);
+    type_names[type.id()] = type.class_name().ToStdString();
+    ++graph->num_types;
+  }
+  std::map<uint64_t, std::string> field_names;
+  for (auto it = decoder.field_names(); it; ++it) {
+    InternedString::Decoder field_name(*it);
+    field_names[field_name.iid()] =
+        std::string(reinterpret_cast<const char*>(field_name.str().data), field_name.str().size);
+    ++graph->num_field_names;
+  }
+
+  uint64_t prev_object_id = 0u;
+  for (auto it = decoder.objects(); it; ++it) {
+    HeapGraphObject::Decoder object(*it);
+    uint64_t object_id = object.has_id() ? object.id() : prev_object_id + object.id_delta();
+    prev_object_id = object_id;
+
+    DecodedObject decoded;
+    decoded.type = type_names[object.type_id()];
+    decoded.self_size = object.self_size();
+    decoded.native_allocation_registry_size = object.native_allocation_registry_size_field();
+    bool parse_error = false;
+    for (auto field_it = object.reference_field_id(&parse_error); field_it; ++field_it) {
+      decoded.reference_fields.push_back(field_names[*field_it]);
+    }
+    for (auto ref_it = object.reference_object_id(&parse_error); ref_it; ++ref_it) {
+      uint64_t referred_id = *ref_it;
+      if (referred_id != 0u) {
+        referred_id += object.reference_field_id_base();
+      }
+      decoded.referred_objects.push_back(referred_id);
+    }
+    if (parse_error || !graph->objects.emplace(object_id, std::move(decoded)).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class PerfettoHprofTest : public art::CommonRuntimeTest {
+ protected:
+  PerfettoHprofTest() {
+    use_boot_image_ = true;  // Make the Runtime creation cheaper.
+  }
+
+  DecodedHeapGraph Dump(const std::vector<std::string>& ignored_types, size_t encoding_threads) {
+    art::Thread* self = art::Thread::Current();
+    std::vector<uint8_t> data;
+    {
+      art::ScopedThreadSuspension sts(self, art::ThreadState::kSuspended);
+      art::gc::ScopedGCCriticalSection gcs(self,
+                                           art::gc::kGcCauseHprof,
+                                           art::gc::kCollectorTypeHprof);
+      art::ScopedSuspendAll ssa(__FUNCTION__);
+      data = DumpHeapGraphForTesting(ignored_types, encoding_threads);
+    }
+    DecodedHeapGraph graph;
+    EXPECT_TRUE(Decode(data, &graph));
+    return graph;
+  }
+
+  void ExpectSameHeapGraph(const DecodedHeapGraph& expected, const DecodedHeapGraph& actual) {
+    EXPECT_EQ(expected.num_types, actual.num_types);
+    EXPECT_EQ(expected.num_field_names, actual.num_field_names);
+    ASSERT_EQ(expected.objects.size(), actual.objects.size());
+    for (const auto& [id, object] : expected.objects) {
+      auto it = actual.objects.find(id);
+      ASSERT_TRUE(it != actual.objects.end()) << id;
+      EXPECT_TRUE(object == it->second) << id << " " << object.type << " " << it->second.type;
+    }
+  }
+};
+
+// The objects encoded by the encoding threads must be the same as if they were encoded by the
+// dumping thread. The heap of the boot image has enough objects to split the encoding of every
+// chunk of objects in several pieces.
+TEST_F(PerfettoHprofTest, ParallelEncoding) {
+  art::ScopedObjectAccess soa(art::Thread::Current());
+  art::StackHandleScope<1> hs(soa.Self());
+  constexpr size_t kNumStrings = 10000;
+  art::Handle<art::mirror::ObjectArray<art::mirror::Object>> array =
+      hs.NewHandle(art::mirror::ObjectArray<art::mirror::Object>::Alloc(
+          soa.Self(), art::GetClassRoot<art::mirror::ObjectArray<art::mirror::Object>>(),
+          kNumStrings));
+  ASSERT_TRUE(array != nullptr);
+  for (size_t i = 0; i != kNumStrings; ++i) {
+    std::string value = "string " + std::to_string(i);
+    art::ObjPtr<art::mirror::String> str =
+        art::mirror::String::AllocFromModifiedUtf8(soa.Self(), value.c_str());
+    ASSERT_TRUE(str != nullptr);
+    array->Set(i, str);
+  }
+
+  DecodedHeapGraph serial = Dump(/*ignored_types=*/{}, /*encoding_threads=*/1u);
+  ASSERT_GT(serial.objects.size(), kNumStrings);
+  for (size_t encoding_threads : {2u, 4u}) {
+    ExpectSameHeapGraph(serial, Dump(/*ignored_types=*/{}, encoding_threads));
+  }
+}
+
+TEST_F(PerfettoHprofTest, IgnoredTypes) {
+  art::ScopedObjectAccess soa(art::Thread::Current());
+  const std::vector<std::string> ignored_types = {"Ljava/lang/String;"};
+  DecodedHeapGraph serial = Dump(ignored_types, /*encoding_threads=*/1u);
+  for (const auto& [id, object] : serial.objects) {
+    EXPECT_NE(object.type, "java.lang.String") << id;
+    for (uint64_t referred_id : object.referred_objects) {
+      auto it = serial.objects.find(referred_id);
+      EXPECT_TRUE(referred_id == 0u || it != serial.objects.end()) << id;
+    }
+  }
+  ExpectSameHeapGraph(serial, Dump(ignored_types, /*encoding_threads=*/4u));
+}
+
+}  // namespace perfetto_hprof
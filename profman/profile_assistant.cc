@@ -16,6 +16,12 @@
 
 #include "profile_assistant.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "base/os.h"
 #include "base/unix_file/fd_file.h"
 #include "profman/profman_result.h"
@@ -27,52 +33,215 @@ namespace art {
 static constexpr const uint32_t kMinNewMethodsForCompilation = 100;
 static constexpr const uint32_t kMinNewClassesForCompilation = 50;
 
-ProfmanResult::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
-    const std::vector<ScopedFlock>& profile_files,
+// Loads the reference profile into `info` and records its size before the merge.
+static ProfmanResult::ProcessingResult LoadReferenceProfile(
     const ScopedFlock& reference_profile_file,
     const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
-    const Options& options) {
-  ProfileCompilationInfo info(options.IsBootImageMerge());
-
+    const ProfileAssistant::Options& options,
+    /*inout*/ ProfileCompilationInfo* info,
+    /*out*/ uint32_t* number_of_methods,
+    /*out*/ uint32_t* number_of_classes) {
   // Load the reference profile.
-  if (!info.Load(reference_profile_file->Fd(), /*merge_classes=*/ true, filter_fn)) {
+  if (!info->Load(reference_profile_file->Fd(), /*merge_classes=*/ true, filter_fn)) {
     LOG(WARNING) << "Could not load reference profile file";
     return ProfmanResult::kErrorBadProfiles;
   }
 
-  if (options.IsBootImageMerge() && !info.IsForBootImage()) {
+  if (options.IsBootImageMerge() && !info->IsForBootImage()) {
     LOG(WARNING) << "Requested merge for boot image profile but the reference profile is regular.";
     return ProfmanResult::kErrorBadProfiles;
   }
 
   // Store the current state of the reference profile before merging with the current profiles.
-  uint32_t number_of_methods = info.GetNumberOfMethods();
-  uint32_t number_of_classes = info.GetNumberOfResolvedClasses();
+  *number_of_methods = info->GetNumberOfMethods();
+  *number_of_classes = info->GetNumberOfResolvedClasses();
+  return ProfmanResult::kSuccess;
+}
+
+// Returns the result for a profile that could not be loaded, or `kSuccess` if it should be
+// ignored.
+static ProfmanResult::ProcessingResult HandleLoadFailure(
+    const ScopedFlock& profile_file,
+    size_t index,
+    const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+    const ProfileAssistant::Options& options) {
+  LOG(WARNING) << "Could not load profile file at index " << index;
+  if (options.IsForceMerge() || options.IsForceMergeAndAnalyze()) {
+    // If we have to merge forcefully, ignore load failures.
+    // This is useful for boot image profiles to ignore stale profiles which are
+    // cleared lazily.
+    return ProfmanResult::kSuccess;
+  }
+  // TODO: Do we really need to use a different error code for version mismatch?
+  ProfileCompilationInfo wrong_info(!options.IsBootImageMerge());
+  if (wrong_info.Load(profile_file->Fd(), /*merge_classes=*/ true, filter_fn)) {
+    return ProfmanResult::kErrorDifferentVersions;
+  }
+  return ProfmanResult::kErrorBadProfiles;
+}
+
+ProfmanResult::ProcessingResult ProfileAssistant::MergeProfiles(
+    const std::vector<ScopedFlock>& profile_files,
+    const ScopedFlock& reference_profile_file,
+    const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+    const Options& options,
+    /*inout*/ ProfileCompilationInfo* info,
+    /*out*/ uint32_t* number_of_methods,
+    /*out*/ uint32_t* number_of_classes) {
+  ProfmanResult::ProcessingResult result = LoadReferenceProfile(
+      reference_profile_file, filter_fn, options, info, number_of_methods, number_of_classes);
+  if (result != ProfmanResult::kSuccess) {
+    return result;
+  }
 
   // Merge all current profiles.
   for (size_t i = 0; i < profile_files.size(); i++) {
     ProfileCompilationInfo cur_info(options.IsBootImageMerge());
     if (!cur_info.Load(profile_files[i]->Fd(), /*merge_classes=*/ true, filter_fn)) {
-      LOG(WARNING) << "Could not load profile file at index " << i;
-      if (options.IsForceMerge() || options.IsForceMergeAndAnalyze()) {
-        // If we have to merge forcefully, ignore load failures.
-        // This is useful for boot image profiles to ignore stale profiles which are
-        // cleared lazily.
-        continue;
-      }
-      // TODO: Do we really need to use a different error code for version mismatch?
-      ProfileCompilationInfo wrong_info(!options.IsBootImageMerge());
-      if (wrong_info.Load(profile_files[i]->Fd(), /*merge_classes=*/ true, filter_fn)) {
-        return ProfmanResult::kErrorDifferentVersions;
+      result = HandleLoadFailure(profile_files[i], i, filter_fn, options);
+      if (result != ProfmanResult::kSuccess) {
+        return result;
       }
-      return ProfmanResult::kErrorBadProfiles;
+      continue;
     }
 
-    if (!info.MergeWith(cur_info)) {
+    if (!info->MergeWith(cur_info)) {
       LOG(WARNING) << "Could not merge profile file at index " << i;
       return ProfmanResult::kErrorBadProfiles;
     }
   }
+  return ProfmanResult::kSuccess;
+}
+
+ProfmanResult::ProcessingResult ProfileAssistant::MergeProfilesParallel(
+    const std::vector<ScopedFlock>& profile_files,
+    const ScopedFlock& reference_profile_file,
+    const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+    const Options& options,
+    /*inout*/ ProfileCompilationInfo* info,
+    /*out*/ uint32_t* number_of_methods,
+    /*out*/ uint32_t* number_of_classes) {
+  ProfmanResult::ProcessingResult result = LoadReferenceProfile(
+      reference_profile_file, filter_fn, options, info, number_of_methods, number_of_classes);
+  if (result != ProfmanResult::kSuccess) {
+    return result;
+  }
+
+  // The profiles are loaded on `num_threads` threads, each into its own staging profile, so
+  // that every section is read and inflated once and a profile is merged only if it loaded
+  // completely. This thread merges each staged profile as soon as it and all the profiles
+  // before it are loaded, in input order, which keeps the result, including the order of dex
+  // files, identical to the single-threaded merge. The loaders claim the profiles in input
+  // order and do not claim another one while the staged profiles use `staging_bytes` or more,
+  // so the memory held by staged profiles is bounded by that plus one profile per thread.
+  const size_t num_threads = options.GetMergeThreads();
+  const size_t staging_bytes = options.GetMergeStagingBytes();
+  DCHECK_NE(num_threads, 0u);
+  struct StagedProfile {
+    std::unique_ptr<ProfileCompilationInfo> info;
+    size_t bytes = 0u;
+    bool done = false;
+    bool loaded = false;
+  };
+  std::vector<StagedProfile> staged(profile_files.size());
+  std::mutex lock;
+  std::condition_variable cond;
+  size_t next_to_load = 0u;  // Guarded by `lock`.
+  size_t staged_bytes = 0u;  // Guarded by `lock`.
+  bool stop = false;  // Guarded by `lock`.
+  auto load = [&]() {
+    while (true) {
+      size_t i;
+      {
+        std::unique_lock<std::mutex> mu(lock);
+        cond.wait(mu, [&]() {
+          return stop || next_to_load == profile_files.size() || staged_bytes < staging_bytes;
+        });
+        if (stop || next_to_load == profile_files.size()) {
+          return;
+        }
+        i = next_to_load++;
+      }
+      auto info = std::make_unique<ProfileCompilationInfo>(options.IsBootImageMerge());
+      bool loaded = info->Load(profile_files[i]->Fd(), /*merge_classes=*/ true, filter_fn);
+      size_t bytes = info->GetAllocator()->BytesUsed();
+      {
+        std::lock_guard<std::mutex> mu(lock);
+        staged[i].info = std::move(info);
+        staged[i].bytes = bytes;
+        staged[i].loaded = loaded;
+        staged[i].done = true;
+        staged_bytes += bytes;
+      }
+      cond.notify_all();
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (size_t t = 0; t != num_threads; ++t) {
+    threads.emplace_back(load);
+  }
+
+  for (size_t i = 0; i != profile_files.size(); ++i) {
+    std::unique_ptr<ProfileCompilationInfo> staged_info;
+    bool loaded;
+    {
+      std::unique_lock<std::mutex> mu(lock);
+      cond.wait(mu, [&]() { return staged[i].done; });
+      staged_info = std::move(staged[i].info);
+      loaded = staged[i].loaded;
+    }
+    if (!loaded) {
+      // Retried on this thread, the loaders do not read this profile again.
+      result = HandleLoadFailure(profile_files[i], i, filter_fn, options);
+    } else if (!info->MergeWith(*staged_info)) {
+      LOG(WARNING) << "Could not merge profile file at index " << i;
+      result = ProfmanResult::kErrorBadProfiles;
+    }
+    // Release the staged profile and let the loaders continue.
+    staged_info.reset();
+    {
+      std::lock_guard<std::mutex> mu(lock);
+      staged_bytes -= staged[i].bytes;
+      stop = (result != ProfmanResult::kSuccess);
+    }
+    cond.notify_all();
+    if (result != ProfmanResult::kSuccess) {
+      break;
+    }
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
+ProfmanResult::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
+    const std::vector<ScopedFlock>& profile_files,
+    const ScopedFlock& reference_profile_file,
+    const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+    const Options& options) {
+  ProfileCompilationInfo info(options.IsBootImageMerge());
+  uint32_t number_of_methods = 0u;
+  uint32_t number_of_classes = 0u;
+  ProfmanResult::ProcessingResult merge_result = (options.GetMergeThreads() != 0u)
+      ? MergeProfilesParallel(profile_files,
+                              reference_profile_file,
+                              filter_fn,
+                              options,
+                              &info,
+                              &number_of_methods,
+                              &number_of_classes)
+      : MergeProfiles(profile_files,
+                      reference_profile_file,
+                      filter_fn,
+                      options,
+                      &info,
+                      &number_of_methods,
+                      &number_of_classes);
+  if (merge_result != ProfmanResult::kSuccess) {
+    return merge_result;
+  }
 
   // If we perform a forced merge do not analyze the difference between profiles.
   if (!options.IsForceMerge()) {
@@ -111,6 +280,7 @@ ProfmanResult::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
     PLOG(WARNING) << "Could not clear reference profile file";
     return ProfmanResult::kErrorIO;
   }
+  info.SetSaveMappable(options.IsMappableReferenceProfile());
   if (!info.Save(reference_profile_file->Fd())) {
     LOG(WARNING) << "Could not save reference profile file";
     return ProfmanResult::kErrorIO;
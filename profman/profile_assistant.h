@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include "base/globals.h"
 #include "base/scoped_flock.h"
 #include "profile/profile_compilation_info.h"
 #include "profman/profman_result.h"
@@ -34,6 +35,7 @@ class ProfileAssistant {
     static constexpr bool kBootImageMergeDefault = false;
     static constexpr uint32_t kMinNewMethodsPercentChangeForCompilation = 2;
     static constexpr uint32_t kMinNewClassesPercentChangeForCompilation = 2;
+    static constexpr uint32_t kMergeStagingBytesDefault = 64 * MB;
 
     Options()
         : force_merge_(kForceMergeDefault),
@@ -42,7 +44,10 @@ class ProfileAssistant {
           min_new_methods_percent_change_for_compilation_(
               kMinNewMethodsPercentChangeForCompilation),
           min_new_classes_percent_change_for_compilation_(
-              kMinNewClassesPercentChangeForCompilation) {
+              kMinNewClassesPercentChangeForCompilation),
+          merge_threads_(0u),
+          merge_staging_bytes_(kMergeStagingBytesDefault),
+          mappable_reference_profile_(false) {
     }
 
     // Only for S and T uses. U+ should use `IsForceMergeAndAnalyze`.
@@ -55,6 +60,9 @@ class ProfileAssistant {
     uint32_t GetMinNewClassesPercentChangeForCompilation() const {
         return min_new_classes_percent_change_for_compilation_;
     }
+    uint32_t GetMergeThreads() const { return merge_threads_; }
+    uint32_t GetMergeStagingBytes() const { return merge_staging_bytes_; }
+    bool IsMappableReferenceProfile() const { return mappable_reference_profile_; }
 
     void SetForceMerge(bool value) { force_merge_ = value; }
     void SetForceMergeAndAnalyze(bool value) { force_merge_and_analyze_ = value; }
@@ -65,6 +73,9 @@ class ProfileAssistant {
     void SetMinNewClassesPercentChangeForCompilation(uint32_t value) {
       min_new_classes_percent_change_for_compilation_ = value;
     }
+    void SetMergeThreads(uint32_t value) { merge_threads_ = value; }
+    void SetMergeStagingBytes(uint32_t value) { merge_staging_bytes_ = value; }
+    void SetMappableReferenceProfile(bool value) { mappable_reference_profile_ = value; }
 
    private:
     // If true, performs a forced merge, without analyzing if there is a significant difference
@@ -81,6 +92,15 @@ class ProfileAssistant {
     bool boot_image_merge_;
     uint32_t min_new_methods_percent_change_for_compilation_;
     uint32_t min_new_classes_percent_change_for_compilation_;
+    // If non-zero, the input profiles are loaded on this many threads and merged in input
+    // order, so that the result is the same as with the default single-threaded merge.
+    uint32_t merge_threads_;
+    // With `merge_threads_`, no new input profile is loaded while the profiles loaded ahead of
+    // the merge use this many bytes or more.
+    uint32_t merge_staging_bytes_;
+    // If true, the reference profile is saved uncompressed with the index used by
+    // `ProfileCompilationInfo::MappedProfile`.
+    bool mappable_reference_profile_;
   };
 
   // Process the profile information present in the given files. Returns one of
@@ -113,6 +133,24 @@ class ProfileAssistant {
       const Options& options = Options());
 
  private:
+  static ProfmanResult::ProcessingResult MergeProfiles(
+      const std::vector<ScopedFlock>& profile_files,
+      const ScopedFlock& reference_profile_file,
+      const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+      const Options& options,
+      /*inout*/ ProfileCompilationInfo* info,
+      /*out*/ uint32_t* number_of_methods,
+      /*out*/ uint32_t* number_of_classes);
+
+  static ProfmanResult::ProcessingResult MergeProfilesParallel(
+      const std::vector<ScopedFlock>& profile_files,
+      const ScopedFlock& reference_profile_file,
+      const ProfileCompilationInfo::ProfileLoadFilterFn& filter_fn,
+      const Options& options,
+      /*inout*/ ProfileCompilationInfo* info,
+      /*out*/ uint32_t* number_of_methods,
+      /*out*/ uint32_t* number_of_classes);
+
   static ProfmanResult::ProcessingResult ProcessProfilesInternal(
       const std::vector<ScopedFlock>& profile_files,
       const ScopedFlock& reference_profile_file,
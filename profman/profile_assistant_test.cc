@@ -26,6 +26,7 @@
 #include "base/unix_file/fd_file.h"
 #include "base/utils.h"
 #include "common_runtime_test.h"
+#include "dex/class_accessor-inl.h"
 #include "dex/descriptors_names.h"
 #include "dex/dex_file_structs.h"
 #include "dex/dex_instruction-inl.h"
@@ -210,7 +211,8 @@ class ProfileAssistantTest : public CommonRuntimeTest, public ProfileTestHelper
   bool CreateProfile(const std::string& profile_file_contents,
                      const std::string& filename,
                      const std::string& dex_location,
-                     bool for_boot_image = false) {
+                     bool for_boot_image = false,
+                     const std::vector<std::string>& extra_args = {}) {
     ScratchFile class_names_file;
     File* file = class_names_file.GetFile();
     EXPECT_TRUE(file->WriteFully(profile_file_contents.c_str(), profile_file_contents.length()));
@@ -223,6 +225,7 @@ class ProfileAssistantTest : public CommonRuntimeTest, public ProfileTestHelper
     argv_str.push_back("--reference-profile-file=" + filename);
     argv_str.push_back("--apk=" + dex_location);
     argv_str.push_back("--dex-location=" + dex_location);
+    argv_str.insert(argv_str.end(), extra_args.begin(), extra_args.end());
     std::string error;
     EXPECT_EQ(ExecAndReturnCode(argv_str, &error), 0) << error;
     return true;
@@ -590,6 +593,103 @@ TEST_F(ProfileAssistantTest, AdviseCompilationNonEmptyReferences) {
   CheckProfileInfo(profile2, info2);
 }
 
+TEST_F(ProfileAssistantTest, ParallelMerge) {
+  ScratchFile profile1;
+  ScratchFile profile2;
+  ScratchFile profile3;
+  ScratchFile reference_profile;
+  ScratchFile serial_reference_profile;
+
+  std::vector<int> profile_fds({
+      GetFd(profile1),
+      GetFd(profile2),
+      GetFd(profile3)});
+  int serial_reference_profile_fd = GetFd(serial_reference_profile);
+
+  const uint16_t kNumberOfMethodsToEnableCompilation = 100;
+  ProfileCompilationInfo info1;
+  SetupProfile(dex3, dex4, kNumberOfMethodsToEnableCompilation, 0, profile1, &info1);
+  ProfileCompilationInfo info2;
+  SetupProfile(dex1, dex2, kNumberOfMethodsToEnableCompilation, 10, profile2, &info2);
+  ProfileCompilationInfo info3;
+  SetupProfile(dex4, dex2, kNumberOfMethodsToEnableCompilation, 5, profile3, &info3, 50);
+  ProfileCompilationInfo reference_info;
+  SetupProfile(dex1, dex2, kNumberOfMethodsToEnableCompilation, 0, reference_profile,
+      &reference_info, kNumberOfMethodsToEnableCompilation / 2);
+  ProfileCompilationInfo serial_reference_info;
+  SetupProfile(dex1, dex2, kNumberOfMethodsToEnableCompilation, 0, serial_reference_profile,
+      &serial_reference_info, kNumberOfMethodsToEnableCompilation / 2);
+
+  ASSERT_EQ(ProfmanResult::kCompile,
+            ProcessProfiles(profile_fds, serial_reference_profile_fd));
+  ProfileCompilationInfo serial_result;
+  ASSERT_TRUE(serial_result.Load(serial_reference_profile_fd));
+
+  // Use fewer threads than profiles, and a staging budget so small that each profile has to be
+  // merged before the next one is loaded.
+  for (const char* staging : {"--merge-staging-bytes=67108864", "--merge-staging-bytes=1"}) {
+    ScratchFile copy;
+    int copy_fd = GetFd(copy);
+    ASSERT_TRUE(reference_info.Save(copy_fd));
+    ASSERT_EQ(ProfmanResult::kCompile,
+              ProcessProfiles(profile_fds, copy_fd, {"--merge-threads=2", staging}));
+
+    // The result, including the order of the dex files, must not depend on the threads.
+    ProfileCompilationInfo result;
+    ASSERT_TRUE(result.Load(copy_fd));
+    ASSERT_TRUE(result.Equals(serial_result)) << staging;
+  }
+
+  // The information from profiles must remain the same.
+  CheckProfileInfo(profile1, info1);
+  CheckProfileInfo(profile2, info2);
+  CheckProfileInfo(profile3, info3);
+}
+
+// With --force-merge, a profile that cannot be loaded completely is ignored as a whole, even if
+// its first sections are valid.
+TEST_F(ProfileAssistantTest, ParallelMergeIgnoresTruncatedProfile) {
+  ScratchFile profile1;
+  ScratchFile profile2;
+  ScratchFile reference_profile;
+
+  std::vector<int> profile_fds({
+      GetFd(profile1),
+      GetFd(profile2)});
+  int reference_profile_fd = GetFd(reference_profile);
+
+  const uint16_t kNumberOfMethodsToEnableCompilation = 100;
+  ProfileCompilationInfo info1;
+  SetupProfile(dex3, dex4, kNumberOfMethodsToEnableCompilation, 10, profile1, &info1);
+  int64_t length = profile1.GetFile()->GetLength();
+  ASSERT_GT(length, 0);
+  ASSERT_EQ(0, profile1.GetFile()->SetLength(length - 1));
+  ProfileCompilationInfo info2;
+  SetupProfile(dex1, dex2, kNumberOfMethodsToEnableCompilation, 0, profile2, &info2);
+  ProfileCompilationInfo reference_info;
+  SetupProfile(dex1, dex2, kNumberOfMethodsToEnableCompilation, 0, reference_profile,
+      &reference_info, kNumberOfMethodsToEnableCompilation / 2);
+
+  for (const char* threads : {"--merge-threads=1", "--merge-threads=2"}) {
+    ScratchFile copy;
+    int copy_fd = GetFd(copy);
+    ASSERT_TRUE(reference_info.Save(copy_fd));
+    ASSERT_EQ(ProfmanResult::kSuccess,
+              ProcessProfiles(profile_fds, copy_fd, {"--force-merge", threads}));
+
+    ProfileCompilationInfo result;
+    ASSERT_TRUE(result.Load(copy_fd));
+    ProfileCompilationInfo expected;
+    ASSERT_TRUE(expected.MergeWith(reference_info));
+    ASSERT_TRUE(expected.MergeWith(info2));
+    ASSERT_TRUE(result.Equals(expected)) << threads;
+  }
+
+  // Without --force-merge the truncated profile is an error.
+  ASSERT_EQ(ProfmanResult::kErrorBadProfiles,
+            ProcessProfiles(profile_fds, reference_profile_fd, {"--merge-threads=2"}));
+}
+
 TEST_F(ProfileAssistantTest, DoNotAdviseCompilationEmptyProfile) {
   ScratchFile profile1;
   ScratchFile profile2;
@@ -2348,4 +2448,65 @@ TEST_F(ProfileAssistantTest, ForceMergeIgnoreProfilesItCannotLoad) {
   }
 }
 
+TEST_F(ProfileAssistantTest, CreateProfileRecordStartupOrder) {
+  // Startup methods out of method index order, with a method that is only hot in between and a
+  // repeated line, which does not move the method.
+  std::vector<std::string> input_data = {
+      "SLMain;->getC()Ljava/lang/String;",
+      "HLMain;->getB()Ljava/lang/String;",
+      "SLMain;->getA()Ljava/lang/String;",
+      "SLMain;->getC()Ljava/lang/String;",
+  };
+  std::string input_file_contents = JoinProfileLines(input_data);
+  std::string dex_location = GetTestDexFileName("ProfileTestMultiDex");
+  std::vector<std::unique_ptr<const DexFile>> dex_files = OpenTestDexFiles("ProfileTestMultiDex");
+  const DexFile* dex_file = nullptr;
+  const dex::ClassDef* class_def = nullptr;
+  for (const std::unique_ptr<const DexFile>& dex : dex_files) {
+    const dex::TypeId* type_id = dex->FindTypeId("LMain;");
+    if (type_id != nullptr) {
+      class_def = dex->FindClassDef(dex->GetIndexForTypeId(*type_id));
+      if (class_def != nullptr) {
+        dex_file = dex.get();
+        break;
+      }
+    }
+  }
+  ASSERT_TRUE(dex_file != nullptr);
+  auto get_index = [&](const ProfileCompilationInfo& info, const char* name) {
+    for (const ClassAccessor::Method& method : ClassAccessor(*dex_file, *class_def).GetMethods()) {
+      if (dex_file->GetMethodName(method.GetIndex()) == std::string_view(name)) {
+        ProfileCompilationInfo::ProfileIndexType profile_index = info.FindDexFile(*dex_file);
+        EXPECT_NE(ProfileCompilationInfo::MaxProfileIndex(), profile_index);
+        return info.GetStartupSequenceIndex(profile_index, method.GetIndex());
+      }
+    }
+    ADD_FAILURE() << "No method " << name;
+    return ProfileCompilationInfo::kNoStartupSequenceIndex;
+  };
+
+  for (bool record_startup_order : {false, true}) {
+    ScratchFile profile_file;
+    std::vector<std::string> extra_args;
+    if (record_startup_order) {
+      extra_args.push_back("--record-startup-order");
+    }
+    ASSERT_TRUE(CreateProfile(input_file_contents,
+                              profile_file.GetFilename(),
+                              dex_location,
+                              /*for_boot_image=*/ false,
+                              extra_args));
+    ProfileCompilationInfo info;
+    ASSERT_TRUE(info.Load(profile_file.GetFilename(), /*clear_if_invalid=*/ false));
+    if (record_startup_order) {
+      EXPECT_EQ(0u, get_index(info, "getC"));
+      EXPECT_EQ(1u, get_index(info, "getA"));
+    } else {
+      EXPECT_EQ(ProfileCompilationInfo::kNoStartupSequenceIndex, get_index(info, "getC"));
+      EXPECT_EQ(ProfileCompilationInfo::kNoStartupSequenceIndex, get_index(info, "getA"));
+    }
+    EXPECT_EQ(ProfileCompilationInfo::kNoStartupSequenceIndex, get_index(info, "getB"));
+  }
+}
+
 }  // namespace art
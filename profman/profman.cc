@@ -150,6 +150,9 @@ NO_RETURN static void Usage(const char *fmt, ...) {
   UsageError("      methods and inline caches.");
   UsageError("  --output-profile-type=(app|boot|bprof): Select output profile format for");
   UsageError("      the --create-profile-from option. Default: app.");
+  UsageError("  --record-startup-order: with --create-profile-from, record the order of the");
+  UsageError("      startup ('S') methods in the input as the order in which they were first");
+  UsageError("      executed. Used by dex2oat --startup-ordered-code-layout.");
   UsageError("");
   UsageError("  --dex-location=<string>: location string to use with corresponding");
   UsageError("      apk-fd to find dex files");
@@ -198,6 +201,14 @@ NO_RETURN static void Usage(const char *fmt, ...) {
   UsageError("      the min percent of new methods to trigger a compilation.");
   UsageError("  --min-new-classes-percent-change=percentage between 0 and 100 (default 2)");
   UsageError("      the min percent of new classes to trigger a compilation.");
+  UsageError("  --merge-threads=<number>: load the profiles to merge on the given number of");
+  UsageError("      threads. Reduces the time to merge many profiles, the result is unchanged.");
+  UsageError("      Each profile is merged as soon as it and all profiles before it are loaded.");
+  UsageError("  --merge-staging-bytes=<number>: with --merge-threads, do not start loading");
+  UsageError("      another profile while the loaded, not yet merged ones use this many bytes");
+  UsageError("      (default 64MB).");
+  UsageError("  --mappable-reference-profile: write the merged reference profile uncompressed,");
+  UsageError("      with an index for queries on the mapped file without loading it.");
   UsageError("");
 
   exit(ProfmanResult::kErrorUsage);
@@ -320,6 +331,7 @@ class ProfMan final {
       test_profile_seed_(NanoTime()),
       start_ns_(NanoTime()),
       copy_and_update_profile_key_(false),
+      record_startup_order_(false),
       profile_assistant_options_(ProfileAssistant::Options()) {}
 
   ~ProfMan() {
@@ -354,6 +366,8 @@ class ProfMan final {
         dump_classes_and_methods_ = true;
       } else if (option.starts_with("--create-profile-from=")) {
         create_profile_from_file_ = std::string(option.substr(strlen("--create-profile-from=")));
+      } else if (option == "--record-startup-order") {
+        record_startup_order_ = true;
       } else if (option.starts_with("--output-profile-type=")) {
         ParseOutputProfileType(option, "--output-profile-type=", &output_profile_type_);
       } else if (option.starts_with("--dump-output-to-fd=")) {
@@ -463,6 +477,16 @@ class ProfMan final {
                         100u);
         profile_assistant_options_.SetMinNewClassesPercentChangeForCompilation(
             min_new_classes_percent_change);
+      } else if (option.starts_with("--merge-threads=")) {
+        uint32_t merge_threads;
+        ParseUintOption(raw_option, "--merge-threads=", &merge_threads, 1u, 256u);
+        profile_assistant_options_.SetMergeThreads(merge_threads);
+      } else if (option.starts_with("--merge-staging-bytes=")) {
+        uint32_t merge_staging_bytes;
+        ParseUintOption(raw_option, "--merge-staging-bytes=", &merge_staging_bytes);
+        profile_assistant_options_.SetMergeStagingBytes(merge_staging_bytes);
+      } else if (option == "--mappable-reference-profile") {
+        profile_assistant_options_.SetMappableReferenceProfile(true);
       } else if (option == "--copy-and-update-profile-key") {
         copy_and_update_profile_key_ = true;
       } else if (option == "--boot-image-merge") {
@@ -1430,6 +1454,11 @@ class ProfMan final {
       // TODO: Check return value?
       profile->AddMethods(
           methods, static_cast<ProfileCompilationInfo::MethodHotness::Flag>(flags), annotation);
+      if (record_startup_order_ && is_startup) {
+        for (const ProfileMethodInfo& method : methods) {
+          profile->AddStartupSequenceMethod(method.ref, annotation);
+        }
+      }
       return true;
     }
 
@@ -1574,6 +1603,11 @@ class ProfMan final {
       }
       DCHECK(profile->GetMethodHotness(ref, annotation).IsInProfile()) << method_spec;
     }
+    if (record_startup_order_ && is_startup) {
+      if (!profile->AddStartupSequenceMethod(ref, annotation)) {
+        return false;
+      }
+    }
     return true;
   }
 
@@ -1677,6 +1711,8 @@ class ProfMan final {
   //   # Methods with inline caches
   //   LTestInline;->inlinePolymorphic(LSuper;)I+LSubA;,LSubB;,LSubC;
   //   LTestInline;->noInlineCache(LSuper;)I
+  // Lines are processed in input order, so that with --record-startup-order the position of
+  // a startup method in the input is its position in the startup order.
   int CreateProfile() {
     // Validate parameters for this command.
     if (apk_files_.empty() && apks_fd_.empty()) {
@@ -1699,8 +1735,8 @@ class ProfMan final {
         return -1;
     }
     // Read the user-specified list of classes and methods.
-    std::unique_ptr<std::unordered_set<std::string>>
-        user_lines(ReadCommentedInputFromFile<std::unordered_set<std::string>>(
+    std::unique_ptr<std::vector<std::string>>
+        user_lines(ReadCommentedInputFromFile<std::vector<std::string>>(
             create_profile_from_file_.c_str(), nullptr));  // No post-processing.
 
     // Open the dex files to look up classes and methods.
@@ -1722,8 +1758,11 @@ class ProfMan final {
       }
     }
 
+    std::unordered_set<std::string_view> processed_lines;
     for (const auto& line : *user_lines) {
-      ProcessLine(dex_files, line, &info);
+      if (processed_lines.insert(line).second) {
+        ProcessLine(dex_files, line, &info);
+      }
     }
 
     // Write the profile file.
@@ -1917,6 +1956,7 @@ class ProfMan final {
   uint32_t test_profile_seed_;
   uint64_t start_ns_;
   bool copy_and_update_profile_key_;
+  bool record_startup_order_;
   ProfileAssistant::Options profile_assistant_options_;
   std::string boot_profile_out_path_;
   std::string preloaded_classes_out_path_;
@@ -96,6 +96,7 @@
 #include "intern_table-inl.h"
 #include "interpreter/interpreter.h"
 #include "interpreter/mterp/nterp.h"
+#include "javaheapprof/allocation_site_profiler.h"
 #include "jit/debugger_interface.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -158,6 +159,7 @@
 #include "vdex_file.h"
 #include "verifier/class_verifier.h"
 #include "verifier/verifier_deps.h"
+#include "wall_clock_profiler.h"
 #include "well_known_classes.h"
 
 namespace art HIDDEN {
@@ -2717,6 +2719,8 @@ void ClassLinker::PrepareToDeleteClassLoader(Thread* self,
     // If we don't have a JIT, we need to manually remove the CHA dependencies manually.
     cha_->RemoveDependenciesForLinearAlloc(self, data.allocator);
   }
+  AllocationSiteProfiler::RemoveMethodsIn(self, *data.allocator);
+  WallClockProfiler::RemoveMethodsIn(self, *data.allocator);
   // Cleanup references to single implementation ArtMethods that will be deleted.
   if (cleanup_cha) {
     CHAOnDeleteUpdateClassVisitor visitor(data.allocator);
@@ -4447,6 +4451,13 @@ ObjPtr<mirror::DexCache> ClassLinker::RegisterDexFile(const DexFile& dex_file,
   }
   VLOG(class_linker) << "Registered dex file " << dex_file.GetLocation();
   PaletteNotifyDexFileLoaded(dex_file.GetLocation().c_str());
+  Runtime* runtime = Runtime::Current();
+  if (runtime->IsVerifyInBackgroundEnabled() &&
+      h_class_loader != nullptr &&
+      !runtime->IsAotCompiler()) {
+    // The app starts using this dex file, verify what the AOT verifier could not ahead of use.
+    runtime->GetOatFileManager().RunBackgroundRuntimeVerification(dex_file, h_class_loader.Get());
+  }
   return h_dex_cache.Get();
 }
 
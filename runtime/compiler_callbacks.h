@@ -27,6 +27,7 @@ namespace art HIDDEN {
 
 class ClassLinker;
 class CompilerDriver;
+class DexFile;
 class InternTable;
 
 namespace mirror {
@@ -37,6 +38,7 @@ class Class;
 
 namespace verifier {
 
+class SharedRegTypeCache;
 class VerifierDeps;
 
 }  // namespace verifier
@@ -59,6 +61,13 @@ class CompilerCallbacks {
   virtual verifier::VerifierDeps* GetVerifierDeps() const = 0;
   virtual void SetVerifierDeps([[maybe_unused]] verifier::VerifierDeps* deps) {}
 
+  // Return the type resolution cache shared by the verifiers of `dex_file`, if any.
+  virtual verifier::SharedRegTypeCache* GetSharedRegTypeCache(
+      [[maybe_unused]] const DexFile* dex_file) const {
+    return nullptr;
+  }
+  virtual void SetSharedRegTypeCache([[maybe_unused]] verifier::SharedRegTypeCache* cache) {}
+
   // Return the class status of a previous stage of the compilation. This can be used, for example,
   // when class unloading is enabled during multidex compilation.
   virtual ClassStatus GetPreviousClassState([[maybe_unused]] ClassReference ref) {
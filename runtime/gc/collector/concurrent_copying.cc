@@ -2501,7 +2501,7 @@ void ConcurrentCopying::Sweep(bool swap_bitmaps) {
         space::ContinuousMemMapAllocSpace* alloc_space = space->AsContinuousMemMapAllocSpace();
         TimingLogger::ScopedTiming split2(
             alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepAllocSpace", GetTimings());
-        RecordFree(alloc_space->Sweep(swap_bitmaps));
+        SweepSpace(alloc_space, swap_bitmaps);
       }
     }
     SweepLargeObjects(swap_bitmaps);
@@ -2552,7 +2552,7 @@ void ConcurrentCopying::MarkZygoteLargeObjects() {
 void ConcurrentCopying::SweepLargeObjects(bool swap_bitmaps) {
   TimingLogger::ScopedTiming split("SweepLargeObjects", GetTimings());
   if (heap_->GetLargeObjectsSpace() != nullptr) {
-    RecordFreeLOS(heap_->GetLargeObjectsSpace()->Sweep(swap_bitmaps));
+    SweepLargeObjectSpace(heap_->GetLargeObjectsSpace(), swap_bitmaps);
   }
 }
 
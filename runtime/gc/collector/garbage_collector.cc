@@ -37,6 +37,7 @@
 #include "runtime.h"
 #include "thread-current-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 
 namespace art HIDDEN {
 namespace gc {
@@ -408,6 +409,7 @@ void GarbageCollector::ResetMeasurements() {
   total_freed_objects_ = 0u;
   total_freed_bytes_ = 0;
   total_scanned_bytes_ = 0u;
+  total_sweep_time_ns_ = 0u;
 }
 
 GarbageCollector::ScopedPause::ScopedPause(GarbageCollector* collector, bool with_reporting)
@@ -475,6 +477,35 @@ void GarbageCollector::RecordFreeLOS(const ObjectBytePair& freed) {
   heap_->RecordFree(freed.objects, freed.bytes);
 }
 
+size_t GarbageCollector::GetSweepThreadCount() const {
+  // Sweep on the GC thread only in a background state (non jank perceptible), as for marking. The
+  // memory tool may read the classes of the swept objects, which are freed in any order.
+  Runtime* runtime = Runtime::Current();
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  if (thread_pool == nullptr ||
+      !runtime->IsParallelSweepingEnabled() ||
+      !runtime->InJankPerceptibleProcessState() ||
+      runtime->IsRunningOnMemoryTool()) {
+    return 1;
+  }
+  // Whether the sweep is paused or concurrent, use the workers of the heap thread pool, which is
+  // sized from `-XX:ParallelGCThreads`. `-XX:ConcGCThreads` defaults to 0 and would leave the
+  // sweep on the GC thread.
+  return std::min(thread_pool->GetThreadCount(), kMaxParallelSweepThreads) + 1;
+}
+
+void GarbageCollector::SweepSpace(space::ContinuousMemMapAllocSpace* space, bool swap_bitmaps) {
+  const uint64_t start_ns = NanoTime();
+  RecordFree(space->Sweep(swap_bitmaps, heap_->GetThreadPool(), GetSweepThreadCount()));
+  total_sweep_time_ns_ += NanoTime() - start_ns;
+}
+
+void GarbageCollector::SweepLargeObjectSpace(space::LargeObjectSpace* space, bool swap_bitmaps) {
+  const uint64_t start_ns = NanoTime();
+  RecordFreeLOS(space->Sweep(swap_bitmaps, heap_->GetThreadPool(), GetSweepThreadCount()));
+  total_sweep_time_ns_ += NanoTime() - start_ns;
+}
+
 uint64_t GarbageCollector::GetTotalPausedTimeNs() {
   MutexLock mu(Thread::Current(), pause_histogram_lock_);
   return pause_histogram_.AdjustedSum();
@@ -530,7 +561,9 @@ void GarbageCollector::DumpPerformanceInfo(std::ostream& os) {
      << GetName() << " tracing throughput: "
      << PrettySize(scanned_bytes / seconds) << "/s "
      << " per cpu-time: "
-     << PrettySize(scanned_bytes / cpu_seconds) << "/s\n";
+     << PrettySize(scanned_bytes / cpu_seconds) << "/s\n"
+     << GetName() << " total sweep time: " << PrettyDuration(total_sweep_time_ns_)
+     << " mean sweep time: " << PrettyDuration(total_sweep_time_ns_ / iterations) << "\n";
 }
 
 }  // namespace collector
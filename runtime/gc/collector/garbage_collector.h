@@ -52,12 +52,17 @@ using ObjectStack = AtomicStack<mirror::Object>;
 }  // namespace accounting
 
 namespace space {
+class ContinuousMemMapAllocSpace;
 class ContinuousSpace;
+class LargeObjectSpace;
 }  // namespace space
 
 namespace collector {
 class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public MarkObjectVisitor {
  public:
+  // Maximum number of heap thread pool workers sweeping a space along with the GC thread.
+  static constexpr size_t kMaxParallelSweepThreads = 4;
+
   class SCOPED_LOCKABLE ScopedPause {
    public:
     explicit ScopedPause(GarbageCollector* collector, bool with_reporting = true)
@@ -104,6 +109,10 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   uint64_t GetTotalScannedBytes() const {
     return total_scanned_bytes_;
   }
+  // Time spent sweeping the alloc spaces and the large object space.
+  uint64_t GetTotalSweepTimeNs() const {
+    return total_sweep_time_ns_;
+  }
   // Reset the cumulative timings and pause histogram.
   void ResetMeasurements() REQUIRES(!pause_histogram_lock_);
   // Returns the estimated throughput in bytes / second.
@@ -165,6 +174,14 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
                   bool swap_bitmaps,
                   std::vector<space::ContinuousSpace*>* sweep_spaces)
       REQUIRES(Locks::heap_bitmap_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+  // Sweep a space, on the heap thread pool if parallel sweeping is enabled, and record the freed
+  // objects and the time spent.
+  void SweepSpace(space::ContinuousMemMapAllocSpace* space, bool swap_bitmaps)
+      REQUIRES(Locks::heap_bitmap_lock_);
+  void SweepLargeObjectSpace(space::LargeObjectSpace* space, bool swap_bitmaps)
+      REQUIRES(Locks::heap_bitmap_lock_);
+  // Returns the number of threads sweeping a space, including the GC thread.
+  size_t GetSweepThreadCount() const;
 
   static constexpr size_t kPauseBucketSize = 500;
   static constexpr size_t kPauseBucketCount = 32;
@@ -195,6 +212,7 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   uint64_t total_freed_objects_;
   int64_t total_freed_bytes_;
   uint64_t total_scanned_bytes_;
+  uint64_t total_sweep_time_ns_;
   CumulativeLogger cumulative_timings_;
   mutable Mutex pause_histogram_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   bool is_transaction_active_;
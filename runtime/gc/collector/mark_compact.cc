@@ -1140,7 +1140,7 @@ void MarkCompact::Sweep(bool swap_bitmaps) {
       space::ContinuousMemMapAllocSpace* alloc_space = space->AsContinuousMemMapAllocSpace();
       DCHECK(!alloc_space->IsZygoteSpace());
       TimingLogger::ScopedTiming split("SweepMallocSpace", GetTimings());
-      RecordFree(alloc_space->Sweep(swap_bitmaps));
+      SweepSpace(alloc_space, swap_bitmaps);
     }
   }
   SweepLargeObjects(swap_bitmaps);
@@ -1150,7 +1150,7 @@ void MarkCompact::SweepLargeObjects(bool swap_bitmaps) {
   space::LargeObjectSpace* los = heap_->GetLargeObjectsSpace();
   if (los != nullptr) {
     TimingLogger::ScopedTiming split(__FUNCTION__, GetTimings());
-    RecordFreeLOS(los->Sweep(swap_bitmaps));
+    SweepLargeObjectSpace(los, swap_bitmaps);
   }
 }
 
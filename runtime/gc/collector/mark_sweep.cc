@@ -1235,7 +1235,7 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
       TimingLogger::ScopedTiming split(
           alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepMallocSpace",
           GetTimings());
-      RecordFree(alloc_space->Sweep(swap_bitmaps));
+      SweepSpace(alloc_space, swap_bitmaps);
     }
   }
   SweepLargeObjects(swap_bitmaps);
@@ -1245,7 +1245,7 @@ void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
   space::LargeObjectSpace* los = heap_->GetLargeObjectsSpace();
   if (los != nullptr) {
     TimingLogger::ScopedTiming split(__FUNCTION__, GetTimings());
-    RecordFreeLOS(los->Sweep(swap_bitmaps));
+    SweepLargeObjectSpace(los, swap_bitmaps);
   }
 }
 
@@ -521,7 +521,7 @@ void SemiSpace::Sweep(bool swap_bitmaps) {
       }
       TimingLogger::ScopedTiming split(
           alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepAllocSpace", GetTimings());
-      RecordFree(alloc_space->Sweep(swap_bitmaps));
+      SweepSpace(alloc_space, swap_bitmaps);
     }
   }
   SweepLargeObjects(swap_bitmaps);
@@ -531,7 +531,7 @@ void SemiSpace::SweepLargeObjects(bool swap_bitmaps) {
   space::LargeObjectSpace* los = heap_->GetLargeObjectsSpace();
   if (los != nullptr) {
     TimingLogger::ScopedTiming split("SweepLargeObjects", GetTimings());
-    RecordFreeLOS(los->Sweep(swap_bitmaps));
+    SweepLargeObjectSpace(los, swap_bitmaps);
   }
 }
 
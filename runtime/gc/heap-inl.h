@@ -32,6 +32,7 @@
 #include "gc/space/region_space-inl.h"
 #include "gc/space/rosalloc_space-inl.h"
 #include "handle_scope-inl.h"
+#include "javaheapprof/allocation_site_profiler.h"
 #include "obj_ptr-inl.h"
 #include "runtime.h"
 #include "thread-inl.h"
@@ -232,6 +233,13 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
   } else {
     DCHECK(!Runtime::Current()->HasStatsEnabled());
   }
+  if (UNLIKELY(self->GetPendingAllocationSampleBytes() != 0u)) {
+    // The heap sampler picked this object before its class was set, see HeapSampler::ReportSample.
+    size_t sample_bytes = self->GetPendingAllocationSampleBytes();
+    self->SetPendingAllocationSampleBytes(0u);
+    AllocationSiteProfiler::RecordSample(
+        self, obj->GetClass(), sample_bytes, GetHeapSampler().GetSamplingInterval());
+  }
   if (kInstrumented) {
     if (IsAllocTrackingEnabled()) {
       // allocation_records_ is not null since it never becomes null after allocation tracking is
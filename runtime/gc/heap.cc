@@ -393,6 +393,7 @@ Heap::Heap(size_t initial_size,
       foreground_heap_growth_multiplier_(foreground_heap_growth_multiplier),
       stop_for_native_allocs_(stop_for_native_allocs),
       total_wait_time_(0),
+      finalizers_enqueued_count_(0u),
       verify_object_mode_(kVerifyObjectModeDisabled),
       disable_moving_gc_count_(0),
       semi_space_collector_(nullptr),
@@ -698,6 +699,10 @@ Heap::Heap(size_t initial_size,
   if (large_object_space_type == space::LargeObjectSpaceType::kFreeList) {
     large_object_space_ = space::FreeListSpace::Create("free list large object space", capacity_);
     CHECK(large_object_space_ != nullptr) << "Failed to create large object space";
+  } else if (large_object_space_type == space::LargeObjectSpaceType::kFreeListDeferred) {
+    large_object_space_ = space::DeferredReleaseFreeListSpace::Create(
+        "deferred release large object space", capacity_);
+    CHECK(large_object_space_ != nullptr) << "Failed to create large object space";
   } else if (large_object_space_type == space::LargeObjectSpaceType::kMap) {
     large_object_space_ = space::LargeObjectMapSpace::Create("mem map large object space");
     CHECK(large_object_space_ != nullptr) << "Failed to create large object space";
@@ -1011,20 +1016,34 @@ void Heap::IncrementDisableThreadFlip(Thread* self) {
     // counter. The global counter is incremented only once for a thread for the outermost enter.
     return;
   }
+  // Fast path: announce the critical section and check that no thread flip has started. The GC
+  // sets thread_flip_running_ before reading disable_thread_flip_count_ in ThreadFlipBegin, so
+  // with sequentially consistent accesses either the GC sees our increment and waits for us, or
+  // we see the flip and back off. This avoids the thread state change and the lock in the common
+  // case of frequent JNI critical enters and exits.
+  disable_thread_flip_count_.fetch_add(1u, std::memory_order_seq_cst);
+  if (LIKELY(!thread_flip_running_.load(std::memory_order_seq_cst))) {
+    return;
+  }
   ScopedThreadStateChange tsc(self, ThreadState::kWaitingForGcThreadFlip);
   MutexLock mu(self, *thread_flip_lock_);
   thread_flip_cond_->CheckSafeToWait(self);
+  // Back off, we may be the last thread the GC is waiting for.
+  if (disable_thread_flip_count_.fetch_sub(1u, std::memory_order_seq_cst) == 1u) {
+    thread_flip_cond_->Broadcast(self);
+  }
   bool has_waited = false;
   uint64_t wait_start = 0;
-  if (thread_flip_running_) {
+  if (thread_flip_running_.load(std::memory_order_relaxed)) {
     wait_start = NanoTime();
     ScopedTrace trace("IncrementDisableThreadFlip");
-    while (thread_flip_running_) {
+    while (thread_flip_running_.load(std::memory_order_relaxed)) {
       has_waited = true;
       thread_flip_cond_->Wait(self);
     }
   }
-  ++disable_thread_flip_count_;
+  // The GC only starts a thread flip with thread_flip_lock_ held, so it will see this increment.
+  disable_thread_flip_count_.fetch_add(1u, std::memory_order_seq_cst);
   if (has_waited) {
     uint64_t wait_time = NanoTime() - wait_start;
     total_wait_time_ += wait_time;
@@ -1058,11 +1077,14 @@ void Heap::DecrementDisableThreadFlip(Thread* self) {
     // The global counter is decremented only once for a thread for the outermost exit.
     return;
   }
-  MutexLock mu(self, *thread_flip_lock_);
-  CHECK_GT(disable_thread_flip_count_, 0U);
-  --disable_thread_flip_count_;
-  if (disable_thread_flip_count_ == 0) {
-    // Potentially notify the GC thread blocking to begin a thread flip.
+  size_t old_count = disable_thread_flip_count_.fetch_sub(1u, std::memory_order_seq_cst);
+  CHECK_GT(old_count, 0U);
+  // The GC can only be waiting for us if it started a thread flip. See IncrementDisableThreadFlip
+  // for why the lock-free check is sufficient.
+  if (old_count == 1u && thread_flip_running_.load(std::memory_order_seq_cst)) {
+    // Potentially notify the GC thread blocking to begin a thread flip. Taking the lock ensures
+    // that the GC is either before its check of the counter or waiting on the condition.
+    MutexLock mu(self, *thread_flip_lock_);
     thread_flip_cond_->Broadcast(self);
   }
 }
@@ -1075,11 +1097,11 @@ void Heap::ThreadFlipBegin(Thread* self) {
   thread_flip_cond_->CheckSafeToWait(self);
   bool has_waited = false;
   uint64_t wait_start = NanoTime();
-  CHECK(!thread_flip_running_);
+  CHECK(!thread_flip_running_.load(std::memory_order_relaxed));
   // Set this to true before waiting so that frequent JNI critical enter/exits won't starve
   // GC. This like a writer preference of a reader-writer lock.
-  thread_flip_running_ = true;
-  while (disable_thread_flip_count_ > 0) {
+  thread_flip_running_.store(true, std::memory_order_seq_cst);
+  while (disable_thread_flip_count_.load(std::memory_order_seq_cst) > 0) {
     has_waited = true;
     thread_flip_cond_->Wait(self);
   }
@@ -1096,8 +1118,8 @@ void Heap::ThreadFlipEnd(Thread* self) {
   // Supposed to be called by GC. Set thread_flip_running_ to false and potentially wake up mutators
   // waiting before doing a JNI critical.
   MutexLock mu(self, *thread_flip_lock_);
-  CHECK(thread_flip_running_);
-  thread_flip_running_ = false;
+  CHECK(thread_flip_running_.load(std::memory_order_relaxed));
+  thread_flip_running_.store(false, std::memory_order_seq_cst);
   // Potentially notify mutator threads blocking to enter a JNI critical section.
   thread_flip_cond_->Broadcast(self);
 }
@@ -1307,6 +1329,8 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   os << "Total blocking GC count: " << GetBlockingGcCount() << "\n";
   os << "Total blocking GC time: " << PrettyDuration(GetBlockingGcTime()) << "\n";
   os << "Total pre-OOME GC count: " << GetPreOomeGcCount() << "\n";
+  reference_processor_->DumpGetReferentStats(os);
+  os << "Total finalizers enqueued: " << GetFinalizersEnqueuedCount() << "\n";
   {
     MutexLock mu(Thread::Current(), *gc_complete_lock_);
     if (gc_count_rate_histogram_.SampleSize() > 0U) {
@@ -1354,6 +1378,8 @@ void Heap::ResetGcPerformanceInfo() {
   blocking_gc_count_ = 0;
   blocking_gc_time_ = 0;
   pre_oome_gc_count_.store(0, std::memory_order_relaxed);
+  reference_processor_->ResetGetReferentStats();
+  finalizers_enqueued_count_.store(0u, std::memory_order_relaxed);
   gc_count_last_window_ = 0;
   blocking_gc_count_last_window_ = 0;
   last_update_time_gc_count_rate_histograms_ =  // Round down by the window duration.
@@ -1716,6 +1742,9 @@ void Heap::TrimSpaces(Thread* self) {
       }
     }
   }
+  if (large_object_space_ != nullptr) {
+    managed_reclaimed += large_object_space_->Trim();
+  }
   total_alloc_space_allocated = GetBytesAllocated();
   if (large_object_space_ != nullptr) {
     total_alloc_space_allocated -= large_object_space_->GetBytesAllocated();
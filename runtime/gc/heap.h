@@ -559,6 +559,15 @@ class Heap {
 
   EXPORT void AddFinalizerReference(Thread* self, ObjPtr<mirror::Object>* object);
 
+  // Number of objects the GC has enqueued for finalization. The finalizers themselves run on
+  // the libcore daemons, which do not report back, so the queue length is not known here.
+  void RecordFinalizersEnqueued(size_t count) {
+    finalizers_enqueued_count_.fetch_add(count, std::memory_order_relaxed);
+  }
+  uint64_t GetFinalizersEnqueuedCount() const {
+    return finalizers_enqueued_count_.load(std::memory_order_relaxed);
+  }
+
   // Returns the number of bytes currently allocated.
   // The result should be treated as an approximation, if it is being concurrently updated.
   size_t GetBytesAllocated() const {
@@ -1441,9 +1450,11 @@ class Heap {
   Mutex* thread_flip_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::unique_ptr<ConditionVariable> thread_flip_cond_ GUARDED_BY(thread_flip_lock_);
   // This counter keeps track of how many threads are currently in a JNI critical section. This is
-  // incremented once per thread even with nested enters.
-  size_t disable_thread_flip_count_ GUARDED_BY(thread_flip_lock_);
-  bool thread_flip_running_ GUARDED_BY(thread_flip_lock_);
+  // incremented once per thread even with nested enters. Mutators update it without holding
+  // `thread_flip_lock_` when no thread flip is running, see `IncrementDisableThreadFlip()`.
+  std::atomic<size_t> disable_thread_flip_count_;
+  // Only written with `thread_flip_lock_` held, but read without it by mutators.
+  std::atomic<bool> thread_flip_running_;
 
   // Reference processor;
   std::unique_ptr<ReferenceProcessor> reference_processor_;
@@ -1632,6 +1643,9 @@ class Heap {
   // Total time which mutators are paused or waiting for GC to complete.
   uint64_t total_wait_time_;
 
+  // Total number of objects enqueued for finalization, see RecordFinalizersEnqueued().
+  Atomic<uint64_t> finalizers_enqueued_count_;
+
   // The current state of heap verification, may be enabled or disabled.
   VerifyObjectMode verify_object_mode_;
 
@@ -16,6 +16,9 @@
 
 #include "reference_processor.h"
 
+#include <algorithm>
+#include <ostream>
+
 #include "art_field-inl.h"
 #include "base/mutex.h"
 #include "base/time_utils.h"
@@ -23,6 +26,7 @@
 #include "base/systrace.h"
 #include "class_root-inl.h"
 #include "collector/garbage_collector.h"
+#include "heap.h"
 #include "jni/java_vm_ext.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -48,7 +52,10 @@ ReferenceProcessor::ReferenceProcessor()
       weak_reference_queue_(Locks::reference_queue_weak_references_lock_),
       finalizer_reference_queue_(Locks::reference_queue_finalizer_references_lock_),
       phantom_reference_queue_(Locks::reference_queue_phantom_references_lock_),
-      cleared_references_(Locks::reference_queue_cleared_references_lock_) {
+      cleared_references_(Locks::reference_queue_cleared_references_lock_),
+      blocked_get_referent_count_(0u),
+      blocked_get_referent_time_ns_(0u),
+      max_blocked_get_referent_time_ns_(0u) {
 }
 
 static inline MemberOffset GetSlowPathFlagOffset(ObjPtr<mirror::Class> reference_class)
@@ -104,10 +111,12 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
   }
 
   bool started_trace = false;
-  uint64_t start_millis;
-  auto finish_trace = [](uint64_t start_millis) {
+  uint64_t start_ns;
+  auto finish_trace = [this](uint64_t start_ns) {
     ATraceEnd();
-    uint64_t millis = MilliTime() - start_millis;
+    uint64_t duration_ns = NanoTime() - start_ns;
+    RecordBlockedGetReferent(duration_ns);
+    uint64_t millis = NsToMs(duration_ns);
     static constexpr uint64_t kReportMillis = 10;  // Long enough to risk dropped frames.
     if (millis > kReportMillis) {
       LOG(WARNING) << "Weak pointer dereference blocked for " << millis << " milliseconds.";
@@ -124,13 +133,30 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
                  || (other_read_barrier && reference->IsPhantomReferenceInstance()))) {
       // Odd cases in which it doesn't hurt to just wait, or the wait is likely to be very brief.
 
+      if (rp_state_ == RpState::kStarting &&
+          !reference->IsFinalizerReferenceInstance() &&
+          !reference->IsPhantomReferenceInstance()) {
+        // Marking may still be in progress, so a white referent could yet be marked, but a marked
+        // referent stays marked and will not be cleared. Return it without waiting, as for
+        // kInitMarkingDone below.
+        referent = reference->GetReferent<kWithoutReadBarrier>();
+        ObjPtr<mirror::Object> forwarded_ref =
+            referent.IsNull() ? nullptr : collector_->IsMarked(referent.Ptr());
+        if (forwarded_ref != nullptr || referent.IsNull()) {
+          if (started_trace) {
+            finish_trace(start_ns);
+          }
+          return forwarded_ref;
+        }
+      }
+
       // Check and run the empty checkpoint before blocking so the empty checkpoint will work in the
       // presence of threads blocking for weak ref access.
       self->CheckEmptyCheckpointFromWeakRefAccess(Locks::reference_processor_lock_);
       if (!started_trace) {
         ATraceBegin("GetReferent blocked");
         started_trace = true;
-        start_millis = MilliTime();
+        start_ns = NanoTime();
       }
       condition_.WaitHoldingLocks(self);
       continue;
@@ -153,12 +179,12 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
     // Either the referent was marked, and forwarded_ref is the correct return value, or it
     // was not, and forwarded_ref == null, which is again the correct return value.
     if (started_trace) {
-      finish_trace(start_millis);
+      finish_trace(start_ns);
     }
     return forwarded_ref;
   }
   if (started_trace) {
-    finish_trace(start_millis);
+    finish_trace(start_ns);
   }
   return reference->GetReferent();
 }
@@ -230,8 +256,14 @@ void ReferenceProcessor::ProcessReferences(Thread* self, TimingLogger* timings)
   }
   // Clear all remaining soft and weak references with white referents.
   // This misses references only reachable through finalizers.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector_);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector_);
+  {
+    // Mutators getting the referent of a reference may block until this is done, see
+    // GetReferent().
+    TimingLogger::ScopedTiming t2(
+        concurrent_ ? "ClearWhiteReferences" : "(Paused)ClearWhiteReferences", timings);
+    ClearWhiteReferences(&soft_reference_queue_);
+    ClearWhiteReferences(&weak_reference_queue_);
+  }
   // Defer PhantomReference processing until we've finished marking through finalizers.
   {
     // TODO: Capture mark state of some system weaks here. If the referent was marked here,
@@ -253,6 +285,10 @@ void ReferenceProcessor::ProcessReferences(Thread* self, TimingLogger* timings)
     // Preserve all white objects with finalize methods and schedule them for finalization.
     FinalizerStats finalizer_stats =
         finalizer_reference_queue_.EnqueueFinalizerReferences(&cleared_references_, collector_);
+    // Cleared references are only handed to the finalizer threads once the runtime is started.
+    if (Runtime::Current()->IsStarted()) {
+      Runtime::Current()->GetHeap()->RecordFinalizersEnqueued(finalizer_stats.num_enqueued_);
+    }
     if (ATraceEnabled()) {
       static constexpr size_t kBufSize = 80;
       char buf[kBufSize];
@@ -285,13 +321,11 @@ void ReferenceProcessor::ProcessReferences(Thread* self, TimingLogger* timings)
   // finalized object containing pointers to native objects that have already been deallocated.
   // But it can be argued that this is just an instance of the broader rule that it is not safe
   // for finalizers to access otherwise inaccessible finalizable objects.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector_,
-                                             /*report_cleared=*/ true);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector_,
-                                             /*report_cleared=*/ true);
+  ClearWhiteReferences(&soft_reference_queue_, /*report_cleared=*/ true);
+  ClearWhiteReferences(&weak_reference_queue_, /*report_cleared=*/ true);
 
   // Clear all phantom references with white referents. It's fine to do this just once here.
-  phantom_reference_queue_.ClearWhiteReferences(&cleared_references_, collector_);
+  ClearWhiteReferences(&phantom_reference_queue_);
 
   // At this point all reference queues other than the cleared references should be empty.
   DCHECK(soft_reference_queue_.IsEmpty());
@@ -312,6 +346,55 @@ void ReferenceProcessor::ProcessReferences(Thread* self, TimingLogger* timings)
   }
 }
 
+size_t ReferenceProcessor::GetThreadCount() const {
+  // Use only the GC thread in a background state (non jank perceptible), as the mutators are
+  // unlikely to wait for the referents then.
+  Runtime* runtime = Runtime::Current();
+  ThreadPool* thread_pool = runtime->GetHeap()->GetThreadPool();
+  if (thread_pool == nullptr ||
+      !runtime->IsParallelReferenceProcessingEnabled() ||
+      !runtime->InJankPerceptibleProcessState()) {
+    return 1;
+  }
+  // The heap thread pool is sized from the parallel GC thread count for the parallel reference
+  // processing. The concurrent GC thread count is 0 unless set with `-XX:ConcGCThreads`, so it is
+  // not used even though the references of the concurrent collectors are processed concurrently.
+  return std::min(thread_pool->GetThreadCount(), kMaxParallelThreads) + 1;
+}
+
+void ReferenceProcessor::ClearWhiteReferences(ReferenceQueue* queue, bool report_cleared) {
+  queue->ClearWhiteReferencesParallel(&cleared_references_,
+                                      collector_,
+                                      Runtime::Current()->GetHeap()->GetThreadPool(),
+                                      GetThreadCount(),
+                                      report_cleared);
+}
+
+void ReferenceProcessor::RecordBlockedGetReferent(uint64_t duration_ns) {
+  blocked_get_referent_count_.fetch_add(1u, std::memory_order_relaxed);
+  blocked_get_referent_time_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+  uint64_t max_ns = max_blocked_get_referent_time_ns_.load(std::memory_order_relaxed);
+  while (duration_ns > max_ns &&
+         !max_blocked_get_referent_time_ns_.compare_exchange_weak(
+             max_ns, duration_ns, std::memory_order_relaxed)) {
+  }
+}
+
+void ReferenceProcessor::DumpGetReferentStats(std::ostream& os) const {
+  os << "Total GetReferent calls blocked by reference processing: "
+     << GetBlockedGetReferentCount() << "\n";
+  os << "Total time GetReferent was blocked: " << PrettyDuration(GetBlockedGetReferentTimeNs())
+     << "\n";
+  os << "Max time GetReferent was blocked: " << PrettyDuration(GetMaxBlockedGetReferentTimeNs())
+     << "\n";
+}
+
+void ReferenceProcessor::ResetGetReferentStats() {
+  blocked_get_referent_count_.store(0u, std::memory_order_relaxed);
+  blocked_get_referent_time_ns_.store(0u, std::memory_order_relaxed);
+  max_blocked_get_referent_time_ns_.store(0u, std::memory_order_relaxed);
+}
+
 // Process the "referent" field in a java.lang.ref.Reference.  If the referent has not yet been
 // marked, put it on the appropriate list in the heap for later processing.
 void ReferenceProcessor::DelayReferenceReferent(ObjPtr<mirror::Class> klass,
@@ -17,6 +17,9 @@
 #ifndef ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 #define ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 
+#include <atomic>
+#include <iosfwd>
+
 #include "base/macros.h"
 #include "base/locks.h"
 #include "jni.h"
@@ -46,6 +49,10 @@ class Heap;
 // Used to process java.lang.ref.Reference instances concurrently or paused.
 class ReferenceProcessor {
  public:
+  // Maximum number of heap thread pool workers used to clear references, see
+  // `-XX:ParallelReferenceProcessing`.
+  static constexpr size_t kMaxParallelThreads = 4;
+
   ReferenceProcessor();
 
   // Initialize for a reference processing pass. Called before suspending weak
@@ -92,8 +99,29 @@ class ReferenceProcessor {
   uint32_t ForwardSoftReferences(TimingLogger* timings)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Number of GetReferent calls that blocked for reference processing, and the total and maximum
+  // time they were blocked.
+  uint64_t GetBlockedGetReferentCount() const {
+    return blocked_get_referent_count_.load(std::memory_order_relaxed);
+  }
+  uint64_t GetBlockedGetReferentTimeNs() const {
+    return blocked_get_referent_time_ns_.load(std::memory_order_relaxed);
+  }
+  uint64_t GetMaxBlockedGetReferentTimeNs() const {
+    return max_blocked_get_referent_time_ns_.load(std::memory_order_relaxed);
+  }
+  void DumpGetReferentStats(std::ostream& os) const;
+  void ResetGetReferentStats();
+
  private:
   bool SlowPathEnabled() REQUIRES_SHARED(Locks::mutator_lock_);
+  // Clears the white referents of `queue` into cleared_references_, in parallel if the heap
+  // thread pool is available.
+  void ClearWhiteReferences(ReferenceQueue* queue, bool report_cleared = false)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  // Number of threads, including the GC thread, used by ClearWhiteReferences.
+  size_t GetThreadCount() const;
+  void RecordBlockedGetReferent(uint64_t duration_ns);
   // Called by ProcessReferences.
   void DisableSlowPath(Thread* self) REQUIRES(Locks::reference_processor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -124,6 +152,11 @@ class ReferenceProcessor {
   ReferenceQueue phantom_reference_queue_;
   ReferenceQueue cleared_references_;
 
+  std::atomic<uint64_t> blocked_get_referent_count_;
+  std::atomic<uint64_t> blocked_get_referent_time_ns_;
+  std::atomic<uint64_t> max_blocked_get_referent_time_ns_;
+
+  friend class ReferenceProcessorTest;  // For ClearWhiteReferences and DisableSlowPath.
   DISALLOW_COPY_AND_ASSIGN(ReferenceProcessor);
 };
 
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reference_processor.h"
+
+#include <set>
+#include <unordered_set>
+
+#include "class_root-inl.h"
+#include "collector/garbage_collector.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "heap.h"
+#include "mirror/class-alloc-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object_array-alloc-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/reference-inl.h"
+#include "reference_queue.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
+
+namespace art HIDDEN {
+namespace gc {
+
+// A collector which only knows the objects that are marked, to process references without
+// running a GC.
+class MarkedSetCollector final : public collector::GarbageCollector {
+ public:
+  explicit MarkedSetCollector(Heap* heap) : GarbageCollector(heap, "marked set") {}
+
+  void Mark(ObjPtr<mirror::Object> obj) {
+    marked_.insert(obj.Ptr());
+  }
+
+  collector::GcType GetGcType() const override {
+    return collector::kGcTypeFull;
+  }
+  CollectorType GetCollectorType() const override {
+    return kCollectorTypeNone;
+  }
+
+  // Called concurrently by the workers of the thread pool, which only read `marked_`.
+  mirror::Object* IsMarked(mirror::Object* obj) override {
+    return marked_.find(obj) != marked_.end() ? obj : nullptr;
+  }
+  bool IsNullOrMarkedHeapReference(mirror::HeapReference<mirror::Object>* obj,
+                                   [[maybe_unused]] bool do_atomic_update) override {
+    mirror::Object* ref = obj->AsMirrorPtr();
+    return ref == nullptr || IsMarked(ref) != nullptr;
+  }
+
+  void ProcessMarkStack() override {}
+  mirror::Object* MarkObject([[maybe_unused]] mirror::Object* obj) override {
+    LOG(FATAL) << "Unreachable";
+    UNREACHABLE();
+  }
+  void MarkHeapReference([[maybe_unused]] mirror::HeapReference<mirror::Object>* obj,
+                         [[maybe_unused]] bool do_atomic_update) override {
+    LOG(FATAL) << "Unreachable";
+  }
+  void DelayReferenceReferent([[maybe_unused]] ObjPtr<mirror::Class> klass,
+                              [[maybe_unused]] ObjPtr<mirror::Reference> reference) override {
+    LOG(FATAL) << "Unreachable";
+  }
+  void VisitRoots([[maybe_unused]] mirror::Object*** roots,
+                  [[maybe_unused]] size_t count,
+                  [[maybe_unused]] const RootInfo& info) override {
+    LOG(FATAL) << "Unreachable";
+  }
+  void VisitRoots([[maybe_unused]] mirror::CompressedReference<mirror::Object>** roots,
+                  [[maybe_unused]] size_t count,
+                  [[maybe_unused]] const RootInfo& info) override {
+    LOG(FATAL) << "Unreachable";
+  }
+
+ protected:
+  void RunPhases() override {
+    LOG(FATAL) << "Unreachable";
+  }
+  void RevokeAllThreadLocalBuffers() override {}
+
+ private:
+  std::unordered_set<mirror::Object*> marked_;
+};
+
+class ReferenceProcessorTest : public CommonRuntimeTest {
+ protected:
+  ReferenceProcessorTest() {
+    use_boot_image_ = true;  // Make the Runtime creation cheaper.
+  }
+
+  void SetUpRuntimeOptions(RuntimeOptions* options) override {
+    CommonRuntimeTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:ParallelReferenceProcessing=true", nullptr));
+  }
+
+  static ObjPtr<mirror::Reference> AllocWeakReference(Thread* self)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    ObjPtr<mirror::Class> weak_reference_class =
+        Runtime::Current()->GetClassLinker()->FindSystemClass(self,
+                                                              "Ljava/lang/ref/WeakReference;");
+    return weak_reference_class->AllocObject(self)->AsReference();
+  }
+
+  static void ClearWhiteReferences(ReferenceProcessor* processor, ReferenceQueue* queue)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    processor->ClearWhiteReferences(queue);
+  }
+
+  static size_t GetThreadCount(ReferenceProcessor* processor) {
+    return processor->GetThreadCount();
+  }
+
+  static ReferenceQueue* GetClearedReferences(ReferenceProcessor* processor) {
+    return &processor->cleared_references_;
+  }
+
+  static void DisableSlowPath(Thread* self, ReferenceProcessor* processor)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    MutexLock mu(self, *Locks::reference_processor_lock_);
+    processor->DisableSlowPath(self);
+  }
+};
+
+// Clears the white referents of more references than ReferenceQueue::kMinParallelReferences, so
+// that the heap thread pool is used. The pool is smaller than the number of threads requested
+// from ClearWhiteReferencesParallel in the second round.
+TEST_F(ReferenceProcessorTest, ClearsWhiteReferencesInParallel) {
+  Thread* self = Thread::Current();
+  Heap* heap = Runtime::Current()->GetHeap();
+  if (heap->GetThreadPool() == nullptr) {
+    heap->CreateThreadPool(/*num_threads=*/ 2u);
+  }
+  ThreadPool* thread_pool = heap->GetThreadPool();
+  ASSERT_TRUE(thread_pool != nullptr);
+
+  ScopedObjectAccess soa(self);
+  ReferenceProcessor processor;
+  size_t thread_count = GetThreadCount(&processor);
+  EXPECT_GT(thread_count, 1u);
+  EXPECT_LE(thread_count - 1u, thread_pool->GetThreadCount());
+
+  constexpr size_t kNumReferences = 4096;
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ObjectArray<mirror::Object>> objects =
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(
+          self, GetClassRoot<mirror::ObjectArray<mirror::Object>>(), 2u * kNumReferences));
+  ASSERT_TRUE(objects != nullptr);
+  for (size_t round = 0; round != 2u; ++round) {
+    for (size_t i = 0; i != kNumReferences; ++i) {
+      ObjPtr<mirror::Reference> ref = AllocWeakReference(self);
+      ASSERT_TRUE(ref != nullptr);
+      objects->Set(2 * i, ref);
+      // Every fifth reference has no referent.
+      if (i % 5 != 0) {
+        ObjPtr<mirror::Object> referent = GetClassRoot<mirror::Object>()->AllocObject(self);
+        ASSERT_TRUE(referent != nullptr);
+        objects->Set(2 * i + 1, referent);
+        objects->Get(2 * i)->AsReference()->SetReferent<false>(referent);
+      } else {
+        objects->Set(2 * i + 1, nullptr);
+      }
+    }
+    // Allocations may move objects, so mark and enqueue them once they are all allocated. One
+    // referent in three is marked.
+    MarkedSetCollector collector(heap);
+    processor.Setup(self, &collector, /*concurrent=*/ false, /*clear_soft_references=*/ false);
+    Mutex lock("Reference queue lock");
+    ReferenceQueue queue(&lock);
+    std::set<mirror::Reference*> white;
+    for (size_t i = 0; i != kNumReferences; ++i) {
+      ObjPtr<mirror::Reference> ref = objects->Get(2 * i)->AsReference();
+      queue.EnqueueReference(ref);
+      if (i % 5 != 0 && i % 3 == 0) {
+        collector.Mark(objects->Get(2 * i + 1));
+      } else if (i % 5 != 0) {
+        white.insert(ref.Ptr());
+      }
+    }
+
+    ReferenceQueue* cleared_references = GetClearedReferences(&processor);
+    if (round == 0u) {
+      ClearWhiteReferences(&processor, &queue);
+    } else {
+      queue.ClearWhiteReferencesParallel(cleared_references,
+                                         &collector,
+                                         thread_pool,
+                                         thread_pool->GetThreadCount() + 4u);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+
+    std::set<mirror::Reference*> cleared;
+    while (!cleared_references->IsEmpty()) {
+      cleared.insert(cleared_references->DequeuePendingReference().Ptr());
+    }
+    EXPECT_EQ(cleared.size(), white.size()) << round;
+    EXPECT_TRUE(cleared == white) << round;
+    for (size_t i = 0; i != kNumReferences; ++i) {
+      ObjPtr<mirror::Reference> ref = objects->Get(2 * i)->AsReference();
+      ObjPtr<mirror::Object> expected_referent =
+          (white.find(ref.Ptr()) != white.end()) ? nullptr : objects->Get(2 * i + 1);
+      EXPECT_TRUE(ref->GetReferent() == expected_referent) << round << " " << i;
+    }
+  }
+}
+
+// While marking is in progress, a marked referent is returned without waiting for the reference
+// processing.
+TEST_F(ReferenceProcessorTest, GetReferentReturnsMarkedReferentWhileStarting) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Reference> ref = hs.NewHandle(AllocWeakReference(self));
+  ASSERT_TRUE(ref != nullptr);
+  Handle<mirror::Object> referent =
+      hs.NewHandle(GetClassRoot<mirror::Object>()->AllocObject(self));
+  ASSERT_TRUE(referent != nullptr);
+  ref->SetReferent<false>(referent.Get());
+
+  ReferenceProcessor processor;
+  MarkedSetCollector collector(Runtime::Current()->GetHeap());
+  collector.Mark(referent.Get());
+  processor.Setup(self, &collector, /*concurrent=*/ true, /*clear_soft_references=*/ false);
+  // Require the slow path, as the collectors do when they start processing references.
+  if (gUseReadBarrier) {
+    self->SetWeakRefAccessEnabled(false);
+  } else {
+    processor.EnableSlowPath();
+  }
+
+  EXPECT_TRUE(processor.GetReferent(self, ref.Get()) == referent.Get());
+  EXPECT_EQ(processor.GetBlockedGetReferentCount(), 0u);
+
+  if (gUseReadBarrier) {
+    self->SetWeakRefAccessEnabled(true);
+  } else {
+    DisableSlowPath(self, &processor);
+  }
+}
+
+}  // namespace gc
+}  // namespace art
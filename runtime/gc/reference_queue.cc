@@ -16,6 +16,8 @@
 
 #include "reference_queue.h"
 
+#include <algorithm>
+
 #include "accounting/card_table-inl.h"
 #include "base/mutex.h"
 #include "collector/concurrent_copying.h"
@@ -131,30 +133,41 @@ size_t ReferenceQueue::GetLength() const {
   return count;
 }
 
+bool ReferenceQueue::ClearWhiteReferent(ObjPtr<mirror::Reference> ref,
+                                        collector::GarbageCollector* collector) {
+  mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
+  // do_atomic_update is false because this happens during the reference processing phase where
+  // Reference.clear() would block.
+  if (collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
+    return false;
+  }
+  // Referent is white, clear it.
+  if (Runtime::Current()->IsActiveTransaction()) {
+    ref->ClearReferent<true>();
+  } else {
+    ref->ClearReferent<false>();
+  }
+  return true;
+}
+
+void ReferenceQueue::ReportClearedFromFinalizer() {
+  static bool already_reported = false;
+  if (!already_reported) {
+    // TODO: Maybe do this only if the queue is non-null?
+    LOG(WARNING) << "Cleared Reference was only reachable from finalizer (only reported once)";
+    already_reported = true;
+  }
+}
+
 void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
                                           collector::GarbageCollector* collector,
                                           bool report_cleared) {
   while (!IsEmpty()) {
     ObjPtr<mirror::Reference> ref = DequeuePendingReference();
-    mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
-    // do_atomic_update is false because this happens during the reference processing phase where
-    // Reference.clear() would block.
-    if (!collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
-      // Referent is white, clear it.
-      if (Runtime::Current()->IsActiveTransaction()) {
-        ref->ClearReferent<true>();
-      } else {
-        ref->ClearReferent<false>();
-      }
+    if (ClearWhiteReferent(ref, collector)) {
       cleared_references->EnqueueReference(ref);
       if (report_cleared) {
-        static bool already_reported = false;
-        if (!already_reported) {
-          // TODO: Maybe do this only if the queue is non-null?
-          LOG(WARNING)
-              << "Cleared Reference was only reachable from finalizer (only reported once)";
-          already_reported = true;
-        }
+        ReportClearedFromFinalizer();
       }
     }
     // Delay disabling the read barrier until here so that the ClearReferent call above in
@@ -163,6 +176,81 @@ void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
   }
 }
 
+// Checks and clears the referents of a slice of the dequeued references. Each reference is
+// handled by exactly one task, so the referent fields can be updated without atomics.
+class ReferenceQueue::ClearWhiteReferentsTask : public Task {
+ public:
+  ClearWhiteReferentsTask(collector::GarbageCollector* collector,
+                          mirror::Reference** refs,
+                          uint8_t* cleared,
+                          size_t count)
+      : collector_(collector), refs_(refs), cleared_(cleared), count_(count) {}
+
+  void Run([[maybe_unused]] Thread* self) override NO_THREAD_SAFETY_ANALYSIS {
+    for (size_t i = 0; i != count_; ++i) {
+      cleared_[i] = ClearWhiteReferent(refs_[i], collector_) ? 1u : 0u;
+    }
+  }
+
+  void Finalize() override {
+    delete this;
+  }
+
+ private:
+  collector::GarbageCollector* const collector_;
+  mirror::Reference** const refs_;
+  uint8_t* const cleared_;
+  const size_t count_;
+};
+
+void ReferenceQueue::ClearWhiteReferencesParallel(ReferenceQueue* cleared_references,
+                                                  collector::GarbageCollector* collector,
+                                                  ThreadPool* thread_pool,
+                                                  size_t thread_count,
+                                                  bool report_cleared) {
+  // In transaction mode the referents are cleared with a read barrier, which needs the read
+  // barrier of the reference to be enabled until the referent is cleared.
+  if (thread_pool == nullptr || thread_count <= 1u || Runtime::Current()->IsActiveTransaction()) {
+    ClearWhiteReferences(cleared_references, collector, report_cleared);
+    return;
+  }
+  // Unlinking the list is cheap compared to checking the mark state of the referents, which
+  // mostly misses the cache.
+  std::vector<mirror::Reference*> refs;
+  while (!IsEmpty()) {
+    refs.push_back(DequeuePendingReference().Ptr());
+  }
+  std::vector<uint8_t> cleared(refs.size(), 0u);
+  if (refs.size() < kMinParallelReferences) {
+    for (size_t i = 0; i != refs.size(); ++i) {
+      cleared[i] = ClearWhiteReferent(refs[i], collector) ? 1u : 0u;
+    }
+  } else {
+    Thread* self = Thread::Current();
+    const size_t chunk_size = (refs.size() + thread_count - 1u) / thread_count;
+    for (size_t begin = 0; begin < refs.size(); begin += chunk_size) {
+      size_t count = std::min(chunk_size, refs.size() - begin);
+      thread_pool->AddTask(self,
+                           new ClearWhiteReferentsTask(
+                               collector, refs.data() + begin, cleared.data() + begin, count));
+    }
+    thread_pool->SetMaxActiveWorkers(std::min(thread_count - 1, thread_pool->GetThreadCount()));
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, /* do_work= */ true, /* may_hold_lock= */ true);
+    thread_pool->StopWorkers(self);
+  }
+  // The cleared references list is not thread safe, fill it from this thread.
+  for (size_t i = 0; i != refs.size(); ++i) {
+    if (cleared[i] != 0u) {
+      cleared_references->EnqueueReference(refs[i]);
+      if (report_cleared) {
+        ReportClearedFromFinalizer();
+      }
+    }
+    DisableReadBarrierForReference(refs[i], std::memory_order_relaxed);
+  }
+}
+
 FinalizerStats ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
                                                 collector::GarbageCollector* collector) {
   uint32_t num_refs(0), num_enqueued(0);
@@ -109,6 +109,16 @@ class ReferenceQueue {
                             bool report_cleared = false)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Same as ClearWhiteReferences, but the referents are checked and cleared by `thread_count`
+  // threads, including the calling thread and workers of `thread_pool`, as far as the pool has
+  // enough workers. Falls back to ClearWhiteReferences for short lists and in transaction mode.
+  void ClearWhiteReferencesParallel(ReferenceQueue* cleared_references,
+                                    collector::GarbageCollector* collector,
+                                    ThreadPool* thread_pool,
+                                    size_t thread_count,
+                                    bool report_cleared = false)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   void Dump(std::ostream& os) const REQUIRES_SHARED(Locks::mutator_lock_);
   size_t GetLength() const REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -130,6 +140,18 @@ class ReferenceQueue {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
  private:
+  class ClearWhiteReferentsTask;
+
+  // Minimum number of references for ClearWhiteReferencesParallel to use more than one thread.
+  static constexpr size_t kMinParallelReferences = 1024;
+
+  // Clears the referent of `ref` if it is white. Returns whether the referent was cleared.
+  static bool ClearWhiteReferent(ObjPtr<mirror::Reference> ref,
+                                 collector::GarbageCollector* collector)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static void ReportClearedFromFinalizer();
+
   // Lock, used for parallel GC reference enqueuing. It allows for multiple threads simultaneously
   // calling AtomicEnqueueIfNotEnqueued.
   Mutex* const lock_;
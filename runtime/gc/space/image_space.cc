@@ -20,11 +20,14 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "android-base/logging.h"
@@ -81,6 +84,10 @@ using ::android::base::StringPrintf;
 // supposed to be much smaller and allocating more that this would likely fail anyway.
 static constexpr size_t kMaxTotalImageReservationSize = 1 * GB;
 
+// Maximum number of threads used to decompress an image when the runtime thread pool is not
+// available. Matches the size of the runtime thread pool.
+static constexpr size_t kMaxImageDecompressionThreads = 4u;
+
 }  // namespace
 
 Atomic<uint32_t> ImageSpace::bitmap_index_(0);
@@ -1059,35 +1066,86 @@ class ImageSpace::Loader {
         const uint64_t start = NanoTime();
         Thread* const self = Thread::Current();
         static constexpr size_t kMinBlocks = 2u;
-        const bool use_parallel = pool != nullptr && image_header.GetBlockCount() >= kMinBlocks;
-        bool failed_decompression = false;
-        for (const ImageHeader::Block& block : image_header.GetBlocks(temp_map.Begin())) {
-          auto function = [&](Thread*) {
-            const uint64_t start2 = NanoTime();
-            ScopedTrace trace("LZ4 decompress block");
-            bool result = block.Decompress(/*out_ptr=*/map.Begin(),
-                                           /*in_ptr=*/temp_map.Begin(),
-                                           error_msg);
-            if (!result) {
-              failed_decompression = true;
-              if (error_msg != nullptr) {
-                *error_msg = "Failed to decompress image block " + *error_msg;
-              }
-            }
-            VLOG(image) << "Decompress block " << block.GetDataSize() << " -> "
-                        << block.GetImageSize() << " in " << PrettyDuration(NanoTime() - start2);
-          };
-          if (use_parallel) {
-            pool->AddTask(self, new FunctionTask(std::move(function)));
-          } else {
-            function(self);
+        const size_t block_count = image_header.GetBlockCount();
+        const bool use_parallel = pool != nullptr && block_count >= kMinBlocks;
+        // Digest the compression dictionary once for all blocks.
+        ArrayRef<const uint8_t> dictionary_data;
+        ImageHeader::DecompressionDictionary dictionary;
+        std::string dictionary_error_msg;
+        if (!image_header.GetCompressionDictionary(
+                temp_map.Begin(), temp_map.Size(), &dictionary_data, &dictionary_error_msg) ||
+            !dictionary.Init(dictionary_data, &dictionary_error_msg)) {
+          if (error_msg != nullptr) {
+            *error_msg = dictionary_error_msg + " in " + image_filename;
           }
+          return MemMap::Invalid();
         }
+        std::atomic<bool> failed_decompression(false);
+        auto decompress_block = [&](const ImageHeader::Block& block,
+                                    ImageHeader::DecompressionContext* context) {
+          const uint64_t start2 = NanoTime();
+          ScopedTrace trace(block.GetStorageMode() == ImageHeader::kStorageModeZstd
+                                ? "Zstd decompress block"
+                                : "LZ4 decompress block");
+          std::string block_error_msg;
+          bool result = block.Decompress(/*out_ptr=*/map.Begin(),
+                                         /*in_ptr=*/temp_map.Begin(),
+                                         dictionary,
+                                         context,
+                                         &block_error_msg);
+          // Report only the first failure, blocks may be decompressed concurrently.
+          if (!result && !failed_decompression.exchange(true) && error_msg != nullptr) {
+            *error_msg = "Failed to decompress image block " + block_error_msg;
+          }
+          VLOG(image) << "Decompress block " << block.GetDataSize() << " -> "
+                      << block.GetImageSize() << " in " << PrettyDuration(NanoTime() - start2);
+        };
+        // Each thread claims blocks one at a time and reuses its zstd context for all of them.
+        const ImageHeader::Block* blocks = image_header.GetBlocks(temp_map.Begin()).begin();
+        std::atomic<size_t> next_block(0u);
+        auto worker = [&]() {
+          ImageHeader::DecompressionContext context;
+          for (size_t i = next_block.fetch_add(1u, std::memory_order_relaxed);
+               i < block_count;
+               i = next_block.fetch_add(1u, std::memory_order_relaxed)) {
+            decompress_block(blocks[i], &context);
+          }
+        };
+        // Without the runtime thread pool, for example while loading the boot image, use
+        // short-lived threads. Decompression does not touch any runtime state.
+        const size_t num_threads = use_parallel
+            ? 1u
+            : std::min({static_cast<size_t>(std::thread::hardware_concurrency()),
+                        kMaxImageDecompressionThreads,
+                        block_count});
         if (use_parallel) {
+          // One task per pool worker and one for this thread, which also runs tasks in `Wait()`.
+          const size_t num_tasks = std::min(pool->GetThreadCount() + 1u, block_count);
+          for (size_t i = 0; i != num_tasks; ++i) {
+            pool->AddTask(self, new FunctionTask([&](Thread*) { worker(); }));
+          }
           ScopedTrace trace("Waiting for workers");
           // Go to native since we don't want to suspend while holding the mutator lock.
           ScopedThreadSuspension sts(Thread::Current(), ThreadState::kNative);
           pool->Wait(self, true, false);
+        } else if (num_threads > 1u) {
+          std::optional<ScopedThreadSuspension> sts;
+          if (self != nullptr) {
+            // Go to native since we don't want to suspend while holding the mutator lock.
+            sts.emplace(self, ThreadState::kNative);
+          }
+          std::vector<std::thread> threads;
+          threads.reserve(num_threads - 1u);
+          for (size_t i = 1u; i != num_threads; ++i) {
+            threads.emplace_back(worker);
+          }
+          worker();
+          ScopedTrace trace("Waiting for decompression threads");
+          for (std::thread& thread : threads) {
+            thread.join();
+          }
+        } else {
+          worker();
         }
         const uint64_t time = NanoTime() - start;
         // Add one 1 ns to prevent possible divide by 0.
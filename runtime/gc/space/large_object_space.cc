@@ -18,6 +18,7 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <memory>
 
 #include <android-base/logging.h>
@@ -364,7 +365,7 @@ inline bool FreeListSpace::SortByPrevFree::operator()(const AllocationInfo* a,
   return reinterpret_cast<uintptr_t>(a) < reinterpret_cast<uintptr_t>(b);
 }
 
-FreeListSpace* FreeListSpace::Create(const std::string& name, size_t size) {
+MemMap FreeListSpace::MapSpace(const std::string& name, size_t size) {
   CHECK_ALIGNED_PARAM(size, ObjectAlignment());
   DCHECK_LE(gPageSize, ObjectAlignment())
       << "MapAnonymousAligned() should be used if the large-object alignment is larger than the "
@@ -376,7 +377,14 @@ FreeListSpace* FreeListSpace::Create(const std::string& name, size_t size) {
                                         /*low_4gb=*/true,
                                         &error_msg);
   CHECK(mem_map.IsValid()) << "Failed to allocate large object space mem map: " << error_msg;
-  return new FreeListSpace(name, std::move(mem_map), mem_map.Begin(), mem_map.End());
+  return mem_map;
+}
+
+FreeListSpace* FreeListSpace::Create(const std::string& name, size_t size) {
+  MemMap mem_map = MapSpace(name, size);
+  uint8_t* begin = mem_map.Begin();
+  uint8_t* end = mem_map.End();
+  return new FreeListSpace(name, std::move(mem_map), begin, end);
 }
 
 FreeListSpace::FreeListSpace(const std::string& name,
@@ -384,7 +392,8 @@ FreeListSpace::FreeListSpace(const std::string& name,
                              uint8_t* begin,
                              uint8_t* end)
     : LargeObjectSpace(name, begin, end, "free list space lock"),
-      mem_map_(std::move(mem_map)) {
+      mem_map_(std::move(mem_map)),
+      page_release_count_(0u) {
   const size_t space_capacity = end - begin;
   free_end_ = space_capacity;
   CHECK_ALIGNED_PARAM(space_capacity, ObjectAlignment());
@@ -467,12 +476,21 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
 
   // madvise the pages without lock
   madvise(obj, allocation_size, MADV_DONTNEED);
+  page_release_count_.fetch_add(1u, std::memory_order_relaxed);
   if (kIsDebugBuild) {
     // Can't disallow reads since we use them to find next chunks during coalescing.
     CheckedCall(mprotect, __FUNCTION__, obj, allocation_size, PROT_READ);
   }
 
   MutexLock mu(self, lock_);
+  FreeBlock(info, allocation_size);
+  --num_objects_allocated_;
+  DCHECK_LE(allocation_size, num_bytes_allocated_);
+  num_bytes_allocated_ -= allocation_size;
+  return allocation_size;
+}
+
+void FreeListSpace::FreeBlock(AllocationInfo* info, size_t allocation_size) {
   info->SetByteSize(allocation_size, true);  // Mark as free.
   // Look at the next chunk.
   AllocationInfo* next_info = info->GetNextInfo();
@@ -515,10 +533,6 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
     info->SetByteSize(new_free_size, true);
     DCHECK_EQ(info->GetNextInfo(), new_free_info);
   }
-  --num_objects_allocated_;
-  DCHECK_LE(allocation_size, num_bytes_allocated_);
-  num_bytes_allocated_ -= allocation_size;
-  return allocation_size;
 }
 
 size_t FreeListSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
@@ -535,6 +549,11 @@ size_t FreeListSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
 mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
                                      size_t* usable_size, size_t* bytes_tl_bulk_allocated) {
   MutexLock mu(self, lock_);
+  return AllocLocked(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
+}
+
+mirror::Object* FreeListSpace::AllocLocked(size_t num_bytes, size_t* bytes_allocated,
+                                           size_t* usable_size, size_t* bytes_tl_bulk_allocated) {
   const size_t allocation_size = RoundUp(num_bytes, ObjectAlignment());
   AllocationInfo temp_info;
   temp_info.SetPrevFreeBytes(allocation_size);
@@ -640,11 +659,179 @@ void FreeListSpace::SetAllLargeObjectsAsZygoteObjects(Thread* self, bool set_mar
   }
 }
 
+// Sorts the blocks by address and madvise()s each range of adjacent blocks with a single call.
+// Returns the number of madvise() calls.
+static size_t ReleaseBlockPages(std::vector<std::pair<uintptr_t, size_t>>* blocks) {
+  std::sort(blocks->begin(), blocks->end());
+  size_t calls = 0u;
+  for (size_t i = 0; i != blocks->size();) {
+    const uintptr_t begin = (*blocks)[i].first;
+    uintptr_t end = begin + (*blocks)[i].second;
+    for (++i; i != blocks->size() && (*blocks)[i].first == end; ++i) {
+      end += (*blocks)[i].second;
+    }
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    ++calls;
+    if (kIsDebugBuild) {
+      CheckedCall(mprotect, __FUNCTION__, reinterpret_cast<void*>(begin), end - begin, PROT_READ);
+    }
+  }
+  return calls;
+}
+
+DeferredReleaseFreeListSpace* DeferredReleaseFreeListSpace::Create(const std::string& name,
+                                                                   size_t size) {
+  MemMap mem_map = MapSpace(name, size);
+  uint8_t* begin = mem_map.Begin();
+  uint8_t* end = mem_map.End();
+  return new DeferredReleaseFreeListSpace(name, std::move(mem_map), begin, end);
+}
+
+DeferredReleaseFreeListSpace::DeferredReleaseFreeListSpace(const std::string& name,
+                                                           MemMap&& mem_map,
+                                                           uint8_t* begin,
+                                                           uint8_t* end)
+    : FreeListSpace(name, std::move(mem_map), begin, end),
+      unreleased_pages_((end - begin) / ObjectAlignment(), false),
+      unreleased_bytes_(0) {
+}
+
+mirror::Object* DeferredReleaseFreeListSpace::Alloc(Thread* self, size_t num_bytes,
+                                              size_t* bytes_allocated, size_t* usable_size,
+                                              size_t* bytes_tl_bulk_allocated) {
+  uint8_t* dirty_begin = nullptr;
+  uint8_t* dirty_end = nullptr;
+  mirror::Object* obj;
+  {
+    MutexLock mu(self, lock_);
+    obj = AllocLocked(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
+    if (obj == nullptr || unreleased_bytes_ == 0u) {
+      return obj;
+    }
+    const size_t begin_slot = GetSlotIndexForAddress(reinterpret_cast<uintptr_t>(obj));
+    const size_t end_slot = begin_slot + *bytes_allocated / ObjectAlignment();
+    for (size_t slot = begin_slot; slot != end_slot; ++slot) {
+      if (unreleased_pages_[slot]) {
+        unreleased_pages_[slot] = false;
+        unreleased_bytes_ -= ObjectAlignment();
+        uint8_t* page = reinterpret_cast<uint8_t*>(GetAllocationAddressForSlot(slot));
+        if (dirty_begin == nullptr) {
+          dirty_begin = page;
+        }
+        dirty_end = page + ObjectAlignment();
+      }
+    }
+  }
+  // The unreleased pages still hold the contents of the freed objects. The block is allocated,
+  // so it can be cleared without the lock.
+  if (dirty_begin != nullptr) {
+    memset(dirty_begin, 0, dirty_end - dirty_begin);
+  }
+  return obj;
+}
+
+size_t DeferredReleaseFreeListSpace::Free(Thread* self, mirror::Object* obj) {
+  return FreeList(self, 1u, &obj);
+}
+
+size_t DeferredReleaseFreeListSpace::FreeList(Thread* self,
+                                              size_t num_ptrs,
+                                              mirror::Object** ptrs) {
+  // Release the pages of the blocks whose release is not deferred without the lock.
+  std::vector<std::pair<uintptr_t, size_t>> released;
+  size_t total = 0;
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    DCHECK(Contains(ptrs[i]));
+    DCHECK_ALIGNED_PARAM(ptrs[i], ObjectAlignment());
+    AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(ptrs[i]));
+    DCHECK(!info->IsFree());
+    const size_t allocation_size = info->ByteSize();
+    DCHECK_GT(allocation_size, 0U);
+    total += allocation_size;
+    if (allocation_size > kMaxDeferredBytes) {
+      released.emplace_back(reinterpret_cast<uintptr_t>(ptrs[i]), allocation_size);
+    } else if (kIsDebugBuild) {
+      CheckedCall(mprotect, __FUNCTION__, ptrs[i], allocation_size, PROT_READ);
+    }
+  }
+  page_release_count_.fetch_add(ReleaseBlockPages(&released), std::memory_order_relaxed);
+  MutexLock mu(self, lock_);
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(ptrs[i]);
+    AllocationInfo* info = GetAllocationInfoForAddress(address);
+    const size_t allocation_size = info->ByteSize();
+    if (allocation_size <= kMaxDeferredBytes) {
+      const size_t begin_slot = GetSlotIndexForAddress(address);
+      const size_t end_slot = begin_slot + allocation_size / ObjectAlignment();
+      for (size_t slot = begin_slot; slot != end_slot; ++slot) {
+        DCHECK(!unreleased_pages_[slot]);
+        unreleased_pages_[slot] = true;
+      }
+      unreleased_bytes_ += allocation_size;
+    }
+    FreeBlock(info, allocation_size);
+    --num_objects_allocated_;
+    DCHECK_LE(allocation_size, num_bytes_allocated_);
+    num_bytes_allocated_ -= allocation_size;
+  }
+  if (unreleased_bytes_ > kMaxUnreleasedBytes) {
+    // Release down to half the limit so that the madvise() calls are batched over many frees.
+    ReleaseUnreleasedPages(kMaxUnreleasedBytes / 2);
+  }
+  return total;
+}
+
+void DeferredReleaseFreeListSpace::ClampGrowthLimit(size_t capacity) {
+  // Release the pages before the end of the space may be unmapped.
+  Trim();
+  FreeListSpace::ClampGrowthLimit(capacity);
+  MutexLock mu(Thread::Current(), lock_);
+  unreleased_pages_.resize(Size() / ObjectAlignment());
+}
+
+size_t DeferredReleaseFreeListSpace::Trim() {
+  MutexLock mu(Thread::Current(), lock_);
+  return ReleaseUnreleasedPages(0u);
+}
+
+size_t DeferredReleaseFreeListSpace::GetUnreleasedBytes() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return unreleased_bytes_;
+}
+
+size_t DeferredReleaseFreeListSpace::ReleaseUnreleasedPages(size_t max_unreleased_bytes) {
+  // Ties between free blocks of the same size are broken in favor of the lowest address, so the
+  // highest pages are the least likely to be allocated again soon.
+  size_t released_bytes = 0;
+  for (size_t slot = unreleased_pages_.size();
+       slot != 0u && unreleased_bytes_ > max_unreleased_bytes;) {
+    --slot;
+    if (!unreleased_pages_[slot]) {
+      continue;
+    }
+    const size_t end_slot = slot + 1u;
+    unreleased_pages_[slot] = false;
+    unreleased_bytes_ -= ObjectAlignment();
+    while (slot != 0u && unreleased_pages_[slot - 1u] && unreleased_bytes_ > max_unreleased_bytes) {
+      --slot;
+      unreleased_pages_[slot] = false;
+      unreleased_bytes_ -= ObjectAlignment();
+    }
+    const size_t length = (end_slot - slot) * ObjectAlignment();
+    madvise(reinterpret_cast<void*>(GetAllocationAddressForSlot(slot)), length, MADV_DONTNEED);
+    page_release_count_.fetch_add(1u, std::memory_order_relaxed);
+    released_bytes += length;
+  }
+  return released_bytes;
+}
+
 void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, void* arg) {
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
   space::LargeObjectSpace* space = context->space->AsLargeObjectSpace();
   Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
+  if (!context->on_thread_pool) {
+    Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
+  }
   // If the bitmaps aren't swapped we need to clear the bits since the GC isn't going to re-swap
   // the bitmaps as an optimization.
   if (!context->swap_bitmaps) {
@@ -657,7 +844,9 @@ void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, voi
   context->freed.bytes += space->FreeList(self, num_ptrs, ptrs);
 }
 
-collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps) {
+collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps,
+                                                 ThreadPool* thread_pool,
+                                                 size_t thread_count) {
   if (Begin() >= End()) {
     return collector::ObjectBytePair(0, 0);
   }
@@ -666,14 +855,16 @@ collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps) {
   if (swap_bitmaps) {
     std::swap(live_bitmap, mark_bitmap);
   }
-  AllocSpace::SweepCallbackContext scc(swap_bitmaps, this);
   std::pair<uint8_t*, uint8_t*> range = GetBeginEndAtomic();
-  accounting::LargeObjectBitmap::SweepWalk(*live_bitmap, *mark_bitmap,
-                                           reinterpret_cast<uintptr_t>(range.first),
-                                           reinterpret_cast<uintptr_t>(range.second),
-                                           SweepCallback,
-                                           &scc);
-  return scc.freed;
+  return SweepRange(this,
+                    *live_bitmap,
+                    *mark_bitmap,
+                    reinterpret_cast<uintptr_t>(range.first),
+                    reinterpret_cast<uintptr_t>(range.second),
+                    SweepCallback,
+                    swap_bitmaps,
+                    thread_pool,
+                    thread_count);
 }
 
 bool LargeObjectSpace::LogFragmentationAllocFailure(std::ostream& /*os*/,
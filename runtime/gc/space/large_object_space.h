@@ -18,6 +18,7 @@
 #define ART_RUNTIME_GC_SPACE_LARGE_OBJECT_SPACE_H_
 
 #include "base/allocator.h"
+#include "base/atomic.h"
 #include "base/safe_map.h"
 #include "base/tracking_safe_map.h"
 #include "dlmalloc_space.h"
@@ -37,6 +38,7 @@ enum class LargeObjectSpaceType {
   kDisabled,
   kMap,
   kFreeList,
+  kFreeListDeferred,
 };
 
 // Abstraction implemented by all large object spaces.
@@ -80,7 +82,10 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   AllocSpace* AsAllocSpace() override {
     return this;
   }
-  collector::ObjectBytePair Sweep(bool swap_bitmaps);
+  // Sweeps the space, in parallel on `thread_pool` if `thread_count` is above one.
+  collector::ObjectBytePair Sweep(bool swap_bitmaps,
+                                  ThreadPool* thread_pool = nullptr,
+                                  size_t thread_count = 1u);
   bool CanMoveObjects() const override {
     return false;
   }
@@ -117,6 +122,11 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   virtual std::pair<uint8_t*, uint8_t*> GetBeginEndAtomic() const = 0;
   // Clamp the space size to the given capacity.
   virtual void ClampGrowthLimit(size_t capacity) = 0;
+  // Return memory held by the space but not used by any large object to the system. Returns the
+  // number of bytes released.
+  virtual size_t Trim() {
+    return 0U;
+  }
 
   // The way large object spaces are implemented, the object alignment has to be
   // the same as the *runtime* OS page size. However, in the future this may
@@ -196,7 +206,7 @@ class LargeObjectMapSpace : public LargeObjectSpace {
 };
 
 // A continuous large object space with a free-list to handle holes.
-class FreeListSpace final : public LargeObjectSpace {
+class FreeListSpace : public LargeObjectSpace {
  public:
   virtual ~FreeListSpace();
   static FreeListSpace* Create(const std::string& name, size_t capacity);
@@ -211,9 +221,14 @@ class FreeListSpace final : public LargeObjectSpace {
   void ForEachMemMap(std::function<void(const MemMap&)> func) const override REQUIRES(!lock_);
   std::pair<uint8_t*, uint8_t*> GetBeginEndAtomic() const override REQUIRES(!lock_);
   void ClampGrowthLimit(size_t capacity) override REQUIRES(!lock_);
+  // Number of madvise() calls made to release the pages of freed blocks.
+  size_t GetPageReleaseCount() const {
+    return page_release_count_.load(std::memory_order_relaxed);
+  }
 
  protected:
   FreeListSpace(const std::string& name, MemMap&& mem_map, uint8_t* begin, uint8_t* end);
+  static MemMap MapSpace(const std::string& name, size_t size);
   size_t GetSlotIndexForAddress(uintptr_t address) const {
     DCHECK(Contains(reinterpret_cast<mirror::Object*>(address)));
     return (address - reinterpret_cast<uintptr_t>(Begin())) / ObjectAlignment();
@@ -227,8 +242,14 @@ class FreeListSpace final : public LargeObjectSpace {
   uintptr_t GetAddressForAllocationInfo(const AllocationInfo* info) const {
     return GetAllocationAddressForSlot(GetSlotIndexForAllocationInfo(info));
   }
+  // Allocates the best fitting free block, or the start of the free space at the end of the space.
+  mirror::Object* AllocLocked(size_t num_bytes, size_t* bytes_allocated, size_t* usable_size,
+                              size_t* bytes_tl_bulk_allocated) REQUIRES(lock_);
   // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
   void RemoveFreePrev(AllocationInfo* info) REQUIRES(lock_);
+  // Marks the block of `allocation_size` bytes at `info` as free and coalesces it with the free
+  // blocks around it. The caller is responsible for the madvise() and the allocation counters.
+  void FreeBlock(AllocationInfo* info, size_t allocation_size) REQUIRES(lock_);
   bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const override;
   void SetAllLargeObjectsAsZygoteObjects(Thread* self, bool set_mark_bit) override
       REQUIRES(!lock_)
@@ -252,6 +273,48 @@ class FreeListSpace final : public LargeObjectSpace {
   // Free bytes at the end of the space.
   size_t free_end_ GUARDED_BY(lock_);
   FreeBlocks free_blocks_ GUARDED_BY(lock_);
+
+  Atomic<size_t> page_release_count_;
+};
+
+// A free list space which does not release the pages of freed blocks of up to
+// `kMaxDeferredBytes` right away. Such blocks go back to the free list, where they coalesce and
+// are allocated exactly as in a `FreeListSpace`, but their pages are only marked as unreleased.
+// Workloads allocating many arrays just above the large object threshold then pay for neither a
+// madvise() on every free nor a page fault on every page of the next allocation reusing the
+// block; the unreleased pages of an allocation are cleared with memset instead. The unreleased
+// pages are released once they exceed `kMaxUnreleasedBytes` and on `Trim()`, with one madvise()
+// per range of adjacent pages.
+class DeferredReleaseFreeListSpace final : public FreeListSpace {
+ public:
+  static constexpr size_t kMaxDeferredBytes = 64 * KB;
+  static constexpr size_t kMaxUnreleasedBytes = 4 * MB;
+
+  static DeferredReleaseFreeListSpace* Create(const std::string& name, size_t capacity);
+  mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
+                        size_t* usable_size, size_t* bytes_tl_bulk_allocated)
+      override REQUIRES(!lock_);
+  size_t Free(Thread* self, mirror::Object* obj) override REQUIRES(!lock_);
+  size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) override
+      REQUIRES(!lock_);
+  void ClampGrowthLimit(size_t capacity) override REQUIRES(!lock_);
+  size_t Trim() override REQUIRES(!lock_);
+  size_t GetUnreleasedBytes() const REQUIRES(!lock_);
+
+ private:
+  DeferredReleaseFreeListSpace(const std::string& name,
+                               MemMap&& mem_map,
+                               uint8_t* begin,
+                               uint8_t* end);
+  // Releases unreleased pages, highest address first, until at most `max_unreleased_bytes` are
+  // left. The pages are madvised with the lock held, as they are free and could otherwise be
+  // allocated before the madvise() clears them. Returns the number of bytes released.
+  size_t ReleaseUnreleasedPages(size_t max_unreleased_bytes) REQUIRES(lock_);
+
+  // Whether each page of the space belongs to a freed block and still holds its contents. Only
+  // free pages are unreleased.
+  std::vector<bool> unreleased_pages_ GUARDED_BY(lock_);
+  size_t unreleased_bytes_ GUARDED_BY(lock_);
 };
 
 }  // namespace space
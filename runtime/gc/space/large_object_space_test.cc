@@ -16,7 +16,13 @@
 
 #include "large_object_space.h"
 
+#include <sys/resource.h>
+
+#include <algorithm>
+
+#include "base/casts.h"
 #include "base/time_utils.h"
+#include "base/utils.h"
 #include "space_test.h"
 
 namespace art HIDDEN {
@@ -30,19 +36,25 @@ class LargeObjectSpaceTest : public SpaceTest<CommonRuntimeTest> {
   static constexpr size_t kNumThreads = 10;
   static constexpr size_t kNumIterations = 1000;
   void RaceTest();
+
+  void FragmentationBenchmark();
+
+  void ParallelSweepTest();
 };
 
 
 void LargeObjectSpaceTest::LargeObjectTest() {
   size_t rand_seed = 0;
   Thread* const self = Thread::Current();
-  for (size_t i = 0; i < 2; ++i) {
+  for (size_t i = 0; i < 3; ++i) {
     LargeObjectSpace* los = nullptr;
     const size_t capacity = 128 * MB;
     if (i == 0) {
       los = space::LargeObjectMapSpace::Create("large object space");
-    } else {
+    } else if (i == 1) {
       los = space::FreeListSpace::Create("large object space", capacity);
+    } else {
+      los = space::DeferredReleaseFreeListSpace::Create("large object space", capacity);
     }
 
     // Make sure the bitmap is not empty and actually covers at least how much we expect.
@@ -152,12 +164,14 @@ class AllocRaceTask : public Task {
 };
 
 void LargeObjectSpaceTest::RaceTest() {
-  for (size_t los_type = 0; los_type < 2; ++los_type) {
+  for (size_t los_type = 0; los_type < 3; ++los_type) {
     LargeObjectSpace* los = nullptr;
     if (los_type == 0) {
       los = space::LargeObjectMapSpace::Create("large object space");
-    } else {
+    } else if (los_type == 1) {
       los = space::FreeListSpace::Create("large object space", 128 * MB);
+    } else {
+      los = space::DeferredReleaseFreeListSpace::Create("large object space", 128 * MB);
     }
 
     Thread* self = Thread::Current();
@@ -175,6 +189,124 @@ void LargeObjectSpaceTest::RaceTest() {
   }
 }
 
+// Churns through arrays of 12 to 64 KB with a few larger ones mixed in, and compares the free list
+// space with the deferred release space: the number of madvise() calls and page faults, and how
+// far into the space they have to go for the same live set.
+void LargeObjectSpaceTest::FragmentationBenchmark() {
+  static constexpr size_t kCapacity = 128 * MB;
+  static constexpr size_t kLiveObjects = 512;
+  static constexpr size_t kIterations = 50000;
+  Thread* const self = Thread::Current();
+  size_t peak_extent[2] = {0u, 0u};
+  size_t release_count[2] = {0u, 0u};
+  for (size_t los_type = 0; los_type < 2; ++los_type) {
+    FreeListSpace* los = nullptr;
+    if (los_type == 0) {
+      los = space::FreeListSpace::Create("large object space", kCapacity);
+    } else {
+      los = space::DeferredReleaseFreeListSpace::Create("large object space", kCapacity);
+    }
+    size_t rand_seed = 0;
+    std::vector<std::pair<mirror::Object*, size_t>> live;
+    struct rusage start_usage;
+    ASSERT_EQ(0, getrusage(RUSAGE_SELF, &start_usage));
+    const uint64_t start_ns = NanoTime();
+    for (size_t i = 0; i < kIterations; ++i) {
+      if (live.size() == kLiveObjects) {
+        size_t index = test_rand(&rand_seed) % live.size();
+        std::swap(live[index], live.back());
+        ASSERT_EQ(live.back().second, los->Free(self, live.back().first));
+        live.pop_back();
+      }
+      size_t request_size = (i % 64 == 0)
+          ? 256 * KB + test_rand(&rand_seed) % (768 * KB)
+          : 12 * KB + test_rand(&rand_seed) % (52 * KB);
+      size_t allocation_size = 0;
+      size_t bytes_tl_bulk_allocated;
+      mirror::Object* obj = los->Alloc(self, request_size, &allocation_size, nullptr,
+                                       &bytes_tl_bulk_allocated);
+      ASSERT_TRUE(obj != nullptr);
+      // Reused blocks have to be cleared like fresh ones.
+      ASSERT_EQ(0u, reinterpret_cast<const uint8_t*>(obj)[request_size - 1]);
+      memset(obj, 0xFF, request_size);
+      live.push_back(std::make_pair(obj, allocation_size));
+      size_t extent = reinterpret_cast<uint8_t*>(obj) + allocation_size - los->Begin();
+      peak_extent[los_type] = std::max(peak_extent[los_type], extent);
+    }
+    const uint64_t duration_ns = NanoTime() - start_ns;
+    struct rusage end_usage;
+    ASSERT_EQ(0, getrusage(RUSAGE_SELF, &end_usage));
+    release_count[los_type] = los->GetPageReleaseCount();
+    for (const auto& pair : live) {
+      los->Free(self, pair.first);
+    }
+    if (los_type == 1) {
+      DeferredReleaseFreeListSpace* deferred_los = down_cast<DeferredReleaseFreeListSpace*>(los);
+      EXPECT_LE(deferred_los->GetUnreleasedBytes(),
+                DeferredReleaseFreeListSpace::kMaxUnreleasedBytes);
+      deferred_los->Trim();
+      EXPECT_EQ(0u, deferred_los->GetUnreleasedBytes());
+    }
+    LOG(INFO) << los->GetName() << " type " << los_type << ": " << kIterations
+              << " allocations in " << PrettyDuration(duration_ns)
+              << ", " << release_count[los_type] << " madvise calls, "
+              << (end_usage.ru_minflt - start_usage.ru_minflt) << " minor page faults"
+              << ", peak extent " << PrettySize(peak_extent[los_type]);
+    EXPECT_EQ(0U, los->GetBytesAllocated());
+    EXPECT_EQ(0U, los->GetObjectsAllocated());
+    // All the blocks coalesced back into a single free block.
+    size_t bytes_allocated = 0, bytes_tl_bulk_allocated;
+    mirror::Object* obj = los->Alloc(self, 100 * MB, &bytes_allocated, nullptr,
+                                     &bytes_tl_bulk_allocated);
+    EXPECT_TRUE(obj != nullptr);
+    los->Free(self, obj);
+    delete los;
+  }
+  // Most frees of small blocks skip the madvise(), and not releasing their pages must not cost
+  // any address space. The page faults are only logged, they are counted for the whole process.
+  EXPECT_LT(release_count[1] * 10u, release_count[0]);
+  EXPECT_LE(peak_extent[1], peak_extent[0]);
+}
+
+void LargeObjectSpaceTest::ParallelSweepTest() {
+  static constexpr size_t kNumObjects = 256;
+  static constexpr size_t kObjectSize = 256 * KB;
+  Thread* const self = Thread::Current();
+  std::unique_ptr<LargeObjectSpace> los(
+      space::FreeListSpace::Create("large object space", 128 * MB));
+  std::unique_ptr<ThreadPool> thread_pool(
+      ThreadPool::Create("Large object space test thread pool", 3));
+  std::vector<mirror::Object*> objects;
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    size_t bytes_allocated, bytes_tl_bulk_allocated;
+    mirror::Object* obj =
+        los->Alloc(self, kObjectSize, &bytes_allocated, nullptr, &bytes_tl_bulk_allocated);
+    ASSERT_TRUE(obj != nullptr);
+    los->GetLiveBitmap()->Set(obj);
+    // Keep every other object.
+    if (i % 2 == 0) {
+      los->GetMarkBitmap()->Set(obj);
+    }
+    objects.push_back(obj);
+  }
+  collector::ObjectBytePair freed;
+  {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    freed = los->Sweep(/*swap_bitmaps=*/ false, thread_pool.get(), /*thread_count=*/ 4);
+  }
+  EXPECT_EQ(kNumObjects / 2, freed.objects);
+  EXPECT_EQ(static_cast<int64_t>(kNumObjects / 2 * kObjectSize), freed.bytes);
+  EXPECT_EQ(kNumObjects / 2, los->GetObjectsAllocated());
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    // The live bits of the swept objects are cleared, since the bitmaps are not swapped.
+    EXPECT_EQ(i % 2 == 0, los->GetLiveBitmap()->Test(objects[i]));
+    if (i % 2 == 0) {
+      los->Free(self, objects[i]);
+    }
+  }
+  EXPECT_EQ(0U, los->GetBytesAllocated());
+}
+
 TEST_F(LargeObjectSpaceTest, LargeObjectTest) {
   LargeObjectTest();
 }
@@ -183,6 +315,14 @@ TEST_F(LargeObjectSpaceTest, RaceTest) {
   RaceTest();
 }
 
+TEST_F(LargeObjectSpaceTest, FragmentationBenchmark) {
+  FragmentationBenchmark();
+}
+
+TEST_F(LargeObjectSpaceTest, ParallelSweepTest) {
+  ParallelSweepTest();
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -16,14 +16,20 @@
 
 #include "space.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include <android-base/logging.h>
 
+#include "base/bit_utils.h"
 #include "base/macros.h"
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
 #include "runtime.h"
 #include "thread-current-inl.h"
+#include "thread_pool.h"
 
 namespace art HIDDEN {
 namespace gc {
@@ -87,22 +93,28 @@ DiscontinuousSpace::DiscontinuousSpace(const std::string& name,
   CHECK(mark_bitmap_.IsValid());
 }
 
-collector::ObjectBytePair ContinuousMemMapAllocSpace::Sweep(bool swap_bitmaps) {
+collector::ObjectBytePair ContinuousMemMapAllocSpace::Sweep(bool swap_bitmaps,
+                                                           ThreadPool* thread_pool,
+                                                           size_t thread_count) {
   accounting::ContinuousSpaceBitmap* live_bitmap = GetLiveBitmap();
   accounting::ContinuousSpaceBitmap* mark_bitmap = GetMarkBitmap();
   // If the bitmaps are bound then sweeping this space clearly won't do anything.
   if (live_bitmap == mark_bitmap) {
     return collector::ObjectBytePair(0, 0);
   }
-  SweepCallbackContext scc(swap_bitmaps, this);
   if (swap_bitmaps) {
     std::swap(live_bitmap, mark_bitmap);
   }
   // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
-  accounting::ContinuousSpaceBitmap::SweepWalk(
-      *live_bitmap, *mark_bitmap, reinterpret_cast<uintptr_t>(Begin()),
-      reinterpret_cast<uintptr_t>(End()), GetSweepCallback(), reinterpret_cast<void*>(&scc));
-  return scc.freed;
+  return SweepRange(this,
+                    *live_bitmap,
+                    *mark_bitmap,
+                    reinterpret_cast<uintptr_t>(Begin()),
+                    reinterpret_cast<uintptr_t>(End()),
+                    GetSweepCallback(),
+                    swap_bitmaps,
+                    thread_pool,
+                    thread_count);
 }
 
 void ContinuousMemMapAllocSpace::BindLiveToMarkBitmap() {
@@ -133,10 +145,141 @@ void ContinuousMemMapAllocSpace::SwapBitmaps() {
   mark_bitmap_.SetName(temp_name);
 }
 
-AllocSpace::SweepCallbackContext::SweepCallbackContext(bool swap_bitmaps_in, space::Space* space_in)
-    : swap_bitmaps(swap_bitmaps_in), space(space_in), self(Thread::Current()) {
+AllocSpace::SweepCallbackContext::SweepCallbackContext(bool swap_bitmaps_in,
+                                                       space::Space* space_in,
+                                                       bool on_thread_pool_in)
+    : swap_bitmaps(swap_bitmaps_in),
+      space(space_in),
+      self(Thread::Current()),
+      on_thread_pool(on_thread_pool_in) {
 }
 
+template <size_t kAlignment>
+class AllocSpace::SweepTask final : public Task {
+ public:
+  SweepTask(space::Space* space,
+            const accounting::SpaceBitmap<kAlignment>* live_bitmap,
+            const accounting::SpaceBitmap<kAlignment>* mark_bitmap,
+            uintptr_t sweep_begin,
+            uintptr_t sweep_end,
+            accounting::ContinuousSpaceBitmap::SweepCallback* callback,
+            bool swap_bitmaps,
+            collector::ObjectBytePair* freed)
+      : space_(space),
+        live_bitmap_(live_bitmap),
+        mark_bitmap_(mark_bitmap),
+        sweep_begin_(sweep_begin),
+        sweep_end_(sweep_end),
+        callback_(callback),
+        swap_bitmaps_(swap_bitmaps),
+        freed_(freed) {}
+
+  // The GC thread waiting for the task holds the heap bitmap lock.
+  void Run([[maybe_unused]] Thread* self) override NO_THREAD_SAFETY_ANALYSIS {
+    SweepCallbackContext scc(swap_bitmaps_, space_, /*on_thread_pool=*/ true);
+    accounting::SpaceBitmap<kAlignment>::SweepWalk(
+        *live_bitmap_, *mark_bitmap_, sweep_begin_, sweep_end_, callback_, &scc);
+    *freed_ = scc.freed;
+  }
+
+  void Finalize() override {
+    delete this;
+  }
+
+ private:
+  space::Space* const space_;
+  const accounting::SpaceBitmap<kAlignment>* const live_bitmap_;
+  const accounting::SpaceBitmap<kAlignment>* const mark_bitmap_;
+  const uintptr_t sweep_begin_;
+  const uintptr_t sweep_end_;
+  accounting::ContinuousSpaceBitmap::SweepCallback* const callback_;
+  const bool swap_bitmaps_;
+  collector::ObjectBytePair* const freed_;
+};
+
+template <size_t kAlignment>
+collector::ObjectBytePair AllocSpace::SweepRange(
+    space::Space* space,
+    const accounting::SpaceBitmap<kAlignment>& live_bitmap,
+    const accounting::SpaceBitmap<kAlignment>& mark_bitmap,
+    uintptr_t sweep_begin,
+    uintptr_t sweep_end,
+    accounting::ContinuousSpaceBitmap::SweepCallback* callback,
+    bool swap_bitmaps,
+    ThreadPool* thread_pool,
+    size_t thread_count) {
+  // Split the range in slices ending on bitmap word boundaries.
+  std::vector<std::pair<uintptr_t, uintptr_t>> slices;
+  if (thread_pool != nullptr && thread_count > 1u && sweep_begin < sweep_end) {
+    constexpr size_t kWordBytes = kAlignment * kBitsPerIntPtrT;
+    const uintptr_t heap_begin = live_bitmap.HeapBegin();
+    const size_t slice_size =
+        std::max(RoundUp((sweep_end - sweep_begin) / thread_count, kWordBytes),
+                 RoundUp(kMinSweepSliceBytes, kWordBytes));
+    for (uintptr_t begin = sweep_begin; begin < sweep_end;) {
+      uintptr_t end = heap_begin + RoundUp(begin - heap_begin + slice_size, kWordBytes);
+      slices.emplace_back(begin, std::min(end, sweep_end));
+      begin = end;
+    }
+  } else {
+    slices.emplace_back(sweep_begin, sweep_end);
+  }
+  std::vector<collector::ObjectBytePair> freed(slices.size());
+  Thread* self = Thread::Current();
+  const bool parallel = slices.size() > 1u;
+  if (parallel) {
+    for (size_t i = 1; i < slices.size(); ++i) {
+      thread_pool->AddTask(self,
+                           new SweepTask<kAlignment>(space,
+                                                     &live_bitmap,
+                                                     &mark_bitmap,
+                                                     slices[i].first,
+                                                     slices[i].second,
+                                                     callback,
+                                                     swap_bitmaps,
+                                                     &freed[i]));
+    }
+    thread_pool->SetMaxActiveWorkers(std::min(slices.size() - 1, thread_pool->GetThreadCount()));
+    thread_pool->StartWorkers(self);
+  }
+  {
+    SweepCallbackContext scc(swap_bitmaps, space);
+    accounting::SpaceBitmap<kAlignment>::SweepWalk(
+        live_bitmap, mark_bitmap, slices[0].first, slices[0].second, callback, &scc);
+    freed[0] = scc.freed;
+  }
+  if (parallel) {
+    thread_pool->Wait(self, /*do_work=*/ true, /*may_hold_locks=*/ true);
+    thread_pool->StopWorkers(self);
+  }
+  collector::ObjectBytePair total;
+  for (const collector::ObjectBytePair& slice_freed : freed) {
+    total.Add(slice_freed);
+  }
+  return total;
+}
+
+template collector::ObjectBytePair AllocSpace::SweepRange<kObjectAlignment>(
+    space::Space* space,
+    const accounting::ContinuousSpaceBitmap& live_bitmap,
+    const accounting::ContinuousSpaceBitmap& mark_bitmap,
+    uintptr_t sweep_begin,
+    uintptr_t sweep_end,
+    accounting::ContinuousSpaceBitmap::SweepCallback* callback,
+    bool swap_bitmaps,
+    ThreadPool* thread_pool,
+    size_t thread_count);
+template collector::ObjectBytePair AllocSpace::SweepRange<kMinPageSize>(
+    space::Space* space,
+    const accounting::LargeObjectBitmap& live_bitmap,
+    const accounting::LargeObjectBitmap& mark_bitmap,
+    uintptr_t sweep_begin,
+    uintptr_t sweep_end,
+    accounting::ContinuousSpaceBitmap::SweepCallback* callback,
+    bool swap_bitmaps,
+    ThreadPool* thread_pool,
+    size_t thread_count);
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -33,6 +33,8 @@ namespace mirror {
 class Object;
 }  // namespace mirror
 
+class ThreadPool;
+
 namespace gc {
 
 class Heap;
@@ -250,13 +252,37 @@ class AllocSpace {
 
  protected:
   struct SweepCallbackContext {
-    SweepCallbackContext(bool swap_bitmaps, space::Space* space);
+    SweepCallbackContext(bool swap_bitmaps, space::Space* space, bool on_thread_pool = false);
     const bool swap_bitmaps;
     space::Space* const space;
     Thread* const self;
+    // True if `self` sweeps a slice of the space for the GC thread, which holds the heap bitmap
+    // lock on its behalf.
+    const bool on_thread_pool;
     collector::ObjectBytePair freed;
   };
 
+  template <size_t kAlignment> class SweepTask;
+
+  // Minimum number of bytes of a space swept by one thread.
+  static constexpr size_t kMinSweepSliceBytes = 1 * MB;
+
+  // Sweeps the objects of `space` in [sweep_begin, sweep_end) that are live but not marked with
+  // `callback`. With a thread pool and a `thread_count` above one, the range is split into up to
+  // `thread_count` slices which are swept in parallel by the calling thread and the pool workers.
+  // The slices are aligned to bitmap words so that no two threads clear bits of the same word.
+  template <size_t kAlignment>
+  static collector::ObjectBytePair SweepRange(
+      space::Space* space,
+      const accounting::SpaceBitmap<kAlignment>& live_bitmap,
+      const accounting::SpaceBitmap<kAlignment>& mark_bitmap,
+      uintptr_t sweep_begin,
+      uintptr_t sweep_end,
+      accounting::ContinuousSpaceBitmap::SweepCallback* callback,
+      bool swap_bitmaps,
+      ThreadPool* thread_pool,
+      size_t thread_count);
+
   AllocSpace() {}
   virtual ~AllocSpace() {}
 
@@ -451,7 +477,10 @@ class ContinuousMemMapAllocSpace : public MemMapSpace, public AllocSpace {
     return &temp_bitmap_;
   }
 
-  collector::ObjectBytePair Sweep(bool swap_bitmaps);
+  // Sweeps the space, in parallel on `thread_pool` if `thread_count` is above one.
+  collector::ObjectBytePair Sweep(bool swap_bitmaps,
+                                  ThreadPool* thread_pool = nullptr,
+                                  size_t thread_count = 1u);
   virtual accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() = 0;
 
  protected:
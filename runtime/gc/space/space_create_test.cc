@@ -16,9 +16,15 @@
 
 #include "space_test.h"
 
+#include <memory>
+#include <vector>
+
+#include "base/time_utils.h"
 #include "dlmalloc_space.h"
+#include "gc/accounting/space_bitmap-inl.h"
 #include "rosalloc_space.h"
 #include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
 
 namespace art HIDDEN {
 namespace gc {
@@ -349,6 +355,75 @@ TEST_P(SpaceCreateTest, AllocAndFreeListTestBody) {
   space->FreeList(self, arraysize(lots_of_objects), lots_of_objects);
 }
 
+// Sweeps the same heap on the GC thread only and on a thread pool. The workers free their slices
+// through the same space lock, so the log shows whether the parallel sweep pays off.
+TEST_P(SpaceCreateTest, ParallelSweepTestBody) {
+  static constexpr size_t kNumObjects = 64 * 1024;
+  static constexpr size_t kObjectSize = 256;
+  MallocSpace* space(CreateSpace("test", 32 * MB, 64 * MB, 64 * MB));
+  ASSERT_TRUE(space != nullptr);
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  std::unique_ptr<ThreadPool> thread_pool(ThreadPool::Create("Sweep test thread pool", 3));
+  accounting::ContinuousSpaceBitmap* live_bitmap = space->GetLiveBitmap();
+  accounting::ContinuousSpaceBitmap* mark_bitmap = space->GetMarkBitmap();
+
+  std::vector<mirror::Object*> objects(kNumObjects);
+  int64_t freed_bytes[2] = {0, 0};
+  for (size_t round = 0; round != 2u; ++round) {
+    const bool parallel = round == 1u;
+    size_t expected_objects = 0;
+    int64_t expected_bytes = 0;
+    for (size_t i = 0; i < kNumObjects; ++i) {
+      size_t allocation_size, usable_size, bytes_tl_bulk_allocated;
+      objects[i] = AllocWithGrowth(space,
+                                   self,
+                                   kObjectSize,
+                                   &allocation_size,
+                                   &usable_size,
+                                   &bytes_tl_bulk_allocated);
+      ASSERT_TRUE(objects[i] != nullptr);
+      live_bitmap->Set(objects[i]);
+      // Keep every third object.
+      if (i % 3 == 0) {
+        mark_bitmap->Set(objects[i]);
+      } else {
+        ++expected_objects;
+        expected_bytes += space->AllocationSize(objects[i], nullptr);
+      }
+    }
+
+    collector::ObjectBytePair freed;
+    const uint64_t start_ns = NanoTime();
+    {
+      WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+      freed = space->Sweep(/*swap_bitmaps=*/ false,
+                           parallel ? thread_pool.get() : nullptr,
+                           /*thread_count=*/ parallel ? 4u : 1u);
+    }
+    const uint64_t duration_ns = NanoTime() - start_ns;
+    LOG(INFO) << space->GetName() << (parallel ? " parallel" : " serial") << " sweep of "
+              << expected_objects << " objects in " << PrettyDuration(duration_ns);
+    EXPECT_EQ(expected_objects, freed.objects) << round;
+    EXPECT_EQ(expected_bytes, freed.bytes) << round;
+    freed_bytes[round] = freed.bytes;
+
+    for (size_t i = 0; i < kNumObjects; ++i) {
+      // The live bits of the swept objects are cleared, since the bitmaps are not swapped.
+      EXPECT_EQ(i % 3 == 0, live_bitmap->Test(objects[i])) << round << " " << i;
+      if (i % 3 == 0) {
+        live_bitmap->Clear(objects[i]);
+        mark_bitmap->Clear(objects[i]);
+        space->Free(self, objects[i]);
+      }
+    }
+  }
+  EXPECT_EQ(freed_bytes[0], freed_bytes[1]);
+}
+
 INSTANTIATE_TEST_CASE_P(CreateRosAllocSpace,
                         SpaceCreateTest,
                         testing::Values(kMallocSpaceRosAlloc));
@@ -27,13 +27,18 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <set>
+#include <thread>
 
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
@@ -41,6 +46,7 @@
 #include "art_field-inl.h"
 #include "art_method-inl.h"
 #include "base/array_ref.h"
+#include "base/fast_exit.h"
 #include "base/file_utils.h"
 #include "base/logging.h"
 #include "base/macros.h"
@@ -67,6 +73,7 @@
 #include "runtime_globals.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 
 namespace art HIDDEN {
 
@@ -80,6 +87,16 @@ static constexpr uint32_t kHprofNullThread = 0;
 static constexpr size_t kMaxObjectsPerSegment = 128;
 static constexpr size_t kMaxBytesPerSegment = 4096;
 
+// Limits for the batches of objects serialized by one task of a parallel dump.
+static constexpr size_t kMaxObjectsPerTask = 16 * KB;
+static constexpr size_t kMaxObjectBytesPerTask = 1 * MB;
+
+// Upper bound for the number of threads of a parallel dump, including the dumping thread.
+static constexpr size_t kMaxParallelDumpThreads = 8;
+
+// Time after which the child process of a forked dump is killed.
+static constexpr time_t kForkedDumpTimeoutSec = 300;
+
 // The static field-name for the synthetic object generated to account for class static overhead.
 static constexpr const char* kClassOverheadName = "$classOverhead";
 
@@ -126,7 +143,7 @@ enum HprofHeapTag {
   HPROF_ROOT_VM_INTERNAL = 0x8d,
   HPROF_ROOT_JNI_MONITOR = 0x8e,
   HPROF_UNREACHABLE = 0x90,  // Obsolete.
-  HPROF_PRIMITIVE_ARRAY_NODATA_DUMP = 0xc3,  // Obsolete.
+  HPROF_PRIMITIVE_ARRAY_NODATA_DUMP = 0xc3,  // Only when omitting primitive array contents.
 };
 
 enum HprofHeapId {
@@ -429,14 +446,23 @@ class VectorEndianOuputput final : public EndianOutputBuffered {
 
 class Hprof : public SingleRootVisitor {
  public:
-  Hprof(const char* output_filename, int fd, bool direct_to_ddms)
+  Hprof(const char* output_filename, int fd, bool direct_to_ddms, bool omit_primitive_arrays)
       : filename_(output_filename),
         fd_(fd),
-        direct_to_ddms_(direct_to_ddms) {
+        direct_to_ddms_(direct_to_ddms),
+        omit_primitive_arrays_(omit_primitive_arrays),
+        parent_(nullptr) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
   }
 
-  void Dump()
+  // Called in the child process of a forked dump, see `ForkAndDumpHeap()`.
+  void SetInForkedChild() {
+    in_forked_child_ = true;
+  }
+
+  // If `thread_pool` is not null, a dump to a file serializes the heap objects in parallel.
+  // Returns whether the dump was written completely.
+  bool Dump(ThreadPool* thread_pool)
     REQUIRES(Locks::mutator_lock_)
     REQUIRES(!Locks::heap_bitmap_lock_, !Locks::alloc_tracker_lock_) {
     {
@@ -446,6 +472,15 @@ class Hprof : public SingleRootVisitor {
       }
     }
 
+    if (thread_pool != nullptr && !direct_to_ddms_) {
+      size_t size;
+      if (!DumpToFileParallel(thread_pool, &size)) {
+        return false;
+      }
+      LogCompletion(size);
+      return true;
+    }
+
     // First pass to measure the size of the dump.
     size_t overall_size;
     size_t max_length;
@@ -471,15 +506,81 @@ class Hprof : public SingleRootVisitor {
     }
 
     if (okay) {
-      const uint64_t duration = NanoTime() - start_ns_;
-      LOG(INFO) << "hprof: heap dump completed (" << PrettySize(RoundUp(overall_size, KB))
-                << ") in " << PrettyDuration(duration)
-                << " objects " << total_objects_
-                << " objects with stack traces " << total_objects_with_stack_trace_;
+      LogCompletion(overall_size);
     }
+    return okay;
   }
 
  private:
+  // A batch of heap objects of a parallel dump. The task serializes the objects into heap dump
+  // segments of its own, using the string, class and stack trace tables of the dump.
+  class DumpObjectsTask final : public Task {
+   public:
+    explicit DumpObjectsTask(const Hprof* hprof) : hprof_(hprof), object_bytes_(0u) {}
+
+    void AddObject(mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      objects_.push_back(obj);
+      object_bytes_ += obj->SizeOf();
+    }
+
+    bool IsFull() const {
+      return objects_.size() >= kMaxObjectsPerTask || object_bytes_ >= kMaxObjectBytesPerTask;
+    }
+
+    // The dumping thread holds the mutator lock exclusively until all tasks have finished.
+    void Run([[maybe_unused]] Thread* self) override NO_THREAD_SAFETY_ANALYSIS {
+      VectorEndianOuputput output(data_, kMaxBytesPerSegment);
+      Hprof writer(hprof_, &output);
+      output.StartNewRecord(HPROF_TAG_HEAP_DUMP_SEGMENT, kHprofTime);
+      for (mirror::Object* obj : objects_) {
+        writer.DumpHeapObject(obj);
+      }
+      output.EndRecord();
+      number_of_dumped_objects_ = writer.total_objects_;
+      new_strings_ = std::move(writer.strings_);
+    }
+
+    const std::vector<uint8_t>& GetData() const {
+      return data_;
+    }
+
+    // Strings used by the data that are not in the string table of the dump.
+    const SafeMap<std::string, HprofStringId>& GetNewStrings() const {
+      return new_strings_;
+    }
+
+    size_t GetNumberOfDumpedObjects() const {
+      return number_of_dumped_objects_;
+    }
+
+   private:
+    const Hprof* const hprof_;
+    std::vector<mirror::Object*> objects_;
+    size_t object_bytes_;
+    std::vector<uint8_t> data_;
+    size_t number_of_dumped_objects_ = 0u;
+    SafeMap<std::string, HprofStringId> new_strings_;
+  };
+
+  // Constructor for the writers of `DumpObjectsTask`. They write to `output` and only read the
+  // tables of `parent`, which must be complete, see `PrepareTablesForParallelDump()`.
+  Hprof(const Hprof* parent, EndianOutput* output)
+      : filename_(parent->filename_),
+        fd_(-1),
+        direct_to_ddms_(false),
+        omit_primitive_arrays_(parent->omit_primitive_arrays_),
+        parent_(parent) {
+    output_ = output;
+  }
+
+  void LogCompletion(size_t size) {
+    const uint64_t duration = NanoTime() - start_ns_;
+    LOG(INFO) << "hprof: heap dump completed (" << PrettySize(RoundUp(size, KB))
+              << ") in " << PrettyDuration(duration)
+              << " objects " << total_objects_
+              << " objects with stack traces " << total_objects_with_stack_trace_;
+  }
+
   void DumpHeapObject(mirror::Object* obj)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -531,6 +632,93 @@ class Hprof : public SingleRootVisitor {
     output_->EndRecord();
   }
 
+  // A serial dump learns the strings and classes it needs from a first pass over the whole heap
+  // that only measures the output. For a parallel dump, the tables are built from the classes
+  // alone: every ID written for an object other than a class comes from the object's class or
+  // its superclasses, and the names of the heaps. Once this is done, the tables are only read.
+  void PrepareTablesForParallelDump() REQUIRES(Locks::mutator_lock_) {
+    EndianOutput count_output;
+    output_ = &count_output;
+    LookupStringId("app");
+    LookupStringId("zygote");
+    LookupStringId("image");
+    LookupStringId("<ILLEGAL>");
+    auto add_class = [this](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      if (obj->IsClass() && !obj->AsClass()->IsRetired()) {
+        DumpHeapClass(obj->AsClass().Ptr());
+      }
+    };
+    Runtime::Current()->GetHeap()->VisitObjectsPaused(add_class);
+    // Writing the stack traces adds the names of their methods and source files.
+    ProcessHeader(/*string_first=*/ false);
+    output_ = nullptr;
+  }
+
+  void ProcessBodyParallel(ThreadPool* thread_pool) REQUIRES(Locks::mutator_lock_) {
+    Thread* const self = Thread::Current();
+    Runtime* const runtime = Runtime::Current();
+    current_heap_ = HPROF_HEAP_DEFAULT;
+    objects_in_segment_ = 0;
+
+    // Write the roots directly.
+    output_->StartNewRecord(HPROF_TAG_HEAP_DUMP_SEGMENT, kHprofTime);
+    simple_roots_.clear();
+    runtime->VisitRoots(this);
+    runtime->VisitImageRoots(this);
+    output_->EndRecord();
+
+    // Collect the objects in batches while walking the heap. Once there are enough batches for
+    // all threads, serialize them in parallel and write them out before continuing the walk, so
+    // that no more than one round of batches is buffered at any time.
+    const size_t max_tasks_per_round = 2u * (thread_pool->GetThreadCount() + 1u);
+    std::vector<std::unique_ptr<DumpObjectsTask>> round;
+    auto run_round = [&]() REQUIRES(Locks::mutator_lock_) {
+      for (const std::unique_ptr<DumpObjectsTask>& task : round) {
+        thread_pool->AddTask(self, task.get());
+      }
+      thread_pool->Wait(self, /*do_work=*/ true, /*may_hold_locks=*/ true);
+      for (const std::unique_ptr<DumpObjectsTask>& task : round) {
+        // The strings a task had to add must precede the records that use them. Keep them for
+        // the next rounds. Another task may have added the same string with another ID, the
+        // records of both IDs are written.
+        WriteStrings(task->GetNewStrings());
+        output_->EndRecord();
+        for (const auto& p : task->GetNewStrings()) {
+          if (strings_.find(p.first) == strings_.end()) {
+            strings_.Put(p.first, p.second);
+          }
+        }
+        // The data holds complete records. Outside of a record, the output writes it verbatim.
+        const std::vector<uint8_t>& data = task->GetData();
+        output_->AddU1List(data.data(), data.size());
+        output_->EndRecord();
+        total_objects_ += task->GetNumberOfDumpedObjects();
+      }
+      round.clear();
+    };
+    std::unique_ptr<DumpObjectsTask> task;
+    auto add_object = [&](mirror::Object* obj) REQUIRES(Locks::mutator_lock_) {
+      if (task == nullptr) {
+        task.reset(new DumpObjectsTask(this));
+      }
+      task->AddObject(obj);
+      if (task->IsFull()) {
+        round.push_back(std::move(task));
+        if (round.size() == max_tasks_per_round) {
+          run_round();
+        }
+      }
+    };
+    runtime->GetHeap()->VisitObjectsPaused(add_object);
+    if (task != nullptr) {
+      round.push_back(std::move(task));
+    }
+    run_round();
+
+    output_->StartNewRecord(HPROF_TAG_HEAP_DUMP_END, kHprofTime);
+    output_->EndRecord();
+  }
+
   void ProcessHeader(bool string_first) REQUIRES(Locks::mutator_lock_) {
     // Write the header.
     WriteFixedHeader();
@@ -569,7 +757,11 @@ class Hprof : public SingleRootVisitor {
   }
 
   void WriteStringTable() {
-    for (const auto& p : strings_) {
+    WriteStrings(strings_);
+  }
+
+  void WriteStrings(const SafeMap<std::string, HprofStringId>& strings) {
+    for (const auto& p : strings) {
       const std::string& string = p.first;
       const HprofStringId id = p.second;
 
@@ -604,7 +796,9 @@ class Hprof : public SingleRootVisitor {
                       uint32_t thread_serial);
 
   HprofClassObjectId LookupClassId(mirror::Class* c) REQUIRES_SHARED(Locks::mutator_lock_) {
-    if (c != nullptr) {
+    if (parent_ != nullptr) {
+      DCHECK(c == nullptr || parent_->classes_.find(c) != parent_->classes_.end());
+    } else if (c != nullptr) {
       auto it = classes_.find(c);
       if (it == classes_.end()) {
         // first time to see this class
@@ -619,13 +813,14 @@ class Hprof : public SingleRootVisitor {
 
   HprofStackTraceSerialNumber LookupStackTraceSerialNumber(const mirror::Object* obj)
       REQUIRES_SHARED(Locks::mutator_lock_) {
-    auto r = allocation_records_.find(obj);
-    if (r == allocation_records_.end()) {
+    const Hprof* tables = (parent_ != nullptr) ? parent_ : this;
+    auto r = tables->allocation_records_.find(obj);
+    if (r == tables->allocation_records_.end()) {
       return kHprofNullStackTrace;
     } else {
       const gc::AllocRecordStackTrace* trace = r->second;
-      auto result = traces_.find(trace);
-      CHECK(result != traces_.end());
+      auto result = tables->traces_.find(trace);
+      CHECK(result != tables->traces_.end());
       return result->second;
     }
   }
@@ -639,11 +834,21 @@ class Hprof : public SingleRootVisitor {
   }
 
   HprofStringId LookupStringId(const std::string& string) {
+    if (parent_ != nullptr) {
+      // The string table has already been written. Strings missing from it, if any, are
+      // collected in the writer's own table and written before its records, see
+      // `ProcessBodyParallel()`. Their IDs come from the dump, so they stay unique.
+      auto it = parent_->strings_.find(string);
+      if (it != parent_->strings_.end()) {
+        return it->second;
+      }
+    }
     auto it = strings_.find(string);
     if (it != strings_.end()) {
       return it->second;
     }
-    HprofStringId id = next_string_id_++;
+    const Hprof* tables = (parent_ != nullptr) ? parent_ : this;
+    HprofStringId id = tables->next_string_id_.fetch_add(1u, std::memory_order_relaxed);
     strings_.Put(string, id);
     return id;
   }
@@ -751,26 +956,63 @@ class Hprof : public SingleRootVisitor {
     //        Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
   }
 
-  bool DumpToFile(size_t overall_size, size_t max_length)
-      REQUIRES(Locks::mutator_lock_) {
+  void ReportError(const std::string& msg) REQUIRES(Locks::mutator_lock_) {
+    if (in_forked_child_) {
+      // Allocating the exception could wait for a GC that never happens in the child. The
+      // parent reports the failure from the exit status of the child.
+      LOG(ERROR) << "hprof: " << msg;
+    } else {
+      ThrowRuntimeException("%s", msg.c_str());
+    }
+  }
+
+  std::unique_ptr<File> OpenOutputFile() REQUIRES(Locks::mutator_lock_) {
     // Where exactly are we writing to?
     int out_fd;
     if (fd_ >= 0) {
       out_fd = DupCloexec(fd_);
       if (out_fd < 0) {
-        ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
-        return false;
+        ReportError(android::base::StringPrintf("Couldn't dump heap; dup(%d) failed: %s",
+                                                fd_,
+                                                strerror(errno)));
+        return nullptr;
       }
     } else {
       out_fd = open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
       if (out_fd < 0) {
-        ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
-                              strerror(errno));
-        return false;
+        ReportError(android::base::StringPrintf("Couldn't dump heap; open(\"%s\") failed: %s",
+                                                filename_.c_str(),
+                                                strerror(errno)));
+        return nullptr;
       }
     }
+    return std::make_unique<File>(out_fd, filename_, true);
+  }
 
-    std::unique_ptr<File> file(new File(out_fd, filename_, true));
+  bool CloseOutputFile(std::unique_ptr<File> file, bool okay) REQUIRES(Locks::mutator_lock_) {
+    if (okay) {
+      okay = file->FlushCloseOrErase() == 0;
+    } else {
+      file->Erase();
+    }
+    if (!okay) {
+      std::string msg(android::base::StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                                  filename_.c_str(),
+                                                  strerror(errno)));
+      ReportError(msg);
+      if (!in_forked_child_) {
+        LOG(ERROR) << msg;
+      }
+    }
+    return okay;
+  }
+
+  bool DumpToFile(size_t overall_size, size_t max_length)
+      REQUIRES(Locks::mutator_lock_) {
+    std::unique_ptr<File> file = OpenOutputFile();
+    if (file == nullptr) {
+      return false;
+    }
     bool okay;
     {
       FileEndianOutput file_output(file.get(), max_length);
@@ -786,20 +1028,29 @@ class Hprof : public SingleRootVisitor {
       output_ = nullptr;
     }
 
-    if (okay) {
-      okay = file->FlushCloseOrErase() == 0;
-    } else {
-      file->Erase();
+    return CloseOutputFile(std::move(file), okay);
+  }
+
+  // Writes the header and the roots, then streams the objects serialized by the workers.
+  // Unlike `DumpToFile()`, this does not measure the output in a separate pass first.
+  bool DumpToFileParallel(ThreadPool* thread_pool, /*out*/ size_t* size)
+      REQUIRES(Locks::mutator_lock_) {
+    std::unique_ptr<File> file = OpenOutputFile();
+    if (file == nullptr) {
+      return false;
     }
-    if (!okay) {
-      std::string msg(android::base::StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                                  filename_.c_str(),
-                                                  strerror(errno)));
-      ThrowRuntimeException("%s", msg.c_str());
-      LOG(ERROR) << msg;
+    PrepareTablesForParallelDump();
+    bool okay;
+    {
+      FileEndianOutput file_output(file.get(), kMaxBytesPerSegment);
+      output_ = &file_output;
+      ProcessHeader(/*string_first=*/ true);
+      ProcessBodyParallel(thread_pool);
+      okay = !file_output.Errors();
+      *size = file_output.SumLength();
+      output_ = nullptr;
     }
-
-    return okay;
+    return CloseOutputFile(std::move(file), okay);
   }
 
   bool DumpToDdmsDirect(size_t overall_size, size_t max_length, uint32_t chunk_type)
@@ -872,6 +1123,15 @@ class Hprof : public SingleRootVisitor {
   int fd_;
   bool direct_to_ddms_;
 
+  // Whether to write primitive arrays without their contents.
+  const bool omit_primitive_arrays_;
+
+  // For the writers of a parallel dump, the dump that owns the tables.
+  const Hprof* const parent_;
+
+  // Whether this is the child process of a forked dump.
+  bool in_forked_child_ = false;
+
   uint64_t start_ns_ = NanoTime();
 
   EndianOutput* output_ = nullptr;
@@ -882,7 +1142,8 @@ class Hprof : public SingleRootVisitor {
   size_t total_objects_ = 0u;
   size_t total_objects_with_stack_trace_ = 0u;
 
-  HprofStringId next_string_id_ = 0x400000;
+  // Shared by the writers of a parallel dump.
+  mutable std::atomic<HprofStringId> next_string_id_{0x400000};
   SafeMap<std::string, HprofStringId> strings_;
   HprofClassSerialNumber next_class_serial_number_ = 1;
   SafeMap<mirror::Class*, HprofClassSerialNumber> classes_;
@@ -986,7 +1247,11 @@ void Hprof::MarkRootObject(const mirror::Object* obj, jobject jni_obj, HprofHeap
     case HPROF_ROOT_DEBUGGER:
     case HPROF_ROOT_VM_INTERNAL: {
       uint64_t key = (static_cast<uint64_t>(heap_tag) << 32) | PointerToLowMemUInt32(obj);
-      if (simple_roots_.insert(key).second) {
+      // The writers of a parallel dump see each object once, they only need to skip the roots
+      // already written by the parent.
+      bool is_new_root = (parent_ != nullptr) ? parent_->simple_roots_.count(key) == 0u
+                                              : simple_roots_.insert(key).second;
+      if (is_new_root) {
         __ AddU1(heap_tag);
         __ AddObjectId(obj);
       }
@@ -1231,13 +1496,16 @@ void Hprof::DumpHeapClass(mirror::Class* klass) {
   if (java_heap_overhead_size > 4) {
     // Create a byte array to reflect the allocation of the
     // StaticField array at the end of this class.
-    __ AddU1(HPROF_PRIMITIVE_ARRAY_DUMP);
+    __ AddU1(omit_primitive_arrays_ ? HPROF_PRIMITIVE_ARRAY_NODATA_DUMP
+                                    : HPROF_PRIMITIVE_ARRAY_DUMP);
     __ AddClassStaticsId(klass);
     __ AddStackTraceSerialNumber(LookupStackTraceSerialNumber(klass));
     __ AddU4(java_heap_overhead_size - 4);
     __ AddU1(hprof_basic_byte);
-    for (size_t i = 0; i < java_heap_overhead_size - 4; ++i) {
-      __ AddU1(0);
+    if (!omit_primitive_arrays_) {
+      for (size_t i = 0; i < java_heap_overhead_size - 4; ++i) {
+        __ AddU1(0);
+      }
     }
   }
   const size_t java_heap_overhead_field_count = java_heap_overhead_size > 0
@@ -1447,7 +1715,8 @@ void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass) {
         Primitive::Descriptor(klass->GetComponentType()->GetPrimitiveType()), &size);
 
     // obj is a primitive array.
-    __ AddU1(HPROF_PRIMITIVE_ARRAY_DUMP);
+    __ AddU1(omit_primitive_arrays_ ? HPROF_PRIMITIVE_ARRAY_NODATA_DUMP
+                                    : HPROF_PRIMITIVE_ARRAY_DUMP);
 
     __ AddObjectId(obj);
     __ AddStackTraceSerialNumber(LookupStackTraceSerialNumber(obj));
@@ -1455,7 +1724,9 @@ void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass) {
     __ AddU1(t);
 
     // Dump the raw, packed element values.
-    if (size == 1) {
+    if (omit_primitive_arrays_) {
+      // Keep only the length and type, so the size of the array is still accounted for.
+    } else if (size == 1) {
       __ AddU1List(reinterpret_cast<const uint8_t*>(obj->GetRawData(sizeof(uint8_t), 0)), length);
     } else if (size == 2) {
       __ AddU2List(reinterpret_cast<const uint16_t*>(obj->GetRawData(sizeof(uint16_t), 0)), length);
@@ -1596,21 +1867,158 @@ void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
   MarkRootObject(obj, nullptr, xlate[info.GetType()], info.GetThreadId());
 }
 
+// Kills the calling process if it is still running after `kForkedDumpTimeoutSec`. Used in the
+// child of a forked dump, which could block forever on a lock that was held by another thread
+// of the parent at the time of the fork.
+static void ArmForkedDumpWatchdogOrDie() {
+  timer_t timer_id{};
+  struct sigevent sev {};
+  sev.sigev_notify = SIGEV_SIGNAL;
+  sev.sigev_signo = SIGKILL;
+  if (timer_create(CLOCK_MONOTONIC, &sev, &timer_id) == -1) {
+    PLOG(FATAL) << "hprof: failed to create watchdog timer";
+  }
+  struct itimerspec its {};
+  its.it_value.tv_sec = kForkedDumpTimeoutSec;
+  if (timer_settime(timer_id, 0, &its, nullptr) == -1) {
+    PLOG(FATAL) << "hprof: failed to arm watchdog timer";
+  }
+}
+
+// Suspends all threads only for as long as it takes to fork, then writes the dump in the child
+// from its copy-on-write snapshot of the heap while the parent runs on. Returns the pid of the
+// child, or -1 with a pending exception if the fork failed.
+static pid_t ForkDumpProcess(Thread* self,
+                             const char* filename,
+                             int fd,
+                             bool omit_primitive_arrays) {
+  pid_t pid;
+  int fork_errno;
+  {
+    // As for a dump in the process, the GC must not run when the threads are suspended. Taking
+    // the critical section before the fork also keeps the child from waiting for a GC, as the
+    // GC thread does not exist in the child.
+    gc::ScopedGCCriticalSection gcs(self, gc::kGcCauseHprof, gc::kCollectorTypeHprof);
+    ScopedSuspendAll ssa(__FUNCTION__, /*long_suspend=*/ false);
+    pid = fork();
+    fork_errno = errno;
+    if (pid == 0) {
+      // Only the dumping thread exists in the child. It still holds the mutator lock exclusively
+      // and no other thread was runnable, so the heap is consistent. Locks held by threads in
+      // native code are never released here, the watchdog ends the child if it gets stuck on one.
+      ArmForkedDumpWatchdogOrDie();
+      Hprof hprof(filename, fd, /*direct_to_ddms=*/ false, omit_primitive_arrays);
+      hprof.SetInForkedChild();
+      bool okay = hprof.Dump(/*thread_pool=*/ nullptr);
+      // Do not run the destructors and `atexit` handlers of the parent.
+      FastExit(okay ? 0 : 1);
+    }
+  }
+  if (pid == -1) {
+    ScopedObjectAccess soa(self);
+    ThrowRuntimeException("Couldn't dump heap; fork failed: %s", strerror(fork_errno));
+  }
+  return pid;
+}
+
+// Waits for the dump process `pid`. Returns false if it did not write the dump completely. If
+// the app reaps its child processes itself, the outcome is unknown and this returns true.
+static bool WaitForDumpProcess(pid_t pid, /*out*/ std::string* error_msg) {
+  int status;
+  if (TEMP_FAILURE_RETRY(waitpid(pid, &status, 0)) == -1) {
+    // ECHILD if the app reaps its child processes itself.
+    PLOG(WARNING) << "hprof: waitpid for heap dump process " << pid;
+    return true;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    *error_msg =
+        android::base::StringPrintf("heap dump process %d failed with status 0x%x", pid, status);
+    return false;
+  }
+  return true;
+}
+
+// The calling thread waits for the child so that the dump is complete when this returns, but
+// it does not hold up the GC or the other threads in the meantime. If the child gets stuck, the
+// caller stays blocked until the watchdog kills the child after `kForkedDumpTimeoutSec`, and
+// then throws. See `DumpHeapAsync()` for a dump that does not block the caller.
+static void ForkAndDumpHeap(Thread* self, const char* filename, int fd, bool omit_primitive_arrays) {
+  pid_t pid = ForkDumpProcess(self, filename, fd, omit_primitive_arrays);
+  if (pid == -1) {
+    return;
+  }
+  std::string error_msg;
+  if (!WaitForDumpProcess(pid, &error_msg)) {
+    ScopedObjectAccess soa(self);
+    ThrowRuntimeException("Couldn't dump heap; %s", error_msg.c_str());
+  }
+}
+
+bool DumpHeapAsync(const char* filename,
+                   int fd,
+                   const DumpOptions& options,
+                   std::function<void(bool)>&& on_done) {
+  CHECK(filename != nullptr);
+  Thread* self = Thread::Current();
+  pid_t pid = ForkDumpProcess(self, filename, fd, options.omit_primitive_arrays);
+  if (pid == -1) {
+    return false;
+  }
+  // The waiter is not attached to the runtime, it only reaps the child.
+  std::thread waiter([pid, on_done = std::move(on_done)]() {
+    std::string error_msg;
+    bool okay = WaitForDumpProcess(pid, &error_msg);
+    if (!okay) {
+      LOG(ERROR) << "hprof: couldn't dump heap; " << error_msg;
+    }
+    if (on_done != nullptr) {
+      on_done(okay);
+    }
+  });
+  waiter.detach();
+  return true;
+}
+
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
 // Otherwise, "filename" is used to create an output file.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
+  Runtime* runtime = Runtime::Current();
+  DumpOptions options;
+  options.parallel = runtime->IsParallelHprofEnabled();
+  options.fork = runtime->IsForkHprofEnabled();
+  options.omit_primitive_arrays = runtime->IsHprofOmitPrimitiveArraysEnabled();
+  DumpHeap(filename, fd, direct_to_ddms, options);
+}
+
+void DumpHeap(const char* filename, int fd, bool direct_to_ddms, const DumpOptions& options) {
   CHECK(filename != nullptr);
   Thread* self = Thread::Current();
+  if (options.fork && !direct_to_ddms) {
+    ForkAndDumpHeap(self, filename, fd, options.omit_primitive_arrays);
+    return;
+  }
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (options.parallel && !direct_to_ddms) {
+    size_t num_threads = std::min<size_t>(std::thread::hardware_concurrency(),
+                                          kMaxParallelDumpThreads);
+    if (num_threads > 1u) {
+      // The dumping thread also runs tasks. Create the workers before suspending all threads
+      // as they need to attach to the runtime.
+      thread_pool.reset(ThreadPool::Create("Hprof thread pool", num_threads - 1u));
+      thread_pool->StartWorkers(self);
+      thread_pool->WaitForWorkersToBeCreated();
+    }
+  }
   // Need to take a heap dump while GC isn't running. See the comment in Heap::VisitObjects().
   // Also we need the critical section to avoid visiting the same object twice. See b/34967844
   gc::ScopedGCCriticalSection gcs(self,
                                   gc::kGcCauseHprof,
                                   gc::kCollectorTypeHprof);
   ScopedSuspendAll ssa(__FUNCTION__, true /* long suspend */);
-  Hprof hprof(filename, fd, direct_to_ddms);
-  hprof.Dump();
+  Hprof hprof(filename, fd, direct_to_ddms, options.omit_primitive_arrays);
+  hprof.Dump(thread_pool.get());
 }
 
 }  // namespace hprof
@@ -17,14 +17,45 @@
 #ifndef ART_RUNTIME_HPROF_HPROF_H_
 #define ART_RUNTIME_HPROF_HPROF_H_
 
+#include <functional>
+
 #include "base/macros.h"
 
 namespace art HIDDEN {
 
 namespace hprof {
 
+// How a heap dump to a file is written. Dumps sent to DDMS are always written serially in the
+// process.
+struct DumpOptions {
+  // Serialize the heap objects on a thread pool. The heap walk stays serial: the dumping thread
+  // visits the objects with `Heap::VisitObjectsPaused()` and hands them to the pool in batches.
+  bool parallel = false;
+  // Write the dump from a forked child process. The calling thread waits for the child, which
+  // is killed if it has not finished after 300 seconds. `DumpHeapAsync()` does not wait.
+  bool fork = false;
+  // Leave out the contents of primitive arrays.
+  bool omit_primitive_arrays = false;
+};
+
+// Dump the heap with the options given on the runtime command line.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms);
 
+EXPORT void DumpHeap(const char* filename,
+                     int fd,
+                     bool direct_to_ddms,
+                     const DumpOptions& options);
+
+// Dump the heap to a file from a forked child process, as with `DumpOptions::fork`, but return
+// as soon as the child is forked. A detached thread reaps the child and then calls `on_done`, if
+// not null, with whether the dump was written. `on_done` runs on a thread that is not attached
+// to the runtime. The `parallel` and `fork` options are ignored. Returns false, with a pending
+// exception, if the fork failed; `on_done` is not called then.
+EXPORT bool DumpHeapAsync(const char* filename,
+                          int fd,
+                          const DumpOptions& options,
+                          std::function<void(bool)>&& on_done);
+
 }  // namespace hprof
 
 }  // namespace art
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hprof.h"
+
+#include <future>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "android-base/file.h"
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "jni/java_vm_ext.h"
+#include "mirror/array-alloc-inl.h"
+#include "mirror/array-inl.h"
+#include "mirror/object_array-alloc-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string-alloc-inl.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art HIDDEN {
+namespace hprof {
+
+// The parts of an hprof file that do not depend on how it was written. A parallel dump splits
+// the objects into heap dump segments differently and assigns different IDs to the strings, so
+// the heap dump records are kept with the name of their heap and with the strings they refer to
+// instead of the string IDs.
+struct HprofContents {
+  std::set<std::string> classes;
+  std::set<std::string> roots;
+  std::multiset<std::string> objects;
+  // The contents of the primitive arrays, which `objects` records without their data.
+  std::multiset<std::string> primitive_array_data;
+  size_t num_primitive_arrays = 0u;
+  size_t num_primitive_arrays_without_data = 0u;
+};
+
+class HprofReader {
+ public:
+  explicit HprofReader(const std::string& data)
+      : data_(data), pos_(0u), ok_(true) {}
+
+  bool Parse(/*out*/ HprofContents* contents, /*out*/ std::string* error) {
+    static constexpr const char kMagic[] = "JAVA PROFILE 1.0.3";
+    if (data_.compare(0, sizeof(kMagic), std::string(kMagic, sizeof(kMagic))) != 0) {
+      *error = "Bad magic";
+      return false;
+    }
+    pos_ = sizeof(kMagic);
+    if (U4() != kIdSize) {
+      *error = "Unexpected ID size";
+      return false;
+    }
+    Skip(2u * sizeof(uint32_t));  // Time stamp.
+    const size_t records_begin = pos_;
+
+    // The strings are written before any record that refers to them, but read them first anyway
+    // so that the order of the records does not matter.
+    for (size_t pass = 0; pass != 2u && ok_; ++pass) {
+      pos_ = records_begin;
+      current_heap_ = "<none>";
+      while (ok_ && pos_ != data_.size()) {
+        uint8_t tag = U1();
+        Skip(sizeof(uint32_t));  // Time.
+        uint32_t length = U4();
+        if (!ok_ || length > data_.size() - pos_) {
+          *error = "Record exceeds the file";
+          return false;
+        }
+        size_t end = pos_ + length;
+        if (pass == 0u) {
+          if (tag == kTagString) {
+            uint32_t id = U4();
+            strings_[id] = Take(end - pos_);
+          }
+        } else if (tag == kTagLoadClass) {
+          Skip(sizeof(uint32_t));  // Class serial number.
+          std::string id = Take(kIdSize);
+          Skip(sizeof(uint32_t));  // Stack trace serial number.
+          contents->classes.insert(id + String(U4()));
+        } else if (tag == kTagHeapDump || tag == kTagHeapDumpSegment) {
+          while (ok_ && pos_ < end) {
+            ParseHeapDumpRecord(contents);
+          }
+        }
+        if (!ok_ || pos_ > end) {
+          *error = "Bad record with tag " + std::to_string(tag);
+          return false;
+        }
+        pos_ = end;
+      }
+    }
+    if (!ok_) {
+      *error = "Truncated file";
+    }
+    return ok_;
+  }
+
+ private:
+  static constexpr uint32_t kIdSize = 4u;
+
+  static constexpr uint8_t kTagString = 0x01;
+  static constexpr uint8_t kTagLoadClass = 0x02;
+  static constexpr uint8_t kTagHeapDump = 0x0c;
+  static constexpr uint8_t kTagHeapDumpSegment = 0x1c;
+
+  static constexpr uint8_t kClassDump = 0x20;
+  static constexpr uint8_t kInstanceDump = 0x21;
+  static constexpr uint8_t kObjectArrayDump = 0x22;
+  static constexpr uint8_t kPrimitiveArrayDump = 0x23;
+  static constexpr uint8_t kPrimitiveArrayNoDataDump = 0xc3;
+  static constexpr uint8_t kHeapDumpInfo = 0xfe;
+
+  static constexpr uint8_t kBasicObject = 2;
+
+  void ParseHeapDumpRecord(HprofContents* contents) {
+    const size_t begin = pos_;
+    uint8_t tag = U1();
+    switch (tag) {
+      case 0xff:  // Unknown.
+      case 0x05:  // Sticky class.
+      case 0x07:  // Monitor used.
+      case 0x89:  // Interned string.
+      case 0x8a:  // Finalizing.
+      case 0x8b:  // Debugger.
+      case 0x8c:  // Reference cleanup.
+      case 0x8d:  // VM internal.
+      case 0x90:  // Unreachable.
+        AddRoot(contents, tag, /*extra_size=*/ 0u);
+        break;
+      case 0x01:  // JNI global, with the ID of the JNI global reference.
+        AddRoot(contents, tag, /*extra_size=*/ kIdSize);
+        break;
+      case 0x04:  // Native stack, with the thread serial number.
+      case 0x06:  // Thread block, with the thread serial number.
+        AddRoot(contents, tag, /*extra_size=*/ sizeof(uint32_t));
+        break;
+      case 0x02:  // JNI local, with the thread serial number and the frame number.
+      case 0x03:  // Java frame, with the thread serial number and the frame number.
+      case 0x08:  // Thread object, with the thread serial number and the stack trace serial.
+      case 0x8e:  // JNI monitor, with the thread serial number and the stack depth.
+        AddRoot(contents, tag, /*extra_size=*/ 2u * sizeof(uint32_t));
+        break;
+      case kHeapDumpInfo:
+        Skip(sizeof(uint32_t));  // Heap type.
+        current_heap_ = String(U4());
+        break;
+      case kClassDump: {
+        std::string record = Take(kIdSize + sizeof(uint32_t) + 6u * kIdSize + sizeof(uint32_t));
+        uint16_t constant_pool_size = U2();
+        for (uint16_t i = 0; ok_ && i != constant_pool_size; ++i) {
+          record += Take(sizeof(uint16_t));
+          record += TakeValue(U1());
+        }
+        uint16_t num_static_fields = U2();
+        for (uint16_t i = 0; ok_ && i != num_static_fields; ++i) {
+          record += String(U4());
+          record += TakeValue(U1());
+        }
+        uint16_t num_instance_fields = U2();
+        for (uint16_t i = 0; ok_ && i != num_instance_fields; ++i) {
+          record += String(U4());
+          record += Take(sizeof(uint8_t));
+        }
+        AddObject(contents, tag, record);
+        break;
+      }
+      case kInstanceDump: {
+        Skip(2u * kIdSize + sizeof(uint32_t));
+        uint32_t length = U4();
+        Skip(length);
+        AddObject(contents, tag, data_.substr(begin + 1u, pos_ - begin - 1u));
+        break;
+      }
+      case kObjectArrayDump: {
+        Skip(kIdSize + sizeof(uint32_t));
+        uint32_t length = U4();
+        Skip(kIdSize + length * kIdSize);
+        AddObject(contents, tag, data_.substr(begin + 1u, pos_ - begin - 1u));
+        break;
+      }
+      case kPrimitiveArrayDump: {
+        // Keep only the ID, length and type to compare with the records without data.
+        std::string record = Take(kIdSize);
+        Skip(sizeof(uint32_t));  // Stack trace serial number.
+        uint32_t length = U4();
+        uint8_t type = U1();
+        record += std::to_string(length) + "/" + std::to_string(type);
+        contents->primitive_array_data.insert(record + ":" + Take(length * ValueSize(type)));
+        AddObject(contents, kPrimitiveArrayDump, record);
+        ++contents->num_primitive_arrays;
+        break;
+      }
+      case kPrimitiveArrayNoDataDump: {
+        std::string record = Take(kIdSize);
+        Skip(sizeof(uint32_t));  // Stack trace serial number.
+        uint32_t length = U4();
+        uint8_t type = U1();
+        record += std::to_string(length) + "/" + std::to_string(type);
+        AddObject(contents, kPrimitiveArrayDump, record);
+        ++contents->num_primitive_arrays_without_data;
+        break;
+      }
+      default:
+        ok_ = false;
+        break;
+    }
+  }
+
+  // Roots are compared without the serial numbers of threads, which are assigned in the order
+  // in which the threads are visited.
+  void AddRoot(HprofContents* contents, uint8_t tag, size_t extra_size) {
+    std::string id = Take(kIdSize);
+    Skip(extra_size);
+    contents->roots.insert(std::to_string(tag) + ":" + id);
+  }
+
+  void AddObject(HprofContents* contents, uint8_t tag, const std::string& record) {
+    contents->objects.insert(current_heap_ + ":" + std::to_string(tag) + ":" + record);
+  }
+
+  std::string String(uint32_t id) {
+    auto it = strings_.find(id);
+    if (it == strings_.end()) {
+      ok_ = false;
+      return std::string();
+    }
+    return it->second;
+  }
+
+  size_t ValueSize(uint8_t type) {
+    switch (type) {
+      case kBasicObject: return kIdSize;
+      case 4: return 1u;  // Boolean.
+      case 5: return 2u;  // Char.
+      case 6: return 4u;  // Float.
+      case 7: return 8u;  // Double.
+      case 8: return 1u;  // Byte.
+      case 9: return 2u;  // Short.
+      case 10: return 4u;  // Int.
+      case 11: return 8u;  // Long.
+      default:
+        ok_ = false;
+        return 0u;
+    }
+  }
+
+  std::string TakeValue(uint8_t type) {
+    return std::to_string(type) + Take(ValueSize(type));
+  }
+
+  std::string Take(size_t size) {
+    if (!ok_ || size > data_.size() - pos_) {
+      ok_ = false;
+      return std::string();
+    }
+    std::string result = data_.substr(pos_, size);
+    pos_ += size;
+    return result;
+  }
+
+  void Skip(size_t size) {
+    Take(size);
+  }
+
+  uint32_t ReadBigEndian(size_t size) {
+    std::string bytes = Take(size);
+    uint32_t value = 0u;
+    for (char c : bytes) {
+      value = (value << 8) | static_cast<uint8_t>(c);
+    }
+    return value;
+  }
+
+  uint8_t U1() { return static_cast<uint8_t>(ReadBigEndian(sizeof(uint8_t))); }
+  uint16_t U2() { return static_cast<uint16_t>(ReadBigEndian(sizeof(uint16_t))); }
+  uint32_t U4() { return ReadBigEndian(sizeof(uint32_t)); }
+
+  const std::string& data_;
+  size_t pos_;
+  bool ok_;
+  std::map<uint32_t, std::string> strings_;
+  std::string current_heap_;
+};
+
+class HprofTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kNumObjects = 1000u;
+
+  HprofTest() {
+    use_boot_image_ = true;  // Make the Runtime creation cheaper.
+  }
+
+  void SetUp() override {
+    CommonRuntimeTest::SetUp();
+    // Add strings and primitive arrays to the objects of the boot image.
+    Thread* self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ObjectArray<mirror::Object>> array =
+        hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(
+            self, GetClassRoot<mirror::ObjectArray<mirror::Object>>(), kNumObjects));
+    ASSERT_TRUE(array != nullptr);
+    for (size_t i = 0; i != kNumObjects; ++i) {
+      ObjPtr<mirror::Object> obj;
+      if (i % 2u == 0u) {
+        obj = mirror::String::AllocFromModifiedUtf8(self, std::to_string(i).c_str());
+      } else {
+        ObjPtr<mirror::IntArray> int_array = mirror::IntArray::Alloc(self, i);
+        ASSERT_TRUE(int_array != nullptr);
+        for (size_t j = 0; j != i; ++j) {
+          int_array->Set</*kTransactionActive=*/ false>(j, static_cast<int32_t>(i + j));
+        }
+        obj = int_array;
+      }
+      ASSERT_TRUE(obj != nullptr);
+      array->Set</*kTransactionActive=*/ false>(i, obj);
+    }
+    soa.Vm()->AddGlobalRef(self, array.Get());
+  }
+
+  HprofContents DumpAndParse(const DumpOptions& options, bool async = false) {
+    ScratchFile file;
+    std::promise<bool> done;
+    if (async) {
+      bool forked = DumpHeapAsync(file.GetFilename().c_str(),
+                                  /*fd=*/ -1,
+                                  options,
+                                  [&done](bool okay) { done.set_value(okay); });
+      EXPECT_TRUE(forked);
+      if (!forked) {
+        done.set_value(false);
+      }
+    } else {
+      DumpHeap(file.GetFilename().c_str(), /*fd=*/ -1, /*direct_to_ddms=*/ false, options);
+    }
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      EXPECT_FALSE(soa.Self()->IsExceptionPending());
+      soa.Self()->ClearException();
+    }
+    if (async) {
+      // The caller is not blocked while the child writes the dump.
+      EXPECT_TRUE(done.get_future().get());
+    }
+    std::string data;
+    EXPECT_TRUE(android::base::ReadFileToString(file.GetFilename(), &data));
+    HprofContents contents;
+    std::string error;
+    EXPECT_TRUE(HprofReader(data).Parse(&contents, &error)) << error;
+    return contents;
+  }
+
+  static void ExpectSameContents(const HprofContents& expected, const HprofContents& actual) {
+    EXPECT_EQ(expected.classes, actual.classes);
+    EXPECT_EQ(expected.roots, actual.roots);
+    EXPECT_EQ(expected.objects.size(), actual.objects.size());
+    EXPECT_TRUE(expected.objects == actual.objects);
+    EXPECT_TRUE(expected.primitive_array_data == actual.primitive_array_data);
+    EXPECT_EQ(expected.num_primitive_arrays, actual.num_primitive_arrays);
+    EXPECT_EQ(expected.num_primitive_arrays_without_data,
+              actual.num_primitive_arrays_without_data);
+  }
+};
+
+TEST_F(HprofTest, ParallelDump) {
+  HprofContents serial = DumpAndParse(DumpOptions());
+  EXPECT_FALSE(serial.classes.empty());
+  EXPECT_GE(serial.objects.size(), kNumObjects);
+  EXPECT_GE(serial.num_primitive_arrays, kNumObjects / 2u);
+  EXPECT_EQ(0u, serial.num_primitive_arrays_without_data);
+
+  DumpOptions options;
+  options.parallel = true;
+  ExpectSameContents(serial, DumpAndParse(options));
+}
+
+TEST_F(HprofTest, ForkedDump) {
+  HprofContents serial = DumpAndParse(DumpOptions());
+
+  DumpOptions options;
+  options.fork = true;
+  ExpectSameContents(serial, DumpAndParse(options));
+}
+
+TEST_F(HprofTest, AsyncForkedDump) {
+  HprofContents serial = DumpAndParse(DumpOptions());
+
+  ExpectSameContents(serial, DumpAndParse(DumpOptions(), /*async=*/ true));
+}
+
+TEST_F(HprofTest, OmitPrimitiveArrays) {
+  HprofContents serial = DumpAndParse(DumpOptions());
+  // The primitive arrays are recorded without their contents and compare equal.
+  serial.num_primitive_arrays_without_data = serial.num_primitive_arrays;
+  serial.num_primitive_arrays = 0u;
+  serial.primitive_array_data.clear();
+
+  for (bool parallel : {false, true}) {
+    for (bool fork : {false, true}) {
+      DumpOptions options;
+      options.parallel = parallel;
+      options.fork = fork;
+      options.omit_primitive_arrays = true;
+      ExpectSameContents(serial, DumpAndParse(options));
+    }
+  }
+}
+
+}  // namespace hprof
+}  // namespace art
@@ -25,19 +25,37 @@ namespace art HIDDEN {
 
 inline bool InterpreterCache::Get(Thread* self, const void* key, /* out */ size_t* value) {
   DCHECK(self->GetInterpreterCache() == this) << "Must be called from owning thread";
-  Entry& entry = data_[IndexOf(key)];
-  if (LIKELY(entry.first == key)) {
-    *value = entry.second;
-    return true;
+  Entry* set = &data_[IndexOf(key)];
+  for (size_t way = 0; way != kNumWays; ++way) {
+    if (LIKELY(set[way].first == key)) {
+      *value = set[way].second;
+      if (kCountStats) {
+        ++hit_count_;
+      }
+      return true;
+    }
   }
   return false;
 }
 
 inline void InterpreterCache::Set(Thread* self, const void* key, size_t value) {
   DCHECK(self->GetInterpreterCache() == this) << "Must be called from owning thread";
-  // Simple store works here as the cache is always read/written by the owning
+  if (kCountStats) {
+    ++fill_count_;
+  }
+  // Simple stores work here as the cache is always read/written by the owning
   // thread only (or in a stop-the-world pause).
-  data_[IndexOf(key)] = Entry{key, value};
+  Entry* set = &data_[IndexOf(key)];
+  size_t way = 0;
+  while (way != kNumWays - 1u && set[way].first != key) {
+    ++way;
+  }
+  // Either update the existing entry in place or evict the last way, and move
+  // the more recently inserted entries down to make room in the first way.
+  for (; way != 0; --way) {
+    set[way] = set[way - 1];
+  }
+  set[0] = Entry{key, value};
 }
 
 }  // namespace art
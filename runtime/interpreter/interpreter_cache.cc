@@ -19,7 +19,10 @@
 
 namespace art HIDDEN {
 
+static_assert(InterpreterCache::kHitCountOffset % sizeof(size_t) == 0u);
+
 void InterpreterCache::Clear(Thread* owning_thread) {
+  static_assert(offsetof(InterpreterCache, hit_count_) == kHitCountOffset);
   DCHECK(owning_thread->GetInterpreterCache() == this);
   DCHECK(owning_thread == Thread::Current() || owning_thread->IsSuspended());
   // Avoid using std::fill (or its variant) as there could be a concurrent sweep
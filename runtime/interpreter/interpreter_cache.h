@@ -21,6 +21,7 @@
 #include <atomic>
 
 #include "base/bit_utils.h"
+#include "base/globals.h"
 #include "base/macros.h"
 
 namespace art HIDDEN {
@@ -42,6 +43,11 @@ class Thread;
 // We ensure consistency of the cache by clearing it
 // whenever any dex file is unloaded.
 //
+// The cache is set-associative: a key maps to a set of `kNumWays` consecutive
+// entries, which avoids thrashing when a hot loop references several fields or
+// methods whose instructions map to the same set. New keys are inserted in the
+// first way of their set, moving older entries towards the last way.
+//
 // Aligned to 16-bytes to make it easier to get the address of the cache
 // from assembly (it ensures that the offset is valid immediate value).
 class ALIGNED(16) InterpreterCache {
@@ -49,9 +55,22 @@ class ALIGNED(16) InterpreterCache {
   // Aligned since we load the whole entry in single assembly instruction.
   using Entry ALIGNED(2 * sizeof(size_t)) = std::pair<const void*, size_t>;
 
+  // The nterp fast paths (`fetch_from_thread_cache`) probe both ways of a set,
+  // so they need to be updated if this changes.
+  static constexpr size_t kNumWays = 2;
+
   // 2x size increase/decrease corresponds to ~0.5% interpreter performance change.
-  // Value of 256 has around 75% cache hit rate.
-  static constexpr size_t kSize = 256;
+  // A direct-mapped cache of 256 entries has around 75% cache hit rate.
+  static constexpr size_t kNumSets = 256;
+
+  static constexpr size_t kSize = kNumSets * kNumWays;
+
+  // Debug builds count the hits, including those of the nterp fast paths, and the fills,
+  // which every miss results in. The counts are shown in the thread dump.
+  static constexpr bool kCountStats = kIsDebugBuild;
+
+  // Offset of `hit_count_` in the cache, for the nterp fast paths.
+  static constexpr size_t kHitCountOffset = kSize * sizeof(Entry);
 
   InterpreterCache() {
     // We can not use the Clear() method since the constructor will not
@@ -70,15 +89,24 @@ class ALIGNED(16) InterpreterCache {
     return data_;
   }
 
+  // Number of hits and of `Set()` calls, only maintained if `kCountStats` is true.
+  size_t GetHitCount() const { return hit_count_; }
+  size_t GetFillCount() const { return fill_count_; }
+
  private:
+  // Returns the index of the first entry of the set for `key`.
   static ALWAYS_INLINE size_t IndexOf(const void* key) {
-    static_assert(IsPowerOfTwo(kSize), "Size must be power of two");
-    size_t index = (reinterpret_cast<uintptr_t>(key) >> 2) & (kSize - 1);
+    static_assert(IsPowerOfTwo(kNumSets), "Number of sets must be power of two");
+    size_t index = ((reinterpret_cast<uintptr_t>(key) >> 2) & (kNumSets - 1)) * kNumWays;
     DCHECK_LT(index, kSize);
     return index;
   }
 
   std::array<Entry, kSize> data_;
+
+  // Follow the entries, so they do not change the offsets of the entries used by assembly.
+  size_t hit_count_ = 0u;  // Incremented by the nterp fast paths, see `kHitCountOffset`.
+  size_t fill_count_ = 0u;
 };
 
 }  // namespace art
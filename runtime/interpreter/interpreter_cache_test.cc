@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_cache-inl.h"
+#include "interpreter_inline_cache-inl.h"
+
+#include "common_runtime_test.h"
+#include "thread-current-inl.h"
+
+namespace art HIDDEN {
+
+class InterpreterCacheTest : public CommonRuntimeTest {};
+
+// Returns a key mapping to the same set as `key`.
+static const void* CollidingKey(const void* key, size_t n) {
+  return reinterpret_cast<const uint8_t*>(key) + n * (InterpreterCache::kNumSets << 2);
+}
+
+TEST_F(InterpreterCacheTest, SetAssociative) {
+  Thread* self = Thread::Current();
+  InterpreterCache* cache = self->GetInterpreterCache();
+  cache->Clear(self);
+
+  static const uint16_t kInsns[4] = {};
+  const void* key = &kInsns[0];
+  size_t value = 0u;
+  EXPECT_FALSE(cache->Get(self, key, &value));
+
+  // All ways of a set can be used by keys which would have collided in a direct-mapped cache.
+  for (size_t i = 0; i != InterpreterCache::kNumWays; ++i) {
+    cache->Set(self, CollidingKey(key, i), i + 1u);
+  }
+  for (size_t i = 0; i != InterpreterCache::kNumWays; ++i) {
+    ASSERT_TRUE(cache->Get(self, CollidingKey(key, i), &value));
+    EXPECT_EQ(i + 1u, value);
+  }
+
+  // Updating an existing key does not evict another entry of the set.
+  cache->Set(self, key, 42u);
+  for (size_t i = 0; i != InterpreterCache::kNumWays; ++i) {
+    ASSERT_TRUE(cache->Get(self, CollidingKey(key, i), &value));
+    EXPECT_EQ((i == 0u) ? 42u : i + 1u, value);
+  }
+
+  // Inserting one more colliding key evicts the least recently inserted one.
+  cache->Set(self, CollidingKey(key, InterpreterCache::kNumWays), 0u);
+  EXPECT_TRUE(cache->Get(self, CollidingKey(key, InterpreterCache::kNumWays), &value));
+  EXPECT_TRUE(cache->Get(self, key, &value));
+  EXPECT_EQ(42u, value);
+  EXPECT_FALSE(cache->Get(self, CollidingKey(key, 1u), &value));
+
+  // Keys of other sets are not affected.
+  EXPECT_FALSE(cache->Get(self, &kInsns[2], &value));
+
+  cache->Clear(self);
+  EXPECT_FALSE(cache->Get(self, key, &value));
+}
+
+TEST_F(InterpreterCacheTest, InlineCache) {
+  Thread* self = Thread::Current();
+  InterpreterInlineCache* cache = self->GetInterpreterInlineCache();
+  cache->Clear(self);
+
+  static const uint16_t kInsns[6] = {};
+  // The cache only compares class and method pointers.
+  mirror::Class* klass1 = reinterpret_cast<mirror::Class*>(0x1000);
+  mirror::Class* klass2 = reinterpret_cast<mirror::Class*>(0x2000);
+  ArtMethod* method1 = reinterpret_cast<ArtMethod*>(0x3000);
+  ArtMethod* method2 = reinterpret_cast<ArtMethod*>(0x4000);
+  EXPECT_EQ(nullptr, cache->Get(self, &kInsns[0], klass1));
+
+  cache->Set(self, &kInsns[0], klass1, method1);
+  cache->Set(self, &kInsns[3], klass1, method2);
+  EXPECT_EQ(method1, cache->Get(self, &kInsns[0], klass1));
+  EXPECT_EQ(method2, cache->Get(self, &kInsns[3], klass1));
+  // Monomorphic: another receiver class misses, and replaces the entry.
+  EXPECT_EQ(nullptr, cache->Get(self, &kInsns[0], klass2));
+  cache->Set(self, &kInsns[0], klass2, method2);
+  EXPECT_EQ(method2, cache->Get(self, &kInsns[0], klass2));
+  EXPECT_EQ(nullptr, cache->Get(self, &kInsns[0], klass1));
+
+  cache->Clear(self);
+  EXPECT_EQ(nullptr, cache->Get(self, &kInsns[0], klass2));
+  EXPECT_EQ(nullptr, cache->Get(self, &kInsns[3], klass1));
+}
+
+}  // namespace art
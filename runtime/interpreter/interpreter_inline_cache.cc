@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_inline_cache.h"
+
+#include <atomic>
+
+#include "mirror/class.h"
+#include "object_callbacks.h"
+#include "thread-inl.h"
+
+namespace art HIDDEN {
+
+void InterpreterInlineCache::Clear(Thread* owning_thread) {
+  DCHECK(owning_thread->GetInterpreterInlineCache() == this);
+  DCHECK(owning_thread == Thread::Current() || owning_thread->IsSuspended());
+  // Like `InterpreterCache::Clear()`, only clear the keys, with atomic stores,
+  // as there could be a concurrent sweep happening by the GC thread.
+  for (Entry& entry : data_) {
+    std::atomic<const void*>* atomic_key_addr =
+        reinterpret_cast<std::atomic<const void*>*>(&entry.dex_pc_ptr);
+    atomic_key_addr->store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+void InterpreterInlineCache::Sweep(IsMarkedVisitor* visitor) {
+  for (Entry& entry : data_) {
+    if (entry.dex_pc_ptr == nullptr) {
+      continue;
+    }
+    DCHECK(entry.klass != nullptr);
+    mirror::Class* new_klass = down_cast<mirror::Class*>(visitor->IsMarked(entry.klass));
+    if (new_klass == nullptr) {
+      // The class, and with it the cached method, may be unloaded.
+      entry.dex_pc_ptr = nullptr;
+    } else if (new_klass != entry.klass) {
+      entry.klass = new_klass;
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_INLINE_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_INLINE_CACHE_H_
+
+#include <array>
+
+#include "base/bit_utils.h"
+#include "base/locks.h"
+#include "base/macros.h"
+
+namespace art HIDDEN {
+
+class ArtMethod;
+class IsMarkedVisitor;
+class Thread;
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+// Small thread-local monomorphic inline cache for `invoke-interface` call sites
+// executed by nterp.
+//
+// Each entry maps a dex instruction pointer to the last receiver class seen at
+// that call site and the implementation method it dispatched to. Nterp only
+// consults it when the IMT slot of the receiver class holds a runtime
+// (conflict) method, so that interfaces with colliding IMT slots do not go
+// through the conflict table walk of `art_quick_imt_conflict_trampoline` on
+// every call.
+//
+// Like the `InterpreterCache`, all operations must be done from the owning
+// thread, or at a point when the owning thread is suspended. The cache is
+// cleared whenever any dex file is unloaded, and swept by the GC together with
+// the `InterpreterCache`: entries whose class is not marked are dropped and
+// moved classes are updated.
+//
+// Aligned to 16-bytes for the same reason as the `InterpreterCache`.
+class ALIGNED(16) InterpreterInlineCache {
+ public:
+  // The size of entries is a power of two so that nterp can index the cache
+  // with a single shifted add.
+  struct ALIGNED(4 * sizeof(size_t)) Entry {
+    const void* dex_pc_ptr;
+    mirror::Class* klass;
+    ArtMethod* method;
+    size_t unused;
+  };
+
+  // Direct-mapped. Conflicting IMT slots are rare enough that a handful of
+  // entries covers the hot interface call sites of a thread.
+  static constexpr size_t kSize = 64;
+
+  InterpreterInlineCache() {
+    // We can not use the Clear() method since the constructor will not
+    // be called from the owning thread.
+    data_.fill(Entry{});
+  }
+
+  // Clear the whole cache. It requires the owning thread for DCHECKs.
+  EXPORT void Clear(Thread* owning_thread);
+
+  // Update class pointers after a GC, dropping entries whose class is dead.
+  void Sweep(IsMarkedVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Returns the method cached for `key` and `klass`, or null.
+  ALWAYS_INLINE ArtMethod* Get(Thread* self, const void* key, mirror::Class* klass);
+
+  ALWAYS_INLINE void Set(Thread* self, const void* key, mirror::Class* klass, ArtMethod* method);
+
+  std::array<Entry, kSize>& GetArray() {
+    return data_;
+  }
+
+  // Returns the index of the entry for `key`. Instructions are 2-byte aligned,
+  // and invokes are 3 code units long so the low bit can be ignored.
+  static ALWAYS_INLINE size_t IndexOf(const void* key) {
+    static_assert(IsPowerOfTwo(kSize), "Size must be power of two");
+    size_t index = (reinterpret_cast<uintptr_t>(key) >> 1) & (kSize - 1);
+    DCHECK_LT(index, kSize);
+    return index;
+  }
+
+ private:
+  std::array<Entry, kSize> data_;
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_INLINE_CACHE_H_
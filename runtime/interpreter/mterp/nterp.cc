@@ -27,6 +27,7 @@
 #include "entrypoints/entrypoint_utils-inl.h"
 #include "interpreter/interpreter_cache-inl.h"
 #include "interpreter/interpreter_common.h"
+#include "interpreter/interpreter_inline_cache-inl.h"
 #include "interpreter/shadow_frame-inl.h"
 #include "mirror/string-alloc-inl.h"
 #include "nterp_helpers.h"
@@ -389,6 +390,35 @@ extern "C" size_t NterpGetMethod(Thread* self, ArtMethod* caller, const uint16_t
   }
 }
 
+// Called by nterp for an `invoke-interface` whose IMT slot in `receiver_class` is a
+// runtime (conflict) method and which missed in the thread-local inline cache.
+// `interface_method` is the value nterp got from `NterpGetMethod`. Returns the
+// implementation method, or null if nterp should go through the IMT entry.
+LIBART_PROTECTED
+extern "C" ArtMethod* NterpUpdateInterfaceInlineCache(Thread* self,
+                                                      const uint16_t* dex_pc_ptr,
+                                                      mirror::Class* receiver_class,
+                                                      size_t interface_method)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  ScopedAssertNoThreadSuspension sants("In nterp");
+  // Clear the default method marker set by `NterpGetMethod`.
+  ArtMethod* resolved_method =
+      reinterpret_cast<ArtMethod*>(interface_method & ~static_cast<size_t>(3));
+  DCHECK(resolved_method->GetDeclaringClass()->IsInterface());
+  ArtMethod* method =
+      receiver_class->FindVirtualMethodForInterface(resolved_method, kRuntimePointerSize);
+  if (method == nullptr || method->IsAbstract() || method->IsDefaultConflicting()) {
+    // Let the conflict trampoline throw the appropriate error.
+    return nullptr;
+  }
+  // While the GC is marking, `receiver_class` may be a from-space reference which
+  // would not be updated by the sweep, so do not cache it.
+  if (!self->GetIsGcMarking()) {
+    self->GetInterpreterInlineCache()->Set(self, dex_pc_ptr, receiver_class, method);
+  }
+  return method;
+}
+
 LIBART_PROTECTED
 extern "C" size_t NterpGetStaticField(Thread* self,
                                       ArtMethod* caller,
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <ostream>
+
+#include "art_method-inl.h"
+#include "base/mutex-inl.h"
+#include "base/os.h"
+#include "base/pprof_builder.h"
+#include "base/unix_file/fd_file.h"
+#include "base/utils.h"
+#include "gc/heap.h"
+#include "javaheapprof/javaheapsampler.h"
+#include "linear_alloc.h"
+#include "mirror/class-inl.h"
+#include "monitor.h"
+#include "runtime.h"
+#include "stack.h"
+#include "thread-current-inl.h"
+
+namespace art HIDDEN {
+
+std::atomic<bool> AllocationSiteProfiler::enabled_(false);
+Mutex AllocationSiteProfiler::lock_("allocation site profiler lock", kGenericBottomLock);
+std::vector<AllocationSiteProfiler::TrieNode> AllocationSiteProfiler::nodes_;
+std::map<AllocationSiteProfiler::NodeKey, uint32_t> AllocationSiteProfiler::children_;
+std::vector<std::string> AllocationSiteProfiler::type_names_;
+std::map<std::string, uint32_t> AllocationSiteProfiler::type_ids_;
+std::map<AllocationSiteProfiler::SiteKey, AllocationSiteProfiler::SiteTotals>
+    AllocationSiteProfiler::totals_;
+std::string AllocationSiteProfiler::output_file_;
+
+static HeapSampler& GetHeapSampler() {
+  return Runtime::Current()->GetHeap()->GetHeapSampler();
+}
+
+void AllocationSiteProfiler::Enable(size_t sampling_interval) {
+  HeapSampler& sampler = GetHeapSampler();
+  sampler.SetSamplingInterval(sampling_interval);
+  enabled_.store(true, std::memory_order_relaxed);
+  sampler.EnableSiteProfiling();
+}
+
+void AllocationSiteProfiler::Disable() {
+  GetHeapSampler().DisableSiteProfiling();
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+double AllocationSiteProfiler::GetSampleWeight(size_t byte_count, size_t sampling_interval) {
+  if (sampling_interval <= 1u || byte_count == 0u) {
+    return 1.0;
+  }
+  // The probability of sampling an allocation of `byte_count` bytes is 1 - e^(-size/interval).
+  double probability =
+      -std::expm1(-static_cast<double>(byte_count) / static_cast<double>(sampling_interval));
+  return 1.0 / probability;
+}
+
+void AllocationSiteProfiler::AddRootNodes() {
+  DCHECK(nodes_.empty());
+  nodes_.push_back({/*parent=*/ kRootNode, /*depth=*/ 0u, "", "", /*line_number=*/ -1});
+  nodes_.push_back(
+      {/*parent=*/ kRootNode, /*depth=*/ 1u, "<other sites>", "", /*line_number=*/ -1});
+}
+
+uint32_t AllocationSiteProfiler::FindOrAddNode(uint32_t parent, const Frame& frame) {
+  NodeKey key(parent, frame.method, frame.dex_pc);
+  auto it = children_.find(key);
+  if (it != children_.end()) {
+    return it->second;
+  }
+  if (nodes_.size() >= kMaxTrieNodes) {
+    return kOverflowNode;
+  }
+  const char* file_name;
+  int32_t line_number;
+  Monitor::TranslateLocation(frame.method, frame.dex_pc, &file_name, &line_number);
+  uint32_t node = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back({parent,
+                    nodes_[parent].depth + 1u,
+                    frame.method->PrettyMethod(),
+                    file_name != nullptr ? file_name : "",
+                    line_number});
+  children_.emplace(key, node);
+  return node;
+}
+
+uint32_t AllocationSiteProfiler::FindOrAddType(ObjPtr<mirror::Class> klass) {
+  std::string name = klass->PrettyDescriptor();
+  auto it = type_ids_.find(name);
+  if (it != type_ids_.end()) {
+    return it->second;
+  }
+  uint32_t type = static_cast<uint32_t>(type_names_.size());
+  type_names_.push_back(name);
+  type_ids_.emplace(std::move(name), type);
+  return type;
+}
+
+void AllocationSiteProfiler::RecordSample(Thread* self,
+                                          ObjPtr<mirror::Class> klass,
+                                          size_t byte_count,
+                                          size_t sampling_interval) {
+  DCHECK_EQ(self, Thread::Current());
+  // Walk the stack outside of the lock. This does not suspend, so `klass` stays valid.
+  Frame frames[kMaxStackDepth];
+  size_t depth = 0u;
+  StackVisitor::WalkStack(
+      [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* m = stack_visitor->GetMethod();
+        // m may be null if we have inlined methods of unresolved classes.
+        if (m != nullptr && !m->IsRuntimeMethod()) {
+          m = m->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+          frames[depth++] = {m, stack_visitor->GetDexPc(/*abort_on_failure=*/ false)};
+        }
+        return depth != kMaxStackDepth;
+      },
+      self,
+      /* context= */ nullptr,
+      art::StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+
+  double weight = GetSampleWeight(byte_count, sampling_interval);
+  MutexLock mu(self, lock_);
+  if (nodes_.empty()) {
+    AddRootNodes();
+  }
+  uint32_t node = kRootNode;
+  for (size_t i = 0; i != depth && node != kOverflowNode; ++i) {
+    node = FindOrAddNode(node, frames[i]);
+  }
+  SiteKey key(node, FindOrAddType(klass));
+  if (totals_.size() >= kMaxSites && totals_.find(key) == totals_.end()) {
+    key.first = kOverflowNode;
+  }
+  SiteTotals& totals = totals_[key];
+  ++totals.samples;
+  totals.sampled_bytes += byte_count;
+  totals.estimated_count += weight;
+  totals.estimated_bytes += weight * static_cast<double>(byte_count);
+}
+
+void AllocationSiteProfiler::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  // Aggregate the stacks by allocating frame, i.e. by the first level of the trie.
+  std::map<SiteKey, SiteTotals> sites;
+  SiteTotals all;
+  for (const auto& [key, totals] : totals_) {
+    uint32_t node = key.first;
+    while (nodes_[node].depth > 1u) {
+      node = nodes_[node].parent;
+    }
+    SiteTotals& site = sites[SiteKey(node, key.second)];
+    for (SiteTotals* sum : {&site, &all}) {
+      sum->samples += totals.samples;
+      sum->sampled_bytes += totals.sampled_bytes;
+      sum->estimated_count += totals.estimated_count;
+      sum->estimated_bytes += totals.estimated_bytes;
+    }
+  }
+  std::vector<std::pair<SiteKey, SiteTotals>> sorted_sites(sites.begin(), sites.end());
+  std::sort(sorted_sites.begin(),
+            sorted_sites.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.second.estimated_bytes > rhs.second.estimated_bytes;
+            });
+
+  os << "Allocation sites: " << all.samples << " samples at " << sorted_sites.size()
+     << " sites, estimated " << static_cast<uint64_t>(all.estimated_count) << " allocations of "
+     << PrettySize(static_cast<uint64_t>(all.estimated_bytes)) << "\n";
+  size_t num_dumped = std::min(sorted_sites.size(), kMaxDumpedSites);
+  for (size_t i = 0; i != num_dumped; ++i) {
+    const auto& [key, site] = sorted_sites[i];
+    const TrieNode& node = nodes_[key.first];
+    os << "  " << type_names_[key.second] << " at ";
+    if (key.first == kRootNode) {
+      os << "<unknown>";
+    } else if (key.first == kOverflowNode) {
+      os << node.method_name;
+    } else {
+      os << node.method_name << " (" << node.file_name << ":" << node.line_number << ")";
+    }
+    os << ": samples=" << site.samples
+       << " estimated count=" << static_cast<uint64_t>(site.estimated_count)
+       << " estimated size=" << PrettySize(static_cast<uint64_t>(site.estimated_bytes)) << "\n";
+  }
+  if (num_dumped != sorted_sites.size()) {
+    os << "  ... " << (sorted_sites.size() - num_dumped) << " more sites\n";
+  }
+}
+
+std::string AllocationSiteProfiler::DumpPprof() {
+  PprofBuilder builder;
+  builder.AddSampleType("alloc_objects", "count");
+  builder.AddSampleType("alloc_space", "bytes");
+  builder.AddSampleType("sampled_objects", "count");
+  builder.AddSampleType("sampled_space", "bytes");
+  builder.SetPeriod("space", "bytes", GetHeapSampler().GetSamplingInterval());
+  builder.SetTimeNanos(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+
+  MutexLock mu(Thread::Current(), lock_);
+  std::vector<uint64_t> location_ids(nodes_.size(), 0u);
+  std::vector<uint64_t> stack;
+  for (const auto& [key, totals] : totals_) {
+    // The trie starts with the allocating frame, as do pprof stacks.
+    stack.clear();
+    for (uint32_t node = key.first; node != kRootNode; node = nodes_[node].parent) {
+      if (location_ids[node] == 0u) {
+        const TrieNode& trie_node = nodes_[node];
+        location_ids[node] = builder.AddLocation(
+            trie_node.method_name, trie_node.file_name, trie_node.line_number);
+      }
+      stack.push_back(location_ids[node]);
+    }
+    std::reverse(stack.begin(), stack.end());
+    builder.AddSample(stack,
+                      {static_cast<int64_t>(totals.estimated_count),
+                       static_cast<int64_t>(totals.estimated_bytes),
+                       static_cast<int64_t>(totals.samples),
+                       static_cast<int64_t>(totals.sampled_bytes)},
+                      {{"object type", type_names_[key.second]}});
+  }
+  return builder.Build();
+}
+
+bool AllocationSiteProfiler::WritePprof(const std::string& filename, std::string* error_msg) {
+  std::string profile = DumpPprof();
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(filename.c_str()));
+  if (file == nullptr) {
+    *error_msg = "Could not create " + filename + ": " + strerror(errno);
+    return false;
+  }
+  if (!file->WriteFully(profile.data(), profile.size()) || file->FlushCloseOrErase() != 0) {
+    *error_msg = "Could not write " + filename + ": " + strerror(errno);
+    file->Erase();
+    return false;
+  }
+  return true;
+}
+
+void AllocationSiteProfiler::SetOutputFile(const std::string& filename) {
+  MutexLock mu(Thread::Current(), lock_);
+  output_file_ = filename;
+}
+
+void AllocationSiteProfiler::DumpForSigQuit(std::ostream& os) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Dump(os);
+  WriteOutputFile(os);
+  os << "\n";
+}
+
+void AllocationSiteProfiler::WriteOutputFile(std::ostream& os) {
+  std::string output_file;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    output_file = output_file_;
+  }
+  if (!output_file.empty()) {
+    std::string error_msg;
+    if (WritePprof(output_file, &error_msg)) {
+      os << "Allocation site profile written to " << output_file << "\n";
+    } else {
+      os << error_msg << "\n";
+    }
+  }
+}
+
+void AllocationSiteProfiler::Reset() {
+  MutexLock mu(Thread::Current(), lock_);
+  nodes_.clear();
+  children_.clear();
+  type_names_.clear();
+  type_ids_.clear();
+  totals_.clear();
+}
+
+void AllocationSiteProfiler::RemoveMethodsIn(Thread* self, const LinearAlloc& alloc) {
+  MutexLock mu(self, lock_);
+  for (auto it = children_.begin(); it != children_.end();) {
+    if (alloc.ContainsUnsafe(std::get<1>(it->first))) {
+      it = children_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JAVAHEAPPROF_ALLOCATION_SITE_PROFILER_H_
+#define ART_RUNTIME_JAVAHEAPPROF_ALLOCATION_SITE_PROFILER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "base/globals.h"
+#include "base/locks.h"
+#include "base/macros.h"
+#include "obj_ptr.h"
+
+namespace art HIDDEN {
+
+class ArtMethod;
+class LinearAlloc;
+class Thread;
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+// Aggregates the allocations picked by the `HeapSampler` per allocation site and type, cheaply
+// enough to stay enabled in production. Unlike `AllocRecordObjectMap`, which keeps the full stack
+// of every tracked allocation, the stacks of the samples are deduplicated into a trie whose first
+// level is the allocating frame, and only byte and count totals are kept per (stack, type).
+//
+// The sampler picks allocations with a probability proportional to their size, so each sample
+// is also weighted to estimate the total number and size of the allocations it stands for.
+class AllocationSiteProfiler {
+ public:
+  static constexpr size_t kDefaultSamplingInterval = 512 * KB;
+
+  // Frames recorded per sample, starting with the allocating frame.
+  static constexpr size_t kMaxStackDepth = 32;
+
+  // Maximum number of allocation sites printed by `Dump`, sorted by estimated size.
+  static constexpr size_t kMaxDumpedSites = 20;
+
+  // Maximum number of trie nodes and of (stack, type) totals. Samples that need more are recorded
+  // with their type at an "<other sites>" node, so the memory used stays bounded.
+  static constexpr size_t kMaxTrieNodes = 64 * 1024;
+  static constexpr size_t kMaxSites = 16 * 1024;
+
+  // Starts sampling allocations, on average one for every `sampling_interval` bytes allocated.
+  static void Enable(size_t sampling_interval) REQUIRES(!lock_);
+  static void Disable();
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records a sampled allocation of `byte_count` bytes of type `klass` at the current stack of
+  // `self`. `sampling_interval` is the sampling interval at the time of the allocation.
+  static void RecordSample(Thread* self,
+                           ObjPtr<mirror::Class> klass,
+                           size_t byte_count,
+                           size_t sampling_interval)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  // Prints the allocation sites with the largest estimated size.
+  static void Dump(std::ostream& os) REQUIRES(!lock_);
+
+  // Same as `Dump`, but only if the profiler is enabled. Also writes the pprof output if an
+  // output file was given with `-Xallocsiteprofile-output`.
+  static void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+  // Writes the pprof output if an output file was given with `-Xallocsiteprofile-output` and
+  // reports the result to `os`.
+  static void WriteOutputFile(std::ostream& os) REQUIRES(!lock_);
+
+  // Returns the aggregated data as a serialized pprof profile. Each sample is a stack and carries
+  // the allocated type as the "object type" label.
+  static std::string DumpPprof() REQUIRES(!lock_);
+
+  static bool WritePprof(const std::string& filename, std::string* error_msg) REQUIRES(!lock_);
+
+  static void SetOutputFile(const std::string& filename) REQUIRES(!lock_);
+
+  // Drops all aggregated data.
+  static void Reset() REQUIRES(!lock_);
+
+  // Forgets the methods allocated in `alloc`, which is about to be freed with its class loader.
+  // Their nodes keep the names resolved when they were added, and a method allocated later at
+  // the same address gets new nodes.
+  static void RemoveMethodsIn(Thread* self, const LinearAlloc& alloc) REQUIRES(!lock_);
+
+  // Returns the estimated number of allocations represented by a sample of `byte_count` bytes.
+  static double GetSampleWeight(size_t byte_count, size_t sampling_interval);
+
+ private:
+  struct Frame {
+    ArtMethod* method;
+    uint32_t dex_pc;
+  };
+
+  struct TrieNode {
+    uint32_t parent;
+    uint32_t depth;
+    std::string method_name;
+    std::string file_name;
+    int32_t line_number;
+  };
+
+  struct SiteTotals {
+    uint64_t samples = 0u;
+    uint64_t sampled_bytes = 0u;
+    double estimated_count = 0.0;
+    double estimated_bytes = 0.0;
+  };
+
+  // The root of the trie, and the node of the samples that do not fit in the trie or the totals.
+  static constexpr uint32_t kRootNode = 0u;
+  static constexpr uint32_t kOverflowNode = 1u;
+
+  // Key of a trie node: the parent node and the frame. Methods are removed from the keys when
+  // their class loader is unloaded, see `RemoveMethodsIn`.
+  using NodeKey = std::tuple<uint32_t, ArtMethod*, uint32_t>;
+  // Key of the totals: the trie node of the outermost recorded frame and the type id.
+  using SiteKey = std::pair<uint32_t, uint32_t>;
+
+  static void AddRootNodes() REQUIRES(lock_);
+  static uint32_t FindOrAddNode(uint32_t parent, const Frame& frame)
+      REQUIRES(lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+  static uint32_t FindOrAddType(ObjPtr<mirror::Class> klass)
+      REQUIRES(lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static std::atomic<bool> enabled_;
+  static Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+  // Trie of the sampled stacks, starting with `kRootNode` and `kOverflowNode`. Method names are
+  // resolved when a node is added, so the trie stays printable after the classes of its methods
+  // are unloaded.
+  static std::vector<TrieNode> nodes_ GUARDED_BY(lock_);
+  static std::map<NodeKey, uint32_t> children_ GUARDED_BY(lock_);
+  static std::vector<std::string> type_names_ GUARDED_BY(lock_);
+  static std::map<std::string, uint32_t> type_ids_ GUARDED_BY(lock_);
+  static std::map<SiteKey, SiteTotals> totals_ GUARDED_BY(lock_);
+  static std::string output_file_ GUARDED_BY(lock_);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocationSiteProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JAVAHEAPPROF_ALLOCATION_SITE_PROFILER_H_
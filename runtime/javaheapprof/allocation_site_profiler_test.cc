@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_profiler.h"
+
+#include <cmath>
+#include <sstream>
+
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "mirror/array-alloc-inl.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+
+namespace art HIDDEN {
+
+class AllocationSiteProfilerTest : public CommonRuntimeTest {};
+
+TEST_F(AllocationSiteProfilerTest, SampleWeight) {
+  // Every allocation is sampled with an interval of one byte.
+  EXPECT_DOUBLE_EQ(1.0, AllocationSiteProfiler::GetSampleWeight(16u, 1u));
+  // Allocations much larger than the interval are almost always sampled.
+  EXPECT_NEAR(1.0, AllocationSiteProfiler::GetSampleWeight(64 * KB, 1 * KB), 1e-9);
+  // Small allocations stand for about interval / size allocations.
+  EXPECT_NEAR(512.0, AllocationSiteProfiler::GetSampleWeight(1u, 512u), 1.0);
+  EXPECT_DOUBLE_EQ(1.0 / (1.0 - std::exp(-1.0)),
+                   AllocationSiteProfiler::GetSampleWeight(4 * KB, 4 * KB));
+}
+
+TEST_F(AllocationSiteProfilerTest, AggregatesPerSiteAndType) {
+  Thread* self = Thread::Current();
+  AllocationSiteProfiler::Reset();
+  {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i != 3u; ++i) {
+      AllocationSiteProfiler::RecordSample(
+          self, GetClassRoot<mirror::Object>(), /* byte_count= */ 4 * KB, 4 * KB);
+    }
+    AllocationSiteProfiler::RecordSample(
+        self, GetClassRoot<mirror::String>(), /* byte_count= */ 64 * KB, 4 * KB);
+  }
+  std::ostringstream oss;
+  AllocationSiteProfiler::Dump(oss);
+  std::string pprof = AllocationSiteProfiler::DumpPprof();
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("4 samples at 2 sites")) << dump;
+  // The larger String allocation comes first.
+  size_t string_pos = dump.find("java.lang.String at <unknown>: samples=1");
+  size_t object_pos = dump.find("java.lang.Object at <unknown>: samples=3");
+  EXPECT_NE(std::string::npos, string_pos) << dump;
+  EXPECT_NE(std::string::npos, object_pos) << dump;
+  EXPECT_LT(string_pos, object_pos) << dump;
+  EXPECT_NE(std::string::npos, pprof.find("java.lang.String"));
+  EXPECT_NE(std::string::npos, pprof.find("object type"));
+  AllocationSiteProfiler::Reset();
+}
+
+// Returns the samples of `type` printed by `AllocationSiteProfiler::Dump` for allocations without
+// a Java frame, or 0 if there are none.
+static uint64_t GetSamplesWithoutFrame(const std::string& dump, const std::string& type) {
+  std::string prefix = "  " + type + " at <unknown>: samples=";
+  size_t pos = dump.find(prefix);
+  if (pos == std::string::npos) {
+    return 0u;
+  }
+  return std::stoull(dump.substr(pos + prefix.size()));
+}
+
+TEST_F(AllocationSiteProfilerTest, SamplesAllocations) {
+  Thread* self = Thread::Current();
+  AllocationSiteProfiler::Reset();
+  AllocationSiteProfiler::Enable(/* sampling_interval= */ 4 * KB);
+  {
+    ScopedObjectAccess soa(self);
+    // Small arrays are allocated in thread-local buffers. The sampler reports them before their
+    // class is set, and they are recorded when the allocation completes.
+    for (size_t i = 0; i != 2 * KB; ++i) {
+      ASSERT_TRUE(mirror::IntArray::Alloc(self, /* length= */ 256u) != nullptr);
+      ASSERT_EQ(0u, self->GetPendingAllocationSampleBytes());
+    }
+    // Large arrays are reported once they are initialized.
+    ASSERT_TRUE(mirror::ByteArray::Alloc(self, /* length= */ 1 * MB) != nullptr);
+    ASSERT_EQ(0u, self->GetPendingAllocationSampleBytes());
+  }
+  AllocationSiteProfiler::Disable();
+
+  std::ostringstream oss;
+  AllocationSiteProfiler::Dump(oss);
+  std::string dump = oss.str();
+  // About 2MiB of int arrays were allocated, so expect about 500 samples. The first thread-local
+  // buffer was allocated before the profiler was enabled and is not sampled.
+  EXPECT_GT(GetSamplesWithoutFrame(dump, "int[]"), 200u) << dump;
+  EXPECT_LT(GetSamplesWithoutFrame(dump, "int[]"), 1000u) << dump;
+  // An allocation 256 times the interval is sampled once with a weight of about 1.
+  EXPECT_EQ(1u, GetSamplesWithoutFrame(dump, "byte[]")) << dump;
+  AllocationSiteProfiler::Reset();
+}
+
+}  // namespace art
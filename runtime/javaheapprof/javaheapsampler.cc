@@ -17,11 +17,14 @@
 #include "base/atomic.h"
 #include "base/locks.h"
 #include "gc/heap.h"
+#include "javaheapprof/allocation_site_profiler.h"
 #include "javaheapprof/javaheapsampler.h"
+#include "mirror/object-inl.h"
 #ifdef ART_TARGET_ANDROID
 #include "perfetto/heap_profile.h"
 #endif
 #include "runtime.h"
+#include "thread-current-inl.h"
 
 namespace art HIDDEN {
 
@@ -61,13 +64,28 @@ size_t HeapSampler::PickAndAdjustNextSample(size_t sample_adjust_bytes) {
 // Also bytes_until_sample can only be updated after the allocation and reporting is done.
 // Thus next bytes_until_sample is previously calculated (before allocation) to be able to
 // get the next tlab_size, but only saved/updated here.
-void HeapSampler::ReportSample(art::mirror::Object* obj, size_t allocation_size) {
-  VLOG(heap) << "JHP:***Report Perfetto Allocation: alloc_size: " << allocation_size;
-  uint64_t perf_alloc_id = reinterpret_cast<uint64_t>(obj);
-  VLOG(heap) << "JHP:***Report Perfetto Allocation: obj: " << perf_alloc_id;
+// Objects are only reported from the allocation paths, which hold the mutator lock.
+void HeapSampler::ReportSample(art::mirror::Object* obj, size_t allocation_size)
+    NO_THREAD_SAFETY_ANALYSIS {
+  if (enabled_.load(std::memory_order_acquire)) {
+    VLOG(heap) << "JHP:***Report Perfetto Allocation: alloc_size: " << allocation_size;
+    uint64_t perf_alloc_id = reinterpret_cast<uint64_t>(obj);
+    VLOG(heap) << "JHP:***Report Perfetto Allocation: obj: " << perf_alloc_id;
 #ifdef ART_TARGET_ANDROID
-  AHeapProfile_reportSample(perfetto_heap_id_, perf_alloc_id, allocation_size);
+    AHeapProfile_reportSample(perfetto_heap_id_, perf_alloc_id, allocation_size);
 #endif
+  }
+  if (site_profiling_enabled_.load(std::memory_order_acquire) && obj != nullptr) {
+    Thread* self = Thread::Current();
+    // TLAB samples are reported before the pre-fence visitor sets the class. Leave those to
+    // `Heap::AllocObjectWithAllocator`, which records them once the object is initialized.
+    ObjPtr<mirror::Class> klass = obj->GetClass<kVerifyNone, kWithoutReadBarrier>();
+    if (klass != nullptr) {
+      AllocationSiteProfiler::RecordSample(self, klass, allocation_size, GetSamplingInterval());
+    } else {
+      self->SetPendingAllocationSampleBytes(allocation_size);
+    }
+  }
 }
 
 // Check whether we should take a sample or not at this allocation and calculate the sample
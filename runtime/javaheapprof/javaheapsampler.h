@@ -51,7 +51,14 @@ class HeapSampler {
   void DisableHeapSampler() {
     enabled_.store(false, std::memory_order_release);
   }
-  // Report a sample to Perfetto.
+  // Also sample allocations for the `AllocationSiteProfiler`, independently of Perfetto.
+  void EnableSiteProfiling() {
+    site_profiling_enabled_.store(true, std::memory_order_release);
+  }
+  void DisableSiteProfiling() {
+    site_profiling_enabled_.store(false, std::memory_order_release);
+  }
+  // Report a sample to Perfetto and/or the allocation site profiler.
   void ReportSample(art::mirror::Object* obj, size_t allocation_size);
   // Check whether we should take a sample or not at this allocation, and return the
   // number of bytes from current pos to the next sample to use in the expand Tlab
@@ -68,7 +75,10 @@ class HeapSampler {
   // of new Tlab after Reset.
   void AdjustSampleOffset(size_t adjustment);
   // Is heap sampler enabled?
-  bool IsEnabled() { return enabled_.load(std::memory_order_acquire); }
+  bool IsEnabled() {
+    return enabled_.load(std::memory_order_acquire) ||
+           site_profiling_enabled_.load(std::memory_order_acquire);
+  }
   // Set the sampling interval.
   void SetSamplingInterval(int sampling_interval) REQUIRES(!geo_dist_rng_lock_);
   // Return the sampling interval.
@@ -81,6 +91,7 @@ class HeapSampler {
   size_t PickAndAdjustNextSample(size_t sample_adj_bytes = 0) REQUIRES(!geo_dist_rng_lock_);
 
   std::atomic<bool> enabled_{false};
+  std::atomic<bool> site_profiling_enabled_{false};
   // Default sampling interval is 4kb.
   // Writes guarded by geo_dist_rng_lock_.
   std::atomic<int> p_sampling_interval_{4 * 1024};
@@ -23,6 +23,7 @@
 #include <unistd.h>
 
 #include "android-base/strings.h"
+#include "android-base/unique_fd.h"
 #include "art_method-inl.h"
 #include "base/compiler_filter.h"
 #include "base/logging.h"  // For VLOG.
@@ -93,6 +94,7 @@ ProfileSaver::ProfileSaver(const ProfileSaverOptions& options, jit::JitCodeCache
       total_number_of_code_cache_queries_(0),
       total_number_of_skipped_writes_(0),
       total_number_of_failed_writes_(0),
+      total_number_of_methods_in_reference_profile_(0),
       total_ms_of_sleep_(0),
       total_ns_of_work_(0),
       total_number_of_hot_spikes_(0),
@@ -823,13 +825,14 @@ bool ProfileSaver::ProcessProfilingInfo(bool force_save, /*out*/uint16_t* number
                      << " last_save_number_of_classes=" << last_save_number_of_classes
                      << " number of profiled methods=" << profile_methods.size();
 
+      const Hotness::Flag flags =
+          AnnotateSampleFlags(Hotness::kFlagHot | Hotness::kFlagPostStartup);
+      FilterMethodsInReferenceProfile(filename, flags, &profile_methods);
+
       // Try to add the method data. Note this may fail is the profile loaded from disk contains
       // outdated data (e.g. the previous profiled dex files might have been updated).
       // If this happens we clear the profile data and for the save to ensure the file is cleared.
-      if (!info.AddMethods(
-              profile_methods,
-              AnnotateSampleFlags(Hotness::kFlagHot | Hotness::kFlagPostStartup),
-              GetProfileSampleAnnotation())) {
+      if (!info.AddMethods(profile_methods, flags, GetProfileSampleAnnotation())) {
         LOG(WARNING) << "Could not add methods to the existing profiler. "
             << "Clearing the profile data.";
         info.ClearData();
@@ -1164,6 +1167,8 @@ void ProfileSaver::DumpInfo(std::ostream& os) {
      << total_number_of_code_cache_queries_ << '\n'
      << "ProfileSaver total_number_of_skipped_writes=" << total_number_of_skipped_writes_ << '\n'
      << "ProfileSaver total_number_of_failed_writes=" << total_number_of_failed_writes_ << '\n'
+     << "ProfileSaver total_number_of_methods_in_reference_profile="
+     << total_number_of_methods_in_reference_profile_ << '\n'
      << "ProfileSaver total_ms_of_sleep=" << total_ms_of_sleep_ << '\n'
      << "ProfileSaver total_ms_of_work=" << NsToMs(total_ns_of_work_) << '\n'
      << "ProfileSaver total_number_of_hot_spikes=" << total_number_of_hot_spikes_ << '\n'
@@ -1247,6 +1252,49 @@ uint32_t ProfileSaver::GetExtraMethodHotnessFlags(const ProfileSaverOptions& opt
   }
 }
 
+void ProfileSaver::FilterMethodsInReferenceProfile(
+    const std::string& output_filename,
+    uint32_t flags,
+    /*inout*/ std::vector<ProfileMethodInfo>* profile_methods) {
+  std::string ref_profile_filename;
+  {
+    MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+    auto it = tracked_profiles_.find(output_filename);
+    if (it != tracked_profiles_.end()) {
+      ref_profile_filename = it->second;
+    }
+  }
+  if (ref_profile_filename.empty() || profile_methods->empty()) {
+    return;
+  }
+  // The app cannot write its reference profile, so open it read-only without locking it.
+  android::base::unique_fd fd(open(ref_profile_filename.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    return;
+  }
+  std::string error_msg;
+  std::unique_ptr<ProfileCompilationInfo::MappedProfile> ref_profile =
+      ProfileCompilationInfo::MappedProfile::Open(fd.get(), &error_msg);
+  if (ref_profile == nullptr ||
+      ref_profile->IsForBootImage() != options_.GetProfileBootClassPath()) {
+    VLOG(profiler) << "Cannot map reference profile " << ref_profile_filename << ": " << error_msg;
+    return;
+  }
+  std::vector<ProfileMethodInfo> new_methods;
+  new_methods.reserve(profile_methods->size());
+  for (ProfileMethodInfo& method : *profile_methods) {
+    if (method.inline_caches.empty() &&
+        (ref_profile->GetMethodHotness(method.ref).GetFlags() & flags) == flags) {
+      continue;
+    }
+    new_methods.push_back(std::move(method));
+  }
+  VLOG(profiler) << (profile_methods->size() - new_methods.size()) << " of "
+                 << profile_methods->size() << " methods already in " << ref_profile_filename;
+  total_number_of_methods_in_reference_profile_ += profile_methods->size() - new_methods.size();
+  *profile_methods = std::move(new_methods);
+}
+
 Hotness::Flag ProfileSaver::AnnotateSampleFlags(uint32_t flags) {
   uint32_t extra_flags = GetExtraMethodHotnessFlags(options_);
   return static_cast<Hotness::Flag>(flags | extra_flags);
@@ -109,6 +109,15 @@ class ProfileSaver {
   // profile saver session.
   ProfileCompilationInfo::ProfileSampleAnnotation GetProfileSampleAnnotation();
 
+  // Removes from `profile_methods` the methods without inline caches that the reference profile
+  // of `output_filename` already has with all of `flags`: saving them adds no information.
+  // The reference profile is only read if it was saved in the mappable layout, loading it
+  // completely on every save would cost more than the writes it may avoid.
+  void FilterMethodsInReferenceProfile(const std::string& output_filename,
+                                       uint32_t flags,
+                                       /*inout*/ std::vector<ProfileMethodInfo>* profile_methods)
+      REQUIRES(!Locks::profiler_lock_);
+
   // Get extra global flags if necessary (e.g. the running architecture), otherwise 0.
   static uint32_t GetExtraMethodHotnessFlags(const ProfileSaverOptions& options);
 
@@ -166,6 +175,7 @@ class ProfileSaver {
   uint64_t total_number_of_code_cache_queries_;
   uint64_t total_number_of_skipped_writes_;
   uint64_t total_number_of_failed_writes_;
+  uint64_t total_number_of_methods_in_reference_profile_;
   uint64_t total_ms_of_sleep_;
   uint64_t total_ns_of_work_;
   // TODO(calin): replace with an actual size.
@@ -16,6 +16,7 @@
 
 #include <gtest/gtest.h>
 
+#include "base/mutex.h"
 #include "common_runtime_test.h"
 #include "compiler_callbacks.h"
 #include "jit/jit.h"
@@ -59,6 +60,17 @@ class ProfileSaverTest : public CommonRuntimeTest {
     return profile_saver_->AnnotateSampleFlags(flags);
   }
 
+  void FilterMethodsInReferenceProfile(const std::string& output_filename,
+                                       const std::string& ref_profile_filename,
+                                       uint32_t flags,
+                                       std::vector<ProfileMethodInfo>* profile_methods) {
+    {
+      MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+      profile_saver_->AddTrackedLocations(output_filename, {}, ref_profile_filename);
+    }
+    profile_saver_->FilterMethodsInReferenceProfile(output_filename, flags, profile_methods);
+  }
+
  protected:
   ProfileSaver* profile_saver_ = nullptr;
 };
@@ -103,4 +115,50 @@ TEST_F(ProfileSaverTest, AnnotateSampleFlags) {
   ASSERT_EQ(Hotness::kFlagHot, actual);
 }
 
+TEST_F(ProfileSaverTest, FilterMethodsInReferenceProfile) {
+  const DexFile* dex = java_lang_dex_file_;
+  ASSERT_GE(dex->NumMethodIds(), 4u);
+  const Hotness::Flag flags = static_cast<Hotness::Flag>(Hotness::kFlagHot |
+                                                         Hotness::kFlagPostStartup);
+  // Method 0 is in the reference profile with the saved flags, method 1 without the
+  // post-startup flag, method 2 with the saved flags but gets inline caches.
+  ProfileCompilationInfo ref_info;
+  ASSERT_TRUE(ref_info.AddMethod(ProfileMethodInfo(MethodReference(dex, 0)), flags));
+  ASSERT_TRUE(ref_info.AddMethod(ProfileMethodInfo(MethodReference(dex, 1)), Hotness::kFlagHot));
+  ASSERT_TRUE(ref_info.AddMethod(ProfileMethodInfo(MethodReference(dex, 2)), flags));
+  auto get_methods = [&]() {
+    std::vector<ProfileMethodInfo> methods;
+    for (uint32_t i = 0; i != 4u; ++i) {
+      methods.emplace_back(MethodReference(dex, i));
+    }
+    methods[2].inline_caches.emplace_back(
+        /*pc=*/ 0u, /*missing_types=*/ true, std::vector<TypeReference>());
+    return methods;
+  };
+
+  // A reference profile that is not mappable is not read.
+  ScratchFile output_profile;
+  ScratchFile ref_profile;
+  ASSERT_TRUE(ref_info.Save(ref_profile.GetFd()));
+  ASSERT_EQ(0, ref_profile.GetFile()->Flush());
+  std::vector<ProfileMethodInfo> methods = get_methods();
+  FilterMethodsInReferenceProfile(
+      output_profile.GetFilename(), ref_profile.GetFilename(), flags, &methods);
+  EXPECT_EQ(4u, methods.size());
+
+  // Only method 0 is entirely covered by the mappable reference profile.
+  ScratchFile other_output_profile;
+  ScratchFile mappable_ref_profile;
+  ref_info.SetSaveMappable(true);
+  ASSERT_TRUE(ref_info.Save(mappable_ref_profile.GetFd()));
+  ASSERT_EQ(0, mappable_ref_profile.GetFile()->Flush());
+  methods = get_methods();
+  FilterMethodsInReferenceProfile(
+      other_output_profile.GetFilename(), mappable_ref_profile.GetFilename(), flags, &methods);
+  ASSERT_EQ(3u, methods.size());
+  EXPECT_EQ(1u, methods[0].ref.index);
+  EXPECT_EQ(2u, methods[1].ref.index);
+  EXPECT_EQ(3u, methods[2].ref.index);
+}
+
 }  // namespace art
@@ -112,6 +112,21 @@ void JNIEnvExt::DeleteLocalRef(jobject obj) {
   }
 }
 
+void JNIEnvExt::AddLocalReferences(ArrayRef<const ObjPtr<mirror::Object>> objs,
+                                   /*out*/ jobject* refs) {
+  std::string error_msg;
+  if (UNLIKELY(!locals_.AddBatch(objs, reinterpret_cast<IndirectRef*>(refs), &error_msg))) {
+    // This is really unexpected if we allow resizing LRTs...
+    LOG(FATAL) << error_msg;
+    UNREACHABLE();
+  }
+}
+
+void JNIEnvExt::DeleteLocalRefs(ArrayRef<const jobject> refs) {
+  locals_.RemoveBatch(ArrayRef<const IndirectRef>(
+      reinterpret_cast<const IndirectRef*>(refs.data()), refs.size()));
+}
+
 void JNIEnvExt::SetCheckJniEnabled(bool enabled) {
   check_jni_ = enabled;
   locals_.SetCheckJniEnabled(enabled);
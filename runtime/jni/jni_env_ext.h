@@ -69,6 +69,15 @@ class JNIEnvExt : public JNIEnv {
   EXPORT jobject NewLocalRef(mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_);
   EXPORT void DeleteLocalRef(jobject obj) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Batch versions of `AddLocalReference()` and `DeleteLocalRef()` for native code that
+  // creates and drops many local references at once. See `LocalReferenceTable::AddBatch()`
+  // and `LocalReferenceTable::RemoveBatch()`.
+  EXPORT void AddLocalReferences(ArrayRef<const ObjPtr<mirror::Object>> objs,
+                                 /*out*/ jobject* refs)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  EXPORT void DeleteLocalRefs(ArrayRef<const jobject> refs)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   void TrimLocals() REQUIRES_SHARED(Locks::mutator_lock_) {
     locals_.Trim();
   }
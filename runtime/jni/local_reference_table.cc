@@ -32,6 +32,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace art HIDDEN {
@@ -405,6 +406,68 @@ IndirectRef LocalReferenceTable::Add(ObjPtr<mirror::Object> obj, std::string* er
   return store_obj(free_entry, "slow-path");
 }
 
+bool LocalReferenceTable::AddBatch(ArrayRef<const ObjPtr<mirror::Object>> objs,
+                                   /*out*/ IndirectRef* refs,
+                                   std::string* error_msg) {
+  if (UNLIKELY(IsCheckJniEnabled())) {
+    // CheckJNI entries need serial numbers and padding, use the regular path.
+    for (size_t i = 0; i != objs.size(); ++i) {
+      if (objs[i] == nullptr) {
+        refs[i] = nullptr;
+        continue;
+      }
+      refs[i] = Add(objs[i], error_msg);
+      if (refs[i] == nullptr) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t count = std::count_if(objs.begin(),
+                               objs.end(),
+                               [](ObjPtr<mirror::Object> obj) { return obj != nullptr; });
+  if (count == 0u) {
+    std::fill_n(refs, objs.size(), nullptr);
+    return true;
+  }
+
+  DCHECK_LE(previous_state_.top_index, segment_state_.top_index);
+  // Entries of popped segments must not remain on the free list once we move the top over them.
+  uint32_t first_free_index = GetFirstFreeIndex();
+  if (first_free_index != kFreeListEnd && first_free_index >= segment_state_.top_index) {
+    PrunePoppedFreeEntries([&](size_t index) { return GetEntry(index); });
+  }
+  if (!EnsureFreeCapacity(count, error_msg)) {
+    std::ostringstream oss;
+    oss << "JNI ERROR (app bug): " << kLocal << " table overflow "
+        << "(max=" << max_entries_ << ")" << std::endl
+        << MutatorLockedDumpable<LocalReferenceTable>(*this)
+        << " Resizing failed: " << *error_msg;
+    *error_msg = oss.str();
+    return false;
+  }
+
+  uint32_t top_index = segment_state_.top_index;
+  for (size_t i = 0; i != objs.size(); ++i) {
+    ObjPtr<mirror::Object> obj = objs[i];
+    if (obj == nullptr) {
+      refs[i] = nullptr;
+      continue;
+    }
+    VerifyObject(obj);
+    LrtEntry* free_entry = GetEntry(top_index);
+    ++top_index;
+    free_entry->SetReference(obj);
+    refs[i] = ToIndirectRef(free_entry);
+  }
+  segment_state_.top_index = top_index;
+  if (kDebugLRT) {
+    LOG(INFO) << "+++ AddBatch: added " << count << ", top=" << segment_state_.top_index;
+  }
+  return true;
+}
+
 // Removes an object.
 //
 // This method is not called when a local frame is popped; this is only used
@@ -593,6 +656,14 @@ bool LocalReferenceTable::Remove(IndirectRef iref) {
   return true;
 }
 
+void LocalReferenceTable::RemoveBatch(ArrayRef<const IndirectRef> refs) {
+  for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+    if (*it != nullptr) {
+      Remove(*it);
+    }
+  }
+}
+
 void LocalReferenceTable::AssertEmpty() {
   CHECK_EQ(Capacity(), 0u) << "Internal Error: non-empty local reference table.";
 }
@@ -25,6 +25,7 @@
 
 #include <android-base/logging.h>
 
+#include "base/array_ref.h"
 #include "base/bit_field.h"
 #include "base/bit_utils.h"
 #include "base/casts.h"
@@ -271,6 +272,16 @@ class LocalReferenceTable {
   EXPORT IndirectRef Add(ObjPtr<mirror::Object> obj, std::string* error_msg)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Add new entries for `objs`, storing the references in `refs`. Null objects are not added
+  // and get a null reference. With CheckJNI disabled, this grows the table at most once and
+  // fills consecutive entries at the top of the current segment instead of reusing holes.
+  // Returns false if an error happened (with an appropriate error message set), in which
+  // case some of the objects may have been added already.
+  EXPORT bool AddBatch(ArrayRef<const ObjPtr<mirror::Object>> objs,
+                       /*out*/ IndirectRef* refs,
+                       std::string* error_msg)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Given an `IndirectRef` in the table, return the `Object` it refers to.
   //
   // This function may abort under error conditions in debug build.
@@ -293,6 +304,13 @@ class LocalReferenceTable {
   bool Remove(IndirectRef iref)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Remove existing entries as if by `Remove()`, ignoring null references. The references
+  // are removed in reverse order, so that references added in sequence, for example by
+  // `AddBatch()`, are popped from the top of the segment instead of being turned into holes
+  // that need to be pruned later.
+  EXPORT void RemoveBatch(ArrayRef<const IndirectRef> refs)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   void AssertEmpty();
 
   void Dump(std::ostream& os) const
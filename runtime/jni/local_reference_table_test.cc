@@ -43,6 +43,7 @@ class LocalReferenceTableTest : public CommonRuntimeTest {
   void BasicResizeTest(bool check_jni, size_t max_count);
   void TestAddRemove(bool check_jni, size_t max_count, size_t fill_count = 0u);
   void TestAddRemoveMixed(bool start_check_jni);
+  void TestAddRemoveBatch(bool check_jni);
 };
 
 void LocalReferenceTableTest::CheckDump(
@@ -778,6 +779,63 @@ TEST_F(LocalReferenceTableTest, TestAddRemoveMixed) {
   TestAddRemoveMixed(/*start_check_jni=*/ true);
 }
 
+void LocalReferenceTableTest::TestAddRemoveBatch(bool check_jni) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c = hs.NewHandle(GetClassRoot<mirror::Object>());
+  ASSERT_TRUE(c != nullptr);
+  Handle<mirror::Object> obj0 = hs.NewHandle(c->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj0 != nullptr);
+
+  std::string error_msg;
+  LocalReferenceTable lrt(check_jni);
+  bool success = lrt.Initialize(kSmallLrtEntries, &error_msg);
+  ASSERT_TRUE(success) << error_msg;
+
+  IndirectRef first = lrt.Add(c.Get(), &error_msg);
+  ASSERT_TRUE(first != nullptr) << error_msg;
+
+  // Leave a hole on the free list in a popped segment.
+  LRTSegmentState cookie = lrt.PushFrame();
+  IndirectRef hole = lrt.Add(obj0.Get(), &error_msg);
+  ASSERT_TRUE(hole != nullptr) << error_msg;
+  ASSERT_TRUE(lrt.Add(obj0.Get(), &error_msg) != nullptr) << error_msg;
+  ASSERT_TRUE(lrt.Remove(hole));
+  lrt.PopFrame(cookie);
+  ASSERT_EQ(1u, lrt.Capacity());
+
+  // Add more references than fit in the small table, with a few nulls.
+  static constexpr size_t kBatchSize = 3u * kSmallLrtEntries;
+  std::vector<ObjPtr<mirror::Object>> objs(kBatchSize, obj0.Get());
+  objs[1] = nullptr;
+  objs[kBatchSize - 1u] = nullptr;
+  std::vector<IndirectRef> refs(kBatchSize);
+  ASSERT_TRUE(lrt.AddBatch(ArrayRef<const ObjPtr<mirror::Object>>(objs), refs.data(), &error_msg))
+      << error_msg;
+  EXPECT_EQ(1u + kBatchSize - 2u, lrt.Capacity());
+  for (size_t i = 0; i != kBatchSize; ++i) {
+    if (objs[i] == nullptr) {
+      EXPECT_TRUE(refs[i] == nullptr);
+    } else {
+      ASSERT_TRUE(refs[i] != nullptr);
+      EXPECT_OBJ_PTR_EQ(obj0.Get(), lrt.Get(refs[i]));
+    }
+  }
+  EXPECT_OBJ_PTR_EQ(c.Get(), lrt.Get(first));
+
+  lrt.RemoveBatch(ArrayRef<const IndirectRef>(refs));
+  EXPECT_EQ(1u, lrt.Capacity());
+  EXPECT_OBJ_PTR_EQ(c.Get(), lrt.Get(first));
+}
+
+TEST_F(LocalReferenceTableTest, TestAddRemoveBatch) {
+  TestAddRemoveBatch(/*check_jni=*/ false);
+}
+
+TEST_F(LocalReferenceTableTest, TestAddRemoveBatchCheckJNI) {
+  TestAddRemoveBatch(/*check_jni=*/ true);
+}
+
 TEST_F(LocalReferenceTableTest, RegressionTestB276210372) {
   LocalReferenceTable lrt(/*check_jni=*/ false);
   std::string error_msg;
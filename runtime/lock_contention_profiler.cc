@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profiler.h"
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "base/mutex-inl.h"
+#include "base/time_utils.h"
+#include "barrier.h"
+#include "closure.h"
+#include "monitor.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+#include "thread.h"
+#include "thread_list.h"
+
+namespace art HIDDEN {
+
+std::atomic<bool> LockContentionProfiler::enabled_(false);
+Mutex LockContentionProfiler::lock_("lock contention profiler lock", kGenericBottomLock);
+std::map<std::string, LockContentionProfiler::ContentionSite> LockContentionProfiler::sites_;
+
+size_t LockContentionProfiler::GetWaitHistogramBucket(uint64_t wait_ns) {
+  uint64_t wait_ms = NsToMs(wait_ns);
+  if (wait_ms == 0u) {
+    return 0u;
+  }
+  size_t bucket = MinimumBitsToStore(wait_ms);
+  return std::min(bucket, kNumWaitHistogramBuckets - 1u);
+}
+
+std::string LockContentionProfiler::PrettyLocation(ArtMethod* method, uint32_t dex_pc) {
+  if (method == nullptr) {
+    return "<unknown>";
+  }
+  const char* filename;
+  int32_t line_number;
+  Monitor::TranslateLocation(method, dex_pc, &filename, &line_number);
+  std::ostringstream oss;
+  oss << method->PrettyMethod() << " (" << (filename != nullptr ? filename : "null") << ":"
+      << line_number << ")";
+  return oss.str();
+}
+
+void LockContentionProfiler::RecordContention(Thread* self,
+                                              ArtMethod* method,
+                                              uint32_t dex_pc,
+                                              ArtMethod* owner_method,
+                                              uint32_t owner_dex_pc,
+                                              uint64_t wait_ns,
+                                              std::string&& owner_stack) {
+  DCHECK_EQ(self, Thread::Current());
+  LockContentionBuffer* buffer = self->GetLockContentionBuffer();
+  if (buffer == nullptr) {
+    buffer = new LockContentionBuffer();
+    self->SetLockContentionBuffer(buffer);
+  } else if (buffer->IsFull()) {
+    FlushThreadBuffer(self);
+    buffer = new LockContentionBuffer();
+    self->SetLockContentionBuffer(buffer);
+  }
+  LockContentionSample sample;
+  sample.location = PrettyLocation(method, dex_pc);
+  sample.owner_location = PrettyLocation(owner_method, owner_dex_pc);
+  sample.wait_ns = wait_ns;
+  if (!owner_stack.empty()) {
+    // Owner stacks are only captured for long contentions, so record them directly.
+    MutexLock mu(self, lock_);
+    GetSite(sample.location).last_owner_stack = std::move(owner_stack);
+  }
+  buffer->Add(std::move(sample));
+}
+
+LockContentionProfiler::ContentionSite& LockContentionProfiler::GetSite(
+    const std::string& location) {
+  auto it = sites_.find(location);
+  if (it == sites_.end()) {
+    it = sites_.emplace(location, ContentionSite()).first;
+    it->second.location = location;
+  }
+  return it->second;
+}
+
+void LockContentionProfiler::MergeSample(const LockContentionSample& sample) {
+  ContentionSite& site = GetSite(sample.location);
+  ++site.count;
+  site.total_wait_ns += sample.wait_ns;
+  site.max_wait_ns = std::max(site.max_wait_ns, sample.wait_ns);
+  ++site.wait_histogram[GetWaitHistogramBucket(sample.wait_ns)];
+  ++site.owners[sample.owner_location];
+}
+
+void LockContentionProfiler::FlushThreadBuffer(Thread* thread) {
+  DCHECK(thread == Thread::Current() || thread->IsSuspended());
+  LockContentionBuffer* buffer = thread->GetLockContentionBuffer();
+  if (buffer == nullptr) {
+    return;
+  }
+  thread->SetLockContentionBuffer(nullptr);
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    for (const LockContentionSample& sample : *buffer) {
+      MergeSample(sample);
+    }
+  }
+  delete buffer;
+}
+
+class FlushLockContentionBufferClosure final : public Closure {
+ public:
+  explicit FlushLockContentionBufferClosure(Barrier* barrier) : barrier_(barrier) {}
+
+  void Run(Thread* thread) override REQUIRES_SHARED(Locks::mutator_lock_) {
+    LockContentionProfiler::FlushThreadBuffer(thread);
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Barrier* const barrier_;
+};
+
+void LockContentionProfiler::CollectThreadBuffers(Thread* self) {
+  Barrier barrier(0);
+  FlushLockContentionBufferClosure closure(&barrier);
+  size_t threads_running_checkpoint =
+      Runtime::Current()->GetThreadList()->RunCheckpoint(&closure,
+                                                         /* callback= */ nullptr,
+                                                         /* allow_lock_checking= */ true,
+                                                         /* acquire_mutator_lock= */ true);
+  if (threads_running_checkpoint != 0) {
+    ScopedThreadStateChange tsc(self, ThreadState::kWaitingForCheckPointsToRun);
+    barrier.Increment(self, threads_running_checkpoint);
+  }
+}
+
+void LockContentionProfiler::Dump(std::ostream& os) {
+  Thread* self = Thread::Current();
+  if (self != nullptr) {
+    CollectThreadBuffers(self);
+  }
+
+  MutexLock mu(self, lock_);
+  std::vector<const ContentionSite*> sorted_sites;
+  sorted_sites.reserve(sites_.size());
+  uint64_t total_count = 0u;
+  uint64_t total_wait_ns = 0u;
+  for (const auto& entry : sites_) {
+    sorted_sites.push_back(&entry.second);
+    total_count += entry.second.count;
+    total_wait_ns += entry.second.total_wait_ns;
+  }
+  std::sort(sorted_sites.begin(),
+            sorted_sites.end(),
+            [](const ContentionSite* lhs, const ContentionSite* rhs) {
+              return lhs->total_wait_ns > rhs->total_wait_ns;
+            });
+
+  os << "Monitor contention: " << total_count << " contended acquisitions at "
+     << sites_.size() << " sites, total wait " << PrettyDuration(total_wait_ns) << "\n";
+  size_t num_dumped = std::min(sorted_sites.size(), kMaxDumpedSites);
+  for (size_t i = 0; i != num_dumped; ++i) {
+    const ContentionSite& site = *sorted_sites[i];
+    os << "  " << site.location << ": count=" << site.count
+       << " total=" << PrettyDuration(site.total_wait_ns)
+       << " avg=" << PrettyDuration(site.count != 0u ? site.total_wait_ns / site.count : 0u)
+       << " max=" << PrettyDuration(site.max_wait_ns) << "\n";
+    os << "    wait histogram (ms):";
+    for (size_t bucket = 0; bucket != kNumWaitHistogramBuckets; ++bucket) {
+      if (site.wait_histogram[bucket] == 0u) {
+        continue;
+      }
+      uint64_t lower_bound_ms = (bucket == 0u) ? 0u : (UINT64_C(1) << (bucket - 1u));
+      os << " [" << lower_bound_ms;
+      if (bucket + 1u == kNumWaitHistogramBuckets) {
+        os << ",inf)";
+      } else {
+        os << "," << (UINT64_C(1) << bucket) << ")";
+      }
+      os << "=" << site.wait_histogram[bucket];
+    }
+    os << "\n";
+    for (const auto& owner_entry : site.owners) {
+      os << "    owner " << owner_entry.first << ": " << owner_entry.second << "\n";
+    }
+    if (!site.last_owner_stack.empty()) {
+      os << "    last long contention owner stack:\n" << site.last_owner_stack;
+    }
+  }
+  if (num_dumped != sorted_sites.size()) {
+    os << "  ... " << (sorted_sites.size() - num_dumped) << " more sites\n";
+  }
+}
+
+void LockContentionProfiler::DumpForSigQuit(std::ostream& os) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Dump(os);
+  os << "\n";
+}
+
+void LockContentionProfiler::Reset() {
+  MutexLock mu(Thread::Current(), lock_);
+  sites_.clear();
+}
+
+}  // namespace art
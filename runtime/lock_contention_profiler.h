@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
+#define ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+#include "base/locks.h"
+#include "base/macros.h"
+
+namespace art HIDDEN {
+
+class ArtMethod;
+class Thread;
+
+// A contended monitor acquisition, as seen by the thread that had to wait. Locations are resolved
+// when the sample is recorded: the methods may be unloaded before the buffer is merged.
+struct LockContentionSample {
+  std::string location;
+  std::string owner_location;
+  uint64_t wait_ns = 0u;
+};
+
+// Per-thread buffer of contention samples. Samples are only appended by the owning thread while
+// it is runnable, so the buffer can be drained either by the owning thread or by a checkpoint
+// without further synchronization.
+class LockContentionBuffer {
+ public:
+  static constexpr size_t kCapacity = 32;
+
+  LockContentionBuffer() : size_(0u) {}
+
+  bool IsFull() const { return size_ == kCapacity; }
+  bool IsEmpty() const { return size_ == 0u; }
+
+  void Add(LockContentionSample&& sample) {
+    DCHECK(!IsFull());
+    samples_[size_++] = std::move(sample);
+  }
+
+  const LockContentionSample* begin() const { return samples_.data(); }
+  const LockContentionSample* end() const { return samples_.data() + size_; }
+
+  void Clear() { size_ = 0u; }
+
+ private:
+  std::array<LockContentionSample, kCapacity> samples_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(LockContentionBuffer);
+};
+
+// Aggregates monitor contention events per contending source location. `Monitor::Lock` records
+// every contended acquisition while enabled, sharing the owner lookup it does for the sampled
+// `LogContentionEvent`, and captures the owner stack of contentions longer than `kLongWaitMs`
+// independently of `-Xstackdumplockprofthreshold`. Samples are first collected in a small
+// per-thread buffer and merged into the global table only when the buffer fills up, the thread
+// exits or a dump is requested.
+class LockContentionProfiler {
+ public:
+  // Wait time histogram buckets. Bucket 0 holds waits below 1ms, bucket `i` holds waits in
+  // [2^(i-1), 2^i) ms and the last bucket holds everything longer.
+  static constexpr size_t kNumWaitHistogramBuckets = 16;
+
+  // Maximum number of sites printed by `Dump`, sorted by total wait time.
+  static constexpr size_t kMaxDumpedSites = 20;
+
+  static void Enable() { enabled_.store(true, std::memory_order_relaxed); }
+  static void Disable() { enabled_.store(false, std::memory_order_relaxed); }
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records a contended acquisition of a monitor by `self`. The method locations are resolved
+  // immediately. `owner_stack` is the owner's Java stack if it was captured for a long
+  // contention, or empty.
+  static void RecordContention(Thread* self,
+                               ArtMethod* method,
+                               uint32_t dex_pc,
+                               ArtMethod* owner_method,
+                               uint32_t owner_dex_pc,
+                               uint64_t wait_ns,
+                               std::string&& owner_stack)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Merges the samples buffered by `thread` into the global table and releases the buffer.
+  // `thread` must be the current thread or suspended.
+  static void FlushThreadBuffer(Thread* thread) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Collects the buffered samples of all threads and prints the aggregated per-site data.
+  static void Dump(std::ostream& os) REQUIRES(!Locks::mutator_lock_);
+
+  // Same as `Dump`, but only if the profiler is enabled.
+  static void DumpForSigQuit(std::ostream& os) REQUIRES(!Locks::mutator_lock_);
+
+  // Drops all aggregated data.
+  static void Reset();
+
+  static size_t GetWaitHistogramBucket(uint64_t wait_ns);
+
+ private:
+  struct ContentionSite {
+    std::string location;
+    uint64_t count = 0u;
+    uint64_t total_wait_ns = 0u;
+    uint64_t max_wait_ns = 0u;
+    std::array<uint64_t, kNumWaitHistogramBuckets> wait_histogram = {};
+    // Number of contentions per owner location.
+    std::map<std::string, uint64_t> owners;
+    // Owner stack of the most recent contention long enough to trigger a stack dump.
+    std::string last_owner_stack;
+  };
+
+  static ContentionSite& GetSite(const std::string& location) REQUIRES(lock_);
+
+  static void MergeSample(const LockContentionSample& sample) REQUIRES(lock_);
+
+  static void CollectThreadBuffers(Thread* self) REQUIRES(!Locks::mutator_lock_);
+
+  static std::string PrettyLocation(ArtMethod* method, uint32_t dex_pc)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static std::atomic<bool> enabled_;
+  static Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+  // Sites keyed by their pretty location.
+  static std::map<std::string, ContentionSite> sites_ GUARDED_BY(lock_);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LockContentionProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profiler.h"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/string.h"
+#include "monitor.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+#include "thread_pool.h"
+
+namespace art HIDDEN {
+
+class LockContentionProfilerTest : public CommonRuntimeTest {};
+
+TEST_F(LockContentionProfilerTest, WaitHistogramBuckets) {
+  EXPECT_EQ(0u, LockContentionProfiler::GetWaitHistogramBucket(0u));
+  EXPECT_EQ(0u, LockContentionProfiler::GetWaitHistogramBucket(MsToNs(1u) - 1u));
+  EXPECT_EQ(1u, LockContentionProfiler::GetWaitHistogramBucket(MsToNs(1u)));
+  EXPECT_EQ(2u, LockContentionProfiler::GetWaitHistogramBucket(MsToNs(2u)));
+  EXPECT_EQ(2u, LockContentionProfiler::GetWaitHistogramBucket(MsToNs(3u)));
+  EXPECT_EQ(3u, LockContentionProfiler::GetWaitHistogramBucket(MsToNs(4u)));
+  EXPECT_EQ(LockContentionProfiler::kNumWaitHistogramBuckets - 1u,
+            LockContentionProfiler::GetWaitHistogramBucket(UINT64_MAX));
+}
+
+TEST_F(LockContentionProfilerTest, AggregatesPerSite) {
+  Thread* self = Thread::Current();
+  LockContentionProfiler::Reset();
+  {
+    ScopedObjectAccess soa(self);
+    // Overflow the per-thread buffer at least once.
+    for (size_t i = 0; i != 2 * LockContentionBuffer::kCapacity + 1u; ++i) {
+      LockContentionProfiler::RecordContention(self,
+                                               /* method= */ nullptr,
+                                               /* dex_pc= */ 0u,
+                                               /* owner_method= */ nullptr,
+                                               /* owner_dex_pc= */ 0u,
+                                               MsToNs(5u),
+                                               /* owner_stack= */ "");
+    }
+  }
+  std::ostringstream oss;
+  {
+    ScopedThreadSuspension sts(self, ThreadState::kNative);
+    LockContentionProfiler::Dump(oss);
+  }
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("65 contended acquisitions at 1 sites")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("[4,8)=65")) << dump;
+  EXPECT_TRUE(self->GetLockContentionBuffer() == nullptr);
+  LockContentionProfiler::Reset();
+}
+
+TEST_F(LockContentionProfilerTest, RecordsMonitorContention) {
+  Thread* self = Thread::Current();
+  LockContentionProfiler::Reset();
+  LockContentionProfiler::Enable();
+  std::unique_ptr<ThreadPool> thread_pool(ThreadPool::Create("Contention test pool", 1u));
+  {
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::Object> lock(hs.NewHandle<mirror::Object>(
+        mirror::String::AllocFromModifiedUtf8(self, "lock")));
+    ASSERT_TRUE(lock != nullptr);
+    Monitor::MonitorEnter(self, lock.Get(), /* trylock= */ false);
+
+    std::atomic<Thread*> contender(nullptr);
+    thread_pool->AddTask(self, new FunctionTask([&](Thread* worker) {
+      ScopedObjectAccess worker_soa(worker);
+      contender.store(worker, std::memory_order_release);
+      ObjPtr<mirror::Object> obj =
+          Monitor::MonitorEnter(worker, lock.Get(), /* trylock= */ false);
+      Monitor::MonitorExit(worker, obj);
+    }));
+    thread_pool->StartWorkers(self);
+
+    {
+      // Let the contender inflate the lock and block in `Monitor::Lock`.
+      ScopedThreadSuspension sts(self, ThreadState::kNative);
+      while (contender.load(std::memory_order_acquire) == nullptr ||
+             contender.load(std::memory_order_acquire)->GetState() != ThreadState::kBlocked) {
+        usleep(1000);
+      }
+      usleep(5000);
+    }
+    Monitor::MonitorExit(self, lock.Get());
+    {
+      ScopedThreadSuspension sts(self, ThreadState::kNative);
+      thread_pool->Wait(self, /* do_work= */ false, /* may_hold_locks= */ false);
+    }
+  }
+  thread_pool->StopWorkers(self);
+  LockContentionProfiler::Disable();
+
+  std::ostringstream oss;
+  {
+    ScopedThreadSuspension sts(self, ThreadState::kNative);
+    LockContentionProfiler::Dump(oss);
+  }
+  std::string dump = oss.str();
+  // The buffered sample of the worker is collected by the dump checkpoint.
+  EXPECT_NE(std::string::npos, dump.find("1 contended acquisitions at 1 sites")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("count=1")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("    owner ")) << dump;
+  LockContentionProfiler::Reset();
+}
+
+}  // namespace art
@@ -32,6 +32,7 @@
 #include "dex/dex_instruction-inl.h"
 #include "entrypoints/entrypoint_utils-inl.h"
 #include "gc/verification-inl.h"
+#include "lock_contention_profiler.h"
 #include "lock_word-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -455,8 +456,9 @@ void Monitor::Lock(Thread* self) {
     return;
   }
   // Contended; not reentrant. We hold no locks, so tread carefully.
-  const bool log_contention = (lock_profiling_threshold_ != 0);
-  uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
+  const bool profile_contention = LockContentionProfiler::IsEnabled();
+  const bool log_contention = (lock_profiling_threshold_ != 0) || profile_contention;
+  uint64_t wait_start_ns = log_contention ? NanoTime() : 0;
 
   Thread *orig_owner = nullptr;
   ArtMethod* owners_method;
@@ -525,14 +527,19 @@ void Monitor::Lock(Thread* self) {
 
     if (log_contention && orig_owner != nullptr) {
       // Woken from contention.
-      uint64_t wait_ms = MilliTime() - wait_start_ms;
-      uint32_t sample_percent;
-      if (wait_ms >= lock_profiling_threshold_) {
-        sample_percent = 100;
-      } else {
-        sample_percent = 100 * wait_ms / lock_profiling_threshold_;
+      uint64_t wait_ns = NanoTime() - wait_start_ns;
+      uint64_t wait_ms = NsToMs(wait_ns);
+      uint32_t sample_percent = 0;
+      if (lock_profiling_threshold_ != 0) {
+        if (wait_ms >= lock_profiling_threshold_) {
+          sample_percent = 100;
+        } else {
+          sample_percent = 100 * wait_ms / lock_profiling_threshold_;
+        }
       }
-      if (sample_percent != 0 && (static_cast<uint32_t>(rand() % 100) < sample_percent)) {
+      const bool sample_event =
+          sample_percent != 0 && (static_cast<uint32_t>(rand() % 100) < sample_percent);
+      if (sample_event || profile_contention) {
         // Do this unconditionally for consistency. It's possible another thread
         // snuck in in the middle, and tracing was enabled. In that case, we may get its
         // MonitorEnter information. We can live with that.
@@ -541,8 +548,14 @@ void Monitor::Lock(Thread* self) {
         // Reacquire mutator_lock_ for logging.
         ScopedObjectAccess soa(self);
 
-        const bool should_dump_stacks = stack_dump_lock_profiling_threshold_ > 0 &&
+        const bool should_dump_stacks = sample_event &&
+            stack_dump_lock_profiling_threshold_ > 0 &&
             wait_ms > stack_dump_lock_profiling_threshold_;
+        // The contention profiler keeps the owner stack of every long contention, regardless of
+        // the stack dump threshold.
+        const bool collect_owner_stack =
+            should_dump_stacks || (profile_contention && wait_ms > kLongWaitMs);
+        std::string owner_stack_dump;
 
         // Acquire thread-list lock to find thread and keep it from dying until we've got all
         // the info we need.
@@ -554,9 +567,8 @@ void Monitor::Lock(Thread* self) {
           uint32_t original_owner_tid = orig_owner->GetTid();  // System thread id.
           std::string original_owner_name;
           orig_owner->GetThreadName(original_owner_name);
-          std::string owner_stack_dump;
 
-          if (should_dump_stacks) {
+          if (collect_owner_stack) {
             // Very long contention. Dump stacks.
             struct CollectStackTrace : public Closure {
               void Run(art::Thread* thread) override
@@ -598,7 +610,7 @@ void Monitor::Lock(Thread* self) {
                 << PrettyDuration(MsToNs(wait_ms)) << "\n"
                 << "Current owner stack:\n" << owner_stack_dump
                 << "Contender stack:\n" << self_trace_oss.str();
-          } else if (wait_ms > kLongWaitMs && owners_method != nullptr) {
+          } else if (sample_event && wait_ms > kLongWaitMs && owners_method != nullptr) {
             uint32_t pc;
             ArtMethod* m = self->GetCurrentMethod(&pc);
             // TODO: We should maybe check that original_owner is still a live thread.
@@ -611,14 +623,30 @@ void Monitor::Lock(Thread* self) {
                 << " in " << ArtMethod::PrettyMethod(m) << " for "
                 << PrettyDuration(MsToNs(wait_ms));
           }
-          LogContentionEvent(self,
-                            wait_ms,
-                            sample_percent,
-                            owners_method,
-                            owners_dex_pc);
+          if (sample_event) {
+            LogContentionEvent(self,
+                              wait_ms,
+                              sample_percent,
+                              owners_method,
+                              owners_dex_pc);
+          }
         } else {
           Locks::thread_list_lock_->ExclusiveUnlock(self);
         }
+
+        if (profile_contention) {
+          // Record the contention while the contending and owning methods are known to be
+          // live; the profiler resolves their locations right away.
+          uint32_t pc;
+          ArtMethod* m = self->GetCurrentMethod(&pc);
+          LockContentionProfiler::RecordContention(self,
+                                                   m,
+                                                   pc,
+                                                   owners_method,
+                                                   owners_dex_pc,
+                                                   wait_ns,
+                                                   std::move(owner_stack_dump));
+        }
       }
     }
   }
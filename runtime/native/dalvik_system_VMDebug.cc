@@ -37,8 +37,10 @@
 #include "gc/space/zygote_space.h"
 #include "handle_scope-inl.h"
 #include "hprof/hprof.h"
+#include "javaheapprof/allocation_site_profiler.h"
 #include "jni/java_vm_ext.h"
 #include "jni/jni_internal.h"
+#include "lock_contention_profiler.h"
 #include "mirror/array-alloc-inl.h"
 #include "mirror/array-inl.h"
 #include "mirror/class.h"
@@ -51,6 +53,7 @@
 #include "thread-inl.h"
 #include "trace.h"
 #include "trace_profile.h"
+#include "wall_clock_profiler.h"
 
 namespace art HIDDEN {
 
@@ -356,9 +359,23 @@ enum class VMDebugRuntimeStatId {
   kArtGcObjectsAllocated,
   kArtGcTotalTimeWaitingForGc,
   kArtGcPreOomeGcCount,
+  // The profiler dumps below have no name in libcore's VMDebug.getRuntimeStat() table yet, so
+  // they can only be read with VMDebug.getRuntimeStatInternal() and the raw id asserted after
+  // this enum. Naming one requires a matching libcore change, which adds the name to the table
+  // with the same id.
+  // Reading the allocation site and wall clock profiles also writes their output files, the same
+  // as SIGQUIT does.
+  kArtMonitorContentionProfile,
+  kArtAllocationSiteProfile,
+  kArtWallClockProfile,
   kNumRuntimeStats,
 };
 
+// Raw ids of the stats not named in libcore, see above. They must not change.
+static_assert(enum_cast<int32_t>(VMDebugRuntimeStatId::kArtMonitorContentionProfile) == 11);
+static_assert(enum_cast<int32_t>(VMDebugRuntimeStatId::kArtAllocationSiteProfile) == 12);
+static_assert(enum_cast<int32_t>(VMDebugRuntimeStatId::kArtWallClockProfile) == 13);
+
 static jstring VMDebug_getRuntimeStatInternal(JNIEnv* env, jclass, jint statId) {
   gc::Heap* heap = Runtime::Current()->GetHeap();
   switch (static_cast<VMDebugRuntimeStatId>(statId)) {
@@ -408,6 +425,36 @@ static jstring VMDebug_getRuntimeStatInternal(JNIEnv* env, jclass, jint statId)
       std::string output = std::to_string(heap->GetPreOomeGcCount());
       return env->NewStringUTF(output.c_str());
     }
+    case VMDebugRuntimeStatId::kArtMonitorContentionProfile: {
+      if (!LockContentionProfiler::IsEnabled()) {
+        return nullptr;
+      }
+      std::ostringstream output;
+      LockContentionProfiler::Dump(output);
+      return env->NewStringUTF(output.str().c_str());
+    }
+    case VMDebugRuntimeStatId::kArtAllocationSiteProfile: {
+      if (!AllocationSiteProfiler::IsEnabled()) {
+        return nullptr;
+      }
+      std::ostringstream output;
+      AllocationSiteProfiler::Dump(output);
+      AllocationSiteProfiler::WriteOutputFile(output);
+      return env->NewStringUTF(output.str().c_str());
+    }
+    case VMDebugRuntimeStatId::kArtWallClockProfile: {
+      if (!WallClockProfiler::IsRunning()) {
+        return nullptr;
+      }
+      // Return the collapsed stacks, the report about the output files goes to the log.
+      std::ostringstream report;
+      WallClockProfiler::WriteOutputFiles(report);
+      if (!report.str().empty()) {
+        LOG(INFO) << report.str();
+      }
+      std::string output = WallClockProfiler::DumpCollapsed();
+      return env->NewStringUTF(output.c_str());
+    }
     default:
       return nullptr;
   }
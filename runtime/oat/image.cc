@@ -18,9 +18,12 @@
 
 #include <lz4.h>
 #include <lz4hc.h>
+#include <memory>
 #include <sstream>
 #include <sys/stat.h>
+#include <zdict.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include "android-base/stringprintf.h"
 
@@ -34,8 +37,8 @@
 namespace art HIDDEN {
 
 const uint8_t ImageHeader::kImageMagic[] = { 'a', 'r', 't', '\n' };
-// Last change: Add intrinsics for Unsafe/JdkUnsafe.arrayBaseOffset.
-const uint8_t ImageHeader::kImageVersion[] = { '1', '1', '4', '\0' };
+// Last change: Add zstd storage mode with an optional compression dictionary.
+const uint8_t ImageHeader::kImageVersion[] = { '1', '1', '5', '\0' };
 
 ImageHeader::ImageHeader(uint32_t image_reservation_size,
                          uint32_t component_count,
@@ -217,8 +220,88 @@ bool LZ4_decompress_safe_checked(const char* source,
   }
 }
 
+static bool ZSTD_decompress_checked(const uint8_t* source,
+                                    uint8_t* dest,
+                                    size_t compressed_size,
+                                    size_t max_decompressed_size,
+                                    const ZSTD_DDict* ddict,
+                                    ZSTD_DCtx* dctx,
+                                    /*out*/ size_t* decompressed_size_checked,
+                                    /*out*/ std::string* error_msg) {
+  if (dctx == nullptr) {
+    *error_msg = "ZSTD_createDCtx() failed";
+    return false;
+  }
+  size_t decompressed_size = (ddict == nullptr)
+      ? ZSTD_decompressDCtx(dctx, dest, max_decompressed_size, source, compressed_size)
+      : ZSTD_decompress_usingDDict(dctx,
+                                   dest,
+                                   max_decompressed_size,
+                                   source,
+                                   compressed_size,
+                                   ddict);
+  if (UNLIKELY(ZSTD_isError(decompressed_size))) {
+    *error_msg = android::base::StringPrintf("ZSTD_decompress() failed: %s",
+                                             ZSTD_getErrorName(decompressed_size));
+    return false;
+  }
+  *decompressed_size_checked = decompressed_size;
+  return true;
+}
+
+ImageHeader::DecompressionDictionary::~DecompressionDictionary() {
+  ZSTD_freeDDict(ddict_);
+}
+
+bool ImageHeader::DecompressionDictionary::Init(ArrayRef<const uint8_t> dictionary,
+                                                std::string* error_msg) {
+  DCHECK(ddict_ == nullptr);
+  if (dictionary.empty()) {
+    return true;
+  }
+  ddict_ = ZSTD_createDDict(dictionary.data(), dictionary.size());
+  if (ddict_ == nullptr) {
+    *error_msg = "ZSTD_createDDict() failed";
+    return false;
+  }
+  return true;
+}
+
+ImageHeader::DecompressionContext::~DecompressionContext() {
+  ZSTD_freeDCtx(dctx_);
+}
+
+ZSTD_DCtx* ImageHeader::DecompressionContext::GetZstdContext() {
+  if (dctx_ == nullptr) {
+    dctx_ = ZSTD_createDCtx();
+  }
+  return dctx_;
+}
+
+bool ImageHeader::GetCompressionDictionary(const uint8_t* image_begin,
+                                           size_t data_size,
+                                           /*out*/ ArrayRef<const uint8_t>* dictionary,
+                                           /*out*/ std::string* error_msg) const {
+  // Unsigned 64-bit arithmetic, the sum of two 32-bit values cannot wrap around.
+  if (dictionary_size_ != 0u &&
+      static_cast<uint64_t>(dictionary_offset_) + dictionary_size_ > data_size) {
+    *error_msg = android::base::StringPrintf(
+        "Image compression dictionary at %u, size %u, is outside of the image data of size %zu",
+        dictionary_offset_,
+        dictionary_size_,
+        data_size);
+    return false;
+  }
+  *dictionary = (dictionary_size_ != 0u)
+      ? ArrayRef<const uint8_t>(image_begin + dictionary_offset_, dictionary_size_)
+      : ArrayRef<const uint8_t>();
+  return true;
+}
+
 bool ImageHeader::Block::Decompress(uint8_t* out_ptr,
                                     const uint8_t* in_ptr,
+                                    const DecompressionDictionary& dictionary,
+                                    DecompressionContext* context,
                                     std::string* error_msg) const {
   switch (storage_mode_) {
     case kStorageModeUncompressed: {
@@ -227,17 +310,34 @@ bool ImageHeader::Block::Decompress(uint8_t* out_ptr,
       break;
     }
     case kStorageModeLZ4:
-    case kStorageModeLZ4HC: {
-      // LZ4HC and LZ4 have same internal format, both use LZ4_decompress.
+    case kStorageModeLZ4HC:
+    case kStorageModeZstd: {
       size_t decompressed_size;
-      bool ok = LZ4_decompress_safe_checked(
-          reinterpret_cast<const char*>(in_ptr) + data_offset_,
-          reinterpret_cast<char*>(out_ptr) + image_offset_,
-          data_size_,
-          image_size_,
-          &decompressed_size,
-          error_msg);
+      std::string temp_error_msg;
+      bool ok;
+      if (storage_mode_ == kStorageModeZstd) {
+        ok = ZSTD_decompress_checked(in_ptr + data_offset_,
+                                     out_ptr + image_offset_,
+                                     data_size_,
+                                     image_size_,
+                                     dictionary.Get(),
+                                     context->GetZstdContext(),
+                                     &decompressed_size,
+                                     &temp_error_msg);
+      } else {
+        // LZ4HC and LZ4 have same internal format, both use LZ4_decompress.
+        ok = LZ4_decompress_safe_checked(
+            reinterpret_cast<const char*>(in_ptr) + data_offset_,
+            reinterpret_cast<char*>(out_ptr) + image_offset_,
+            data_size_,
+            image_size_,
+            &decompressed_size,
+            &temp_error_msg);
+      }
       if (!ok) {
+        if (error_msg != nullptr) {
+          *error_msg = std::move(temp_error_msg);
+        }
         return false;
       }
       if (decompressed_size != image_size_) {
@@ -279,29 +379,78 @@ const char* ImageHeader::GetImageSectionName(ImageSections index) {
   }
 }
 
-// Compress data from `source` into `storage`.
+// Zstd level used for image compression. Like LZ4HC, favor the compression ratio since the
+// decompression speed barely depends on the level. Levels above 19 need much larger windows.
+static constexpr int kZstdCompressionLevel = 19;
+
+// Size of the samples the zstd dictionary is trained on.
+static constexpr size_t kZstdDictionarySampleSize = 4 * KB;
+
+// Zstd state shared by the compression of all blocks of an image.
+struct ZstdCompressionState {
+  ZstdCompressionState() {}
+
+  ~ZstdCompressionState() {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeCCtx(cctx);
+  }
+
+  ZSTD_CCtx* cctx = nullptr;
+  // The dictionary digested once for compression, null if there is no dictionary.
+  ZSTD_CDict* cdict = nullptr;
+  // The same dictionary digested for decompression, to check the compressed data.
+  ImageHeader::DecompressionDictionary ddict;
+  // The context for that check.
+  ImageHeader::DecompressionContext dctx;
+
+  DISALLOW_COPY_AND_ASSIGN(ZstdCompressionState);
+};
+
+// Compress data from `source` into `storage`. The `zstd_state` is only used, and must only be
+// non-null, for zstd compression.
 static bool CompressData(ArrayRef<const uint8_t> source,
                          ImageHeader::StorageMode image_storage_mode,
+                         ZstdCompressionState* zstd_state,
                          /*out*/ dchecked_vector<uint8_t>* storage) {
   const uint64_t compress_start_time = NanoTime();
 
-  // Bound is same for both LZ4 and LZ4HC.
-  storage->resize(LZ4_compressBound(source.size()));
   size_t data_size = 0;
-  if (image_storage_mode == ImageHeader::kStorageModeLZ4) {
-    data_size = LZ4_compress_default(
-        reinterpret_cast<char*>(const_cast<uint8_t*>(source.data())),
-        reinterpret_cast<char*>(storage->data()),
-        source.size(),
-        storage->size());
+  if (image_storage_mode == ImageHeader::kStorageModeZstd) {
+    DCHECK(zstd_state != nullptr);
+    storage->resize(ZSTD_compressBound(source.size()));
+    size_t result = (zstd_state->cdict != nullptr)
+        ? ZSTD_compress_usingCDict(zstd_state->cctx,
+                                   storage->data(),
+                                   storage->size(),
+                                   source.data(),
+                                   source.size(),
+                                   zstd_state->cdict)
+        : ZSTD_compressCCtx(zstd_state->cctx,
+                            storage->data(),
+                            storage->size(),
+                            source.data(),
+                            source.size(),
+                            kZstdCompressionLevel);
+    data_size = ZSTD_isError(result) ? 0u : result;
   } else {
-    DCHECK_EQ(image_storage_mode, ImageHeader::kStorageModeLZ4HC);
-    data_size = LZ4_compress_HC(
-        reinterpret_cast<const char*>(const_cast<uint8_t*>(source.data())),
-        reinterpret_cast<char*>(storage->data()),
-        source.size(),
-        storage->size(),
-        LZ4HC_CLEVEL_MAX);
+    DCHECK(zstd_state == nullptr);
+    // Bound is same for both LZ4 and LZ4HC.
+    storage->resize(LZ4_compressBound(source.size()));
+    if (image_storage_mode == ImageHeader::kStorageModeLZ4) {
+      data_size = LZ4_compress_default(
+          reinterpret_cast<char*>(const_cast<uint8_t*>(source.data())),
+          reinterpret_cast<char*>(storage->data()),
+          source.size(),
+          storage->size());
+    } else {
+      DCHECK_EQ(image_storage_mode, ImageHeader::kStorageModeLZ4HC);
+      data_size = LZ4_compress_HC(
+          reinterpret_cast<const char*>(const_cast<uint8_t*>(source.data())),
+          reinterpret_cast<char*>(storage->data()),
+          source.size(),
+          storage->size(),
+          LZ4HC_CLEVEL_MAX);
+    }
   }
 
   if (data_size == 0) {
@@ -313,33 +462,65 @@ static bool CompressData(ArrayRef<const uint8_t> source,
               << PrettyDuration(NanoTime() - compress_start_time);
   if (kIsDebugBuild) {
     dchecked_vector<uint8_t> decompressed(source.size());
-    size_t decompressed_size;
+    ImageHeader::Block block(image_storage_mode,
+                             /*data_offset=*/ 0u,
+                             /*data_size=*/ storage->size(),
+                             /*image_offset=*/ 0u,
+                             /*image_size=*/ source.size());
     std::string error_msg;
-    bool ok = LZ4_decompress_safe_checked(
-        reinterpret_cast<char*>(storage->data()),
-        reinterpret_cast<char*>(decompressed.data()),
-        storage->size(),
-        decompressed.size(),
-        &decompressed_size,
-        &error_msg);
+    ImageHeader::DecompressionDictionary no_dictionary;
+    ImageHeader::DecompressionContext context;
+    bool ok = block.Decompress(decompressed.data(),
+                               storage->data(),
+                               (zstd_state != nullptr) ? zstd_state->ddict : no_dictionary,
+                               (zstd_state != nullptr) ? &zstd_state->dctx : &context,
+                               &error_msg);
     if (!ok) {
       LOG(FATAL) << error_msg;
       UNREACHABLE();
     }
-    CHECK_EQ(decompressed_size, decompressed.size());
     CHECK_EQ(memcmp(source.data(), decompressed.data(), source.size()), 0) << image_storage_mode;
   }
   return true;
 }
 
+// Train a zstd dictionary of at most `max_size` bytes on `data`. Returns an empty dictionary
+// if the data is not suitable for training.
+static dchecked_vector<uint8_t> TrainDictionary(ArrayRef<const uint8_t> data, size_t max_size) {
+  const uint64_t train_start_time = NanoTime();
+  std::vector<size_t> sample_sizes;
+  sample_sizes.reserve(RoundUp(data.size(), kZstdDictionarySampleSize) / kZstdDictionarySampleSize);
+  for (size_t offset = 0; offset < data.size(); offset += kZstdDictionarySampleSize) {
+    sample_sizes.push_back(std::min(kZstdDictionarySampleSize, data.size() - offset));
+  }
+  dchecked_vector<uint8_t> dictionary(max_size);
+  size_t dictionary_size = ZDICT_trainFromBuffer(dictionary.data(),
+                                                 dictionary.size(),
+                                                 data.data(),
+                                                 sample_sizes.data(),
+                                                 sample_sizes.size());
+  if (ZDICT_isError(dictionary_size)) {
+    VLOG(image) << "Not using a compression dictionary: "
+                << ZDICT_getErrorName(dictionary_size);
+    return {};
+  }
+  dictionary.resize(dictionary_size);
+  VLOG(image) << "Trained " << dictionary_size << " bytes dictionary in "
+              << PrettyDuration(NanoTime() - train_start_time);
+  return dictionary;
+}
+
 bool ImageHeader::WriteData(const ImageFileGuard& image_file,
                             const uint8_t* data,
                             const uint8_t* bitmap_data,
                             ImageHeader::StorageMode image_storage_mode,
                             uint32_t max_image_block_size,
+                            uint32_t dictionary_size,
                             bool update_checksum,
                             std::string* error_msg) {
   const bool is_compressed = image_storage_mode != ImageHeader::kStorageModeUncompressed;
+  this->dictionary_offset_ = 0u;
+  this->dictionary_size_ = 0u;
   dchecked_vector<std::pair<uint32_t, uint32_t>> block_sources;
   dchecked_vector<ImageHeader::Block> blocks;
 
@@ -365,6 +546,37 @@ bool ImageHeader::WriteData(const ImageFileGuard& image_file,
                              sizeof(ImageHeader));
   }
 
+  // A dictionary shared by all blocks recovers most of the ratio lost by splitting the image
+  // into small blocks for parallel decompression.
+  dchecked_vector<uint8_t> dictionary;
+  std::unique_ptr<ZstdCompressionState> zstd_state;
+  if (image_storage_mode == ImageHeader::kStorageModeZstd) {
+    if (dictionary_size != 0u) {
+      dictionary = TrainDictionary(
+          ArrayRef<const uint8_t>(data + sizeof(ImageHeader),
+                                  GetImageSize() - sizeof(ImageHeader)),
+          dictionary_size);
+    }
+    // Digest the dictionary once rather than for each block.
+    zstd_state.reset(new ZstdCompressionState());
+    zstd_state->cctx = ZSTD_createCCtx();
+    if (zstd_state->cctx == nullptr) {
+      *error_msg = "ZSTD_createCCtx() failed for " + image_file->GetPath();
+      return false;
+    }
+    if (!dictionary.empty()) {
+      zstd_state->cdict =
+          ZSTD_createCDict(dictionary.data(), dictionary.size(), kZstdCompressionLevel);
+      if (zstd_state->cdict == nullptr) {
+        *error_msg = "ZSTD_createCDict() failed for " + image_file->GetPath();
+        return false;
+      }
+      if (!zstd_state->ddict.Init(ArrayRef<const uint8_t>(dictionary), error_msg)) {
+        return false;
+      }
+    }
+  }
+
   // Copy and compress blocks.
   uint32_t out_offset = sizeof(ImageHeader);
   for (const std::pair<uint32_t, uint32_t> block : block_sources) {
@@ -372,7 +584,7 @@ bool ImageHeader::WriteData(const ImageFileGuard& image_file,
     dchecked_vector<uint8_t> compressed_data;
     ArrayRef<const uint8_t> image_data;
     if (is_compressed) {
-      if (!CompressData(raw_image_data, image_storage_mode, &compressed_data)) {
+      if (!CompressData(raw_image_data, image_storage_mode, zstd_state.get(), &compressed_data)) {
         *error_msg = "Error compressing data for " +
             image_file->GetPath() + ": " + std::string(strerror(errno));
         return false;
@@ -403,6 +615,20 @@ bool ImageHeader::WriteData(const ImageFileGuard& image_file,
     }
   }
 
+  if (!dictionary.empty()) {
+    if (!image_file->PwriteFully(dictionary.data(), dictionary.size(), out_offset)) {
+      *error_msg = "Failed to write image compression dictionary " +
+          image_file->GetPath() + ": " + std::string(strerror(errno));
+      return false;
+    }
+    this->dictionary_offset_ = out_offset;
+    this->dictionary_size_ = dictionary.size();
+    out_offset += dictionary.size();
+    if (update_checksum) {
+      image_checksum = adler32(image_checksum, dictionary.data(), dictionary.size());
+    }
+  }
+
   if (is_compressed) {
     // Align up since the compressed data is not necessarily aligned.
     out_offset = RoundUp(out_offset, alignof(ImageHeader::Block));
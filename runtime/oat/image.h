@@ -19,6 +19,7 @@
 
 #include <string.h>
 
+#include "base/array_ref.h"
 #include "base/iteration_range.h"
 #include "base/macros.h"
 #include "base/os.h"
@@ -27,6 +28,9 @@
 #include "mirror/object.h"
 #include "runtime_globals.h"
 
+struct ZSTD_DCtx_s;
+struct ZSTD_DDict_s;
+
 namespace art HIDDEN {
 
 class ArtField;
@@ -83,10 +87,46 @@ class PACKED(8) ImageHeader {
     kStorageModeUncompressed,
     kStorageModeLZ4,
     kStorageModeLZ4HC,
+    kStorageModeZstd,
     kStorageModeCount,  // Number of elements in enum.
   };
   static constexpr StorageMode kDefaultStorageMode = kStorageModeUncompressed;
 
+  // The zstd dictionary of an image, digested once for the decompression of all its blocks.
+  class DecompressionDictionary {
+   public:
+    DecompressionDictionary() {}
+    ~DecompressionDictionary();
+
+    // Digests `dictionary`. An empty `dictionary` leaves this object empty.
+    bool Init(ArrayRef<const uint8_t> dictionary, std::string* error_msg);
+
+    const ZSTD_DDict_s* Get() const {
+      return ddict_;
+    }
+
+   private:
+    ZSTD_DDict_s* ddict_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(DecompressionDictionary);
+  };
+
+  // The zstd decompression context of a thread, reused for all the blocks it decompresses.
+  // Must not be used by several threads at the same time.
+  class DecompressionContext {
+   public:
+    DecompressionContext() {}
+    ~DecompressionContext();
+
+    // Returns the zstd context, created on first use. Returns null if the creation fails.
+    ZSTD_DCtx_s* GetZstdContext();
+
+   private:
+    ZSTD_DCtx_s* dctx_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(DecompressionContext);
+  };
+
   // Solid block of the image. May be compressed or uncompressed.
   class PACKED(4) Block final {
    public:
@@ -101,7 +141,17 @@ class PACKED(8) ImageHeader {
           image_offset_(image_offset),
           image_size_(image_size) {}
 
-    bool Decompress(uint8_t* out_ptr, const uint8_t* in_ptr, std::string* error_msg) const;
+    // Decompresses the block from the image file data at `in_ptr` into the image at `out_ptr`.
+    // The `dictionary` and `context` are only used by zstd blocks, the `dictionary` may be empty.
+    bool Decompress(uint8_t* out_ptr,
+                    const uint8_t* in_ptr,
+                    const DecompressionDictionary& dictionary,
+                    DecompressionContext* context,
+                    std::string* error_msg) const;
+
+    uint32_t GetDataOffset() const {
+      return data_offset_;
+    }
 
     StorageMode GetStorageMode() const {
       return storage_mode_;
@@ -427,6 +477,19 @@ class PACKED(8) ImageHeader {
     return blocks_count_;
   }
 
+  // Return the size of the dictionary shared by the zstd compressed blocks, 0 if there is none.
+  uint32_t GetCompressionDictionarySize() const {
+    return dictionary_size_;
+  }
+
+  // Get the dictionary shared by the zstd compressed blocks, empty if there is none, from the
+  // `data_size` bytes of image file data at `image_begin`. Return false if the dictionary
+  // recorded in the header is not within the data.
+  EXPORT bool GetCompressionDictionary(const uint8_t* image_begin,
+                                       size_t data_size,
+                                       /*out*/ ArrayRef<const uint8_t>* dictionary,
+                                       /*out*/ std::string* error_msg) const;
+
   // Helper for writing `data` and `bitmap_data` into `image_file`, following
   // the information stored in this header and passed as arguments.
   EXPORT bool WriteData(const ImageFileGuard& image_file,
@@ -434,6 +497,7 @@ class PACKED(8) ImageHeader {
                         const uint8_t* bitmap_data,
                         ImageHeader::StorageMode image_storage_mode,
                         uint32_t max_image_block_size,
+                        uint32_t dictionary_size,
                         bool update_checksum,
                         std::string* error_msg);
 
@@ -524,6 +588,10 @@ class PACKED(8) ImageHeader {
   uint32_t blocks_offset_ = 0u;
   uint32_t blocks_count_ = 0u;
 
+  // Dictionary trained on the image data, only used for zstd compressed images.
+  uint32_t dictionary_offset_ = 0u;
+  uint32_t dictionary_size_ = 0u;
+
   friend class linker::ImageWriter;
   friend class RuntimeImageHelper;
 };
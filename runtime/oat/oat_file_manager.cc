@@ -16,24 +16,30 @@
 
 #include "oat_file_manager.h"
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
 #include <queue>
+#include <set>
 #include <vector>
 
 #include "android-base/file.h"
 #include "android-base/stringprintf.h"
 #include "android-base/strings.h"
+#include "android-base/unique_fd.h"
 #include "art_field-inl.h"
 #include "base/bit_vector-inl.h"
+#include "base/casts.h"
 #include "base/file_utils.h"
 #include "base/logging.h"  // For VLOG.
 #include "base/mutex-inl.h"
 #include "base/sdk_version.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
+#include "base/time_utils.h"
 #include "class_linker.h"
 #include "class_loader_context.h"
 #include "dex/art_dex_file_loader.h"
@@ -51,6 +57,7 @@
 #include "oat_file.h"
 #include "oat_file_assistant.h"
 #include "obj_ptr-inl.h"
+#include "profile/profile_compilation_info.h"
 #include "runtime_image.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-current-inl.h"
@@ -154,7 +161,8 @@ std::vector<const OatFile*> OatFileManager::GetBootOatFiles() const {
 }
 
 OatFileManager::OatFileManager()
-    : only_use_system_oat_files_(false) {}
+    : only_use_system_oat_files_(false),
+      runtime_verification_profile_opened_(false) {}
 
 OatFileManager::~OatFileManager() {
   // Explicitly clear oat_files_ since the OatFile destructor calls back into OatFileManager for
@@ -786,16 +794,14 @@ class BackgroundVerificationTask final : public Task {
   DISALLOW_COPY_AND_ASSIGN(BackgroundVerificationTask);
 };
 
-void OatFileManager::RunBackgroundVerification(const std::vector<const DexFile*>& dex_files,
-                                               jobject class_loader) {
+bool OatFileManager::CanVerifyInBackground(Thread* self, jobject class_loader) const {
   Runtime* const runtime = Runtime::Current();
-  Thread* const self = Thread::Current();
 
   if (runtime->IsJavaDebuggable()) {
     // Threads created by ThreadPool ("runtime threads") are not allowed to load
     // classes when debuggable to match class-initialization semantics
     // expectations. Do not verify in the background.
-    return;
+    return false;
   }
 
   {
@@ -808,17 +814,40 @@ void OatFileManager::RunBackgroundVerification(const std::vector<const DexFile*>
       // chain. Because the background verification runs on runtime threads,
       // which do not call Java, we won't be able to load classes when
       // verifying, which is something the current verifier relies on.
-      return;
+      return false;
     }
   }
 
   if (!IsSdkVersionSetAndAtLeast(runtime->GetTargetSdkVersion(), SdkVersion::kQ)) {
     // Do not run for legacy apps as they may depend on the previous class loader behaviour.
-    return;
+    return false;
   }
 
   if (runtime->IsShuttingDown(self)) {
     // Not allowed to create new threads during runtime shutdown.
+    return false;
+  }
+
+  return true;
+}
+
+void OatFileManager::AddVerificationTask(Thread* self, Task* task) {
+  {
+    WriterMutexLock mu(self, *Locks::oat_file_manager_lock_);
+    if (verification_thread_pool_ == nullptr) {
+      verification_thread_pool_.reset(
+          ThreadPool::Create("Verification thread pool", /* num_threads= */ 1));
+      verification_thread_pool_->StartWorkers(self);
+    }
+  }
+  verification_thread_pool_->AddTask(self, task);
+}
+
+void OatFileManager::RunBackgroundVerification(const std::vector<const DexFile*>& dex_files,
+                                               jobject class_loader) {
+  Thread* const self = Thread::Current();
+
+  if (!CanVerifyInBackground(self, class_loader)) {
     return;
   }
 
@@ -851,20 +880,188 @@ void OatFileManager::RunBackgroundVerification(const std::vector<const DexFile*>
     return;
   }
 
-  {
-    WriterMutexLock mu(self, *Locks::oat_file_manager_lock_);
-    if (verification_thread_pool_ == nullptr) {
-      verification_thread_pool_.reset(
-          ThreadPool::Create("Verification thread pool", /* num_threads= */ 1));
-      verification_thread_pool_->StartWorkers(self);
-    }
-  }
-  verification_thread_pool_->AddTask(self, new BackgroundVerificationTask(
+  AddVerificationTask(self, new BackgroundVerificationTask(
       dex_files,
       class_loader,
       GetVdexFilename(odex_filename)));
 }
 
+// Verifies the classes of an oat-backed dex file that were not verified ahead of time, so that
+// the threads using them find them verified. The classes used during startup according to the
+// app's reference profile are verified first.
+//
+// This only moves the work of ClassLinker::VerifyClass off the threads that use the classes, it
+// does not make the verification itself cheaper. Runtime verification has no verifier deps to
+// consult and the vdex only records classes the AOT verifier accepted, so for these classes no
+// per-method results exist to reuse. Persisting per-method results across runs would duplicate
+// what the vdex does for AOT-verified classes and is not done here.
+class RuntimeVerificationTask final : public Task {
+ public:
+  RuntimeVerificationTask(const DexFile* dex_file, jobject class_loader)
+      : dex_file_(dex_file),
+        class_loader_(class_loader) {}
+
+  ~RuntimeVerificationTask() {
+    Thread* const self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    soa.Vm()->DeleteGlobalRef(self, class_loader_);
+  }
+
+  void Run(Thread* self) override {
+    ScopedTrace trace("Background runtime verification");
+    uint64_t start_ns = NanoTime();
+    Runtime* const runtime = Runtime::Current();
+    ClassLinker* const class_linker = runtime->GetClassLinker();
+
+    // Only classes without a verified status in the oat file need to be verified at runtime.
+    const OatDexFile* oat_dex_file = dex_file_->GetOatDexFile();
+    DCHECK(oat_dex_file != nullptr);
+    std::vector<uint16_t> class_def_indexes;
+    for (uint32_t i = 0; i < dex_file_->NumClassDefs(); ++i) {
+      if (oat_dex_file->GetOatClass(i).GetStatus() < ClassStatus::kVerifiedNeedsAccessChecks) {
+        class_def_indexes.push_back(dchecked_integral_cast<uint16_t>(i));
+      }
+    }
+    if (class_def_indexes.empty()) {
+      return;
+    }
+
+    std::set<dex::TypeIndex> startup_classes =
+        runtime->GetOatFileManager().GetReferenceProfileStartupClasses(*dex_file_);
+    auto startup_end = std::stable_partition(
+        class_def_indexes.begin(),
+        class_def_indexes.end(),
+        [&](uint16_t class_def_index) {
+          const dex::ClassDef& class_def = dex_file_->GetClassDef(class_def_index);
+          return ContainsElement(startup_classes, class_def.class_idx_);
+        });
+
+    size_t verified = 0u;
+    for (uint16_t class_def_index : class_def_indexes) {
+      if (runtime->IsShuttingDown(self)) {
+        break;
+      }
+      const dex::ClassDef& class_def = dex_file_->GetClassDef(class_def_index);
+
+      // Take handles inside the loop. The background verification is low priority
+      // and we want to minimize the risk of blocking anyone else.
+      ScopedObjectAccess soa(self);
+      StackHandleScope<2> hs(self);
+      Handle<mirror::ClassLoader> h_loader(hs.NewHandle(
+          soa.Decode<mirror::ClassLoader>(class_loader_)));
+      Handle<mirror::Class> h_class(hs.NewHandle<mirror::Class>(class_linker->FindClass(
+          self,
+          dex_file_->GetClassDescriptor(class_def),
+          h_loader)));
+
+      if (h_class == nullptr) {
+        DCHECK(self->IsExceptionPending());
+        self->ClearException();
+        continue;
+      }
+
+      if (&h_class->GetDexFile() != dex_file_ ||
+          h_class->IsErroneous() ||
+          h_class->GetStatus() >= ClassStatus::kVerifiedNeedsAccessChecks) {
+        // A different class with the same descriptor, or a class already verified by its user.
+        continue;
+      }
+
+      class_linker->VerifyClass(self, /* verifier_deps= */ nullptr, h_class);
+      if (self->IsExceptionPending()) {
+        // ClassLinker::VerifyClass can throw, but the exception isn't useful here.
+        self->ClearException();
+      }
+      if (h_class->GetStatus() >= ClassStatus::kVerifiedNeedsAccessChecks) {
+        ++verified;
+      }
+    }
+
+    VLOG(verifier) << "Verified " << verified << " of " << class_def_indexes.size()
+                   << " classes of " << dex_file_->GetLocation() << " in the background ("
+                   << std::distance(class_def_indexes.begin(), startup_end)
+                   << " startup classes first) in " << PrettyDuration(NanoTime() - start_ns);
+  }
+
+  void Finalize() override {
+    delete this;
+  }
+
+ private:
+  const DexFile* const dex_file_;
+  jobject class_loader_;
+
+  DISALLOW_COPY_AND_ASSIGN(RuntimeVerificationTask);
+};
+
+std::set<dex::TypeIndex> OatFileManager::GetReferenceProfileStartupClasses(
+    const DexFile& dex_file) {
+  if (!runtime_verification_profile_opened_) {
+    runtime_verification_profile_opened_ = true;
+    std::string profile_path = Runtime::Current()->GetAppInfo()->GetPrimaryApkReferenceProfile();
+    if (!profile_path.empty()) {
+      // The app cannot write its reference profile, so open it read-only without locking it.
+      android::base::unique_fd fd(open(profile_path.c_str(), O_RDONLY | O_CLOEXEC));
+      std::string error_msg;
+      if (fd.get() >= 0) {
+        runtime_verification_mapped_profile_ =
+            ProfileCompilationInfo::MappedProfile::Open(fd.get(), &error_msg);
+      }
+      if (fd.get() >= 0 && runtime_verification_mapped_profile_ == nullptr) {
+        // Not saved as mappable, fall back to loading the whole profile.
+        VLOG(verifier) << "Cannot map reference profile " << profile_path << ": " << error_msg;
+        std::unique_ptr<ProfileCompilationInfo> info = std::make_unique<ProfileCompilationInfo>();
+        if (info->Load(fd.get())) {
+          runtime_verification_profile_ = std::move(info);
+        }
+      }
+      if (runtime_verification_mapped_profile_ == nullptr &&
+          runtime_verification_profile_ == nullptr) {
+        VLOG(verifier) << "Could not load reference profile " << profile_path;
+      }
+    }
+  }
+
+  std::set<dex::TypeIndex> classes;
+  std::set<uint16_t> hot_methods;
+  std::set<uint16_t> startup_methods;
+  std::set<uint16_t> post_startup_methods;
+  bool found = false;
+  if (runtime_verification_mapped_profile_ != nullptr) {
+    found = runtime_verification_mapped_profile_->GetClassesAndMethods(
+        dex_file, &classes, &hot_methods, &startup_methods, &post_startup_methods);
+  } else if (runtime_verification_profile_ != nullptr) {
+    found = runtime_verification_profile_->GetClassesAndMethods(
+        dex_file, &classes, &hot_methods, &startup_methods, &post_startup_methods);
+  }
+  if (found) {
+    for (uint16_t method_idx : startup_methods) {
+      classes.insert(dex_file.GetMethodId(method_idx).class_idx_);
+    }
+  }
+  return classes;
+}
+
+void OatFileManager::RunBackgroundRuntimeVerification(const DexFile& dex_file,
+                                                      ObjPtr<mirror::ClassLoader> class_loader) {
+  Thread* const self = Thread::Current();
+  const OatDexFile* oat_dex_file = dex_file.GetOatDexFile();
+  if (class_loader == nullptr || oat_dex_file == nullptr || oat_dex_file->GetOatFile() == nullptr) {
+    return;
+  }
+
+  // Create a global ref for `class_loader` because it will be accessed from a different thread.
+  jobject global_class_loader = Runtime::Current()->GetJavaVM()->AddGlobalRef(self, class_loader);
+  CHECK(global_class_loader != nullptr);
+  if (!CanVerifyInBackground(self, global_class_loader)) {
+    Runtime::Current()->GetJavaVM()->DeleteGlobalRef(self, global_class_loader);
+    return;
+  }
+  // The classes to verify are collected by the task, off the thread registering the dex file.
+  VLOG(verifier) << "Scheduling background verification of " << dex_file.GetLocation();
+  AddVerificationTask(self, new RuntimeVerificationTask(&dex_file, global_class_loader));
+}
+
 void OatFileManager::WaitForWorkersToBeCreated() {
   DCHECK(!Runtime::Current()->IsShuttingDown(Thread::Current()))
       << "Cannot create new threads during runtime shutdown";
@@ -27,6 +27,8 @@
 #include "base/locks.h"
 #include "base/macros.h"
 #include "jni.h"
+#include "obj_ptr.h"
+#include "profile/profile_compilation_info.h"
 
 namespace art HIDDEN {
 
@@ -36,10 +38,16 @@ class ImageSpace;
 }  // namespace space
 }  // namespace gc
 
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
 class ClassLoaderContext;
 class DexFile;
 class MemMap;
 class OatFile;
+class Task;
+class Thread;
 class ThreadPool;
 
 // Class for dealing with oat file management.
@@ -128,6 +136,18 @@ class OatFileManager {
   void RunBackgroundVerification(const std::vector<const DexFile*>& dex_files,
                                  jobject class_loader);
 
+  // Spawn a background thread which verifies the classes of an oat-backed dex file that were not
+  // verified ahead of time, so that they are not verified on first use.
+  EXPORT void RunBackgroundRuntimeVerification(const DexFile& dex_file,
+                                               ObjPtr<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Return the classes of `dex_file` that the reference profile of the app lists, or that
+  // declare startup methods according to it. The profile is opened on first use; one saved as
+  // mappable is queried in place instead of being loaded. Only called from the verification
+  // thread pool, which has a single worker.
+  std::set<dex::TypeIndex> GetReferenceProfileStartupClasses(const DexFile& dex_file);
+
   // Wait for thread pool workers to be created. This is used during shutdown as
   // threads are not allowed to attach while runtime is in shutdown lock.
   void WaitForWorkersToBeCreated();
@@ -161,6 +181,12 @@ class OatFileManager {
   // Return true if we should attempt to load the app image.
   bool ShouldLoadAppImage() const;
 
+  // Return true if classes of `class_loader` can be loaded and verified on a runtime thread.
+  bool CanVerifyInBackground(Thread* self, jobject class_loader) const;
+
+  // Run `task` on the verification thread pool, creating it if needed.
+  void AddVerificationTask(Thread* self, Task* task) REQUIRES(!Locks::oat_file_manager_lock_);
+
   std::set<std::unique_ptr<const OatFile>> oat_files_ GUARDED_BY(Locks::oat_file_manager_lock_);
 
   // Only use the compiled code in an OAT file when the file is on /system. If the OAT file
@@ -170,6 +196,13 @@ class OatFileManager {
   // Single-thread pool used to run the verifier in the background.
   std::unique_ptr<ThreadPool> verification_thread_pool_;
 
+  // The app's reference profile used to order background runtime verification, shared by the
+  // dex files of the app. At most one of them is set, the mapped one if the profile was saved as
+  // mappable. Only accessed from the verification thread pool.
+  std::unique_ptr<ProfileCompilationInfo::MappedProfile> runtime_verification_mapped_profile_;
+  std::unique_ptr<ProfileCompilationInfo> runtime_verification_profile_;
+  bool runtime_verification_profile_opened_;
+
   DISALLOW_COPY_AND_ASSIGN(OatFileManager);
 };
 
@@ -18,9 +18,14 @@
 
 #include <string>
 
+#include "android-base/strings.h"
+#include "base/sdk_version.h"
+#include "class_linker.h"
 #include "common_runtime_test.h"
 #include "dexopt_test.h"
 #include "gtest/gtest.h"
+#include "mirror/class-inl.h"
+#include "oat_file_manager.h"
 #include "scoped_thread_state_change-inl.h"
 #include "vdex_file.h"
 
@@ -93,4 +98,58 @@ TEST_F(OatFileTest, ChangingMultiDexUncompressed) {
       << error_msg;
 }
 
+// Test that the background runtime verification verifies the classes that were not verified
+// ahead of time.
+TEST_F(OatFileTest, RunBackgroundRuntimeVerification) {
+  std::string dex_location = GetScratchDir() + "/RuntimeVerification.jar";
+  Copy(GetDexSrc1(), dex_location);
+  // Nothing is verified ahead of time with the extract filter.
+  GenerateOatForTest(dex_location.c_str(), CompilerFilter::kExtract);
+
+  // Start the runtime to initialize the system's class loader.
+  Thread* self = Thread::Current();
+  self->TransitionFromSuspendedToRunnable();
+  runtime_->Start();
+  runtime_->SetTargetSdkVersion(static_cast<uint32_t>(SdkVersion::kQ));
+
+  std::vector<std::string> error_msgs;
+  const OatFile* oat_file = nullptr;
+  std::vector<std::unique_ptr<const DexFile>> dex_files =
+      runtime_->GetOatFileManager().OpenDexFilesFromOat(dex_location.c_str(),
+                                                        runtime_->GetSystemClassLoader(),
+                                                        /*dex_elements=*/nullptr,
+                                                        &oat_file,
+                                                        &error_msgs);
+  ASSERT_EQ(1u, dex_files.size()) << android::base::Join(error_msgs, "\n");
+  ASSERT_TRUE(oat_file != nullptr);
+  const DexFile* dex_file = dex_files[0].get();
+  const OatDexFile* oat_dex_file = dex_file->GetOatDexFile();
+  ASSERT_TRUE(oat_dex_file != nullptr);
+  ASSERT_NE(0u, dex_file->NumClassDefs());
+  for (uint32_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+    ASSERT_LT(oat_dex_file->GetOatClass(i).GetStatus(), ClassStatus::kVerifiedNeedsAccessChecks);
+  }
+  // The class loader refers to the dex files, keep them alive until the end of the test.
+  loaded_dex_files_.push_back(std::move(dex_files[0]));
+
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    class_loader = class_linker_->CreatePathClassLoader(self, {dex_file});
+    runtime_->GetOatFileManager().RunBackgroundRuntimeVerification(
+        *dex_file, soa.Decode<mirror::ClassLoader>(class_loader));
+  }
+  runtime_->GetOatFileManager().WaitForBackgroundVerificationTasks();
+
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> loader = hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader));
+  for (uint32_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+    const char* descriptor = dex_file->GetClassDescriptor(dex_file->GetClassDef(i));
+    ObjPtr<mirror::Class> klass = class_linker_->LookupClass(self, descriptor, loader.Get());
+    ASSERT_TRUE(klass != nullptr) << descriptor;
+    EXPECT_GE(klass->GetStatus(), ClassStatus::kVerifiedNeedsAccessChecks) << descriptor;
+  }
+}
+
 }  // namespace art
@@ -332,6 +332,8 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .WithType<gc::space::LargeObjectSpaceType>()
           .WithValueMap({{"disabled", gc::space::LargeObjectSpaceType::kDisabled},
                          {"freelist", gc::space::LargeObjectSpaceType::kFreeList},
+                         {"freelist-deferred",
+                          gc::space::LargeObjectSpaceType::kFreeListDeferred},
                          {"map",      gc::space::LargeObjectSpaceType::kMap}})
           .IntoKey(M::LargeObjectSpace)
       .Define("-XX:LargeObjectThreshold=_")
@@ -350,6 +352,30 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xstackdumplockprofthreshold:_")
           .WithType<unsigned int>()
           .IntoKey(M::StackDumpLockProfThreshold)
+      .Define("-Xlockcontentionprofile")
+          .IntoKey(M::LockContentionProfile)
+      .Define("-Xallocsiteprofile")
+          .IntoKey(M::AllocSiteProfile)
+      .Define("-Xallocsiteprofile-interval:_")
+          .WithType<unsigned int>()
+          .IntoKey(M::AllocSiteProfileInterval)
+      .Define("-Xallocsiteprofile-output:_")
+          .WithType<std::string>()
+          .IntoKey(M::AllocSiteProfileOutput)
+      .Define("-Xwallclockprofile")
+          .IntoKey(M::WallClockProfile)
+      .Define("-Xwallclockprofile-interval:_")
+          .WithType<unsigned int>()
+          .IntoKey(M::WallClockProfileInterval)
+      .Define("-Xwallclockprofile-output:_")
+          .WithType<std::string>()
+          .IntoKey(M::WallClockProfileOutput)
+      .Define("-Xtrace-profile-buffer-size:_")
+          .WithType<unsigned int>()
+          .IntoKey(M::TraceProfileBufferSize)
+      .Define("-Xtrace-profile-flight-recorder-dir:_")
+          .WithType<std::string>()
+          .IntoKey(M::TraceProfileFlightRecorderDir)
       .Define("-Xmethod-trace")
           .IntoKey(M::MethodTrace)
       .Define("-Xmethod-trace-file:_")
@@ -384,6 +410,8 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
                          {"all",      verifier::VerifyMode::kEnable},
                          {"softfail", verifier::VerifyMode::kSoftFail}})
           .IntoKey(M::Verify)
+      .Define("-Xverify-in-background")
+          .IntoKey(M::VerifyInBackground)
       .Define("-XX:NativeBridge=_")
           .WithType<std::string>()
           .IntoKey(M::NativeBridge)
@@ -478,7 +506,27 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:PerfettoJavaHeapStackProf=_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
-          .IntoKey(M::PerfettoJavaHeapStackProf);
+          .IntoKey(M::PerfettoJavaHeapStackProf)
+      .Define("-XX:ParallelHprof=_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::ParallelHprof)
+      .Define("-XX:HprofOmitPrimitiveArrays=_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::HprofOmitPrimitiveArrays)
+      .Define("-XX:ForkHprof=_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::ForkHprof)
+      .Define("-XX:ParallelReferenceProcessing=_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::ParallelReferenceProcessing)
+      .Define("-XX:ParallelSweeping=_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::ParallelSweeping);
   // clang-format on
 
   FlagBase::AddFlagsToCmdlineParser(parser_builder.get());
@@ -81,7 +81,9 @@
 #include "experimental_flags.h"
 #include "fault_handler.h"
 #include "gc/accounting/card_table-inl.h"
+#include "gc/collector/garbage_collector.h"
 #include "gc/heap.h"
+#include "gc/reference_processor.h"
 #include "gc/scoped_gc_critical_section.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
@@ -93,6 +95,7 @@
 #include "instrumentation.h"
 #include "intern_table-inl.h"
 #include "interpreter/interpreter.h"
+#include "javaheapprof/allocation_site_profiler.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
 #include "jit/profile_saver.h"
@@ -100,6 +103,7 @@
 #include "jni/jni_id_manager.h"
 #include "jni_id_type.h"
 #include "linear_alloc.h"
+#include "lock_contention_profiler.h"
 #include "memory_representation.h"
 #include "metrics/statsd.h"
 #include "mirror/array.h"
@@ -177,8 +181,10 @@
 #include "thread_list.h"
 #include "ti/agent.h"
 #include "trace.h"
+#include "trace_profile.h"
 #include "vdex_file.h"
 #include "verifier/class_verifier.h"
+#include "wall_clock_profiler.h"
 #include "well_known_classes-inl.h"
 
 #ifdef ART_TARGET_ANDROID
@@ -287,6 +293,7 @@ Runtime::Runtime()
       dump_gc_performance_on_shutdown_(false),
       active_transaction_(false),
       verify_(verifier::VerifyMode::kNone),
+      verify_in_background_(false),
       target_sdk_version_(static_cast<uint32_t>(SdkVersion::kUnset)),
       compat_framework_(),
       implicit_null_checks_(false),
@@ -322,6 +329,13 @@ Runtime::Runtime()
       verifier_missing_kthrow_fatal_(false),
       perfetto_hprof_enabled_(false),
       perfetto_javaheapprof_enabled_(false),
+      parallel_hprof_enabled_(false),
+      hprof_omit_primitive_arrays_(false),
+      fork_hprof_enabled_(false),
+      parallel_reference_processing_enabled_(false),
+      parallel_sweeping_enabled_(false),
+      wall_clock_profile_interval_us_(0u),
+      trace_profile_buffer_size_(kAlwaysOnTraceBufSize),
       out_of_memory_error_hook_(nullptr) {
   static_assert(Runtime::kCalleeSaveSize ==
                     static_cast<uint32_t>(CalleeSaveType::kLastCalleeSaveType), "Unexpected size");
@@ -432,6 +446,7 @@ Runtime::~Runtime() {
   // Shutdown any trace before SetShuttingDown. Trace uses thread pool workers to flush entries
   // and we want to make sure they are fully created. Threads cannot attach while shutting down.
   Trace::Shutdown();
+  WallClockProfiler::Stop();
 
   {
     ScopedTrace trace2("Wait for shutdown cond");
@@ -1162,6 +1177,10 @@ bool Runtime::Start() {
                  0);
   }
 
+  if (!trace_profile_flight_recorder_dir_.empty()) {
+    TraceProfiler::Start();
+  }
+
   // In case we have a profile path passed as a command line argument,
   // register the current class path for profiling now. Note that we cannot do
   // this before we create the JIT and having it here is the most convenient way.
@@ -1273,6 +1292,17 @@ void Runtime::InitNonZygoteOrPostFork(
     thread_pool_->StartWorkers(Thread::Current());
   }
 
+  // Create the heap thread pool for processing references and sweeping in parallel. The workers do
+  // not survive a fork, so this is not done in the zygote.
+  if ((parallel_reference_processing_enabled_ || parallel_sweeping_enabled_) &&
+      heap_->GetThreadPool() == nullptr) {
+    ScopedTrace timing("CreateHeapThreadPool");
+    heap_->CreateThreadPool(
+        std::min(heap_->GetParallelGCThreadCount(),
+                 std::max(gc::ReferenceProcessor::kMaxParallelThreads,
+                          gc::collector::GarbageCollector::kMaxParallelSweepThreads)));
+  }
+
   // Reset the gc performance data and metrics at zygote fork so that the events from
   // before fork aren't attributed to an app.
   heap_->ResetGcPerformanceInfo();
@@ -1298,6 +1328,12 @@ void Runtime::InitNonZygoteOrPostFork(
 
   StartSignalCatcher();
 
+  // The sampling thread is started here rather than in `Start()`, as the zygote cannot fork
+  // while it runs extra threads.
+  if (wall_clock_profile_interval_us_ != 0u) {
+    WallClockProfiler::Start(wall_clock_profile_interval_us_);
+  }
+
   ScopedObjectAccess soa(Thread::Current());
   if (IsPerfettoHprofEnabled() &&
       (Dbg::IsJdwpAllowed() || IsProfileable() || IsProfileableFromShell() || IsJavaDebuggable() ||
@@ -1551,6 +1587,15 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   force_java_zygote_fork_loop_ = runtime_options.GetOrDefault(Opt::ForceJavaZygoteForkLoop);
   perfetto_hprof_enabled_ = runtime_options.GetOrDefault(Opt::PerfettoHprof);
   perfetto_javaheapprof_enabled_ = runtime_options.GetOrDefault(Opt::PerfettoJavaHeapStackProf);
+  parallel_hprof_enabled_ = runtime_options.GetOrDefault(Opt::ParallelHprof);
+  hprof_omit_primitive_arrays_ = runtime_options.GetOrDefault(Opt::HprofOmitPrimitiveArrays);
+  fork_hprof_enabled_ = runtime_options.GetOrDefault(Opt::ForkHprof);
+  parallel_reference_processing_enabled_ =
+      runtime_options.GetOrDefault(Opt::ParallelReferenceProcessing);
+  parallel_sweeping_enabled_ = runtime_options.GetOrDefault(Opt::ParallelSweeping);
+  trace_profile_buffer_size_ = runtime_options.GetOrDefault(Opt::TraceProfileBufferSize);
+  trace_profile_flight_recorder_dir_ =
+      runtime_options.ReleaseOrDefault(Opt::TraceProfileFlightRecorderDir);
 
   // Try to reserve a dedicated fault page. This is allocated for clobbered registers and sentinels.
   // If we cannot reserve it, log a warning.
@@ -1588,6 +1633,15 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   Thread::SetSensitiveThreadHook(runtime_options.GetOrDefault(Opt::HookIsSensitiveThread));
   Monitor::Init(runtime_options.GetOrDefault(Opt::LockProfThreshold),
                 runtime_options.GetOrDefault(Opt::StackDumpLockProfThreshold));
+  if (runtime_options.Exists(Opt::LockContentionProfile)) {
+    LockContentionProfiler::Enable();
+  }
+  if (runtime_options.Exists(Opt::WallClockProfile)) {
+    wall_clock_profile_interval_us_ = runtime_options.GetOrDefault(Opt::WallClockProfileInterval);
+    if (runtime_options.Exists(Opt::WallClockProfileOutput)) {
+      WallClockProfiler::SetOutputFile(runtime_options.GetOrDefault(Opt::WallClockProfileOutput));
+    }
+  }
 
   image_locations_ = runtime_options.ReleaseOrDefault(Opt::Image);
 
@@ -1678,6 +1732,7 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   monitor_timeout_ns_ = MsToNs(monitor_timeout_ms);
 
   verify_ = runtime_options.GetOrDefault(Opt::Verify);
+  verify_in_background_ = runtime_options.Exists(Opt::VerifyInBackground);
 
   target_sdk_version_ = runtime_options.GetOrDefault(Opt::TargetSdkVersion);
 
@@ -1798,6 +1853,14 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   dump_gc_performance_on_shutdown_ = runtime_options.Exists(Opt::DumpGCPerformanceOnShutdown);
 
+  if (runtime_options.Exists(Opt::AllocSiteProfile)) {
+    if (runtime_options.Exists(Opt::AllocSiteProfileOutput)) {
+      AllocationSiteProfiler::SetOutputFile(
+          runtime_options.GetOrDefault(Opt::AllocSiteProfileOutput));
+    }
+    AllocationSiteProfiler::Enable(runtime_options.GetOrDefault(Opt::AllocSiteProfileInterval));
+  }
+
   bool has_explicit_jdwp_options = runtime_options.Get(Opt::JdwpOptions) != nullptr;
   jdwp_options_ = runtime_options.GetOrDefault(Opt::JdwpOptions);
   jdwp_provider_ = CanonicalizeJdwpProvider(runtime_options.GetOrDefault(Opt::JdwpProvider),
@@ -2469,6 +2532,10 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   }
   DumpDeoptimizations(os);
   TrackedAllocators::Dump(os);
+  LockContentionProfiler::DumpForSigQuit(os);
+  AllocationSiteProfiler::DumpForSigQuit(os);
+  WallClockProfiler::DumpForSigQuit(os);
+  TraceProfiler::DumpForSigQuit(os);
   GetMetrics()->DumpForSigQuit(os);
   os << "\n";
 
@@ -657,6 +657,12 @@ class Runtime {
   bool IsVerificationEnabled() const;
   EXPORT bool IsVerificationSoftFail() const;
 
+  // Whether classes that could not be verified ahead of time are verified on a background thread
+  // when their dex file is first used, instead of on first use of each class.
+  bool IsVerifyInBackgroundEnabled() const {
+    return verify_in_background_;
+  }
+
   void SetHiddenApiEnforcementPolicy(hiddenapi::EnforcementPolicy policy) {
     hidden_api_policy_ = policy;
   }
@@ -1062,6 +1068,34 @@ class Runtime {
     return perfetto_javaheapprof_enabled_;
   }
 
+  bool IsParallelHprofEnabled() const {
+    return parallel_hprof_enabled_;
+  }
+
+  bool IsHprofOmitPrimitiveArraysEnabled() const {
+    return hprof_omit_primitive_arrays_;
+  }
+
+  bool IsForkHprofEnabled() const {
+    return fork_hprof_enabled_;
+  }
+
+  bool IsParallelReferenceProcessingEnabled() const {
+    return parallel_reference_processing_enabled_;
+  }
+
+  bool IsParallelSweepingEnabled() const {
+    return parallel_sweeping_enabled_;
+  }
+
+  uint32_t GetTraceProfileBufferSize() const {
+    return trace_profile_buffer_size_;
+  }
+
+  const std::string& GetTraceProfileFlightRecorderDir() const {
+    return trace_profile_flight_recorder_dir_;
+  }
+
   bool IsMonitorTimeoutEnabled() const {
     return monitor_timeout_enable_;
   }
@@ -1352,6 +1386,9 @@ class Runtime {
   // If kNone, verification is disabled. kEnable by default.
   verifier::VerifyMode verify_;
 
+  // Whether to verify classes rejected by the AOT verifier in the background.
+  bool verify_in_background_;
+
   // List of supported cpu abis.
   std::vector<std::string> cpu_abilist_;
 
@@ -1537,6 +1574,21 @@ class Runtime {
   bool force_java_zygote_fork_loop_;
   bool perfetto_hprof_enabled_;
   bool perfetto_javaheapprof_enabled_;
+  bool parallel_hprof_enabled_;
+  bool hprof_omit_primitive_arrays_;
+  bool fork_hprof_enabled_;
+  bool parallel_reference_processing_enabled_;
+  bool parallel_sweeping_enabled_;
+
+  // Sampling interval of the wall clock profiler started with the runtime, or 0 if none.
+  uint32_t wall_clock_profile_interval_us_;
+
+  // Number of entries of the per-thread buffers of the always-on trace profile.
+  uint32_t trace_profile_buffer_size_;
+
+  // Directory where the always-on trace profile is dumped when the flight recorder is triggered,
+  // or empty if the profile is not started with the runtime.
+  std::string trace_profile_flight_recorder_dir_;
 
   // Called on out of memory error
   void (*out_of_memory_error_hook_)();
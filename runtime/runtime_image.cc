@@ -1922,6 +1922,7 @@ bool RuntimeImage::WriteImageToDisk(std::string* error_msg) {
           reinterpret_cast<const uint8_t*>(image->GetImageBitmap().Begin()),
           kImageStorageMode,
           kMaxImageBlockSize,
+          /* dictionary_size= */ 0u,
           /* update_checksum= */ false,
           error_msg)) {
     return false;
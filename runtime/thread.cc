@@ -78,6 +78,7 @@
 #include "java_frame_root_info.h"
 #include "jni/java_vm_ext.h"
 #include "jni/jni_internal.h"
+#include "lock_contention_profiler.h"
 #include "mirror/class-alloc-inl.h"
 #include "mirror/class_loader.h"
 #include "mirror/object_array-alloc-inl.h"
@@ -2092,6 +2093,11 @@ void Thread::DumpState(std::ostream& os, const Thread* thread, pid_t tid) {
   }
   os << "\n";
 
+  if (InterpreterCache::kCountStats && thread != nullptr) {
+    os << "  | interpreterCacheHits=" << thread->interpreter_cache_.GetHitCount()
+       << " interpreterCacheFills=" << thread->interpreter_cache_.GetFillCount() << "\n";
+  }
+
   // Grab the scheduler stats for this thread.
   std::string scheduler_stats;
   if (android::base::ReadFileToString(StringPrintf("/proc/self/task/%d/schedstat", tid),
@@ -2658,6 +2664,10 @@ void Thread::Destroy(bool should_run_callbacks) {
     if (UNLIKELY(self->GetMethodTraceBuffer() != nullptr)) {
       Trace::FlushThreadBuffer(self);
     }
+
+    if (UNLIKELY(self->GetLockContentionBuffer() != nullptr)) {
+      LockContentionProfiler::FlushThreadBuffer(self);
+    }
   }
   // Mark-stack revocation must be performed at the very end. No
   // checkpoint/flip-function or read-barrier should be called after this.
@@ -2703,6 +2713,7 @@ Thread::~Thread() {
   delete tlsPtr_.deps_or_stack_trace_sample.stack_trace_sample;
 
   CHECK_EQ(tlsPtr_.method_trace_buffer, nullptr);
+  CHECK(lock_contention_buffer_ == nullptr);
 
   Runtime::Current()->GetHeap()->AssertThreadLocalBuffersAreRevoked(this);
 
@@ -4589,6 +4600,7 @@ void Thread::SweepInterpreterCache(IsMarkedVisitor* visitor) {
   for (InterpreterCache::Entry& entry : GetInterpreterCache()->GetArray()) {
     SweepCacheEntry(visitor, reinterpret_cast<const Instruction*>(entry.first), &entry.second);
   }
+  GetInterpreterInlineCache()->Sweep(visitor);
 }
 
 // FIXME: clang-r433403 reports the below function exceeds frame size limit.
@@ -4843,6 +4855,7 @@ void Thread::ClearAllInterpreterCaches() {
   static struct ClearInterpreterCacheClosure : Closure {
     void Run(Thread* thread) override {
       thread->GetInterpreterCache()->Clear(thread);
+      thread->GetInterpreterInlineCache()->Clear(thread);
     }
   } closure;
   Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
@@ -38,6 +38,7 @@
 #include "handle.h"
 #include "handle_scope.h"
 #include "interpreter/interpreter_cache.h"
+#include "interpreter/interpreter_inline_cache.h"
 #include "interpreter/shadow_frame.h"
 #include "javaheapprof/javaheapsampler.h"
 #include "jvalue.h"
@@ -97,6 +98,7 @@ class FrameIdToShadowFrame;
 class IsMarkedVisitor;
 class JavaVMExt;
 class JNIEnvExt;
+class LockContentionBuffer;
 class Monitor;
 class RootVisitor;
 class ScopedObjectAccessAlreadyRunnable;
@@ -1379,6 +1381,14 @@ class EXPORT Thread {
     }
   }
 
+  LockContentionBuffer* GetLockContentionBuffer() { return lock_contention_buffer_; }
+
+  void SetLockContentionBuffer(LockContentionBuffer* buffer) { lock_contention_buffer_ = buffer; }
+
+  size_t GetPendingAllocationSampleBytes() const { return pending_allocation_sample_bytes_; }
+
+  void SetPendingAllocationSampleBytes(size_t bytes) { pending_allocation_sample_bytes_ = bytes; }
+
   uint64_t GetTraceClockBase() const {
     return tls64_.trace_clock_base;
   }
@@ -1587,6 +1597,10 @@ class EXPORT Thread {
     return &interpreter_cache_;
   }
 
+  ALWAYS_INLINE InterpreterInlineCache* GetInterpreterInlineCache() {
+    return &interpreter_inline_cache_;
+  }
+
   // Clear all thread-local interpreter caches.
   //
   // Since the caches are keyed by memory pointer to dex instructions, this must be
@@ -1602,8 +1616,17 @@ class EXPORT Thread {
     return ThreadOffset<pointer_size>(OFFSETOF_MEMBER(Thread, interpreter_cache_));
   }
 
-  static constexpr int InterpreterCacheSizeLog2() {
-    return WhichPowerOf2(InterpreterCache::kSize);
+  static constexpr int InterpreterCacheSetsLog2() {
+    return WhichPowerOf2(InterpreterCache::kNumSets);
+  }
+
+  template<PointerSize pointer_size>
+  static constexpr ThreadOffset<pointer_size> InterpreterInlineCacheOffset() {
+    return ThreadOffset<pointer_size>(OFFSETOF_MEMBER(Thread, interpreter_inline_cache_));
+  }
+
+  static constexpr int InterpreterInlineCacheSizeLog2() {
+    return WhichPowerOf2(InterpreterInlineCache::kSize);
   }
 
   static constexpr uint32_t AllThreadFlags() {
@@ -2349,6 +2372,10 @@ class EXPORT Thread {
   // The value is opcode-depended (e.g. field offset).
   InterpreterCache interpreter_cache_;
 
+  // Monomorphic inline cache for nterp `invoke-interface` call sites whose
+  // IMT slot is a conflict. It is keyed by dex instruction pointer.
+  InterpreterInlineCache interpreter_inline_cache_;
+
   // All fields below this line should not be accessed by native code. This means these fields can
   // be modified, rearranged, added or removed without having to modify asm_support.h
 
@@ -2360,6 +2387,12 @@ class EXPORT Thread {
   // Pointer to the monitor lock we're currently waiting on or null if not waiting.
   Monitor* wait_monitor_ GUARDED_BY(wait_mutex_);
 
+  // Buffered monitor contention samples, see LockContentionProfiler. Allocated lazily.
+  LockContentionBuffer* lock_contention_buffer_ = nullptr;
+
+  // Size of an allocation sampled for the AllocationSiteProfiler before its class was set.
+  size_t pending_allocation_sample_bytes_ = 0u;
+
   // Debug disable read barrier count, only is checked for debug builds and only in the runtime.
   uint8_t debug_disallow_read_barrier_ = 0;
 
@@ -51,6 +51,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 #include "trace.h"
+#include "trace_profile.h"
 #include "unwindstack/AndroidUnwinder.h"
 #include "well_known_classes.h"
 
@@ -1487,6 +1488,7 @@ void ThreadList::Register(Thread* self) {
   }
   CHECK(!Contains(self));
   list_.push_back(self);
+  TraceProfiler::AllocateBufferForNewThread(self);
   if (gUseReadBarrier) {
     gc::collector::ConcurrentCopying* const cc =
         Runtime::Current()->GetHeap()->ConcurrentCopyingCollector();
@@ -106,6 +106,7 @@ namespace {
 // This is initialized at the start of tracing using the timestamp counter update frequency.
 // See InitializeTimestampCounters for more details.
 double tsc_to_microsec_scaling_factor = -1.0;
+}  // namespace
 
 uint64_t GetTimestamp() {
   uint64_t t = 0;
@@ -134,6 +135,7 @@ uint64_t GetTimestamp() {
   return t;
 }
 
+namespace {
 #if defined(__i386__) || defined(__x86_64__) || defined(__aarch64__)
 // Here we compute the scaling factor by sleeping for a millisecond. Alternatively, we could
 // generate raw timestamp counter and also time using clock_gettime at the start and the end of the
@@ -191,6 +193,7 @@ double GetScalingFactorForX86() {
   return scaling_factor;
 }
 #endif
+}  // namespace
 
 void InitializeTimestampCounters() {
   // It is sufficient to initialize this once for the entire execution. Just return if it is
@@ -222,11 +225,17 @@ void InitializeTimestampCounters() {
 #endif
 }
 
-ALWAYS_INLINE uint64_t GetMicroTime(uint64_t counter) {
+uint64_t GetMicroTime(uint64_t counter) {
   DCHECK(tsc_to_microsec_scaling_factor > 0.0) << tsc_to_microsec_scaling_factor;
   return tsc_to_microsec_scaling_factor * counter;
 }
 
+uint64_t GetNanoTime(uint64_t counter) {
+  DCHECK(tsc_to_microsec_scaling_factor > 0.0) << tsc_to_microsec_scaling_factor;
+  return tsc_to_microsec_scaling_factor * 1000.0 * counter;
+}
+
+namespace {
 TraceClockSource GetClockSourceFromFlags(int flags) {
   bool need_wall = flags & Trace::TraceFlag::kTraceClockSourceWallClock;
   bool need_thread_cpu = flags & Trace::TraceFlag::kTraceClockSourceThreadCpu;
@@ -964,7 +973,9 @@ void Trace::FlushThreadBuffer(Thread* self) {
   // Check if we still need to flush inside the trace_lock_. If we are stopping tracing it is
   // possible we already deleted the trace and flushed the buffer too.
   if (the_trace_ == nullptr) {
-    DCHECK_EQ(self->GetMethodTraceBuffer(), nullptr);
+    // The buffer may belong to the always-on trace profile, which drops the events of exiting
+    // threads.
+    TraceProfiler::ReleaseThreadBuffer(self);
     return;
   }
   the_trace_->trace_writer_->FlushBuffer(self, /* is_sync= */ false, /* free_buffer= */ true);
@@ -975,7 +986,7 @@ void Trace::ReleaseThreadBuffer(Thread* self) {
   // Check if we still need to flush inside the trace_lock_. If we are stopping tracing it is
   // possible we already deleted the trace and flushed the buffer too.
   if (the_trace_ == nullptr) {
-    DCHECK_EQ(self->GetMethodTraceBuffer(), nullptr);
+    TraceProfiler::ReleaseThreadBuffer(self);
     return;
   }
   the_trace_->trace_writer_->ReleaseBufferForThread(self);
@@ -124,6 +124,15 @@ static constexpr int32_t kHighTimestampOffsetInBytes =
 
 static constexpr uintptr_t kMaskTraceAction = ~0b11;
 
+// Reads the timestamp counter that the JITed code records for trace entries (cntvct_el0 on arm64,
+// rdtsc on x86).
+uint64_t GetTimestamp();
+// Computes the frequency of the timestamp counter. Must be called before the conversions below.
+void InitializeTimestampCounters();
+// Converts a timestamp counter value to microseconds and nanoseconds.
+uint64_t GetMicroTime(uint64_t counter);
+uint64_t GetNanoTime(uint64_t counter);
+
 // Packet type encoding for the new method tracing format.
 static constexpr int kThreadInfoHeaderV2 = 0;
 static constexpr int kMethodInfoHeaderV2 = 1;
@@ -16,8 +16,18 @@
 
 #include "trace_profile.h"
 
+#include <unistd.h>
+
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "android-base/stringprintf.h"
+#include "art_method-inl.h"
 #include "base/leb128.h"
 #include "base/mutex.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
 #include "com_android_art_flags.h"
 #include "runtime.h"
@@ -30,23 +40,108 @@ namespace art_flags = com::android::art::flags;
 
 namespace art HIDDEN {
 
-// This specifies the maximum number of bits we need for encoding one entry. Each entry just
-// consists of a SLEB encoded value of method and action encodig which is a maximum of
-// sizeof(uintptr_t).
-static constexpr size_t kMaxBytesPerTraceEntry = sizeof(uintptr_t);
-
-// We don't handle buffer overflows when processing the raw trace entries. We have a maximum of
-// kAlwaysOnTraceBufSize raw entries and we need a maximum of kMaxBytesPerTraceEntry to encode
-// each entry. To avoid overflow, we ensure that there are at least kMinBufSizeForEncodedData
-// bytes free space in the buffer.
-static constexpr size_t kMinBufSizeForEncodedData = kAlwaysOnTraceBufSize * kMaxBytesPerTraceEntry;
+using android::base::StringPrintf;
 
-// TODO(mythria): 10 is a randomly chosen value. Tune it if required.
-static constexpr size_t kBufSizeForEncodedData = kMinBufSizeForEncodedData * 10;
+// This specifies the maximum number of bytes we need for encoding one event. Each event just
+// consists of a SLEB encoded value of method and action encoding, which takes at most 10 bytes.
+// Events take two entries of the per-thread buffer, so this is at most sizeof(uintptr_t) per
+// entry.
+static constexpr size_t kMaxBytesPerTraceEntry = sizeof(uintptr_t);
 
 static constexpr size_t kAlwaysOnTraceHeaderSize = 8;
 
+static constexpr const char* kPerfettoTraceSuffix = ".perfetto-trace";
+
 bool TraceProfiler::profile_in_progress_ = false;
+size_t TraceProfiler::buffer_size_ = 0u;
+
+namespace {
+
+// Calls `visitor(method_action_encoding, timestamp)` for each event recorded in `buffer`, oldest
+// first. `current_entry` points to the most recent event. Events are written at decreasing
+// addresses, starting from the end of the buffer and wrapping around before the first entry,
+// which holds the size of the buffer in bytes. So the events are laid out in the buffer at
+// positions size - 2, size - 4, ..., down to 1 or 2.
+template <typename Visitor>
+void VisitEvents(uintptr_t* buffer, uintptr_t* current_entry, Visitor&& visitor) {
+  size_t size = buffer[0] / sizeof(uintptr_t);
+  size_t current = current_entry - buffer;
+  if (current == size) {
+    return;  // No events.
+  }
+  size_t top = size - kAlwaysOnTraceEntriesPerEvent;
+  size_t num_events = (size - 1u) / kAlwaysOnTraceEntriesPerEvent;
+  size_t newest = (top - current) / kAlwaysOnTraceEntriesPerEvent;
+  for (size_t i = 1; i <= num_events; ++i) {
+    size_t index = (newest + i) % num_events;
+    uintptr_t* event = buffer + top - index * kAlwaysOnTraceEntriesPerEvent;
+    // 0 value indicates the entry is empty, i.e. the buffer did not wrap around yet.
+    if (event[0] == 0u) {
+      continue;
+    }
+    visitor(event[0], static_cast<uint64_t>(event[1]));
+  }
+}
+
+// Field numbers and values of the perfetto trace protos, see
+// external/perfetto/protos/perfetto/trace/trace_packet.proto and track_event/*.proto.
+enum PerfettoField : uint32_t {
+  kTracePacket = 1,
+  kPacketTimestamp = 8,
+  kPacketTrustedPacketSequenceId = 10,
+  kPacketTrackEvent = 11,
+  kPacketInternedData = 12,
+  kPacketSequenceFlags = 13,
+  kPacketTimestampClockId = 58,
+  kPacketTrackDescriptor = 60,
+  kTrackDescriptorUuid = 1,
+  kTrackDescriptorThread = 4,
+  kThreadDescriptorPid = 1,
+  kThreadDescriptorTid = 2,
+  kThreadDescriptorThreadName = 5,
+  kTrackEventType = 9,
+  kTrackEventNameIid = 10,
+  kTrackEventTrackUuid = 11,
+  kInternedDataEventNames = 2,
+  kEventNameIid = 1,
+  kEventNameName = 2,
+};
+
+static constexpr uint64_t kTrackEventTypeSliceBegin = 1;
+static constexpr uint64_t kTrackEventTypeSliceEnd = 2;
+static constexpr uint64_t kSeqIncrementalStateCleared = 1;
+static constexpr uint64_t kSeqNeedsIncrementalState = 2;
+static constexpr uint64_t kBuiltinClockMonotonic = 3;
+static constexpr uint64_t kPerfettoSequenceId = 1;
+
+void AppendVarintField(uint32_t field, uint64_t value, std::vector<uint8_t>* out) {
+  EncodeUnsignedLeb128(out, field << 3);
+  EncodeUnsignedLeb128(out, value);
+}
+
+void AppendBytesField(uint32_t field, const uint8_t* data, size_t size, std::vector<uint8_t>* out) {
+  EncodeUnsignedLeb128(out, (field << 3) | 2u);
+  EncodeUnsignedLeb128(out, size);
+  out->insert(out->end(), data, data + size);
+}
+
+void AppendBytesField(uint32_t field, const std::vector<uint8_t>& data, std::vector<uint8_t>* out) {
+  AppendBytesField(field, data.data(), data.size(), out);
+}
+
+void AppendStringField(uint32_t field, std::string_view str, std::vector<uint8_t>* out) {
+  AppendBytesField(field, reinterpret_cast<const uint8_t*>(str.data()), str.size(), out);
+}
+
+}  // namespace
+
+uintptr_t* TraceProfiler::AllocateBuffer(size_t size) {
+  uintptr_t* buffer = new uintptr_t[size];
+  memset(buffer, 0, size * sizeof(uintptr_t));
+  // The JITed code reads the size from the first entry when it wraps around.
+  buffer[0] = size * sizeof(uintptr_t);
+  return buffer;
+}
 
 void TraceProfiler::Start() {
   if (!art_flags::always_enable_profile_code()) {
@@ -67,14 +162,35 @@ void TraceProfiler::Start() {
   }
 
   profile_in_progress_ = true;
+  InitializeTimestampCounters();
 
   ScopedSuspendAll ssa(__FUNCTION__);
   MutexLock tl(self, *Locks::thread_list_lock_);
+  buffer_size_ =
+      std::max<size_t>(Runtime::Current()->GetTraceProfileBufferSize(), kAlwaysOnTraceMinBufSize);
   for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
-    auto buffer = new uintptr_t[kAlwaysOnTraceBufSize];
-    memset(buffer, 0, kAlwaysOnTraceBufSize * sizeof(uintptr_t));
-    thread->SetMethodTraceBuffer(buffer, kAlwaysOnTraceBufSize);
+    // Threads that registered since the buffer size was set already have a buffer.
+    if (thread->GetMethodTraceBuffer() == nullptr) {
+      thread->SetMethodTraceBuffer(AllocateBuffer(buffer_size_), buffer_size_);
+    }
+  }
+}
+
+void TraceProfiler::AllocateBufferForNewThread(Thread* self) {
+  if (buffer_size_ != 0u) {
+    DCHECK(self->GetMethodTraceBuffer() == nullptr);
+    self->SetMethodTraceBuffer(AllocateBuffer(buffer_size_), buffer_size_);
+  }
+}
+
+void TraceProfiler::ReleaseThreadBuffer(Thread* self) {
+  if (!profile_in_progress_) {
+    DCHECK_EQ(self->GetMethodTraceBuffer(), nullptr);
+    return;
   }
+  // The events of exiting threads are dropped.
+  delete[] self->GetMethodTraceBuffer();
+  self->SetMethodTraceBuffer(/* buffer= */ nullptr, /* init_index= */ 0);
 }
 
 void TraceProfiler::Stop() {
@@ -99,12 +215,14 @@ void TraceProfiler::Stop() {
       thread->SetMethodTraceBuffer(/* buffer= */ nullptr, /* offset= */ 0);
     }
   }
+  buffer_size_ = 0u;
 
   profile_in_progress_ = false;
 }
 
 uint8_t* TraceProfiler::DumpBuffer(uint32_t thread_id,
                                    uintptr_t* method_trace_entries,
+                                   uintptr_t* current_entry,
                                    uint8_t* buffer,
                                    std::unordered_set<ArtMethod*>& methods) {
   // Encode header at the end once we compute the number of records.
@@ -112,21 +230,18 @@ uint8_t* TraceProfiler::DumpBuffer(uint32_t thread_id,
 
   int num_records = 0;
   uintptr_t prev_method_action_encoding = 0;
-  for (size_t i = 0; i < kAlwaysOnTraceBufSize; i++) {
-    uintptr_t method_action_encoding = method_trace_entries[num_records];
-    // 0 value indicates the rest of the entries are empty.
-    if (method_action_encoding == 0) {
-      break;
-    }
-
-    int64_t method_diff = method_action_encoding - prev_method_action_encoding;
-    curr_buffer_ptr = EncodeSignedLeb128(curr_buffer_ptr, method_diff);
-
-    ArtMethod* method = reinterpret_cast<ArtMethod*>(method_action_encoding & kMaskTraceAction);
-    methods.insert(method);
-    num_records++;
-    prev_method_action_encoding = method_action_encoding;
-  }
+  VisitEvents(method_trace_entries,
+              current_entry,
+              [&](uintptr_t method_action_encoding, [[maybe_unused]] uint64_t timestamp) {
+                int64_t method_diff = method_action_encoding - prev_method_action_encoding;
+                curr_buffer_ptr = EncodeSignedLeb128(curr_buffer_ptr, method_diff);
+
+                ArtMethod* method =
+                    reinterpret_cast<ArtMethod*>(method_action_encoding & kMaskTraceAction);
+                methods.insert(method);
+                num_records++;
+                prev_method_action_encoding = method_action_encoding;
+              });
 
   // Fill in header information:
   // 1 byte of header identifier
@@ -138,6 +253,71 @@ uint8_t* TraceProfiler::DumpBuffer(uint32_t thread_id,
   return curr_buffer_ptr;
 }
 
+void TraceProfiler::DumpBufferPerfetto(uint32_t tid,
+                                       const std::string& thread_name,
+                                       uintptr_t* method_trace_entries,
+                                       uintptr_t* current_entry,
+                                       uint64_t counter_to_monotonic_ns,
+                                       std::unordered_map<ArtMethod*, uint64_t>& method_iids,
+                                       std::vector<uint8_t>* trace) {
+  uint64_t track_uuid = (static_cast<uint64_t>(getpid()) << 32) | tid;
+  {
+    std::vector<uint8_t> thread_descriptor;
+    AppendVarintField(kThreadDescriptorPid, getpid(), &thread_descriptor);
+    AppendVarintField(kThreadDescriptorTid, tid, &thread_descriptor);
+    AppendStringField(kThreadDescriptorThreadName, thread_name, &thread_descriptor);
+    std::vector<uint8_t> track_descriptor;
+    AppendVarintField(kTrackDescriptorUuid, track_uuid, &track_descriptor);
+    AppendBytesField(kTrackDescriptorThread, thread_descriptor, &track_descriptor);
+    std::vector<uint8_t> packet;
+    AppendVarintField(kPacketTrustedPacketSequenceId, kPerfettoSequenceId, &packet);
+    AppendBytesField(kPacketTrackDescriptor, track_descriptor, &packet);
+    AppendBytesField(kTracePacket, packet, trace);
+  }
+
+  std::vector<uint8_t> track_event;
+  std::vector<uint8_t> interned_data;
+  std::vector<uint8_t> packet;
+  VisitEvents(
+      method_trace_entries,
+      current_entry,
+      [&](uintptr_t method_action_encoding, uint64_t timestamp) REQUIRES_SHARED(
+          Locks::mutator_lock_) {
+        track_event.clear();
+        interned_data.clear();
+        packet.clear();
+        TraceAction action =
+            static_cast<TraceAction>(method_action_encoding & kTraceMethodActionMask);
+        if (action == kTraceMethodEnter) {
+          ArtMethod* method =
+              reinterpret_cast<ArtMethod*>(method_action_encoding & kMaskTraceAction);
+          auto [it, inserted] = method_iids.emplace(method, method_iids.size() + 1u);
+          if (inserted) {
+            std::vector<uint8_t> event_name;
+            AppendVarintField(kEventNameIid, it->second, &event_name);
+            AppendStringField(kEventNameName, method->PrettyMethod(), &event_name);
+            AppendBytesField(kInternedDataEventNames, event_name, &interned_data);
+          }
+          AppendVarintField(kTrackEventType, kTrackEventTypeSliceBegin, &track_event);
+          AppendVarintField(kTrackEventNameIid, it->second, &track_event);
+        } else {
+          AppendVarintField(kTrackEventType, kTrackEventTypeSliceEnd, &track_event);
+        }
+        AppendVarintField(kTrackEventTrackUuid, track_uuid, &track_event);
+
+        AppendVarintField(
+            kPacketTimestamp, GetNanoTime(timestamp) + counter_to_monotonic_ns, &packet);
+        AppendVarintField(kPacketTimestampClockId, kBuiltinClockMonotonic, &packet);
+        AppendVarintField(kPacketTrustedPacketSequenceId, kPerfettoSequenceId, &packet);
+        AppendVarintField(kPacketSequenceFlags, kSeqNeedsIncrementalState, &packet);
+        AppendBytesField(kPacketTrackEvent, track_event, &packet);
+        if (!interned_data.empty()) {
+          AppendBytesField(kPacketInternedData, interned_data, &packet);
+        }
+        AppendBytesField(kTracePacket, packet, trace);
+      });
+}
+
 void TraceProfiler::Dump(int fd) {
   if (!art_flags::always_enable_profile_code()) {
     LOG(ERROR) << "Feature not supported. Please build with ART_ALWAYS_ENABLE_PROFILE_CODE.";
@@ -145,7 +325,7 @@ void TraceProfiler::Dump(int fd) {
   }
 
   std::unique_ptr<File> trace_file(new File(fd, /*check_usage=*/true));
-  Dump(std::move(trace_file));
+  Dump(std::move(trace_file), /* perfetto_format= */ false);
 }
 
 void TraceProfiler::Dump(const char* filename) {
@@ -160,44 +340,108 @@ void TraceProfiler::Dump(const char* filename) {
     return;
   }
 
-  Dump(std::move(trace_file));
+  Dump(std::move(trace_file), std::string_view(filename).ends_with(kPerfettoTraceSuffix));
 }
 
-void TraceProfiler::Dump(std::unique_ptr<File>&& trace_file) {
+void TraceProfiler::Dump(std::unique_ptr<File>&& trace_file, bool perfetto_format) {
   Thread* self = Thread::Current();
   std::unordered_set<ArtMethod*> traced_methods;
-  MutexLock mu(self, *Locks::trace_lock_);
-  if (!profile_in_progress_) {
-    LOG(ERROR) << "No Profile in progress. Nothing to dump.";
-    return;
-  }
+  std::unordered_map<ArtMethod*, uint64_t> method_iids;
+  std::vector<uint8_t> encoded_data;
+  {
+    MutexLock mu(self, *Locks::trace_lock_);
+    if (!profile_in_progress_) {
+      LOG(ERROR) << "No Profile in progress. Nothing to dump.";
+      return;
+    }
 
-  ScopedSuspendAll ssa(__FUNCTION__);
-  MutexLock tl(self, *Locks::thread_list_lock_);
-  uint8_t* buffer_ptr = new uint8_t[kBufSizeForEncodedData];
-  uint8_t* curr_buffer_ptr = buffer_ptr;
-  for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
-    auto method_trace_entries = thread->GetMethodTraceBuffer();
-    if (method_trace_entries == nullptr) {
-      continue;
+    ScopedSuspendAll ssa(__FUNCTION__);
+    MutexLock tl(self, *Locks::thread_list_lock_);
+    // We don't handle buffer overflows when processing the raw trace entries. To avoid overflow,
+    // we ensure that there is enough space for the events of one thread before encoding them.
+    size_t min_buf_size_for_encoded_data =
+        kAlwaysOnTraceHeaderSize + buffer_size_ * kMaxBytesPerTraceEntry;
+    // Offset between the timestamp counter converted to nanoseconds and CLOCK_MONOTONIC.
+    uint64_t counter_to_monotonic_ns = NanoTime() - GetNanoTime(GetTimestamp());
+    if (perfetto_format) {
+      // The first packet clears the incremental state, i.e. the interned method names.
+      std::vector<uint8_t> packet;
+      AppendVarintField(kPacketTrustedPacketSequenceId, kPerfettoSequenceId, &packet);
+      AppendVarintField(kPacketSequenceFlags, kSeqIncrementalStateCleared, &packet);
+      AppendBytesField(kTracePacket, packet, &encoded_data);
     }
+    for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
+      auto method_trace_entries = thread->GetMethodTraceBuffer();
+      if (method_trace_entries == nullptr) {
+        continue;
+      }
 
-    size_t offset = curr_buffer_ptr - buffer_ptr;
-    if (offset >= kMinBufSizeForEncodedData) {
-      if (!trace_file->WriteFully(buffer_ptr, offset)) {
-        PLOG(WARNING) << "Failed streaming a tracing event.";
+      if (perfetto_format) {
+        std::string thread_name;
+        thread->GetThreadName(thread_name);
+        DumpBufferPerfetto(thread->GetTid(),
+                           thread_name,
+                           method_trace_entries,
+                           *thread->GetTraceBufferCurrEntryPtr(),
+                           counter_to_monotonic_ns,
+                           method_iids,
+                           &encoded_data);
+      } else {
+        size_t offset = encoded_data.size();
+        encoded_data.resize(offset + min_buf_size_for_encoded_data);
+        uint8_t* end = DumpBuffer(thread->GetTid(),
+                                  method_trace_entries,
+                                  *thread->GetTraceBufferCurrEntryPtr(),
+                                  encoded_data.data() + offset,
+                                  traced_methods);
+        encoded_data.resize(end - encoded_data.data());
       }
-      curr_buffer_ptr = buffer_ptr;
+      // Reset the buffer and continue profiling. We need to set the entries to zeroes, since we
+      // use a circular buffer and detect empty entries by checking for zeroes. The first entry
+      // holds the size of the buffer.
+      memset(method_trace_entries + 1, 0, (buffer_size_ - 1u) * sizeof(uintptr_t));
+      // Reset the current pointer.
+      thread->SetMethodTraceBufferCurrentEntry(buffer_size_);
     }
-    curr_buffer_ptr =
-        DumpBuffer(thread->GetTid(), method_trace_entries, curr_buffer_ptr, traced_methods);
-    // Reset the buffer and continue profiling. We need to set the buffer to
-    // zeroes, since we use a circular buffer and detect empty entries by
-    // checking for zeroes.
-    memset(method_trace_entries, 0, kAlwaysOnTraceBufSize * sizeof(uintptr_t));
-    // Reset the current pointer.
-    thread->SetMethodTraceBufferCurrentEntry(kAlwaysOnTraceBufSize);
   }
+
+  // Write the file with the threads running and without holding the trace lock, which exiting
+  // threads need. When dumping on SIGQUIT, the app is likely already not responding.
+  if (!trace_file->WriteFully(encoded_data.data(), encoded_data.size()) ||
+      trace_file->FlushCloseOrErase() != 0) {
+    PLOG(WARNING) << "Failed streaming a tracing event.";
+  }
+}
+
+void TraceProfiler::TriggerFlightRecorder(const char* reason) {
+  const std::string& directory = Runtime::Current()->GetTraceProfileFlightRecorderDir();
+  if (directory.empty()) {
+    return;
+  }
+  {
+    MutexLock mu(Thread::Current(), *Locks::trace_lock_);
+    if (!profile_in_progress_) {
+      return;
+    }
+  }
+  std::string filename = StringPrintf("%s/trace_profile_%d_%s_%" PRIu64 "%s",
+                                      directory.c_str(),
+                                      getpid(),
+                                      reason,
+                                      MilliTime(),
+                                      kPerfettoTraceSuffix);
+  LOG(INFO) << "Writing trace profile flight recording to " << filename;
+  Dump(filename.c_str());
+}
+
+void TraceProfiler::DumpForSigQuit(std::ostream& os) {
+  if (!art_flags::always_enable_profile_code() ||
+      Runtime::Current()->GetTraceProfileFlightRecorderDir().empty()) {
+    return;
+  }
+  TriggerFlightRecorder("sigquit");
+  os << "Trace profile flight recording written to "
+     << Runtime::Current()->GetTraceProfileFlightRecorderDir() << "\n\n";
 }
 
 bool TraceProfiler::IsTraceProfileInProgress() {
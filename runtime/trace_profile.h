@@ -17,7 +17,12 @@
 #ifndef ART_RUNTIME_TRACE_PROFILE_H_
 #define ART_RUNTIME_TRACE_PROFILE_H_
 
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "base/locks.h"
 #include "base/macros.h"
@@ -26,17 +31,35 @@
 namespace art HIDDEN {
 
 class ArtMethod;
+class Thread;
 
 // TODO(mythria): A randomly chosen value. Tune it later based on the number of
 // entries required in the buffer.
 static constexpr size_t kAlwaysOnTraceBufSize = 2048;
 
+// Smallest per-thread buffer accepted by `-Xtrace-profile-buffer-size`, in entries.
+static constexpr size_t kAlwaysOnTraceMinBufSize = 64;
+
+// Each event takes two entries: the method pointer, with the trace action in the low bits, and
+// the timestamp counter. Method exits recorded by JITed code do not have a method pointer.
+static constexpr size_t kAlwaysOnTraceEntriesPerEvent = 2;
+
 // This class implements low-overhead tracing. This feature is available only when
 // always_enable_profile_code is enabled which is a build time flag defined in
 // build/flags/art-flags.aconfig. When this flag is enabled, AOT and JITed code can record events
 // on each method execution. When a profile is started, method entry / exit events are recorded in
 // a per-thread circular buffer. When requested the recorded events in the buffer are dumped into a
 // file. The buffers are released when the profile is stopped.
+//
+// The size of the per-thread buffers is set with `-Xtrace-profile-buffer-size`. The first entry
+// of a buffer holds its size in bytes, so that the JITed code can wrap around without knowing the
+// configured size. Events are written at decreasing addresses by the owning thread only and read
+// with all threads suspended, so recording does not need any synchronization. Threads started
+// while a profile is in progress get a buffer when they register.
+//
+// If `-Xtrace-profile-flight-recorder-dir` is given, the profile is started with the runtime and
+// the buffers act as a flight recorder: they are dumped in the perfetto format to that directory
+// when the runtime gets SIGQUIT, as it does on an ANR, or when `TriggerFlightRecorder` is called.
 class TraceProfiler {
  public:
   // Starts profiling by allocating a per-thread buffer for all the threads.
@@ -45,15 +68,31 @@ class TraceProfiler {
   // Releases all the buffers.
   static void Stop();
 
-  // Dumps the recorded events in the buffer from all threads in the specified file.
+  // Dumps the recorded events in the buffer from all threads in the specified file. Files
+  // named *.perfetto-trace are written in the perfetto trace format, others in the format of
+  // the method traces.
   static void Dump(int fd);
   static void Dump(const char* trace_filename);
 
+  // Dumps the recorded events in the perfetto format to a new file in the flight recorder
+  // directory, if there is one. `reason` is added to the file name.
+  static void TriggerFlightRecorder(const char* reason);
+
+  // Triggers the flight recorder, as the runtime gets SIGQUIT on an ANR.
+  static void DumpForSigQuit(std::ostream& os);
+
   static bool IsTraceProfileInProgress() REQUIRES(Locks::trace_lock_);
 
+  // Allocates a buffer for a thread that is being registered while a profile is in progress.
+  static void AllocateBufferForNewThread(Thread* self) REQUIRES(Locks::thread_list_lock_);
+
+  // Releases the buffer of an exiting thread.
+  static void ReleaseThreadBuffer(Thread* self) REQUIRES(Locks::trace_lock_);
+
  private:
-  // Dumps the events from all threads into the trace_file.
-  static void Dump(std::unique_ptr<File>&& trace_file);
+  // Dumps the events from all threads into the trace_file. The events are encoded with all
+  // threads suspended, the file is written once they are resumed.
+  static void Dump(std::unique_ptr<File>&& trace_file, bool perfetto_format);
 
   // This method goes over all the events in the thread_buffer and stores the encoded event in the
   // buffer. It returns the pointer to the next free entry in the buffer.
@@ -62,10 +101,28 @@ class TraceProfiler {
   // processed.
   static uint8_t* DumpBuffer(uint32_t thread_id,
                              uintptr_t* thread_buffer,
+                             uintptr_t* current_entry,
                              uint8_t* buffer /* out */,
                              std::unordered_set<ArtMethod*>& methods /* out */);
 
+  // Appends the events in `thread_buffer` of the thread `tid` to `trace`, a serialized perfetto
+  // `Trace` message.
+  static void DumpBufferPerfetto(uint32_t tid,
+                                 const std::string& thread_name,
+                                 uintptr_t* thread_buffer,
+                                 uintptr_t* current_entry,
+                                 uint64_t counter_to_monotonic_ns,
+                                 std::unordered_map<ArtMethod*, uint64_t>& method_iids /* in out */,
+                                 std::vector<uint8_t>* trace /* out */)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static uintptr_t* AllocateBuffer(size_t size);
+
   static bool profile_in_progress_ GUARDED_BY(Locks::trace_lock_);
+  // Size of the per-thread buffers in entries, or 0 if no profile is in progress.
+  static size_t buffer_size_ GUARDED_BY(Locks::thread_list_lock_);
+
+  friend class TraceProfileTest;  // For DumpBuffer, DumpBufferPerfetto and AllocateBuffer.
   DISALLOW_COPY_AND_ASSIGN(TraceProfiler);
 };
 
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace_profile.h"
+
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/leb128.h"
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change-inl.h"
+#include "trace.h"
+
+namespace art HIDDEN {
+
+// A field of a serialized protobuf message. Only varint and length-delimited fields are used
+// by the perfetto traces of the trace profile.
+struct ProtoField {
+  uint32_t number;
+  uint64_t value;     // For varint fields.
+  std::string bytes;  // For length-delimited fields.
+};
+
+static bool ParseProto(const std::string& data, /*out*/ std::vector<ProtoField>* fields) {
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(data.data());
+  const uint8_t* end = ptr + data.size();
+  while (ptr != end) {
+    uint32_t key;
+    if (!DecodeUnsignedLeb128Checked(&ptr, end, &key)) {
+      return false;
+    }
+    ProtoField field = {key >> 3, 0u, ""};
+    if ((key & 7u) == 0u) {
+      if (!DecodeUnsignedLeb128Checked(&ptr, end, &field.value)) {
+        return false;
+      }
+    } else if ((key & 7u) == 2u) {
+      uint64_t size;
+      if (!DecodeUnsignedLeb128Checked(&ptr, end, &size) ||
+          size > static_cast<size_t>(end - ptr)) {
+        return false;
+      }
+      field.bytes.assign(reinterpret_cast<const char*>(ptr), size);
+      ptr += size;
+    } else {
+      return false;
+    }
+    fields->push_back(std::move(field));
+  }
+  return true;
+}
+
+// Returns the fields of `data` with the given number.
+static std::vector<ProtoField> GetFields(const std::string& data, uint32_t number) {
+  std::vector<ProtoField> fields;
+  EXPECT_TRUE(ParseProto(data, &fields));
+  std::vector<ProtoField> result;
+  for (ProtoField& field : fields) {
+    if (field.number == number) {
+      result.push_back(std::move(field));
+    }
+  }
+  return result;
+}
+
+// Returns the only field of `data` with the given number.
+static ProtoField GetField(const std::string& data, uint32_t number) {
+  std::vector<ProtoField> fields = GetFields(data, number);
+  EXPECT_EQ(fields.size(), 1u) << number;
+  return fields.size() == 1u ? fields[0] : ProtoField{0u, 0u, ""};
+}
+
+class TraceProfileTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kBufferSize = kAlwaysOnTraceMinBufSize;
+  // Number of events that fit in a buffer of `kBufferSize` entries.
+  static constexpr size_t kMaxEvents = (kBufferSize - 1u) / kAlwaysOnTraceEntriesPerEvent;
+  // Size of the header written by `DumpBuffer`.
+  static constexpr size_t kHeaderSize = 8u;
+
+  void SetUp() override {
+    CommonRuntimeTest::SetUp();
+    buffer_ = TraceProfiler::AllocateBuffer(kBufferSize);
+    current_entry_ = buffer_ + kBufferSize;
+  }
+
+  void TearDown() override {
+    delete[] buffer_;
+    CommonRuntimeTest::TearDown();
+  }
+
+  // Records an event like art_quick_record_entry_trace_event and
+  // art_quick_record_exit_trace_event do.
+  void RecordEvent(uintptr_t method_action_encoding, uint64_t timestamp) {
+    current_entry_ -= kAlwaysOnTraceEntriesPerEvent;
+    if (current_entry_ <= buffer_) {
+      current_entry_ = buffer_ + buffer_[0] / sizeof(uintptr_t) - kAlwaysOnTraceEntriesPerEvent;
+    }
+    current_entry_[0] = method_action_encoding;
+    current_entry_[1] = timestamp;
+  }
+
+  // Returns the method and action encodings of the events in the buffer, as they are decoded by
+  // `DumpBuffer`.
+  std::vector<uintptr_t> DecodeEvents() {
+    std::vector<uint8_t> encoded(kHeaderSize + kBufferSize * sizeof(uintptr_t));
+    std::unordered_set<ArtMethod*> methods;
+    uint8_t* end = TraceProfiler::DumpBuffer(
+        /*thread_id=*/ 42u, buffer_, current_entry_, encoded.data(), methods);
+    EXPECT_EQ(encoded[0], kEntryHeaderV2);
+    EXPECT_EQ(42u, static_cast<uint32_t>(encoded[1] | (encoded[2] << 8) | (encoded[3] << 16) |
+                                         (encoded[4] << 24)));
+    size_t num_records = static_cast<size_t>(encoded[5] | (encoded[6] << 8) | (encoded[7] << 16));
+
+    std::vector<uintptr_t> events;
+    const uint8_t* ptr = encoded.data() + kHeaderSize;
+    uintptr_t prev_method_action_encoding = 0u;
+    while (ptr < end) {
+      prev_method_action_encoding += DecodeSignedLeb128<int64_t>(&ptr);
+      events.push_back(prev_method_action_encoding);
+    }
+    EXPECT_EQ(ptr, end);
+    EXPECT_EQ(num_records, events.size());
+    EXPECT_EQ(methods.size(), events.size());
+    return events;
+  }
+
+  std::string DumpPerfetto(uint32_t tid, const std::string& thread_name) {
+    std::unordered_map<ArtMethod*, uint64_t> method_iids;
+    std::vector<uint8_t> trace;
+    TraceProfiler::DumpBufferPerfetto(tid,
+                                      thread_name,
+                                      buffer_,
+                                      current_entry_,
+                                      /*counter_to_monotonic_ns=*/ 0u,
+                                      method_iids,
+                                      &trace);
+    return std::string(trace.begin(), trace.end());
+  }
+
+  uintptr_t* buffer_ = nullptr;
+  uintptr_t* current_entry_ = nullptr;
+};
+
+TEST_F(TraceProfileTest, DecodesEventsOldestFirst) {
+  EXPECT_TRUE(DecodeEvents().empty());
+
+  // Before the buffer wraps around, all events are decoded.
+  constexpr size_t kFewEvents = 10u;
+  for (size_t i = 1; i <= kFewEvents; ++i) {
+    RecordEvent(i << 2, i);
+  }
+  std::vector<uintptr_t> events = DecodeEvents();
+  ASSERT_EQ(events.size(), kFewEvents);
+  for (size_t i = 0; i != kFewEvents; ++i) {
+    EXPECT_EQ(events[i], (i + 1u) << 2) << i;
+  }
+
+  // Once it wrapped around, the oldest events are overwritten and the remaining ones are still
+  // decoded oldest first.
+  constexpr size_t kManyEvents = 2u * kMaxEvents + 5u;
+  for (size_t i = kFewEvents + 1u; i <= kManyEvents; ++i) {
+    RecordEvent(i << 2, i);
+  }
+  events = DecodeEvents();
+  ASSERT_EQ(events.size(), kMaxEvents);
+  for (size_t i = 0; i != kMaxEvents; ++i) {
+    EXPECT_EQ(events[i], (kManyEvents - kMaxEvents + 1u + i) << 2) << i;
+  }
+}
+
+TEST_F(TraceProfileTest, DumpsPerfettoTrace) {
+  ScopedObjectAccess soa(Thread::Current());
+  ObjPtr<mirror::Class> string_class = GetClassRoot<mirror::String>();
+  ArtMethod* length = string_class->FindClassMethod("length", "()I", kRuntimePointerSize);
+  ArtMethod* hash_code = string_class->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+  ASSERT_TRUE(length != nullptr);
+  ASSERT_TRUE(hash_code != nullptr);
+  InitializeTimestampCounters();
+
+  // Fill the buffer past the wrap around with calls of hashCode() from length(). The entry of
+  // the first call of length() is overwritten, so the oldest remaining event is the entry of
+  // hashCode() from that call.
+  constexpr uint64_t kTimestampsPerEvent = 1000u;
+  uint64_t timestamp = 0u;
+  size_t num_calls = kMaxEvents / 4u + 1u;
+  for (size_t i = 0; i != num_calls; ++i) {
+    RecordEvent(reinterpret_cast<uintptr_t>(length) | kTraceMethodEnter,
+                timestamp += kTimestampsPerEvent);
+    RecordEvent(reinterpret_cast<uintptr_t>(hash_code) | kTraceMethodEnter,
+                timestamp += kTimestampsPerEvent);
+    RecordEvent(kTraceMethodExit, timestamp += kTimestampsPerEvent);
+    RecordEvent(kTraceMethodExit, timestamp += kTimestampsPerEvent);
+  }
+  size_t num_dropped_events = num_calls * 4u - kMaxEvents;
+  ASSERT_EQ(kMaxEvents % 4u, 3u);
+  ASSERT_EQ(num_dropped_events, 1u);
+
+  std::string trace = DumpPerfetto(/*tid=*/ 1234u, "trace-profile-test");
+  std::vector<ProtoField> packets = GetFields(trace, /*TracePacket=*/ 1u);
+  ASSERT_EQ(packets.size(), 1u + kMaxEvents);
+
+  // The first packet describes the track of the thread.
+  std::string track_descriptor = GetField(packets[0].bytes, /*track_descriptor=*/ 60u).bytes;
+  uint64_t track_uuid = GetField(track_descriptor, /*uuid=*/ 1u).value;
+  std::string thread = GetField(track_descriptor, /*thread=*/ 4u).bytes;
+  EXPECT_EQ(GetField(thread, /*pid=*/ 1u).value, static_cast<uint64_t>(getpid()));
+  EXPECT_EQ(GetField(thread, /*tid=*/ 2u).value, 1234u);
+  EXPECT_EQ(GetField(thread, /*thread_name=*/ 5u).bytes, "trace-profile-test");
+
+  // The other packets are slice begin and end events, with the names of the methods interned
+  // the first time they are used.
+  std::map<uint64_t, std::string> event_names;
+  std::vector<std::string> slices;
+  uint64_t prev_timestamp = 0u;
+  for (size_t i = 1; i != packets.size(); ++i) {
+    const std::string& packet = packets[i].bytes;
+    uint64_t packet_timestamp = GetField(packet, /*timestamp=*/ 8u).value;
+    EXPECT_GT(packet_timestamp, prev_timestamp) << i;
+    prev_timestamp = packet_timestamp;
+    EXPECT_EQ(GetField(packet, /*timestamp_clock_id=*/ 58u).value, 3u);  // BUILTIN_CLOCK_MONOTONIC
+    for (const ProtoField& interned_data : GetFields(packet, /*interned_data=*/ 12u)) {
+      for (const ProtoField& event_name : GetFields(interned_data.bytes, /*event_names=*/ 2u)) {
+        uint64_t iid = GetField(event_name.bytes, /*iid=*/ 1u).value;
+        EXPECT_TRUE(event_names.find(iid) == event_names.end()) << iid;
+        event_names[iid] = GetField(event_name.bytes, /*name=*/ 2u).bytes;
+      }
+    }
+    std::string track_event = GetField(packet, /*track_event=*/ 11u).bytes;
+    EXPECT_EQ(GetField(track_event, /*track_uuid=*/ 11u).value, track_uuid);
+    uint64_t type = GetField(track_event, /*type=*/ 9u).value;
+    if (type == 1u) {  // TYPE_SLICE_BEGIN
+      uint64_t iid = GetField(track_event, /*name_iid=*/ 10u).value;
+      ASSERT_TRUE(event_names.find(iid) != event_names.end()) << iid;
+      slices.push_back("B " + event_names[iid]);
+    } else {
+      EXPECT_EQ(type, 2u);  // TYPE_SLICE_END
+      EXPECT_TRUE(GetFields(track_event, /*name_iid=*/ 10u).empty());
+      slices.push_back("E");
+    }
+  }
+  EXPECT_EQ(event_names.size(), 2u);
+
+  ASSERT_EQ(slices.size(), kMaxEvents);
+  std::vector<std::string> expected_slices = {"B int java.lang.String.hashCode()", "E", "E"};
+  for (size_t i = 1; i != num_calls; ++i) {
+    expected_slices.push_back("B int java.lang.String.length()");
+    expected_slices.push_back("B int java.lang.String.hashCode()");
+    expected_slices.push_back("E");
+    expected_slices.push_back("E");
+  }
+  EXPECT_EQ(slices, expected_slices);
+}
+
+}  // namespace art
@@ -35,6 +35,7 @@
 #include "base/utils.h"
 #include "class_linker.h"
 #include "class_root-inl.h"
+#include "compiler_callbacks.h"
 #include "dex/class_accessor-inl.h"
 #include "dex/descriptors_names.h"
 #include "dex/dex_file-inl.h"
@@ -60,6 +61,7 @@
 #include "runtime.h"
 #include "scoped_newline.h"
 #include "scoped_thread_state_change-inl.h"
+#include "shared_reg_type_cache.h"
 #include "stack.h"
 #include "vdex_file.h"
 #include "verifier/method_verifier.h"
@@ -174,6 +176,15 @@ class MethodVerifier final : public ::art::verifier::MethodVerifier {
        allow_thread_suspension_(allow_thread_suspension),
        is_constructor_(false),
        api_level_(api_level == 0 ? std::numeric_limits<uint32_t>::max() : api_level) {
+    if (aot_mode && can_load_classes) {
+      // Share type resolution with the other threads verifying this dex file, if the compiler
+      // set up a shared cache for it.
+      SharedRegTypeCache* shared_cache =
+          Runtime::Current()->GetCompilerCallbacks()->GetSharedRegTypeCache(dex_file);
+      if (shared_cache != nullptr && dex_cache->GetClassLoader() == class_loader.Get()) {
+        reg_types_.UseSharedCache(shared_cache, dex_cache, class_loader);
+      }
+    }
   }
 
   void UninstantiableError(const char* descriptor) {
@@ -3589,12 +3600,17 @@ template <bool kVerifierDebug>
 template <CheckAccess C>
 const RegType& MethodVerifier<kVerifierDebug>::ResolveClass(dex::TypeIndex class_idx) {
   ClassLinker* linker = GetClassLinker();
-  ObjPtr<mirror::Class> klass = CanLoadClasses()
-      ? linker->ResolveType(class_idx, dex_cache_, class_loader_)
-      : linker->LookupResolvedType(class_idx, dex_cache_.Get(), class_loader_.Get());
-  if (CanLoadClasses() && klass == nullptr) {
-    DCHECK(self_->IsExceptionPending());
-    self_->ClearException();
+  ObjPtr<mirror::Class> klass;
+  if (reg_types_.GetSharedCache() != nullptr) {
+    klass = reg_types_.ResolveSharedType(class_idx);
+  } else {
+    klass = CanLoadClasses()
+        ? linker->ResolveType(class_idx, dex_cache_, class_loader_)
+        : linker->LookupResolvedType(class_idx, dex_cache_.Get(), class_loader_.Get());
+    if (CanLoadClasses() && klass == nullptr) {
+      DCHECK(self_->IsExceptionPending());
+      self_->ClearException();
+    }
   }
   const RegType* result = nullptr;
   if (klass != nullptr) {
@@ -29,8 +29,10 @@
 #include "dex/descriptors_names.h"
 #include "dex/dex_file-inl.h"
 #include "mirror/class-inl.h"
+#include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
 #include "reg_type-inl.h"
+#include "shared_reg_type_cache.h"
 
 namespace art HIDDEN {
 namespace verifier {
@@ -162,6 +164,12 @@ ObjPtr<mirror::Class> RegTypeCache::ResolveClass(const char* descriptor,
   ObjPtr<mirror::Class> klass = nullptr;
   if (can_load_classes_) {
     klass = class_linker_->FindClass(self, descriptor, loader);
+    if (klass == nullptr) {
+      // We tried loading the class and failed, this might get an exception raised
+      // so we want to clear it before we go on.
+      DCHECK(self->IsExceptionPending());
+      self->ClearException();
+    }
   } else {
     klass = class_linker_->LookupClass(self, descriptor, loader.Get());
     if (klass != nullptr && !klass->IsResolved()) {
@@ -169,6 +177,39 @@ ObjPtr<mirror::Class> RegTypeCache::ResolveClass(const char* descriptor,
       klass = nullptr;
     }
   }
+  DCHECK(!self->IsExceptionPending());
+  return klass;
+}
+
+void RegTypeCache::UseSharedCache(SharedRegTypeCache* shared_cache,
+                                  Handle<mirror::DexCache> dex_cache,
+                                  Handle<mirror::ClassLoader> class_loader) {
+  DCHECK(can_load_classes_);
+  DCHECK_EQ(shared_cache->GetDexFile(), dex_cache->GetDexFile());
+  DCHECK(dex_cache->GetClassLoader() == class_loader.Get());
+  shared_cache_ = shared_cache;
+  shared_dex_cache_ = dex_cache;
+  shared_class_loader_ = class_loader;
+}
+
+ObjPtr<mirror::Class> RegTypeCache::ResolveSharedType(dex::TypeIndex type_idx) {
+  DCHECK(shared_cache_ != nullptr);
+  ObjPtr<mirror::Class> klass = shared_dex_cache_->GetResolvedType(type_idx);
+  if (klass != nullptr) {
+    return klass;
+  }
+  if (shared_cache_->IsUnresolved(type_idx)) {
+    shared_cache_->RecordUnresolvedHit();
+    return nullptr;
+  }
+  shared_cache_->RecordResolution();
+  klass = class_linker_->ResolveType(type_idx, shared_dex_cache_, shared_class_loader_);
+  if (klass == nullptr) {
+    Thread* self = Thread::Current();
+    DCHECK(self->IsExceptionPending());
+    self->ClearException();
+    shared_cache_->MarkUnresolved(type_idx);
+  }
   return klass;
 }
 
@@ -188,8 +229,14 @@ const RegType& RegTypeCache::From(Handle<mirror::ClassLoader> loader, const char
     }
   }
   // Class not found in the cache, will create a new type for that.
-  // Try resolving class.
-  ObjPtr<mirror::Class> klass = ResolveClass(descriptor, loader);
+  // Try resolving class, through the shared cache if the descriptor is in its dex file.
+  const dex::TypeId* type_id = nullptr;
+  if (shared_cache_ != nullptr && loader.Get() == shared_class_loader_.Get()) {
+    type_id = shared_cache_->GetDexFile()->FindTypeId(descriptor);
+  }
+  ObjPtr<mirror::Class> klass = (type_id != nullptr)
+      ? ResolveSharedType(shared_cache_->GetDexFile()->GetIndexForTypeId(*type_id))
+      : ResolveClass(descriptor, loader);
   if (klass != nullptr) {
     // Create a precise type if the class cannot be assigned from other types
     // (final classes, arrays of final classes and primitive arrays, see
@@ -211,14 +258,6 @@ const RegType& RegTypeCache::From(Handle<mirror::ClassLoader> loader, const char
     }
     return AddEntry(entry);
   } else {  // Class not resolved.
-    // We tried loading the class and failed, this might get an exception raised
-    // so we want to clear it before we go on.
-    if (can_load_classes_) {
-      DCHECK(Thread::Current()->IsExceptionPending());
-      Thread::Current()->ClearException();
-    } else {
-      DCHECK(!Thread::Current()->IsExceptionPending());
-    }
     if (IsValidDescriptor(descriptor)) {
       return AddEntry(new (&allocator_) UnresolvedReferenceType(null_handle_,
                                                                 AddString(sv_descriptor),
@@ -291,7 +330,8 @@ RegTypeCache::RegTypeCache(Thread* self,
       allocator_(allocator),
       handles_(self),
       class_linker_(class_linker),
-      can_load_classes_(can_load_classes) {
+      can_load_classes_(can_load_classes),
+      shared_cache_(nullptr) {
   DCHECK(can_suspend || !can_load_classes) << "Cannot load classes if suspension is disabled!";
   if (kIsDebugBuild && can_suspend) {
     Thread::Current()->AssertThreadSuspensionIsAllowable(gAborting == 0);
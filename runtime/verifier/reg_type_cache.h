@@ -24,6 +24,7 @@
 #include "base/casts.h"
 #include "base/macros.h"
 #include "base/scoped_arena_containers.h"
+#include "dex/dex_file_types.h"
 #include "dex/primitive.h"
 #include "gc_root.h"
 #include "handle_scope.h"
@@ -33,6 +34,7 @@ namespace art HIDDEN {
 namespace mirror {
 class Class;
 class ClassLoader;
+class DexCache;
 }  // namespace mirror
 
 class ClassLinker;
@@ -57,6 +59,7 @@ class NullType;
 class PreciseConstType;
 class PreciseReferenceType;
 class RegType;
+class SharedRegTypeCache;
 class ShortType;
 class UndefinedType;
 class UninitializedType;
@@ -72,6 +75,19 @@ class RegTypeCache {
                ScopedArenaAllocator& allocator,
                bool can_suspend = true);
   const art::verifier::RegType& GetFromId(uint16_t id) const;
+  // Share type resolution results with other verifiers of the dex file of `dex_cache`. Requires
+  // that classes can be loaded.
+  void UseSharedCache(SharedRegTypeCache* shared_cache,
+                      Handle<mirror::DexCache> dex_cache,
+                      Handle<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  SharedRegTypeCache* GetSharedCache() const {
+    return shared_cache_;
+  }
+  // Resolve a type of the dex file of the shared cache, returns null with no pending exception
+  // if the type cannot be resolved.
+  ObjPtr<mirror::Class> ResolveSharedType(dex::TypeIndex type_idx)
+      REQUIRES_SHARED(Locks::mutator_lock_);
   // Find a RegType, returns null if not found.
   const RegType* FindClass(ObjPtr<mirror::Class> klass, bool precise) const
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -213,6 +229,11 @@ class RegTypeCache {
   // Whether or not we're allowed to load classes.
   const bool can_load_classes_;
 
+  // Resolution results shared with other verifiers of the same dex file, if any.
+  SharedRegTypeCache* shared_cache_;
+  Handle<mirror::DexCache> shared_dex_cache_;
+  Handle<mirror::ClassLoader> shared_class_loader_;
+
   DISALLOW_COPY_AND_ASSIGN(RegTypeCache);
 };
 
@@ -23,9 +23,11 @@
 #include "base/scoped_arena_allocator.h"
 #include "common_runtime_test.h"
 #include "compiler_callbacks.h"
+#include "mirror/dex_cache.h"
 #include "reg_type-inl.h"
 #include "reg_type_cache-inl.h"
 #include "scoped_thread_state_change-inl.h"
+#include "shared_reg_type_cache.h"
 #include "thread-current-inl.h"
 
 namespace art HIDDEN {
@@ -1094,6 +1096,50 @@ TEST_F(RegTypeTest, ConstPrecision) {
   EXPECT_FALSE(imprecise_const.Equals(precise_const));
 }
 
+TEST_F(RegTypeReferenceTest, SharedCache) {
+  // Tests that caches sharing type resolution results agree with each other and that types
+  // known to fail resolution are not resolved again.
+  ArenaStack stack(Runtime::Current()->GetArenaPool());
+  ScopedArenaAllocator allocator(&stack);
+  ScopedObjectAccess soa(Thread::Current());
+  jobject jclass_loader = LoadDex("Interfaces");
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::ClassLoader> loader(hs.NewHandle(soa.Decode<mirror::ClassLoader>(jclass_loader)));
+  std::vector<const DexFile*> dex_files = GetDexFiles(jclass_loader);
+  ASSERT_EQ(1u, dex_files.size());
+  const DexFile* dex_file = dex_files[0];
+  Handle<mirror::DexCache> dex_cache =
+      hs.NewHandle(class_linker_->RegisterDexFile(*dex_file, loader.Get()));
+  ASSERT_TRUE(dex_cache != nullptr);
+
+  SharedRegTypeCache shared_cache(dex_file);
+  RegTypeCache cache1(soa.Self(), class_linker_, /* can_load_classes= */ true, allocator);
+  RegTypeCache cache2(soa.Self(), class_linker_, /* can_load_classes= */ true, allocator);
+  cache1.UseSharedCache(&shared_cache, dex_cache, loader);
+  cache2.UseSharedCache(&shared_cache, dex_cache, loader);
+
+  // A type that another verifier failed to resolve is not looked up again.
+  const dex::TypeId* type_id = dex_file->FindTypeId("LInterfaces$A;");
+  ASSERT_TRUE(type_id != nullptr);
+  shared_cache.MarkUnresolved(dex_file->GetIndexForTypeId(*type_id));
+  const RegType& unresolved = cache1.FromDescriptor(loader, "LInterfaces$A;");
+  EXPECT_TRUE(unresolved.IsUnresolvedReference());
+  EXPECT_TRUE(class_linker_->LookupClass(soa.Self(), "LInterfaces$A;", loader.Get()) == nullptr);
+  EXPECT_EQ(1u, shared_cache.GetNumberOfUnresolvedHits());
+  EXPECT_EQ(0u, shared_cache.GetNumberOfResolutions());
+
+  // A type resolved by one verifier is found by the other in the dex cache.
+  const RegType& resolved_2 = cache2.FromDescriptor(loader, "LInterfaces$B;");
+  const RegType& resolved_1 = cache1.FromDescriptor(loader, "LInterfaces$B;");
+  ASSERT_TRUE(resolved_2.HasClass());
+  ASSERT_TRUE(resolved_1.HasClass());
+  EXPECT_TRUE(resolved_1.GetClass() == resolved_2.GetClass());
+  // Only the failed resolution avoided above counts as a hit, not the dex cache lookup.
+  EXPECT_EQ(1u, shared_cache.GetNumberOfUnresolvedHits());
+  EXPECT_EQ(1u, shared_cache.GetNumberOfResolutions());
+  EXPECT_EQ(1u, shared_cache.GetNumberOfUnresolvedTypes());
+}
+
 class RegTypeOOMTest : public RegTypeTest {
  protected:
   void SetUpRuntimeOptions(RuntimeOptions *options) override {
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shared_reg_type_cache.h"
+
+#include <ostream>
+
+#include "dex/dex_file.h"
+
+namespace art HIDDEN {
+namespace verifier {
+
+SharedRegTypeCache::SharedRegTypeCache(const DexFile* dex_file)
+    : dex_file_(dex_file),
+      unresolved_(dex_file->NumTypeIds()),
+      number_of_unresolved_hits_(0u),
+      number_of_resolutions_(0u) {}
+
+size_t SharedRegTypeCache::GetNumberOfUnresolvedTypes() const {
+  size_t count = 0u;
+  for (const std::atomic<bool>& unresolved : unresolved_) {
+    if (unresolved.load(std::memory_order_relaxed)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void SharedRegTypeCache::Dump(std::ostream& os) const {
+  os << "shared reg type cache: " << GetNumberOfResolutions() << " resolutions, "
+     << GetNumberOfUnresolvedTypes() << " unresolved types, "
+     << GetNumberOfUnresolvedHits() << " failed resolutions avoided";
+}
+
+}  // namespace verifier
+}  // namespace art
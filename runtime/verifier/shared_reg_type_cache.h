@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_VERIFIER_SHARED_REG_TYPE_CACHE_H_
+#define ART_RUNTIME_VERIFIER_SHARED_REG_TYPE_CACHE_H_
+
+#include <atomic>
+#include <iosfwd>
+#include <vector>
+
+#include <android-base/logging.h>
+
+#include "base/macros.h"
+#include "dex/dex_file_types.h"
+
+namespace art HIDDEN {
+
+class DexFile;
+
+namespace verifier {
+
+// Type resolution results shared by the `RegTypeCache`s of all threads verifying the same dex
+// file during AOT compilation.
+//
+// Reg types themselves are per-method: their ids index the entries of one `RegTypeCache` and
+// they live in the arena of one verifier. What every verifier repeats is the class resolution
+// behind them. Resolved types are already shared through the dex cache, so this only records the
+// types that failed to resolve; without it, each method referencing such a type walks the class
+// loader chain and throws again. A type that failed to resolve while classes can be loaded cannot
+// resolve later in the same compilation, so the entries never need to be invalidated.
+class SharedRegTypeCache {
+ public:
+  explicit SharedRegTypeCache(const DexFile* dex_file);
+
+  const DexFile* GetDexFile() const {
+    return dex_file_;
+  }
+
+  // Returns whether an earlier attempt to resolve `type_idx` failed.
+  bool IsUnresolved(dex::TypeIndex type_idx) const {
+    DCHECK_LT(type_idx.index_, unresolved_.size());
+    return unresolved_[type_idx.index_].load(std::memory_order_relaxed);
+  }
+
+  void MarkUnresolved(dex::TypeIndex type_idx) {
+    DCHECK_LT(type_idx.index_, unresolved_.size());
+    unresolved_[type_idx.index_].store(true, std::memory_order_relaxed);
+  }
+
+  // Counts lookups answered from the unresolved types, i.e. the failed resolutions this cache
+  // saved. Types found in the dex cache are not counted, they are found there without it.
+  void RecordUnresolvedHit() {
+    number_of_unresolved_hits_.fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  // Counts lookups that had to go to the class linker.
+  void RecordResolution() {
+    number_of_resolutions_.fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  size_t GetNumberOfUnresolvedHits() const {
+    return number_of_unresolved_hits_.load(std::memory_order_relaxed);
+  }
+
+  size_t GetNumberOfResolutions() const {
+    return number_of_resolutions_.load(std::memory_order_relaxed);
+  }
+
+  size_t GetNumberOfUnresolvedTypes() const;
+
+  void Dump(std::ostream& os) const;
+
+ private:
+  const DexFile* const dex_file_;
+  std::vector<std::atomic<bool>> unresolved_;
+  std::atomic<size_t> number_of_unresolved_hits_;
+  std::atomic<size_t> number_of_resolutions_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedRegTypeCache);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_SHARED_REG_TYPE_CACHE_H_
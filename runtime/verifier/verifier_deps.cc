@@ -16,7 +16,9 @@
 
 #include "verifier_deps.h"
 
+#include <algorithm>
 #include <cstring>
+#include <numeric>
 #include <sstream>
 
 #include "art_field-inl.h"
@@ -76,6 +78,45 @@ void VerifierDeps::MergeWith(std::unique_ptr<VerifierDeps> other,
   }
 }
 
+void VerifierDeps::SortExtraStrings(const std::vector<const DexFile*>& dex_files) {
+  WriterMutexLock mu(Thread::Current(), *Locks::verifier_deps_lock_);
+  for (const DexFile* dex_file : dex_files) {
+    DexFileDeps* deps = GetDexFileDeps(*dex_file);
+    DCHECK(deps != nullptr);
+    size_t num_extra_strings = deps->strings_.size();
+    if (num_extra_strings == 0u) {
+      continue;
+    }
+    std::vector<uint32_t> order(num_extra_strings);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [deps](uint32_t lhs, uint32_t rhs) {
+      return deps->strings_[lhs] < deps->strings_[rhs];
+    });
+    std::vector<uint32_t> new_ids(num_extra_strings);
+    std::vector<std::string> sorted_strings;
+    sorted_strings.reserve(num_extra_strings);
+    for (uint32_t new_id = 0; new_id != num_extra_strings; ++new_id) {
+      new_ids[order[new_id]] = new_id;
+      sorted_strings.push_back(std::move(deps->strings_[order[new_id]]));
+    }
+    deps->strings_ = std::move(sorted_strings);
+
+    uint32_t num_ids_in_dex = dex_file->NumStringIds();
+    auto remap = [&](dex::StringIndex string_idx) {
+      return string_idx.index_ < num_ids_in_dex
+          ? string_idx
+          : dex::StringIndex(num_ids_in_dex + new_ids[string_idx.index_ - num_ids_in_dex]);
+    };
+    for (std::set<TypeAssignability>& assignable_types : deps->assignable_types_) {
+      std::set<TypeAssignability> remapped_types;
+      for (const TypeAssignability& entry : assignable_types) {
+        remapped_types.emplace(remap(entry.GetDestination()), remap(entry.GetSource()));
+      }
+      assignable_types.swap(remapped_types);
+    }
+  }
+}
+
 VerifierDeps::DexFileDeps* VerifierDeps::GetDexFileDeps(const DexFile& dex_file) {
   auto it = dex_deps_.find(&dex_file);
   return (it == dex_deps_.end()) ? nullptr : it->second.get();
@@ -77,6 +77,12 @@ class VerifierDeps {
   EXPORT void MergeWith(std::unique_ptr<VerifierDeps> other,
                         const std::vector<const DexFile*>& dex_files);
 
+  // Renumber the strings which are not in the dex files so that their ids follow the
+  // lexicographic order of the strings rather than the order in which verifier threads
+  // first encountered them. This makes the encoded data independent of thread scheduling.
+  EXPORT void SortExtraStrings(const std::vector<const DexFile*>& dex_files)
+      REQUIRES(!Locks::verifier_deps_lock_);
+
   // Record information that a class was verified.
   // Note that this function is different from MaybeRecordVerificationStatus() which
   // looks up thread-local VerifierDeps first.
@@ -255,6 +261,7 @@ class VerifierDeps {
 
   friend class VerifierDepsTest;
   ART_FRIEND_TEST(VerifierDepsTest, StringToId);
+  ART_FRIEND_TEST(VerifierDepsTest, SortExtraStrings);
   ART_FRIEND_TEST(VerifierDepsTest, EncodeDecode);
   ART_FRIEND_TEST(VerifierDepsTest, EncodeDecodeMulti);
   ART_FRIEND_TEST(VerifierDepsTest, VerifyDeps);
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "wall_clock_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+
+#include "art_method-inl.h"
+#include "barrier.h"
+#include "base/mutex-inl.h"
+#include "base/os.h"
+#include "base/pprof_builder.h"
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "closure.h"
+#include "linear_alloc.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "stack.h"
+#include "thread-current-inl.h"
+#include "thread_list.h"
+
+namespace art HIDDEN {
+
+std::atomic<bool> WallClockProfiler::running_(false);
+Mutex WallClockProfiler::lock_("wall clock profiler lock", kGenericBottomLock);
+ConditionVariable WallClockProfiler::stop_cond_("wall clock profiler stop condition",
+                                                WallClockProfiler::lock_);
+bool WallClockProfiler::stop_requested_ = false;
+pthread_t WallClockProfiler::sampling_pthread_ = 0U;
+uint32_t WallClockProfiler::interval_us_ = WallClockProfiler::kDefaultIntervalUs;
+uint64_t WallClockProfiler::start_time_ns_ = 0u;
+uint64_t WallClockProfiler::sampled_time_ns_ = 0u;
+std::vector<WallClockProfiler::CallTreeNode> WallClockProfiler::nodes_;
+std::map<WallClockProfiler::NodeKey, uint32_t> WallClockProfiler::children_;
+std::map<WallClockProfiler::SampleKey, uint64_t> WallClockProfiler::samples_;
+std::string WallClockProfiler::output_file_;
+
+bool WallClockProfiler::Start(uint32_t interval_us) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (running_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  interval_us_ = std::max(interval_us, 1u);
+  stop_requested_ = false;
+  start_time_ns_ = NanoTime();
+  running_.store(true, std::memory_order_relaxed);
+  CHECK_PTHREAD_CALL(pthread_create,
+                     (&sampling_pthread_, nullptr, &RunSamplingThread, nullptr),
+                     "Wall clock profiler thread");
+  return true;
+}
+
+void WallClockProfiler::Stop() {
+  Thread* self = Thread::Current();
+  pthread_t sampling_pthread;
+  {
+    MutexLock mu(self, lock_);
+    if (!running_.load(std::memory_order_relaxed) || stop_requested_) {
+      return;
+    }
+    stop_requested_ = true;
+    stop_cond_.Signal(self);
+    sampling_pthread = sampling_pthread_;
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, nullptr), "wall clock profiler shutdown");
+  MutexLock mu(self, lock_);
+  sampled_time_ns_ += NanoTime() - start_time_ns_;
+  sampling_pthread_ = 0U;
+  running_.store(false, std::memory_order_relaxed);
+}
+
+void* WallClockProfiler::RunSamplingThread([[maybe_unused]] void* arg) {
+  Runtime* runtime = Runtime::Current();
+  CHECK(runtime->AttachCurrentThread("Wall Clock Profiler",
+                                     /* as_daemon= */ true,
+                                     runtime->GetSystemThreadGroup(),
+                                     /* create_peer= */ !runtime->IsAotCompiler()));
+  Thread* self = Thread::Current();
+  while (true) {
+    {
+      MutexLock mu(self, lock_);
+      if (!stop_requested_) {
+        stop_cond_.TimedWait(self, interval_us_ / 1000u, (interval_us_ % 1000u) * 1000u);
+      }
+      if (stop_requested_) {
+        break;
+      }
+    }
+    ScopedTrace trace("Wall clock profile sampling");
+    SampleAllThreads(self);
+  }
+  runtime->DetachCurrentThread();
+  return nullptr;
+}
+
+class SampleStackClosure final : public Closure {
+ public:
+  SampleStackClosure(Thread* sampling_thread, Barrier* barrier)
+      : sampling_thread_(sampling_thread), barrier_(barrier) {}
+
+  void Run(Thread* thread) override REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (thread != sampling_thread_) {
+      std::vector<ArtMethod*> frames;
+      StackVisitor::WalkStack(
+          [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+            ArtMethod* m = stack_visitor->GetMethod();
+            // Ignore runtime frames (in particular callee save).
+            if (m != nullptr && !m->IsRuntimeMethod()) {
+              frames.push_back(m->GetInterfaceMethodIfProxy(kRuntimePointerSize));
+            }
+            return frames.size() != WallClockProfiler::kMaxStackDepth;
+          },
+          thread,
+          /* context= */ nullptr,
+          art::StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+      // Threads without Java frames, e.g. the signal catcher, are not interesting.
+      if (!frames.empty()) {
+        // A runnable thread runs the checkpoint itself, anything else was suspended.
+        WallClockProfiler::AddSample(frames, thread->GetState());
+      }
+    }
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Thread* const sampling_thread_;
+  Barrier* const barrier_;
+};
+
+void WallClockProfiler::SampleAllThreads(Thread* self) {
+  Barrier barrier(0);
+  SampleStackClosure closure(self, &barrier);
+  size_t threads_running_checkpoint =
+      Runtime::Current()->GetThreadList()->RunCheckpoint(&closure,
+                                                         /* callback= */ nullptr,
+                                                         /* allow_lock_checking= */ true,
+                                                         /* acquire_mutator_lock= */ true);
+  if (threads_running_checkpoint != 0) {
+    ScopedThreadStateChange tsc(self, ThreadState::kWaitingForCheckPointsToRun);
+    barrier.Increment(self, threads_running_checkpoint);
+  }
+}
+
+uint32_t WallClockProfiler::FindOrAddNode(uint32_t parent, ArtMethod* method) {
+  NodeKey key(parent, method);
+  auto it = children_.find(key);
+  if (it != children_.end()) {
+    return it->second;
+  }
+  if (nodes_.size() >= kMaxCallTreeNodes) {
+    return kOverflowNode;
+  }
+  const char* file_name = method->GetDeclaringClassSourceFile();
+  uint32_t node = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back({parent, method->PrettyMethod(), file_name != nullptr ? file_name : ""});
+  children_.emplace(key, node);
+  return node;
+}
+
+void WallClockProfiler::AddSample(const std::vector<ArtMethod*>& frames, ThreadState state) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (nodes_.empty()) {
+    nodes_.push_back({/* parent= */ kRootNode, "", ""});
+    nodes_.push_back({/* parent= */ kRootNode, "<other stacks>", ""});
+  }
+  uint32_t node = kRootNode;
+  for (auto it = frames.rbegin(); it != frames.rend() && node != kOverflowNode; ++it) {
+    node = FindOrAddNode(node, *it);
+  }
+  ++samples_[SampleKey(node, state)];
+}
+
+void WallClockProfiler::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  struct MethodSamples {
+    uint64_t samples = 0u;
+    uint64_t runnable_samples = 0u;
+  };
+  std::map<std::string, MethodSamples> methods;
+  MethodSamples all;
+  for (const auto& [key, count] : samples_) {
+    MethodSamples& method = methods[nodes_[key.first].method_name];
+    for (MethodSamples* sum : {&method, &all}) {
+      sum->samples += count;
+      if (key.second == ThreadState::kRunnable) {
+        sum->runnable_samples += count;
+      }
+    }
+  }
+  std::vector<std::pair<std::string_view, MethodSamples>> sorted_methods(methods.begin(),
+                                                                         methods.end());
+  std::sort(sorted_methods.begin(),
+            sorted_methods.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.second.samples > rhs.second.samples;
+            });
+
+  uint64_t duration_ns = sampled_time_ns_;
+  if (running_.load(std::memory_order_relaxed)) {
+    duration_ns += NanoTime() - start_time_ns_;
+  }
+  os << "Wall clock profile: " << all.samples << " samples (" << all.runnable_samples
+     << " runnable) over " << PrettyDuration(duration_ns) << " every "
+     << PrettyDuration(UsToNs(interval_us_)) << "\n";
+  size_t num_dumped = std::min(sorted_methods.size(), kMaxDumpedMethods);
+  for (size_t i = 0; i != num_dumped; ++i) {
+    const auto& [method_name, method] = sorted_methods[i];
+    os << "  " << method_name << ": samples=" << method.samples << " ("
+       << (method.samples * 100u / all.samples) << "%) runnable=" << method.runnable_samples
+       << "\n";
+  }
+  if (num_dumped != sorted_methods.size()) {
+    os << "  ... " << (sorted_methods.size() - num_dumped) << " more methods\n";
+  }
+}
+
+std::string WallClockProfiler::DumpPprof() {
+  MutexLock mu(Thread::Current(), lock_);
+  uint64_t duration_ns = sampled_time_ns_;
+  if (running_.load(std::memory_order_relaxed)) {
+    duration_ns += NanoTime() - start_time_ns_;
+  }
+  int64_t interval_ns = static_cast<int64_t>(UsToNs(interval_us_));
+  int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+
+  PprofBuilder builder;
+  builder.AddSampleType("samples", "count");
+  builder.AddSampleType("wall", "nanoseconds");
+  builder.SetPeriod("wall", "nanoseconds", interval_ns);
+  builder.SetTimeNanos(now_ns - static_cast<int64_t>(duration_ns));
+  builder.SetDurationNanos(static_cast<int64_t>(duration_ns));
+
+  std::vector<uint64_t> location_ids(nodes_.size(), 0u);
+  std::vector<uint64_t> stack;
+  for (const auto& [key, count] : samples_) {
+    // Walking up the call tree from the sampled node gives the innermost frame first.
+    stack.clear();
+    for (uint32_t node = key.first; node != kRootNode; node = nodes_[node].parent) {
+      if (location_ids[node] == 0u) {
+        const CallTreeNode& tree_node = nodes_[node];
+        location_ids[node] =
+            builder.AddLocation(tree_node.method_name, tree_node.file_name, /* line= */ -1);
+      }
+      stack.push_back(location_ids[node]);
+    }
+    std::ostringstream state;
+    state << key.second;
+    builder.AddSample(stack,
+                      {static_cast<int64_t>(count), static_cast<int64_t>(count) * interval_ns},
+                      {{"thread state", state.str()}});
+  }
+  return builder.Build();
+}
+
+std::string WallClockProfiler::DumpCollapsed() {
+  MutexLock mu(Thread::Current(), lock_);
+  // Merge the samples of all thread states.
+  std::map<uint32_t, uint64_t> node_samples;
+  for (const auto& [key, count] : samples_) {
+    node_samples[key.first] += count;
+  }
+  std::ostringstream os;
+  std::vector<uint32_t> path;
+  for (const auto& [leaf, count] : node_samples) {
+    path.clear();
+    for (uint32_t node = leaf; node != kRootNode; node = nodes_[node].parent) {
+      path.push_back(node);
+    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      if (it != path.rbegin()) {
+        os << ';';
+      }
+      os << nodes_[*it].method_name;
+    }
+    os << ' ' << count << '\n';
+  }
+  return os.str();
+}
+
+bool WallClockProfiler::WriteToFile(const std::string& filename,
+                                    const std::string& data,
+                                    std::string* error_msg) {
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(filename.c_str()));
+  if (file == nullptr) {
+    *error_msg = "Could not create " + filename + ": " + strerror(errno);
+    return false;
+  }
+  if (!file->WriteFully(data.data(), data.size()) || file->FlushCloseOrErase() != 0) {
+    *error_msg = "Could not write " + filename + ": " + strerror(errno);
+    file->Erase();
+    return false;
+  }
+  return true;
+}
+
+void WallClockProfiler::SetOutputFile(const std::string& filename) {
+  MutexLock mu(Thread::Current(), lock_);
+  output_file_ = filename;
+}
+
+void WallClockProfiler::DumpForSigQuit(std::ostream& os) {
+  if (!IsRunning()) {
+    return;
+  }
+  Dump(os);
+  WriteOutputFiles(os);
+  os << "\n";
+}
+
+void WallClockProfiler::WriteOutputFiles(std::ostream& os) {
+  std::string output_file;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    output_file = output_file_;
+  }
+  if (!output_file.empty()) {
+    std::string collapsed_file = output_file + ".collapsed";
+    std::string error_msg;
+    if (WriteToFile(output_file, DumpPprof(), &error_msg) &&
+        WriteToFile(collapsed_file, DumpCollapsed(), &error_msg)) {
+      os << "Wall clock profile written to " << output_file << " and " << collapsed_file << "\n";
+    } else {
+      os << error_msg << "\n";
+    }
+  }
+}
+
+void WallClockProfiler::Reset() {
+  MutexLock mu(Thread::Current(), lock_);
+  nodes_.clear();
+  children_.clear();
+  samples_.clear();
+  sampled_time_ns_ = 0u;
+  if (running_.load(std::memory_order_relaxed)) {
+    start_time_ns_ = NanoTime();
+  }
+}
+
+void WallClockProfiler::RemoveMethodsIn(Thread* self, const LinearAlloc& alloc) {
+  MutexLock mu(self, lock_);
+  for (auto it = children_.begin(); it != children_.end();) {
+    if (alloc.ContainsUnsafe(it->first.second)) {
+      it = children_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_WALL_CLOCK_PROFILER_H_
+#define ART_RUNTIME_WALL_CLOCK_PROFILER_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "thread_state.h"
+
+namespace art HIDDEN {
+
+class ArtMethod;
+class LinearAlloc;
+class Thread;
+
+// Samples the Java stacks of all threads at a fixed wall-clock interval and aggregates them into
+// an in-memory call tree.
+//
+// Unlike the `kSampling` mode of `Trace`, which suspends all threads for every sample and writes
+// the method trace format, each sample is taken with a checkpoint: runnable threads walk their
+// own stack at their next suspend point and the stacks of suspended threads are walked by the
+// sampling thread, so there is no global pause. Threads are sampled whatever their state, and
+// each sample carries the thread state, so time spent waiting shows up next to time spent
+// running. The call tree can be exported in the pprof format or as collapsed stacks, one line
+// per stack with the frames separated by ';' followed by the number of samples.
+class WallClockProfiler {
+ public:
+  static constexpr uint32_t kDefaultIntervalUs = 10000;
+
+  // Frames recorded per sample. Deeper stacks are truncated at the outermost frames.
+  static constexpr size_t kMaxStackDepth = 64;
+
+  // Maximum number of methods printed by `Dump`, sorted by the number of samples they were on
+  // top of the stack.
+  static constexpr size_t kMaxDumpedMethods = 20;
+
+  // Maximum number of call tree nodes. Samples whose stack needs more are recorded at an
+  // "<other stacks>" node, so the memory used stays bounded.
+  static constexpr size_t kMaxCallTreeNodes = 64 * 1024;
+
+  // Starts the sampling thread. Returns false if the profiler is already running.
+  static bool Start(uint32_t interval_us) REQUIRES(!lock_);
+
+  // Stops and joins the sampling thread. The collected samples are kept until `Reset`.
+  static void Stop() REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  static bool IsRunning() { return running_.load(std::memory_order_relaxed); }
+
+  // Records one sample of a stack. `frames` start with the innermost frame.
+  static void AddSample(const std::vector<ArtMethod*>& frames, ThreadState state)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  // Prints a summary of the methods with the most samples on top of the stack.
+  static void Dump(std::ostream& os) REQUIRES(!lock_);
+
+  // Same as `Dump`, but only if the profiler is running. Also writes the pprof and collapsed
+  // stack outputs if an output file was given with `-Xwallclockprofile-output`.
+  static void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+  // Writes the pprof and collapsed stack outputs if an output file was given with
+  // `-Xwallclockprofile-output` and reports the result to `os`.
+  static void WriteOutputFiles(std::ostream& os) REQUIRES(!lock_);
+
+  // Returns the call tree as a serialized pprof profile. Each sample carries the state of the
+  // sampled thread as the "thread state" label.
+  static std::string DumpPprof() REQUIRES(!lock_);
+
+  // Returns the call tree as collapsed stacks, starting with the outermost frame.
+  static std::string DumpCollapsed() REQUIRES(!lock_);
+
+  static void SetOutputFile(const std::string& filename) REQUIRES(!lock_);
+
+  // Drops all samples.
+  static void Reset() REQUIRES(!lock_);
+
+  // Forgets the methods allocated in `alloc`, which is about to be freed with its class loader.
+  // Their nodes keep the names resolved when they were added, and a method allocated later at
+  // the same address gets new nodes.
+  static void RemoveMethodsIn(Thread* self, const LinearAlloc& alloc) REQUIRES(!lock_);
+
+ private:
+  struct CallTreeNode {
+    uint32_t parent;
+    std::string method_name;
+    std::string file_name;
+  };
+
+  // The root of the call tree, and the node of the samples that do not fit in the tree.
+  static constexpr uint32_t kRootNode = 0u;
+  static constexpr uint32_t kOverflowNode = 1u;
+
+  // Key of a call tree node: the parent node and the method. Methods are removed from the keys
+  // when their class loader is unloaded, see `RemoveMethodsIn`.
+  using NodeKey = std::pair<uint32_t, ArtMethod*>;
+  // Key of the sample counts: the node of the innermost frame and the thread state.
+  using SampleKey = std::pair<uint32_t, ThreadState>;
+
+  static void* RunSamplingThread(void* arg) REQUIRES(!lock_);
+
+  // Samples all threads but the sampling thread and waits for the samples to be recorded.
+  static void SampleAllThreads(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  static uint32_t FindOrAddNode(uint32_t parent, ArtMethod* method)
+      REQUIRES(lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static bool WriteToFile(const std::string& filename,
+                          const std::string& data,
+                          std::string* error_msg);
+
+  static std::atomic<bool> running_;
+  static Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+  static ConditionVariable stop_cond_;
+  static bool stop_requested_ GUARDED_BY(lock_);
+  static pthread_t sampling_pthread_ GUARDED_BY(lock_);
+  static uint32_t interval_us_ GUARDED_BY(lock_);
+  static uint64_t start_time_ns_ GUARDED_BY(lock_);
+  static uint64_t sampled_time_ns_ GUARDED_BY(lock_);
+  // Call tree of the sampled stacks, starting with `kRootNode` and `kOverflowNode`. The children
+  // of the root are the outermost frames. Method names are resolved when a node is added, so the
+  // tree stays printable after the classes of its methods are unloaded.
+  static std::vector<CallTreeNode> nodes_ GUARDED_BY(lock_);
+  static std::map<NodeKey, uint32_t> children_ GUARDED_BY(lock_);
+  static std::map<SampleKey, uint64_t> samples_ GUARDED_BY(lock_);
+  static std::string output_file_ GUARDED_BY(lock_);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(WallClockProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_WALL_CLOCK_PROFILER_H_
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "wall_clock_profiler.h"
+
+#include <sstream>
+
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "mirror/class-inl.h"
+#include "nativehelper/scoped_local_ref.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+
+namespace art HIDDEN {
+
+class WallClockProfilerTest : public CommonRuntimeTest {};
+
+TEST_F(WallClockProfilerTest, AggregatesCallTree) {
+  Thread* self = Thread::Current();
+  WallClockProfiler::Reset();
+  {
+    ScopedObjectAccess soa(self);
+    ObjPtr<mirror::Class> string_class = GetClassRoot<mirror::String>();
+    ArtMethod* length = string_class->FindClassMethod("length", "()I", kRuntimePointerSize);
+    ArtMethod* hash_code = string_class->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+    ASSERT_TRUE(length != nullptr);
+    ASSERT_TRUE(hash_code != nullptr);
+    WallClockProfiler::AddSample({length, hash_code}, ThreadState::kRunnable);
+    WallClockProfiler::AddSample({length, hash_code}, ThreadState::kRunnable);
+    WallClockProfiler::AddSample({hash_code}, ThreadState::kWaiting);
+  }
+  std::ostringstream oss;
+  WallClockProfiler::Dump(oss);
+  std::string collapsed = WallClockProfiler::DumpCollapsed();
+  std::string pprof = WallClockProfiler::DumpPprof();
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("3 samples (2 runnable)")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("int java.lang.String.length(): samples=2 (66%)"))
+      << dump;
+  // Collapsed stacks start with the outermost frame.
+  EXPECT_NE(std::string::npos,
+            collapsed.find("int java.lang.String.hashCode();int java.lang.String.length() 2\n"))
+      << collapsed;
+  EXPECT_NE(std::string::npos, collapsed.find("int java.lang.String.hashCode() 1\n"))
+      << collapsed;
+  EXPECT_NE(std::string::npos, pprof.find("thread state"));
+  EXPECT_NE(std::string::npos, pprof.find("int java.lang.String.length()"));
+  WallClockProfiler::Reset();
+}
+
+// Samples this thread with the sampling thread while it sleeps in Java. The checkpoint of a
+// suspended thread is run by the sampling thread on its behalf.
+TEST_F(WallClockProfilerTest, SamplesLiveThread) {
+  Thread* self = Thread::Current();
+  JNIEnv* env = self->GetJniEnv();
+  ScopedLocalRef<jclass> thread_class(env, env->FindClass("java/lang/Thread"));
+  ASSERT_TRUE(thread_class != nullptr);
+  jmethodID sleep = env->GetStaticMethodID(thread_class.get(), "sleep", "(J)V");
+  ASSERT_TRUE(sleep != nullptr);
+
+  WallClockProfiler::Reset();
+  ASSERT_TRUE(WallClockProfiler::Start(/* interval_us= */ 1000u));
+  EXPECT_FALSE(WallClockProfiler::Start(/* interval_us= */ 1000u));
+  env->CallStaticVoidMethod(thread_class.get(), sleep, static_cast<jlong>(200));
+  ASSERT_FALSE(env->ExceptionCheck());
+  WallClockProfiler::Stop();
+  EXPECT_FALSE(WallClockProfiler::IsRunning());
+
+  std::ostringstream oss;
+  WallClockProfiler::Dump(oss);
+  std::string dump = oss.str();
+  EXPECT_EQ(std::string::npos, dump.find("Wall clock profile: 0 samples")) << dump;
+  // This is the only thread with Java frames. Collapsed stacks start with the outermost frame,
+  // the one called through JNI.
+  std::string collapsed = WallClockProfiler::DumpCollapsed();
+  std::istringstream lines(collapsed);
+  size_t num_lines = 0u;
+  for (std::string line; std::getline(lines, line); ++num_lines) {
+    EXPECT_EQ(0u, line.find("void java.lang.Thread.sleep(long)")) << collapsed;
+  }
+  EXPECT_NE(0u, num_lines);
+  WallClockProfiler::Reset();
+}
+
+}  // namespace art
@@ -17,4 +17,19 @@
 
 def run(ctx, args):
   # Currently app images aren't unloaded when dex files are unloaded.
+  ctx.echo("Run default")
   ctx.default_run(args, secondary_app_image=False)
+
+  # The dumps of the other modes must be readable by hprof-conv as well.
+  ctx.echo("Run -XX:ParallelHprof=true")
+  ctx.default_run(
+      args, secondary_app_image=False, runtime_option=["-XX:ParallelHprof=true"])
+
+  ctx.echo("Run -XX:ForkHprof=true")
+  ctx.default_run(args, secondary_app_image=False, runtime_option=["-XX:ForkHprof=true"])
+
+  ctx.echo("Run -XX:ParallelHprof=true -XX:HprofOmitPrimitiveArrays=true")
+  ctx.default_run(
+      args,
+      secondary_app_image=False,
+      runtime_option=["-XX:ParallelHprof=true", "-XX:HprofOmitPrimitiveArrays=true"])
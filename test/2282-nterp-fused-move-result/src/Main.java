@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.util.ArrayList;
+import java.util.List;
+
+// Each invoke below is followed by a move-result, move-result-wide or move-result-object, which
+// nterp may execute from the invoke handler. The callees in this file run in nterp themselves,
+// the ones from the boot class path are compiled, which covers the different return paths.
+public class Main {
+    public static void main(String[] args) {
+        // Stay below the JIT threshold, the point is to run the invokes in nterp.
+        for (int i = 0; i < 10; ++i) {
+            testStatic();
+            testRange();
+            testVirtual();
+            testInterface();
+            testBootClassPath();
+            testIgnoredResults();
+        }
+        System.out.println("passed");
+    }
+
+    static int sInt(int a) { return a + 1; }
+    static long sLong(long a) { return a * 3; }
+    static float sFloat(float a) { return a * 0.5f; }
+    static double sDouble(double a) { return a + 0.25; }
+    static Object sObject(Object o) { return o; }
+    static boolean sBoolean(int a) { return a > 0; }
+    static byte sByte(int a) { return (byte) a; }
+    static char sChar(int a) { return (char) a; }
+    static short sShort(int a) { return (short) a; }
+
+    static void testStatic() {
+        assertEquals(43, sInt(42));
+        assertEquals(-1, sInt(-2));
+        assertEquals(0x300000000L, sLong(0x100000000L));
+        assertEquals(-3L, sLong(-1L));
+        assertEquals(1.25f, sFloat(2.5f));
+        assertEquals(-0.5f, sFloat(-1.0f));
+        assertEquals(1.75, sDouble(1.5));
+        assertEquals(Double.MAX_VALUE, sDouble(Double.MAX_VALUE));
+        Object o = new Object();
+        assertSame(o, sObject(o));
+        assertSame(null, sObject(null));
+        assertEquals(true, sBoolean(1));
+        assertEquals(false, sBoolean(-1));
+        assertEquals((byte) -128, sByte(128));
+        assertEquals('\uffff', sChar(-1));
+        assertEquals((short) -1, sShort(0xffff));
+        // The result has to be visible to the instruction after the move-result.
+        int sum = sInt(1) + sInt(2);
+        assertEquals(5, sum);
+        long wide = sLong(1L) + sLong(2L);
+        assertEquals(9L, wide);
+    }
+
+    static long sRange(int a, int b, int c, int d, int e, int f) {
+        return (1L << 40) + a + b + c + d + e + f;
+    }
+    static double sRangeDouble(double a, double b, double c, long d) {
+        return a + b + c + d;
+    }
+    static Object sRangeObject(Object a, Object b, Object c, Object d, Object e, Object f) {
+        return f;
+    }
+
+    static void testRange() {
+        assertEquals((1L << 40) + 21, sRange(1, 2, 3, 4, 5, 6));
+        assertEquals(10.5, sRangeDouble(1.0, 2.5, 3.0, 4L));
+        Object f = "f";
+        assertSame(f, sRangeObject(null, null, null, null, null, f));
+    }
+
+    static void testVirtual() {
+        Base base = new Base();
+        Base derived = new Derived();
+        assertEquals(1, base.getInt());
+        assertEquals(2, derived.getInt());
+        assertEquals(1L << 33, base.getLong());
+        assertEquals(1L << 34, derived.getLong());
+        assertEquals(0.5f, derived.getFloat());
+        assertEquals(-0.125, derived.getDouble());
+        assertSame(derived, derived.getThis());
+        // invoke-direct and invoke-super.
+        assertEquals(3, ((Derived) derived).getPrivateSum());
+        assertEquals(7L, base.getRange(1, 1, 1, 1, 1, 2));
+    }
+
+    static void testInterface() {
+        Itf itf = new ItfImpl();
+        assertEquals(6, itf.get(3));
+        assertEquals(-8L, itf.getWide(-4L));
+        assertEquals(0.75, itf.getDouble());
+        assertSame(itf, itf.getObject());
+    }
+
+    static void testBootClassPath() {
+        assertEquals(7, Math.max(3, 7));
+        assertEquals(Long.MIN_VALUE, Long.reverse(1L));
+        assertEquals(1.0f, Float.intBitsToFloat(0x3f800000));
+        assertEquals(2.0, Double.longBitsToDouble(0x4000000000000000L));
+        assertEquals(3, "abc".length());
+        assertEquals('b', "abc".charAt(1));
+        Integer boxed = Integer.valueOf(5);
+        assertEquals(5, boxed.intValue());
+        List<Integer> list = new ArrayList<>();
+        assertEquals(true, list.add(boxed));
+        assertEquals(1, list.size());
+        assertSame(boxed, list.get(0));
+        assertEquals("0x1F", String.format("0x%X", 31, 0, 0, 0, 0, 0));
+    }
+
+    static int counter;
+    static int sCount() { return ++counter; }
+
+    static void testIgnoredResults() {
+        // No move-result follows these invokes.
+        int before = counter;
+        sCount();
+        sLong(1L);
+        sObject(null);
+        assertEquals(before + 1, counter);
+        assertEquals(before + 2, sCount());
+    }
+
+    static void assertEquals(int expected, int actual) {
+        if (expected != actual) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertEquals(long expected, long actual) {
+        if (expected != actual) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertEquals(float expected, float actual) {
+        if (Float.floatToRawIntBits(expected) != Float.floatToRawIntBits(actual)) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertEquals(double expected, double actual) {
+        if (Double.doubleToRawLongBits(expected) != Double.doubleToRawLongBits(actual)) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertEquals(boolean expected, boolean actual) {
+        if (expected != actual) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertEquals(Object expected, Object actual) {
+        if (!expected.equals(actual)) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+    static void assertSame(Object expected, Object actual) {
+        if (expected != actual) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+}
+
+class Base {
+    int getInt() { return 1; }
+    long getLong() { return 1L << 33; }
+    float getFloat() { return 0.25f; }
+    double getDouble() { return 0.125; }
+    Base getThis() { return this; }
+    long getRange(int a, int b, int c, int d, int e, int f) { return a + b + c + d + e + f; }
+}
+
+class Derived extends Base {
+    @Override int getInt() { return 2; }
+    @Override long getLong() { return 1L << 34; }
+    @Override float getFloat() { return 0.5f; }
+    @Override double getDouble() { return -super.getDouble(); }
+
+    private int getPrivate() { return 1; }
+    int getPrivateSum() { return getPrivate() + super.getInt() + getPrivate(); }
+}
+
+interface Itf {
+    int get(int a);
+    long getWide(long a);
+    double getDouble();
+    Object getObject();
+}
+
+class ItfImpl implements Itf {
+    public int get(int a) { return a * 2; }
+    public long getWide(long a) { return a * 2; }
+    public double getDouble() { return 0.75; }
+    public Object getObject() { return this; }
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// `Itf` has more methods than the IMT has entries (43), so some of its methods share an IMT
+// slot and calls to them find a conflict method in the receiver's IMT. nterp resolves such
+// calls with an inline cache keyed by the call site, which must be checked against the
+// receiver class: `callMonomorphic` only ever sees `A`, `callMegamorphic` sees all classes.
+public class Main {
+    public static void main(String[] args) {
+        Itf[] receivers = { new A(), new B(), new C(), new D() };
+        int[] bases = { 0, 100, 200, 0 };
+        // Stay below the JIT threshold, the point is to run the invokes in nterp.
+        for (int i = 0; i < 10; ++i) {
+            callMonomorphic(receivers[0], bases[0]);
+            for (int j = 0; j < receivers.length; ++j) {
+                callMegamorphic(receivers[j], bases[j]);
+            }
+            // Alternate the receiver class on every call of the same site.
+            for (int j = 0; j < receivers.length; ++j) {
+                callMegamorphic(receivers[(i + j) % receivers.length],
+                                bases[(i + j) % receivers.length]);
+            }
+        }
+        System.out.println("passed");
+    }
+
+    static void callMonomorphic(Itf o, int base) {
+        expectEquals(base + 0, o.m0());
+        expectEquals(base + 1, o.m1());
+        expectEquals(base + 2, o.m2());
+        expectEquals(base + 3, o.m3());
+        expectEquals(base + 4, o.m4());
+        expectEquals(base + 5, o.m5());
+        expectEquals(base + 6, o.m6());
+        expectEquals(base + 7, o.m7());
+        expectEquals(base + 8, o.m8());
+        expectEquals(base + 9, o.m9());
+        expectEquals(base + 10, o.m10());
+        expectEquals(base + 11, o.m11());
+        expectEquals(base + 12, o.m12());
+        expectEquals(base + 13, o.m13());
+        expectEquals(base + 14, o.m14());
+        expectEquals(base + 15, o.m15());
+        expectEquals(base + 16, o.m16());
+        expectEquals(base + 17, o.m17());
+        expectEquals(base + 18, o.m18());
+        expectEquals(base + 19, o.m19());
+        expectEquals(base + 20, o.m20());
+        expectEquals(base + 21, o.m21());
+        expectEquals(base + 22, o.m22());
+        expectEquals(base + 23, o.m23());
+        expectEquals(base + 24, o.m24());
+        expectEquals(base + 25, o.m25());
+        expectEquals(base + 26, o.m26());
+        expectEquals(base + 27, o.m27());
+        expectEquals(base + 28, o.m28());
+        expectEquals(base + 29, o.m29());
+        expectEquals(base + 30, o.m30());
+        expectEquals(base + 31, o.m31());
+        expectEquals(base + 32, o.m32());
+        expectEquals(base + 33, o.m33());
+        expectEquals(base + 34, o.m34());
+        expectEquals(base + 35, o.m35());
+        expectEquals(base + 36, o.m36());
+        expectEquals(base + 37, o.m37());
+        expectEquals(base + 38, o.m38());
+        expectEquals(base + 39, o.m39());
+        expectEquals(base + 40, o.m40());
+        expectEquals(base + 41, o.m41());
+        expectEquals(base + 42, o.m42());
+        expectEquals(base + 43, o.m43());
+        expectEquals(base + 44, o.m44());
+        expectEquals(base + 45, o.m45());
+        expectEquals(base + 46, o.m46());
+        expectEquals(base + 47, o.m47());
+        expectEquals(base + 48, o.m48());
+        expectEquals(base + 49, o.m49());
+    }
+
+    static void callMegamorphic(Itf o, int base) {
+        expectEquals(base + 0, o.m0());
+        expectEquals(base + 1, o.m1());
+        expectEquals(base + 2, o.m2());
+        expectEquals(base + 3, o.m3());
+        expectEquals(base + 4, o.m4());
+        expectEquals(base + 5, o.m5());
+        expectEquals(base + 6, o.m6());
+        expectEquals(base + 7, o.m7());
+        expectEquals(base + 8, o.m8());
+        expectEquals(base + 9, o.m9());
+        expectEquals(base + 10, o.m10());
+        expectEquals(base + 11, o.m11());
+        expectEquals(base + 12, o.m12());
+        expectEquals(base + 13, o.m13());
+        expectEquals(base + 14, o.m14());
+        expectEquals(base + 15, o.m15());
+        expectEquals(base + 16, o.m16());
+        expectEquals(base + 17, o.m17());
+        expectEquals(base + 18, o.m18());
+        expectEquals(base + 19, o.m19());
+        expectEquals(base + 20, o.m20());
+        expectEquals(base + 21, o.m21());
+        expectEquals(base + 22, o.m22());
+        expectEquals(base + 23, o.m23());
+        expectEquals(base + 24, o.m24());
+        expectEquals(base + 25, o.m25());
+        expectEquals(base + 26, o.m26());
+        expectEquals(base + 27, o.m27());
+        expectEquals(base + 28, o.m28());
+        expectEquals(base + 29, o.m29());
+        expectEquals(base + 30, o.m30());
+        expectEquals(base + 31, o.m31());
+        expectEquals(base + 32, o.m32());
+        expectEquals(base + 33, o.m33());
+        expectEquals(base + 34, o.m34());
+        expectEquals(base + 35, o.m35());
+        expectEquals(base + 36, o.m36());
+        expectEquals(base + 37, o.m37());
+        expectEquals(base + 38, o.m38());
+        expectEquals(base + 39, o.m39());
+        expectEquals(base + 40, o.m40());
+        expectEquals(base + 41, o.m41());
+        expectEquals(base + 42, o.m42());
+        expectEquals(base + 43, o.m43());
+        expectEquals(base + 44, o.m44());
+        expectEquals(base + 45, o.m45());
+        expectEquals(base + 46, o.m46());
+        expectEquals(base + 47, o.m47());
+        expectEquals(base + 48, o.m48());
+        expectEquals(base + 49, o.m49());
+    }
+
+    static void expectEquals(int expected, int actual) {
+        if (expected != actual) {
+            throw new Error("Expected " + expected + ", got " + actual);
+        }
+    }
+}
+
+interface Itf {
+    int m0();
+    int m1();
+    int m2();
+    int m3();
+    int m4();
+    int m5();
+    int m6();
+    int m7();
+    int m8();
+    int m9();
+    int m10();
+    int m11();
+    int m12();
+    int m13();
+    int m14();
+    int m15();
+    int m16();
+    int m17();
+    int m18();
+    int m19();
+    int m20();
+    int m21();
+    int m22();
+    int m23();
+    int m24();
+    int m25();
+    int m26();
+    int m27();
+    int m28();
+    int m29();
+    int m30();
+    int m31();
+    int m32();
+    int m33();
+    int m34();
+    int m35();
+    int m36();
+    int m37();
+    int m38();
+    int m39();
+    int m40();
+    int m41();
+    int m42();
+    int m43();
+    int m44();
+    int m45();
+    int m46();
+    int m47();
+    int m48();
+    int m49();
+}
+
+class A implements Itf {
+    public int m0() { return 0; }
+    public int m1() { return 1; }
+    public int m2() { return 2; }
+    public int m3() { return 3; }
+    public int m4() { return 4; }
+    public int m5() { return 5; }
+    public int m6() { return 6; }
+    public int m7() { return 7; }
+    public int m8() { return 8; }
+    public int m9() { return 9; }
+    public int m10() { return 10; }
+    public int m11() { return 11; }
+    public int m12() { return 12; }
+    public int m13() { return 13; }
+    public int m14() { return 14; }
+    public int m15() { return 15; }
+    public int m16() { return 16; }
+    public int m17() { return 17; }
+    public int m18() { return 18; }
+    public int m19() { return 19; }
+    public int m20() { return 20; }
+    public int m21() { return 21; }
+    public int m22() { return 22; }
+    public int m23() { return 23; }
+    public int m24() { return 24; }
+    public int m25() { return 25; }
+    public int m26() { return 26; }
+    public int m27() { return 27; }
+    public int m28() { return 28; }
+    public int m29() { return 29; }
+    public int m30() { return 30; }
+    public int m31() { return 31; }
+    public int m32() { return 32; }
+    public int m33() { return 33; }
+    public int m34() { return 34; }
+    public int m35() { return 35; }
+    public int m36() { return 36; }
+    public int m37() { return 37; }
+    public int m38() { return 38; }
+    public int m39() { return 39; }
+    public int m40() { return 40; }
+    public int m41() { return 41; }
+    public int m42() { return 42; }
+    public int m43() { return 43; }
+    public int m44() { return 44; }
+    public int m45() { return 45; }
+    public int m46() { return 46; }
+    public int m47() { return 47; }
+    public int m48() { return 48; }
+    public int m49() { return 49; }
+}
+
+class B implements Itf {
+    public int m0() { return 100; }
+    public int m1() { return 101; }
+    public int m2() { return 102; }
+    public int m3() { return 103; }
+    public int m4() { return 104; }
+    public int m5() { return 105; }
+    public int m6() { return 106; }
+    public int m7() { return 107; }
+    public int m8() { return 108; }
+    public int m9() { return 109; }
+    public int m10() { return 110; }
+    public int m11() { return 111; }
+    public int m12() { return 112; }
+    public int m13() { return 113; }
+    public int m14() { return 114; }
+    public int m15() { return 115; }
+    public int m16() { return 116; }
+    public int m17() { return 117; }
+    public int m18() { return 118; }
+    public int m19() { return 119; }
+    public int m20() { return 120; }
+    public int m21() { return 121; }
+    public int m22() { return 122; }
+    public int m23() { return 123; }
+    public int m24() { return 124; }
+    public int m25() { return 125; }
+    public int m26() { return 126; }
+    public int m27() { return 127; }
+    public int m28() { return 128; }
+    public int m29() { return 129; }
+    public int m30() { return 130; }
+    public int m31() { return 131; }
+    public int m32() { return 132; }
+    public int m33() { return 133; }
+    public int m34() { return 134; }
+    public int m35() { return 135; }
+    public int m36() { return 136; }
+    public int m37() { return 137; }
+    public int m38() { return 138; }
+    public int m39() { return 139; }
+    public int m40() { return 140; }
+    public int m41() { return 141; }
+    public int m42() { return 142; }
+    public int m43() { return 143; }
+    public int m44() { return 144; }
+    public int m45() { return 145; }
+    public int m46() { return 146; }
+    public int m47() { return 147; }
+    public int m48() { return 148; }
+    public int m49() { return 149; }
+}
+
+class C extends A {
+    public int m0() { return 200; }
+    public int m1() { return 201; }
+    public int m2() { return 202; }
+    public int m3() { return 203; }
+    public int m4() { return 204; }
+    public int m5() { return 205; }
+    public int m6() { return 206; }
+    public int m7() { return 207; }
+    public int m8() { return 208; }
+    public int m9() { return 209; }
+    public int m10() { return 210; }
+    public int m11() { return 211; }
+    public int m12() { return 212; }
+    public int m13() { return 213; }
+    public int m14() { return 214; }
+    public int m15() { return 215; }
+    public int m16() { return 216; }
+    public int m17() { return 217; }
+    public int m18() { return 218; }
+    public int m19() { return 219; }
+    public int m20() { return 220; }
+    public int m21() { return 221; }
+    public int m22() { return 222; }
+    public int m23() { return 223; }
+    public int m24() { return 224; }
+    public int m25() { return 225; }
+    public int m26() { return 226; }
+    public int m27() { return 227; }
+    public int m28() { return 228; }
+    public int m29() { return 229; }
+    public int m30() { return 230; }
+    public int m31() { return 231; }
+    public int m32() { return 232; }
+    public int m33() { return 233; }
+    public int m34() { return 234; }
+    public int m35() { return 235; }
+    public int m36() { return 236; }
+    public int m37() { return 237; }
+    public int m38() { return 238; }
+    public int m39() { return 239; }
+    public int m40() { return 240; }
+    public int m41() { return 241; }
+    public int m42() { return 242; }
+    public int m43() { return 243; }
+    public int m44() { return 244; }
+    public int m45() { return 245; }
+    public int m46() { return 246; }
+    public int m47() { return 247; }
+    public int m48() { return 248; }
+    public int m49() { return 249; }
+}
+
+// Same implementations as `A`, but a different receiver class.
+class D extends A {}
@@ -618,5 +618,85 @@ void CodeMetrics::Dump(std::ostream& os, uint64_t total_size) const {
   os << "Low arg savings: " << Percent(low_arg_total * 2, total_size) << "\n";
 }
 
+bool OpcodePairs::IsFusedInNterp(Instruction::Code first, Instruction::Code second) {
+  if (second != Instruction::MOVE_RESULT &&
+      second != Instruction::MOVE_RESULT_WIDE &&
+      second != Instruction::MOVE_RESULT_OBJECT) {
+    return false;
+  }
+  switch (first) {
+    case Instruction::INVOKE_VIRTUAL:
+    case Instruction::INVOKE_SUPER:
+    case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_STATIC:
+    case Instruction::INVOKE_INTERFACE:
+    case Instruction::INVOKE_VIRTUAL_RANGE:
+    case Instruction::INVOKE_SUPER_RANGE:
+    case Instruction::INVOKE_DIRECT_RANGE:
+    case Instruction::INVOKE_STATIC_RANGE:
+    case Instruction::INVOKE_INTERFACE_RANGE:
+    case Instruction::INVOKE_POLYMORPHIC:
+    case Instruction::INVOKE_POLYMORPHIC_RANGE:
+    case Instruction::INVOKE_CUSTOM:
+    case Instruction::INVOKE_CUSTOM_RANGE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void OpcodePairs::ProcessDexFile(const DexFile& dex_file) {
+  for (ClassAccessor accessor : dex_file.GetClasses()) {
+    for (const ClassAccessor::Method& method : accessor.GetMethods()) {
+      bool has_previous = false;
+      Instruction::Code previous = Instruction::NOP;
+      for (const DexInstructionPcPair& inst : method.GetInstructions()) {
+        const Instruction::Code opcode = inst->Opcode();
+        if (opcode == Instruction::NOP && inst->SizeInCodeUnits() != 1u) {
+          // Payload of a switch or fill-array-data, never executed.
+          has_previous = false;
+          continue;
+        }
+        ++total_instructions_;
+        if (has_previous) {
+          ++total_pairs_;
+          ++pair_counts_[static_cast<size_t>(previous) * kNumOpcodes + opcode];
+          if (IsFusedInNterp(previous, opcode)) {
+            ++fused_pairs_;
+          }
+        }
+        previous = opcode;
+        has_previous = true;
+      }
+    }
+  }
+}
+
+void OpcodePairs::Dump(std::ostream& os, [[maybe_unused]] uint64_t total_size) const {
+  std::vector<std::pair<uint64_t, size_t>> sorted_pairs;
+  for (size_t i = 0; i < pair_counts_.size(); ++i) {
+    if (pair_counts_[i] != 0u) {
+      sorted_pairs.emplace_back(pair_counts_[i], i);
+    }
+  }
+  std::sort(sorted_pairs.rbegin(), sorted_pairs.rend());
+  os << "Opcode pairs (" << sorted_pairs.size() << " distinct)\n";
+  const size_t num_dumped = (verbose_level_ >= VerboseLevel::kEverything)
+      ? sorted_pairs.size()
+      : std::min(sorted_pairs.size(), kMaxDumpedPairs);
+  for (size_t i = 0; i < num_dumped; ++i) {
+    const Instruction::Code first = static_cast<Instruction::Code>(sorted_pairs[i].second /
+                                                                   kNumOpcodes);
+    const Instruction::Code second = static_cast<Instruction::Code>(sorted_pairs[i].second %
+                                                                    kNumOpcodes);
+    os << "  " << Instruction::Name(first) << " + " << Instruction::Name(second) << ": "
+       << Percent(sorted_pairs[i].first, total_pairs_)
+       << (IsFusedInNterp(first, second) ? " (fused on arm64)" : "") << "\n";
+  }
+  os << "Total instructions: " << total_instructions_ << "\n";
+  os << "Total pairs: " << total_pairs_ << "\n";
+  os << "Static pairs fused by arm64 nterp: " << Percent(fused_pairs_, total_pairs_) << "\n";
+}
+
 }  // namespace dexanalyze
 }  // namespace art
@@ -172,6 +172,29 @@ class CodeMetrics : public Experiment {
   uint64_t move_result_savings_ = 0u;
 };
 
+// Count pairs of consecutive instructions, to select candidates for fused interpreter handlers
+// (superinstructions), and how many of them the arm64 nterp fuses. Counts are static, each
+// instruction of each method is counted once, so they do not measure executed dispatches.
+class OpcodePairs : public Experiment {
+ public:
+  void ProcessDexFile(const DexFile& dex_file) override;
+
+  void Dump(std::ostream& os, uint64_t total_size) const override;
+
+  // Whether arm64 nterp executes `second` directly from the handler of `first`. Other
+  // architectures do not fuse any pair.
+  static bool IsFusedInNterp(Instruction::Code first, Instruction::Code second);
+
+ private:
+  static constexpr size_t kNumOpcodes = 256u;
+  static constexpr size_t kMaxDumpedPairs = 32u;
+
+  std::vector<uint64_t> pair_counts_ = std::vector<uint64_t>(kNumOpcodes * kNumOpcodes, 0u);
+  uint64_t total_instructions_ = 0u;
+  uint64_t total_pairs_ = 0u;
+  uint64_t fused_pairs_ = 0u;
+};
+
 }  // namespace dexanalyze
 }  // namespace art
 
@@ -52,6 +52,25 @@ TEST_F(DexAnalyzeTest, TestAnalizeCoreDex) {
   DexAnalyzeExec({ "-a", GetLibCoreDexFileNames()[0] }, /*expect_success=*/ true);
 }
 
+TEST_F(DexAnalyzeTest, TestOpcodePairs) {
+  DexAnalyzeExec({ "-opcode-pairs", GetLibCoreDexFileNames()[0] }, /*expect_success=*/ true);
+}
+
+TEST_F(DexAnalyzeTest, TestOpcodePairsCounts) {
+  // The results are logged, which only goes to the captured stderr on host.
+  TEST_DISABLED_FOR_TARGET();
+  std::string output;
+  ForkAndExecResult res = ForkAndExec(
+      { GetDexAnalyzePath(), "-opcode-pairs", GetTestDexFileName("MultiDex") },
+      []() { return true; },
+      &output);
+  ASSERT_TRUE(res.StandardSuccess()) << output;
+  // `Main.main()` calls `Second.getSecond()` and uses the result.
+  EXPECT_NE(output.find("invoke-virtual + move-result-object: "), std::string::npos) << output;
+  EXPECT_NE(output.find(" (fused on arm64)"), std::string::npos) << output;
+  EXPECT_EQ(output.find("Static pairs fused by arm64 nterp: 0"), std::string::npos) << output;
+}
+
 TEST_F(DexAnalyzeTest, TestInvalidArg) {
   DexAnalyzeExec({ "-invalid-option" }, /*expect_success=*/ false);
 }